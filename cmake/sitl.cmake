@@ -13,8 +13,18 @@ main_sources(SITL_COMMON_SRC_EXCLUDES
 
 main_sources(SITL_SRC
     config/config_streamer_file.c
+    drivers/flash_file.c
+    drivers/flash_file.h
+    drivers/sdcard/sdcard.c
+    drivers/sdcard/sdcard_file.c
+    drivers/sdcard/sdcard_file.h
+    drivers/sdcard/sdcard_standard.c
     drivers/serial_tcp.c
     drivers/serial_tcp.h
+    io/asyncfatfs/asyncfatfs.c
+    io/asyncfatfs/fat_standard.c
+    target/SITL/sim/builtin.c
+    target/SITL/sim/builtin.h
     target/SITL/sim/realFlight.c
     target/SITL/sim/realFlight.h
     target/SITL/sim/simHelper.c
@@ -68,6 +68,8 @@
 
 #include "navigation/navigation.h"
 
+#include "programming/logic_condition.h"
+
 #include "rx/rx.h"
 #include "rx/msp_override.h"
 
@@ -99,7 +101,7 @@
 #define BLACKBOX_INVERTED_CARD_DETECTION 0
 #endif
 
-PG_REGISTER_WITH_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 2);
+PG_REGISTER_WITH_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 5);
 
 PG_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig,
     .device = DEFAULT_BLACKBOX_DEVICE,
@@ -109,6 +111,27 @@ PG_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig,
     .includeFlags = BLACKBOX_FEATURE_NAV_PID | BLACKBOX_FEATURE_NAV_POS |
         BLACKBOX_FEATURE_MAG | BLACKBOX_FEATURE_ACC | BLACKBOX_FEATURE_ATTITUDE |
         BLACKBOX_FEATURE_RC_DATA | BLACKBOX_FEATURE_RC_COMMAND | BLACKBOX_FEATURE_MOTORS,
+    .groupRateDiv = {
+        [BLACKBOX_RATE_GROUP_PID] = SETTING_BLACKBOX_RATE_DIV_PID_DEFAULT,
+        [BLACKBOX_RATE_GROUP_GYRO] = SETTING_BLACKBOX_RATE_DIV_GYRO_DEFAULT,
+        [BLACKBOX_RATE_GROUP_ACC] = SETTING_BLACKBOX_RATE_DIV_ACC_DEFAULT,
+        [BLACKBOX_RATE_GROUP_ATTITUDE] = SETTING_BLACKBOX_RATE_DIV_ATTITUDE_DEFAULT,
+        [BLACKBOX_RATE_GROUP_RC] = SETTING_BLACKBOX_RATE_DIV_RC_DEFAULT,
+        [BLACKBOX_RATE_GROUP_MOTORS] = SETTING_BLACKBOX_RATE_DIV_MOTORS_DEFAULT,
+        [BLACKBOX_RATE_GROUP_NAV] = SETTING_BLACKBOX_RATE_DIV_NAV_DEFAULT,
+        [BLACKBOX_RATE_GROUP_SENSORS] = SETTING_BLACKBOX_RATE_DIV_SENSORS_DEFAULT,
+        [BLACKBOX_RATE_GROUP_DEBUG] = SETTING_BLACKBOX_RATE_DIV_DEBUG_DEFAULT,
+    },
+    .encoding = SETTING_BLACKBOX_ENCODING_DEFAULT,
+#ifdef USE_BLACKBOX_RING_BUFFER
+    .mode = SETTING_BLACKBOX_MODE_DEFAULT,
+    .pretriggerMs = SETTING_BLACKBOX_PRETRIGGER_MS_DEFAULT,
+    .posttriggerMs = SETTING_BLACKBOX_POSTTRIGGER_MS_DEFAULT,
+    .triggerFailsafe = SETTING_BLACKBOX_TRIGGER_FAILSAFE_DEFAULT,
+    .triggerSaturation = SETTING_BLACKBOX_TRIGGER_SATURATION_DEFAULT,
+    .triggerVibration = SETTING_BLACKBOX_TRIGGER_VIBRATION_DEFAULT,
+    .triggerLogicCondition = SETTING_BLACKBOX_TRIGGER_LOGIC_CONDITION_DEFAULT,
+#endif
 );
 
 void blackboxIncludeFlagSet(uint32_t mask)
@@ -137,8 +160,11 @@ static const int32_t blackboxSInterval = 4096;
 #define SIGNED FLIGHT_LOG_FIELD_SIGNED
 
 static const char blackboxHeader[] =
-    "H Product:Blackbox flight data recorder by Nicholas Sherlock\n"
-    "H Data version:2\n";
+    "H Product:Blackbox flight data recorder by Nicholas Sherlock\n";
+
+// Logs using the packed encoding can't be read by decoders which only know data version 2
+#define BLACKBOX_DATA_VERSION           2
+#define BLACKBOX_DATA_VERSION_PACKED    3
 
 static const char* const blackboxFieldHeaderNames[] = {
     "name",
@@ -521,6 +547,130 @@ typedef struct blackboxMainState_s {
     int16_t navSurface;
 } blackboxMainState_t;
 
+/*
+ * The main frame fields of each rate group, as ranges of blackboxMainState_t members. Between the frames in which
+ * a group is due, its fields repeat the previous frame's values. The standard encoding still writes their zero
+ * deltas, which needs no support from the decoder. The packed encoding leaves them out of P-frames altogether.
+ */
+typedef struct blackboxRateGroupRange_s {
+    uint8_t group;
+    uint16_t offset;
+    uint16_t size;
+} blackboxRateGroupRange_t;
+
+#define RATE_GROUP_RANGE(group, first, last) { CONCAT(BLACKBOX_RATE_GROUP_, group), offsetof(blackboxMainState_t, first), \
+    offsetof(blackboxMainState_t, last) + sizeof(((blackboxMainState_t *)0)->last) - offsetof(blackboxMainState_t, first) }
+
+static const blackboxRateGroupRange_t blackboxRateGroupRanges[] = {
+    RATE_GROUP_RANGE(PID,       axisPID_P,      axisPID_Setpoint),
+    RATE_GROUP_RANGE(NAV,       mcPosAxisP,     fwPosPIDOutput),
+    RATE_GROUP_RANGE(RC,        rcData,         rcCommand),
+    RATE_GROUP_RANGE(GYRO,      gyroADC,        gyroPeaksYaw),
+    RATE_GROUP_RANGE(ACC,       accADC,         accADC),
+    RATE_GROUP_RANGE(ATTITUDE,  attitude,       attitude),
+    RATE_GROUP_RANGE(DEBUG,     debug,          debug),
+    RATE_GROUP_RANGE(MOTORS,    motor,          servo),
+    RATE_GROUP_RANGE(SENSORS,   vbat,           rssi),
+    RATE_GROUP_RANGE(NAV,       navState,       navSurface),
+};
+
+/*
+ * The fields of a P-frame in the order they are written, as runs of consecutive blackboxMainState_t members of one
+ * type. Predictor, encoding and condition of each run must match its fields in blackboxMainFields[]. Both encodings
+ * walk this table, writeInterframe() with the encoding given here and writeInterframePacked() in packed blocks.
+ */
+typedef enum {
+    BLACKBOX_FIELD_TYPE_S16,
+    BLACKBOX_FIELD_TYPE_U16,
+    BLACKBOX_FIELD_TYPE_S32,
+    BLACKBOX_FIELD_TYPE_U32,
+} blackboxFieldType_e;
+
+#define BLACKBOX_FIELD_COUNT_MOTORS     0                           // One field per motor in use
+#define BLACKBOX_RATE_GROUP_NONE        BLACKBOX_RATE_GROUP_COUNT   // Fields which are never held
+
+typedef struct blackboxInterframeFields_s {
+    uint16_t offset;
+    uint8_t type;
+    uint8_t count;
+    uint8_t predict;
+    uint8_t encode;
+    uint8_t condition;
+    uint8_t group;
+} blackboxInterframeFields_t;
+
+#define INTERFRAME_FIELDS(member, type, count, predict, encode, condition, group) { offsetof(blackboxMainState_t, member), \
+    CONCAT(BLACKBOX_FIELD_TYPE_, type), count, PREDICT(predict), ENCODING(encode), CONDITION(condition), CONCAT(BLACKBOX_RATE_GROUP_, group) }
+
+static const blackboxInterframeFields_t blackboxInterframeFields[] = {
+    // Since the difference between successive times will be nearly constant (looptime spacing), predict a straight line
+    INTERFRAME_FIELDS(time,               U32, 1,                           STRAIGHT_LINE, SIGNED_VB, ALWAYS,           NONE),
+    INTERFRAME_FIELDS(axisPID_Setpoint,   S32, XYZ_AXIS_COUNT,              PREVIOUS,      SIGNED_VB, ALWAYS,           PID),
+    INTERFRAME_FIELDS(axisPID_P,          S32, XYZ_AXIS_COUNT,              PREVIOUS,      SIGNED_VB, ALWAYS,           PID),
+    // The PID I field changes very slowly, most of the time +-2, so use an encoding that can pack all three fields into one byte
+    INTERFRAME_FIELDS(axisPID_I,          S32, XYZ_AXIS_COUNT,              PREVIOUS,      TAG2_3S32, ALWAYS,           PID),
+    // The PID D term is frequently zero for yaw, so don't bother recording D results when PID D terms are zero
+    INTERFRAME_FIELDS(axisPID_D[0],       S32, 1,                           PREVIOUS,      SIGNED_VB, NONZERO_PID_D_0,  PID),
+    INTERFRAME_FIELDS(axisPID_D[1],       S32, 1,                           PREVIOUS,      SIGNED_VB, NONZERO_PID_D_1,  PID),
+    INTERFRAME_FIELDS(axisPID_D[2],       S32, 1,                           PREVIOUS,      SIGNED_VB, NONZERO_PID_D_2,  PID),
+    INTERFRAME_FIELDS(axisPID_F,          S32, XYZ_AXIS_COUNT,              PREVIOUS,      SIGNED_VB, ALWAYS,           PID),
+
+    INTERFRAME_FIELDS(fwAltPID,           S32, 3,                           PREVIOUS,      SIGNED_VB, FIXED_WING_NAV,   NAV),
+    INTERFRAME_FIELDS(fwAltPIDOutput,     S32, 1,                           PREVIOUS,      SIGNED_VB, FIXED_WING_NAV,   NAV),
+    INTERFRAME_FIELDS(fwPosPID,           S32, 3,                           PREVIOUS,      SIGNED_VB, FIXED_WING_NAV,   NAV),
+    INTERFRAME_FIELDS(fwPosPIDOutput,     S32, 1,                           PREVIOUS,      SIGNED_VB, FIXED_WING_NAV,   NAV),
+
+    INTERFRAME_FIELDS(mcPosAxisP,         S32, XYZ_AXIS_COUNT,              PREVIOUS,      SIGNED_VB, MC_NAV,           NAV),
+    INTERFRAME_FIELDS(mcVelAxisPID,       S32, 4 * XYZ_AXIS_COUNT,          PREVIOUS,      SIGNED_VB, MC_NAV,           NAV),
+    INTERFRAME_FIELDS(mcVelAxisOutput,    S32, XYZ_AXIS_COUNT,              PREVIOUS,      SIGNED_VB, MC_NAV,           NAV),
+    INTERFRAME_FIELDS(mcSurfacePID,       S32, 3,                           PREVIOUS,      SIGNED_VB, MC_NAV,           NAV),
+    INTERFRAME_FIELDS(mcSurfacePIDOutput, S32, 1,                           PREVIOUS,      SIGNED_VB, MC_NAV,           NAV),
+
+    // RC tends to stay the same or fairly small for many frames at a time, so use an encoding that can pack multiple values per byte
+    INTERFRAME_FIELDS(rcData,             S16, 4,                           PREVIOUS,      TAG8_4S16, RC_DATA,          RC),
+    INTERFRAME_FIELDS(rcCommand,          S16, 4,                           PREVIOUS,      TAG8_4S16, RC_COMMAND,       RC),
+
+    // Sensors that are updated periodically, so deltas are normally zero
+    INTERFRAME_FIELDS(vbat,               U16, 1,                           PREVIOUS,      TAG8_8SVB, VBAT,             SENSORS),
+    INTERFRAME_FIELDS(amperage,           S16, 1,                           PREVIOUS,      TAG8_8SVB, AMPERAGE,         SENSORS),
+#ifdef USE_MAG
+    INTERFRAME_FIELDS(magADC,             S16, XYZ_AXIS_COUNT,              PREVIOUS,      TAG8_8SVB, MAG,              SENSORS),
+#endif
+#ifdef USE_BARO
+    INTERFRAME_FIELDS(BaroAlt,            S32, 1,                           PREVIOUS,      TAG8_8SVB, BARO,             SENSORS),
+#endif
+#ifdef USE_PITOT
+    INTERFRAME_FIELDS(airSpeed,           S32, 1,                           PREVIOUS,      TAG8_8SVB, PITOT,            SENSORS),
+#endif
+#ifdef USE_RANGEFINDER
+    INTERFRAME_FIELDS(surfaceRaw,         S32, 1,                           PREVIOUS,      TAG8_8SVB, SURFACE,          SENSORS),
+#endif
+    INTERFRAME_FIELDS(rssi,               U16, 1,                           PREVIOUS,      TAG8_8SVB, RSSI,             SENSORS),
+
+    // Since gyros, accs and motors are noisy, base their predictions on the average of the history
+    INTERFRAME_FIELDS(gyroADC,            S16, XYZ_AXIS_COUNT,              AVERAGE_2,     SIGNED_VB, ALWAYS,           GYRO),
+    INTERFRAME_FIELDS(gyroRaw,            S16, XYZ_AXIS_COUNT,              AVERAGE_2,     SIGNED_VB, GYRO_RAW,         GYRO),
+    INTERFRAME_FIELDS(gyroPeaksRoll,      S16, DYN_NOTCH_PEAK_COUNT,        AVERAGE_2,     SIGNED_VB, GYRO_PEAKS_ROLL,  GYRO),
+    INTERFRAME_FIELDS(gyroPeaksPitch,     S16, DYN_NOTCH_PEAK_COUNT,        AVERAGE_2,     SIGNED_VB, GYRO_PEAKS_PITCH, GYRO),
+    INTERFRAME_FIELDS(gyroPeaksYaw,       S16, DYN_NOTCH_PEAK_COUNT,        AVERAGE_2,     SIGNED_VB, GYRO_PEAKS_YAW,   GYRO),
+    INTERFRAME_FIELDS(accADC,             S16, XYZ_AXIS_COUNT,              AVERAGE_2,     SIGNED_VB, ACC,              ACC),
+    INTERFRAME_FIELDS(attitude,           S16, XYZ_AXIS_COUNT,              AVERAGE_2,     SIGNED_VB, ATTITUDE,         ATTITUDE),
+    INTERFRAME_FIELDS(debug,              S32, DEBUG32_VALUE_COUNT,         AVERAGE_2,     SIGNED_VB, DEBUG,            DEBUG),
+    INTERFRAME_FIELDS(motor,              S16, BLACKBOX_FIELD_COUNT_MOTORS, AVERAGE_2,     SIGNED_VB, MOTORS,           MOTORS),
+    INTERFRAME_FIELDS(servo,              S16, MAX_SUPPORTED_SERVOS,        AVERAGE_2,     SIGNED_VB, SERVOS,           MOTORS),
+
+    INTERFRAME_FIELDS(navState,           S16, 1,                           PREVIOUS,      SIGNED_VB, ALWAYS,           NAV),
+    INTERFRAME_FIELDS(navFlags,           U16, 1,                           PREVIOUS,      SIGNED_VB, ALWAYS,           NAV),
+    INTERFRAME_FIELDS(navEPH,             U16, 1,                           PREVIOUS,      SIGNED_VB, NAV_POS,          NAV),
+    INTERFRAME_FIELDS(navEPV,             U16, 1,                           PREVIOUS,      SIGNED_VB, NAV_POS,          NAV),
+    INTERFRAME_FIELDS(navPos,             S32, XYZ_AXIS_COUNT,              PREVIOUS,      SIGNED_VB, NAV_POS,          NAV),
+    INTERFRAME_FIELDS(navRealVel,         S16, XYZ_AXIS_COUNT,              AVERAGE_2,     SIGNED_VB, NAV_POS,          NAV),
+    INTERFRAME_FIELDS(navTargetVel,       S16, XYZ_AXIS_COUNT,              AVERAGE_2,     SIGNED_VB, NAV_POS,          NAV),
+    INTERFRAME_FIELDS(navTargetPos,       S32, XYZ_AXIS_COUNT,              PREVIOUS,      SIGNED_VB, NAV_POS,          NAV),
+    INTERFRAME_FIELDS(navSurface,         S16, 1,                           PREVIOUS,      SIGNED_VB, NAV_POS,          NAV),
+    INTERFRAME_FIELDS(navAccNEU,          S16, XYZ_AXIS_COUNT,              AVERAGE_2,     SIGNED_VB, NAV_ACC,          NAV),
+};
+
 typedef struct blackboxGpsState_s {
     int32_t GPS_home[2];
     int32_t GPS_coord[2];
@@ -585,6 +735,8 @@ static uint32_t blackboxIteration;
 static uint16_t blackboxPFrameIndex;
 static uint16_t blackboxIFrameIndex;
 static uint16_t blackboxSlowFrameIterationTimer;
+static uint32_t blackboxMainFrameIndex; // Main frames logged so far, decides which rate groups are due
+static uint32_t blackboxHeldRateGroups; // Rate groups which repeat their previous values in the current main frame
 static bool blackboxLoggedAnyFrames;
 
 /*
@@ -605,6 +757,11 @@ static EXTENDED_FASTRAM blackboxMainState_t* blackboxHistory[3];
 
 static bool blackboxModeActivationConditionPresent = false;
 
+#ifdef USE_BLACKBOX_RING_BUFFER
+// In triggered mode frames go straight to the device until this time, it's pushed back while a trigger is active
+static timeUs_t blackboxTriggerHoldUntilUs;
+#endif
+
 /**
  * Return true if it is safe to edit the Blackbox configuration.
  */
@@ -991,256 +1148,216 @@ static void writeIntraframe(void)
     blackboxLoggedAnyFrames = true;
 }
 
-static void blackboxWriteArrayUsingAveragePredictor16(int arrOffsetInHistory, int count)
+static void rotateMainHistory(void)
 {
-    int16_t *curr  = (int16_t*) ((char*) (blackboxHistory[0]) + arrOffsetInHistory);
-    int16_t *prev1 = (int16_t*) ((char*) (blackboxHistory[1]) + arrOffsetInHistory);
-    int16_t *prev2 = (int16_t*) ((char*) (blackboxHistory[2]) + arrOffsetInHistory);
-
-    for (int i = 0; i < count; i++) {
-        // Predictor is the average of the previous two history states
-        int32_t predictor = (prev1[i] + prev2[i]) / 2;
+    //Rotate our history buffers
+    blackboxHistory[2] = blackboxHistory[1];
+    blackboxHistory[1] = blackboxHistory[0];
+    blackboxHistory[0] = ((blackboxHistory[0] - blackboxHistoryRing + 1) % 3) + blackboxHistoryRing;
 
-        blackboxWriteSignedVB(curr[i] - predictor);
-    }
+    blackboxLoggedAnyFrames = true;
 }
 
-static void blackboxWriteArrayUsingAveragePredictor32(int arrOffsetInHistory, int count)
-{
-    int32_t *curr  = (int32_t*) ((char*) (blackboxHistory[0]) + arrOffsetInHistory);
-    int32_t *prev1 = (int32_t*) ((char*) (blackboxHistory[1]) + arrOffsetInHistory);
-    int32_t *prev2 = (int32_t*) ((char*) (blackboxHistory[2]) + arrOffsetInHistory);
-
-    for (int i = 0; i < count; i++) {
-        // Predictor is the average of the previous two history states
-        int32_t predictor = ((int64_t)prev1[i] + (int64_t)prev2[i]) / 2;
-
-        blackboxWriteSignedVB(curr[i] - predictor);
-    }
-}
+/*
+ * Residuals of the P-frame fields waiting to be written as a packed block. For each field, the residual is kept
+ * for both the predictor the header promises and a straight line through the last two values. Each block is written
+ * with whichever of the two needs fewer bits.
+ */
+static struct {
+    uint8_t count;
+    int32_t declared[BLACKBOX_PACKED_BLOCK_MAX_VALUES];
+    int32_t linear[BLACKBOX_PACKED_BLOCK_MAX_VALUES];
+} packedBlock;
 
-static void writeInterframe(void)
+static void flushPackedBlock(void)
 {
-    blackboxMainState_t *blackboxCurrent = blackboxHistory[0];
-    blackboxMainState_t *blackboxLast = blackboxHistory[1];
-
-    blackboxWrite('P');
-
-    //No need to store iteration count since its delta is always 1
-
-    /*
-     * Since the difference between the difference between successive times will be nearly zero (due to consistent
-     * looptime spacing), use second-order differences.
-     */
-    blackboxWriteSignedVB((int32_t) (blackboxHistory[0]->time - 2 * blackboxHistory[1]->time + blackboxHistory[2]->time));
-
-    int32_t deltas[8];
-    arraySubInt32(deltas, blackboxCurrent->axisPID_Setpoint, blackboxLast->axisPID_Setpoint, XYZ_AXIS_COUNT);
-    blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
-
-    arraySubInt32(deltas, blackboxCurrent->axisPID_P, blackboxLast->axisPID_P, XYZ_AXIS_COUNT);
-    blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
-
-    /*
-     * The PID I field changes very slowly, most of the time +-2, so use an encoding
-     * that can pack all three fields into one byte in that situation.
-     */
-    arraySubInt32(deltas, blackboxCurrent->axisPID_I, blackboxLast->axisPID_I, XYZ_AXIS_COUNT);
-    blackboxWriteTag2_3S32(deltas);
-
-    /*
-     * The PID D term is frequently set to zero for yaw, which makes the result from the calculation
-     * always zero. So don't bother recording D results when PID D terms are zero.
-     */
-    for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-        if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_0 + x)) {
-            blackboxWriteSignedVB(blackboxCurrent->axisPID_D[x] - blackboxLast->axisPID_D[x]);
-        }
-    }
-
-    arraySubInt32(deltas, blackboxCurrent->axisPID_F, blackboxLast->axisPID_F, XYZ_AXIS_COUNT);
-    blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
-
-    if (testBlackboxCondition(CONDITION(FIXED_WING_NAV))) {
-
-        arraySubInt32(deltas, blackboxCurrent->fwAltPID, blackboxLast->fwAltPID, 3);
-        blackboxWriteSignedVBArray(deltas, 3);
-
-        blackboxWriteSignedVB(blackboxCurrent->fwAltPIDOutput - blackboxLast->fwAltPIDOutput);
-
-        arraySubInt32(deltas, blackboxCurrent->fwPosPID, blackboxLast->fwPosPID, 3);
-        blackboxWriteSignedVBArray(deltas, 3);
-
-        blackboxWriteSignedVB(blackboxCurrent->fwPosPIDOutput - blackboxLast->fwPosPIDOutput);
-
+    if (packedBlock.count == 0) {
+        return;
     }
 
-    if (testBlackboxCondition(CONDITION(MC_NAV))) {
-        arraySubInt32(deltas, blackboxCurrent->mcPosAxisP, blackboxLast->mcPosAxisP, XYZ_AXIS_COUNT);
-        blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
-
-        for (int i = 0; i < 4; i++) {
-            arraySubInt32(deltas, blackboxCurrent->mcVelAxisPID[i], blackboxLast->mcVelAxisPID[i], XYZ_AXIS_COUNT);
-            blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
-        }
-
-        arraySubInt32(deltas, blackboxCurrent->mcVelAxisOutput, blackboxLast->mcVelAxisOutput, XYZ_AXIS_COUNT);
-        blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
-
-        arraySubInt32(deltas, blackboxCurrent->mcSurfacePID, blackboxLast->mcSurfacePID, 3);
-        blackboxWriteSignedVBArray(deltas, 3);
+    const uint8_t declaredWidth = blackboxPackedBlockWidth(packedBlock.declared, packedBlock.count);
+    const uint8_t linearWidth = blackboxPackedBlockWidth(packedBlock.linear, packedBlock.count);
 
-        blackboxWriteSignedVB(blackboxCurrent->mcSurfacePIDOutput - blackboxLast->mcSurfacePIDOutput);
+    if (linearWidth < declaredWidth) {
+        blackboxWritePackedBlock(packedBlock.linear, packedBlock.count, linearWidth, BLACKBOX_PACKED_BLOCK_FLAG_LINEAR);
+    } else {
+        blackboxWritePackedBlock(packedBlock.declared, packedBlock.count, declaredWidth, 0);
     }
 
-    /*
-     * RC tends to stay the same or fairly small for many frames at a time, so use an encoding that
-     * can pack multiple values per byte:
-     */
+    packedBlock.count = 0;
+}
 
-    // rcData
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_RC_DATA)) {
-        for (int x = 0; x < 4; x++) {
-            deltas[x] = blackboxCurrent->rcData[x] - blackboxLast->rcData[x];
-        }
+// Arithmetic wraps around at 32 bits, the decoder has to do the same
+static void packField(int32_t value, int32_t prediction, int32_t prev1, int32_t prev2)
+{
+    packedBlock.declared[packedBlock.count] = (uint32_t)value - (uint32_t)prediction;
+    packedBlock.linear[packedBlock.count] = (uint32_t)value - (2 * (uint32_t)prev1 - (uint32_t)prev2);
 
-        blackboxWriteTag8_4S16(deltas);
+    if (++packedBlock.count == BLACKBOX_PACKED_BLOCK_MAX_VALUES) {
+        flushPackedBlock();
     }
+}
 
-    // rcCommand
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_RC_COMMAND)) {
-        for (int x = 0; x < 4; x++) {
-            deltas[x] = blackboxCurrent->rcCommand[x] - blackboxLast->rcCommand[x];
+static bool blackboxUsesRateGroups(void)
+{
+    for (int group = 0; group < BLACKBOX_RATE_GROUP_COUNT; group++) {
+        if (blackboxConfig()->groupRateDiv[group] > 1) {
+            return true;
         }
-
-        blackboxWriteTag8_4S16(deltas);
     }
 
-    //Check for sensors that are updated periodically (so deltas are normally zero)
-    int optionalFieldCount = 0;
-
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_VBAT)) {
-        deltas[optionalFieldCount++] = (int32_t) blackboxCurrent->vbat - blackboxLast->vbat;
-    }
+    return false;
+}
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_AMPERAGE)) {
-        deltas[optionalFieldCount++] = (int32_t) blackboxCurrent->amperage - blackboxLast->amperage;
-    }
+static int interframeFieldCount(const blackboxInterframeFields_t *fields)
+{
+    return fields->count == BLACKBOX_FIELD_COUNT_MOTORS ? getMotorCount() : fields->count;
+}
 
-#ifdef USE_MAG
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_MAG)) {
-        for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-            deltas[optionalFieldCount++] = blackboxCurrent->magADC[x] - blackboxLast->magADC[x];
-        }
-    }
-#endif
+static int32_t interframeFieldValue(const blackboxMainState_t *state, const blackboxInterframeFields_t *fields, int index)
+{
+    const uint8_t *member = (const uint8_t *)state + fields->offset;
 
-#ifdef USE_BARO
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_BARO)) {
-        deltas[optionalFieldCount++] = blackboxCurrent->BaroAlt - blackboxLast->BaroAlt;
+    switch (fields->type) {
+    case BLACKBOX_FIELD_TYPE_S16:
+        return ((const int16_t *)member)[index];
+    case BLACKBOX_FIELD_TYPE_U16:
+        return ((const uint16_t *)member)[index];
+    default:
+        // The unsigned time only uses the straight line predictor, which wraps around like the decoder does
+        return ((const int32_t *)member)[index];
     }
-#endif
+}
 
-#ifdef USE_PITOT
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_PITOT)) {
-        deltas[optionalFieldCount++] = blackboxCurrent->airSpeed - blackboxLast->airSpeed;
+static int32_t interframeFieldPrediction(uint8_t predict, int32_t prev1, int32_t prev2)
+{
+    switch (predict) {
+    case FLIGHT_LOG_FIELD_PREDICTOR_STRAIGHT_LINE:
+        return 2 * (uint32_t)prev1 - (uint32_t)prev2;
+    case FLIGHT_LOG_FIELD_PREDICTOR_AVERAGE_2:
+        return ((int64_t)prev1 + prev2) / 2;
+    default:
+        return prev1;
     }
-#endif
+}
 
-#ifdef USE_RANGEFINDER
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_SURFACE)) {
-        deltas[optionalFieldCount++] = blackboxCurrent->surfaceRaw - blackboxLast->surfaceRaw;
-    }
-#endif
+/*
+ * Write the fields of blackboxInterframeFields[] using the packed encoding, each with the predictor declared for it.
+ * When rate groups are in use, the frame starts with a mask of the groups which repeat their previous values, and
+ * their fields are left out.
+ */
+static void writeInterframePacked(void)
+{
+    blackboxWrite('P');
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_RSSI)) {
-        deltas[optionalFieldCount++] = (int32_t) blackboxCurrent->rssi - blackboxLast->rssi;
+    if (blackboxUsesRateGroups()) {
+        blackboxWriteUnsignedVB(blackboxHeldRateGroups);
     }
 
-    blackboxWriteTag8_8SVB(deltas, optionalFieldCount);
+    for (unsigned i = 0; i < ARRAYLEN(blackboxInterframeFields); i++) {
+        const blackboxInterframeFields_t *fields = &blackboxInterframeFields[i];
 
-    //Since gyros, accs and motors are noisy, base their predictions on the average of the history:
-    blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, gyroADC),   XYZ_AXIS_COUNT);
-
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_GYRO_RAW)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, gyroRaw), XYZ_AXIS_COUNT);
-    }
+        if ((blackboxHeldRateGroups & (1 << fields->group)) || !testBlackboxCondition(fields->condition)) {
+            continue;
+        }
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_GYRO_PEAKS_ROLL)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, gyroPeaksRoll), DYN_NOTCH_PEAK_COUNT);
-    }
+        const int count = interframeFieldCount(fields);
+        for (int j = 0; j < count; j++) {
+            const int32_t prev1 = interframeFieldValue(blackboxHistory[1], fields, j);
+            const int32_t prev2 = interframeFieldValue(blackboxHistory[2], fields, j);
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_GYRO_PEAKS_PITCH)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, gyroPeaksPitch), DYN_NOTCH_PEAK_COUNT);
+            packField(interframeFieldValue(blackboxHistory[0], fields, j), interframeFieldPrediction(fields->predict, prev1, prev2), prev1, prev2);
+        }
     }
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_GYRO_PEAKS_YAW)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, gyroPeaksYaw), DYN_NOTCH_PEAK_COUNT);
-    }
+    flushPackedBlock();
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_ACC)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, accADC), XYZ_AXIS_COUNT);
-    }
+    rotateMainHistory();
+}
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_ATTITUDE)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, attitude), XYZ_AXIS_COUNT);
+static void writeInterframeDeltas(uint8_t encode, int32_t *deltas, int count)
+{
+    switch (encode) {
+    case FLIGHT_LOG_FIELD_ENCODING_TAG2_3S32:
+        blackboxWriteTag2_3S32(deltas);
+        break;
+    case FLIGHT_LOG_FIELD_ENCODING_TAG8_4S16:
+        blackboxWriteTag8_4S16(deltas);
+        break;
+    case FLIGHT_LOG_FIELD_ENCODING_TAG8_8SVB:
+        blackboxWriteTag8_8SVB(deltas, count);
+        break;
+    default:
+        blackboxWriteSignedVBArray(deltas, count);
+        break;
     }
+}
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_DEBUG)) {
-        blackboxWriteArrayUsingAveragePredictor32(offsetof(blackboxMainState_t, debug), DEBUG32_VALUE_COUNT);
+// Number of consecutive fields the encoding writes together
+static int interframeEncodingGroupSize(uint8_t encode)
+{
+    switch (encode) {
+    case FLIGHT_LOG_FIELD_ENCODING_TAG2_3S32:
+        return 3;
+    case FLIGHT_LOG_FIELD_ENCODING_TAG8_4S16:
+        return 4;
+    case FLIGHT_LOG_FIELD_ENCODING_TAG8_8SVB:
+        return 8;
+    default:
+        return 1;
     }
+}
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_MOTORS)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, motor),     getMotorCount());
+static void writeInterframe(void)
+{
+    if (blackboxConfig()->encoding == BLACKBOX_ENCODING_PACKED) {
+        writeInterframePacked();
+        return;
     }
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_SERVOS)) {
-        blackboxWriteArrayUsingAveragePredictor16(offsetof(blackboxMainState_t, servo),     MAX_SUPPORTED_SERVOS);
-    }
+    blackboxWrite('P');
 
-    blackboxWriteSignedVB(blackboxCurrent->navState - blackboxLast->navState);
+    //No need to store iteration count since its delta is always 1
 
-    blackboxWriteSignedVB(blackboxCurrent->navFlags - blackboxLast->navFlags);
+    // Deltas of fields which are encoded together wait here until their group is complete
+    int32_t deltas[8];
+    int deltaCount = 0;
+    uint8_t deltaEncode = ENCODING(SIGNED_VB);
 
-    /*
-     * NAV_POS fields
-     */
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_NAV_POS)) {
-        blackboxWriteSignedVB(blackboxCurrent->navEPH - blackboxLast->navEPH);
-        blackboxWriteSignedVB(blackboxCurrent->navEPV - blackboxLast->navEPV);
+    for (unsigned i = 0; i < ARRAYLEN(blackboxInterframeFields); i++) {
+        const blackboxInterframeFields_t *fields = &blackboxInterframeFields[i];
 
-        for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-            blackboxWriteSignedVB(blackboxCurrent->navPos[x] - blackboxLast->navPos[x]);
+        if (!testBlackboxCondition(fields->condition)) {
+            continue;
         }
 
-        for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-            blackboxWriteSignedVB(blackboxHistory[0]->navRealVel[x] - (blackboxHistory[1]->navRealVel[x] + blackboxHistory[2]->navRealVel[x]) / 2);
+        if (fields->encode != deltaEncode) {
+            if (deltaCount) {
+                writeInterframeDeltas(deltaEncode, deltas, deltaCount);
+                deltaCount = 0;
+            }
+            deltaEncode = fields->encode;
         }
 
+        const int count = interframeFieldCount(fields);
+        for (int j = 0; j < count; j++) {
+            const int32_t prediction = interframeFieldPrediction(fields->predict,
+                interframeFieldValue(blackboxHistory[1], fields, j), interframeFieldValue(blackboxHistory[2], fields, j));
 
-        for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-            blackboxWriteSignedVB(blackboxHistory[0]->navTargetVel[x] - (blackboxHistory[1]->navTargetVel[x] + blackboxHistory[2]->navTargetVel[x]) / 2);
-        }
+            deltas[deltaCount++] = (uint32_t)interframeFieldValue(blackboxHistory[0], fields, j) - (uint32_t)prediction;
 
-        for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-            blackboxWriteSignedVB(blackboxHistory[0]->navTargetPos[x] - blackboxLast->navTargetPos[x]);
+            if (deltaCount == interframeEncodingGroupSize(deltaEncode)) {
+                writeInterframeDeltas(deltaEncode, deltas, deltaCount);
+                deltaCount = 0;
+            }
         }
-
-        blackboxWriteSignedVB(blackboxCurrent->navSurface - blackboxLast->navSurface);
     }
 
-    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_NAV_ACC)) {
-        for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-            blackboxWriteSignedVB(blackboxHistory[0]->navAccNEU[x] - (blackboxHistory[1]->navAccNEU[x] + blackboxHistory[2]->navAccNEU[x]) / 2);
-        }
+    if (deltaCount) {
+        writeInterframeDeltas(deltaEncode, deltas, deltaCount);
     }
 
-    //Rotate our history buffers
-    blackboxHistory[2] = blackboxHistory[1];
-    blackboxHistory[1] = blackboxHistory[0];
-    blackboxHistory[0] = ((blackboxHistory[0] - blackboxHistoryRing + 1) % 3) + blackboxHistoryRing;
-
-    blackboxLoggedAnyFrames = true;
+    rotateMainHistory();
 }
 
 /* Write the contents of the global "slowHistory" to the log as an "S" frame. Because this data is logged so
@@ -1249,6 +1366,7 @@ static void writeSlowFrame(void)
 {
     int32_t values[3];
 
+    blackboxFrameBegin(BLACKBOX_FRAME_TYPE_SLOW);
     blackboxWrite('S');
 
     blackboxWriteUnsignedVB(slowHistory.flightModeFlags);
@@ -1288,6 +1406,7 @@ static void writeSlowFrame(void)
     blackboxWriteSignedVB(slowHistory.escTemperature);
 #endif
     blackboxWriteUnsignedVB(slowHistory.rxUpdateRate);
+    blackboxFrameEnd();
 
     blackboxSlowFrameIterationTimer = 0;
 }
@@ -1420,6 +1539,7 @@ static void blackboxResetIterationTimers(void)
     blackboxIteration = 0;
     blackboxPFrameIndex = 0;
     blackboxIFrameIndex = 0;
+    blackboxMainFrameIndex = 0;
 }
 
 /**
@@ -1432,6 +1552,7 @@ void blackboxStart(void)
     }
 
     blackboxValidateConfig();
+    blackboxResetStats();
 
     if (!blackboxDeviceOpen()) {
         blackboxSetState(BLACKBOX_STATE_DISABLED);
@@ -1459,6 +1580,10 @@ void blackboxStart(void)
 
     blackboxResetIterationTimers();
 
+#ifdef USE_BLACKBOX_RING_BUFFER
+    blackboxTriggerHoldUntilUs = micros();
+#endif
+
     /*
      * Record the beeper's current idea of the last arming beep time, so that we can detect it changing when
      * it finally plays the beep for this arming event.
@@ -1469,6 +1594,25 @@ void blackboxStart(void)
     blackboxSetState(BLACKBOX_STATE_PREPARE_LOG_FILE);
 }
 
+/*
+ * Summarize the log's frame and device statistics behind the end of log event, where log decoders stop reading.
+ * Encoding times are in nanoseconds.
+ */
+static void blackboxWriteStats(void)
+{
+    const blackboxStats_t *stats = blackboxGetStats();
+
+    for (blackboxFrameType_e type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+        const blackboxFrameStats_t *frameStats = &stats->frames[type];
+        const uint32_t averageTicks = frameStats->frames ? frameStats->encode.totalTicks / frameStats->frames : 0;
+
+        blackboxPrintfHeaderLine("Frame stats", "%c,%u,%u,%u,%u,%u", blackboxFrameTypeChar(type),
+            frameStats->frames, frameStats->bytes, frameStats->dropped,
+            profilerTicksToNs(averageTicks), profilerTicksToNs(frameStats->encode.maxTicks));
+    }
+    blackboxPrintfHeaderLine("Device stats", "%u,%u,%u,%u", stats->overruns, stats->droppedBytes, stats->stalls, stats->ringOverflows);
+}
+
 /**
  * Begin Blackbox shutdown.
  */
@@ -1483,7 +1627,14 @@ void blackboxFinish(void)
 
     case BLACKBOX_STATE_RUNNING:
     case BLACKBOX_STATE_PAUSED:
+#ifdef USE_BLACKBOX_RING_BUFFER
+        // Nothing triggered, drop the capture. A ring which is being written out is left to drain while shutting down
+        if (blackboxRingGetState() == BLACKBOX_RING_CAPTURING) {
+            blackboxRingStop();
+        }
+#endif
         blackboxLogEvent(FLIGHT_LOG_EVENT_LOG_END, NULL);
+        blackboxWriteStats();
         FALLTHROUGH;
 
     default:
@@ -1494,11 +1645,13 @@ void blackboxFinish(void)
 #ifdef USE_GPS
 static void writeGPSHomeFrame(void)
 {
+    blackboxFrameBegin(BLACKBOX_FRAME_TYPE_GPS_HOME);
     blackboxWrite('H');
 
     blackboxWriteSignedVB(GPS_home.lat);
     blackboxWriteSignedVB(GPS_home.lon);
     //TODO it'd be great if we could grab the GPS current time and write that too
+    blackboxFrameEnd();
 
     gpsHistory.GPS_home[0] = GPS_home.lat;
     gpsHistory.GPS_home[1] = GPS_home.lon;
@@ -1506,6 +1659,7 @@ static void writeGPSHomeFrame(void)
 
 static void writeGPSFrame(timeUs_t currentTimeUs)
 {
+    blackboxFrameBegin(BLACKBOX_FRAME_TYPE_GPS);
     blackboxWrite('G');
 
     /*
@@ -1530,6 +1684,7 @@ static void writeGPSFrame(timeUs_t currentTimeUs)
     blackboxWriteUnsignedVB(gpsSol.eph);
     blackboxWriteUnsignedVB(gpsSol.epv);
     blackboxWriteSigned16VBArray(gpsSol.velNED, XYZ_AXIS_COUNT);
+    blackboxFrameEnd();
 
     gpsHistory.GPS_numSat = gpsSol.numSat;
     gpsHistory.GPS_coord[0] = gpsSol.llh.lat;
@@ -1537,10 +1692,35 @@ static void writeGPSFrame(timeUs_t currentTimeUs)
 }
 #endif
 
+// Give the rate groups which aren't due in this frame the values of the previous frame
+static void holdRateGroups(blackboxMainState_t *blackboxCurrent, bool intraframe)
+{
+    blackboxHeldRateGroups = 0;
+
+    // Every group is due in an I-frame, so a decoder that resynchronises there has fresh values for all of them
+    for (int group = 0; group < BLACKBOX_RATE_GROUP_COUNT && !intraframe; group++) {
+        if (blackboxMainFrameIndex % blackboxConfig()->groupRateDiv[group]) {
+            blackboxHeldRateGroups |= 1 << group;
+        }
+    }
+
+    if (blackboxHeldRateGroups) {
+        for (unsigned i = 0; i < ARRAYLEN(blackboxRateGroupRanges); i++) {
+            const blackboxRateGroupRange_t *range = &blackboxRateGroupRanges[i];
+
+            if (blackboxHeldRateGroups & (1 << range->group)) {
+                memcpy((uint8_t *)blackboxCurrent + range->offset, (const uint8_t *)blackboxHistory[1] + range->offset, range->size);
+            }
+        }
+    }
+
+    blackboxMainFrameIndex++;
+}
+
 /**
  * Fill the current state of the blackbox using values read from the flight controller
  */
-static void loadMainState(timeUs_t currentTimeUs)
+static void loadMainState(timeUs_t currentTimeUs, bool intraframe)
 {
     blackboxMainState_t *blackboxCurrent = blackboxHistory[0];
 
@@ -1655,6 +1835,8 @@ static void loadMainState(timeUs_t currentTimeUs)
         blackboxCurrent->navTargetPos[i] = navTargetPosition[i];
     }
     blackboxCurrent->navSurface = navActualSurface;
+
+    holdRateGroups(blackboxCurrent, intraframe);
 }
 
 /**
@@ -1757,7 +1939,15 @@ static bool sendFieldDefinition(char mainFrameChar, char deltaFrameChar, const v
                 }
             } else {
                 //The other headers are integers
-                blackboxPrintf("%d", def->arr[xmitState.headerIndex - 1]);
+                uint8_t value = def->arr[xmitState.headerIndex - 1];
+
+                // The packed encoding replaces the encodings of all the P-frame fields which are written at all
+                if (deltaFrameChar == 'P' && xmitState.headerIndex == BLACKBOX_DELTA_FIELD_HEADER_COUNT - 1
+                        && blackboxConfig()->encoding == BLACKBOX_ENCODING_PACKED && value != FLIGHT_LOG_FIELD_ENCODING_NULL) {
+                    value = FLIGHT_LOG_FIELD_ENCODING_PACKED_BLOCK;
+                }
+
+                blackboxPrintf("%d", value);
             }
         }
     }
@@ -1813,6 +2003,15 @@ static bool blackboxWriteSysinfo(void)
         BLACKBOX_PRINT_HEADER_LINE("Log start datetime", "%s",              blackboxGetStartDateTime(buf));
         BLACKBOX_PRINT_HEADER_LINE("Craft name", "%s",                      systemConfig()->craftName);
         BLACKBOX_PRINT_HEADER_LINE("P interval", "%u/%u",                   blackboxConfig()->rate_num, blackboxConfig()->rate_denom);
+        BLACKBOX_PRINT_HEADER_LINE("P interval div", "%u,%u,%u,%u,%u,%u,%u,%u,%u", blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_PID],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_GYRO],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_ACC],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_ATTITUDE],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_RC],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_MOTORS],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_NAV],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_SENSORS],
+                                                                            blackboxConfig()->groupRateDiv[BLACKBOX_RATE_GROUP_DEBUG]);
         BLACKBOX_PRINT_HEADER_LINE("minthrottle", "%d",                     getThrottleIdleValue());
         BLACKBOX_PRINT_HEADER_LINE("maxthrottle", "%d",                     motorConfig()->maxthrottle);
         BLACKBOX_PRINT_HEADER_LINE("gyro_scale", "0x%x",                    castFloatBytesToInt(1.0f));
@@ -1941,6 +2140,7 @@ void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data)
     }
 
     //Shared header for event frames
+    blackboxFrameBegin(BLACKBOX_FRAME_TYPE_EVENT);
     blackboxWrite('E');
     blackboxWrite(event);
 
@@ -1974,6 +2174,7 @@ void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data)
         blackboxWrite(0);
         break;
     }
+    blackboxFrameEnd();
 }
 
 /* If an arming beep has played since it was last logged, write the time of the arming beep to the log as a synchronization point */
@@ -2034,16 +2235,25 @@ static void blackboxAdvanceIterationTimers(void)
 // Called once every FC loop in order to log the current state
 static void blackboxLogIteration(timeUs_t currentTimeUs)
 {
+#ifdef USE_BLACKBOX_RING_BUFFER
+    blackboxRingMarkIteration();
+#endif
+
     // Write a keyframe every BLACKBOX_I_INTERVAL frames so we can resynchronise upon missing frames
     if (blackboxShouldLogIFrame()) {
+#ifdef USE_BLACKBOX_RING_BUFFER
+        blackboxRingMarkSyncPoint(blackboxIteration, currentTimeUs);
+#endif
         /*
          * Don't log a slow frame if the slow data didn't change ("I" frames are already large enough without adding
          * an additional item to write at the same time). Unless we're *only* logging "I" frames, then we have no choice.
          */
         writeSlowFrameIfNeeded(blackboxIsOnlyLoggingIntraframes());
 
-        loadMainState(currentTimeUs);
+        loadMainState(currentTimeUs, true);
+        blackboxFrameBegin(BLACKBOX_FRAME_TYPE_INTRA);
         writeIntraframe();
+        blackboxFrameEnd();
     } else {
         blackboxCheckAndLogArmingBeep();
         blackboxCheckAndLogFlightMode();
@@ -2055,8 +2265,10 @@ static void blackboxLogIteration(timeUs_t currentTimeUs)
              */
             writeSlowFrameIfNeeded(true);
 
-            loadMainState(currentTimeUs);
+            loadMainState(currentTimeUs, false);
+            blackboxFrameBegin(BLACKBOX_FRAME_TYPE_INTER);
             writeInterframe();
+            blackboxFrameEnd();
         }
 #ifdef USE_GPS
         if (feature(FEATURE_GPS)) {
@@ -2085,6 +2297,81 @@ static void blackboxLogIteration(timeUs_t currentTimeUs)
     blackboxDeviceFlush();
 }
 
+#ifdef USE_BLACKBOX_RING_BUFFER
+static bool blackboxTriggerActive(void)
+{
+    if (blackboxConfig()->triggerFailsafe && failsafePhase() != FAILSAFE_IDLE) {
+        return true;
+    }
+
+    if (blackboxConfig()->triggerSaturation && mixerIsOutputSaturated()) {
+        return true;
+    }
+
+    if (blackboxConfig()->triggerVibration && accGetVibrationLevel() * 100 >= blackboxConfig()->triggerVibration) {
+        return true;
+    }
+
+#ifdef USE_PROGRAMMING_FRAMEWORK
+    if (blackboxConfig()->triggerLogicCondition >= 0 && logicConditionGetValue(blackboxConfig()->triggerLogicCondition)) {
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+/*
+ * In triggered mode frames are captured in the RAM ring. When a trigger fires, the capture is committed to the
+ * device from blackbox_pretrigger_ms before on, and frames keep going to the device until no trigger has been
+ * active for blackbox_posttrigger_ms. Then capturing starts over.
+ */
+static void blackboxUpdateTrigger(timeUs_t currentTimeUs)
+{
+    if (blackboxConfig()->mode != BLACKBOX_MODE_TRIGGERED) {
+        return;
+    }
+
+    if (blackboxTriggerActive()) {
+        blackboxTriggerHoldUntilUs = currentTimeUs + blackboxConfig()->posttriggerMs * 1000;
+    }
+
+    const bool hold = cmpTimeUs(blackboxTriggerHoldUntilUs, currentTimeUs) > 0;
+
+    switch (blackboxRingGetState()) {
+    case BLACKBOX_RING_OFF:
+        if (!hold) {
+            blackboxRingStart();
+        }
+        break;
+    case BLACKBOX_RING_CAPTURING:
+        if (hold) {
+            blackboxRingSyncPoint_t syncPoint;
+
+            // Without a sync point the capture can't be decoded, wait for the next I-frame
+            if (blackboxRingFindSyncPoint(currentTimeUs - blackboxConfig()->pretriggerMs * 1000, &syncPoint)) {
+                // Tell the decoder where the captured frames start, and which home they are relative to
+                flightLogEvent_loggingResume_t resume;
+
+                resume.logIteration = syncPoint.iteration;
+                resume.currentTimeUs = syncPoint.time;
+
+                blackboxLogEvent(FLIGHT_LOG_EVENT_LOGGING_RESUME, (flightLogEventData_t *) &resume);
+#ifdef USE_GPS
+                if (feature(FEATURE_GPS)) {
+                    writeGPSHomeFrame();
+                }
+#endif
+                blackboxRingCommit(&syncPoint);
+            }
+        }
+        break;
+    case BLACKBOX_RING_DRAINING:
+        break;
+    }
+}
+#endif
+
 /**
  * Call each flight loop iteration to perform blackbox logging.
  */
@@ -2115,6 +2402,7 @@ void blackboxUpdate(timeUs_t currentTimeUs)
                 }
 
                 if (blackboxHeader[xmitState.headerIndex] == '\0') {
+                    blackboxPrintfHeaderLine("Data version", "%d", blackboxConfig()->encoding == BLACKBOX_ENCODING_PACKED ? BLACKBOX_DATA_VERSION_PACKED : BLACKBOX_DATA_VERSION);
                     blackboxPrintfHeaderLine("I interval", "%d", blackboxIFrameInterval);
                     blackboxSetState(BLACKBOX_STATE_SEND_MAIN_FIELD_HEADER);
                 }
@@ -2190,6 +2478,9 @@ void blackboxUpdate(timeUs_t currentTimeUs)
         break;
     case BLACKBOX_STATE_RUNNING:
         // On entry to this state, blackboxIteration, blackboxPFrameIndex and blackboxIFrameIndex are reset to 0
+#ifdef USE_BLACKBOX_RING_BUFFER
+        blackboxUpdateTrigger(currentTimeUs);
+#endif
         if (blackboxModeActivationConditionPresent && !IS_RC_MODE_ACTIVE(BOXBLACKBOX)) {
             blackboxSetState(BLACKBOX_STATE_PAUSED);
         } else {
@@ -2205,6 +2496,16 @@ void blackboxUpdate(timeUs_t currentTimeUs)
          *
          * Don't wait longer than it could possibly take if something funky happens.
          */
+#ifdef USE_BLACKBOX_RING_BUFFER
+        // A committed capture can take a while to write out, keep waiting as long as the device takes data
+        if (blackboxRingGetState() == BLACKBOX_RING_DRAINING && millis() <= xmitState.u.startTime + BLACKBOX_SHUTDOWN_TIMEOUT_MILLIS) {
+            if (blackboxRingDrain()) {
+                xmitState.u.startTime = millis();
+            }
+            blackboxDeviceFlush();
+            break;
+        }
+#endif
         if (blackboxDeviceEndLog(blackboxLoggedAnyFrames) && (millis() > xmitState.u.startTime + BLACKBOX_SHUTDOWN_TIMEOUT_MILLIS || blackboxDeviceFlushForce())) {
             blackboxDeviceClose();
             blackboxSetState(BLACKBOX_STATE_STOPPED);
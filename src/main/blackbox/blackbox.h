@@ -36,12 +36,54 @@ typedef enum {
     BLACKBOX_FEATURE_GYRO_PEAKS_PITCH   = 1 << 11,
     BLACKBOX_FEATURE_GYRO_PEAKS_YAW     = 1 << 12,
 } blackboxFeatureMask_e;
+
+// Groups of main frame fields which can be logged at a fraction of the main frame rate
+typedef enum {
+    BLACKBOX_RATE_GROUP_PID = 0,        // PID setpoints and terms
+    BLACKBOX_RATE_GROUP_GYRO,           // gyroADC, gyroRaw and dynamic notch peaks
+    BLACKBOX_RATE_GROUP_ACC,
+    BLACKBOX_RATE_GROUP_ATTITUDE,
+    BLACKBOX_RATE_GROUP_RC,             // rcData and rcCommand
+    BLACKBOX_RATE_GROUP_MOTORS,         // motors and servos
+    BLACKBOX_RATE_GROUP_NAV,            // navigation PIDs, state and position
+    BLACKBOX_RATE_GROUP_SENSORS,        // vbat, amperage, baro, pitot, mag, rangefinder and rssi
+    BLACKBOX_RATE_GROUP_DEBUG,
+    BLACKBOX_RATE_GROUP_COUNT
+} blackboxRateGroup_e;
+
+typedef enum {
+    BLACKBOX_ENCODING_STANDARD = 0,
+    BLACKBOX_ENCODING_PACKED,           // Bit packed P-frames with adaptive prediction, data version 3
+} blackboxEncoding_e;
+
+// Flags of a log in the dataflash log index
+typedef enum {
+    BLACKBOX_LOG_FLAG_TRIGGERED = (1 << 0),
+    BLACKBOX_LOG_FLAG_PACKED    = (1 << 1),
+} blackboxLogFlags_e;
+
+typedef enum {
+    BLACKBOX_MODE_CONTINUOUS = 0,   // Log everything from arming to disarming
+    BLACKBOX_MODE_TRIGGERED,        // Only write the frames around trigger events to the device
+} blackboxMode_e;
+
 typedef struct blackboxConfig_s {
     uint16_t rate_num;
     uint16_t rate_denom;
     uint8_t device;
     uint8_t invertedCardDetection;
     uint32_t includeFlags;
+    uint8_t groupRateDiv[BLACKBOX_RATE_GROUP_COUNT];   // Log each group on every Nth main frame only
+    uint8_t encoding;
+#ifdef USE_BLACKBOX_RING_BUFFER
+    uint8_t mode;
+    uint16_t pretriggerMs;
+    uint16_t posttriggerMs;
+    uint8_t triggerFailsafe;
+    uint8_t triggerSaturation;
+    uint16_t triggerVibration;          // Vibration level in 0.01G, 0 disables the trigger
+    int8_t triggerLogicCondition;       // Logic condition index, -1 disables the trigger
+#endif
 } blackboxConfig_t;
 
 PG_DECLARE(blackboxConfig_t, blackboxConfig);
@@ -365,6 +365,50 @@ void blackboxWriteTag8_8SVB(int32_t *values, int valueCount)
     }
 }
 
+/**
+ * Number of bits needed to store the largest of the given values after ZigZag encoding, 0 if they are all zero.
+ */
+uint8_t blackboxPackedBlockWidth(const int32_t *values, int valueCount)
+{
+    uint32_t bits = 0;
+
+    for (int i = 0; i < valueCount; i++) {
+        bits |= zigzagEncode(values[i]);
+    }
+
+    return bits ? 32 - __builtin_clz(bits) : 0;
+}
+
+/**
+ * Write up to 8 values as a one-byte header followed by the ZigZag encoded values, each stored in `width` bits.
+ * The header holds the width in its low 6 bits and the `flags` in the high 2 bits. The values form one bit-stream,
+ * least-significant bit first, which is padded with zeros to a whole number of bytes.
+ *
+ * All values must fit in `width` bits, see blackboxPackedBlockWidth().
+ */
+void blackboxWritePackedBlock(const int32_t *values, int valueCount, uint8_t width, uint8_t flags)
+{
+    uint64_t bitBuffer = 0;
+    int bitCount = 0;
+
+    blackboxWrite(width | flags);
+
+    for (int i = 0; i < valueCount; i++) {
+        bitBuffer |= (uint64_t)zigzagEncode(values[i]) << bitCount;
+        bitCount += width;
+
+        while (bitCount >= 8) {
+            blackboxWrite(bitBuffer & 0xFF);
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    if (bitCount > 0) {
+        blackboxWrite(bitBuffer & 0xFF);
+    }
+}
+
 /** Write unsigned integer **/
 void blackboxWriteU32(int32_t value)
 {
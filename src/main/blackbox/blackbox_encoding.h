@@ -31,3 +31,9 @@ void blackboxWriteTag8_4S16(int32_t *values);
 void blackboxWriteTag8_8SVB(int32_t *values, int valueCount);
 void blackboxWriteU32(int32_t value);
 void blackboxWriteFloat(float value);
+
+#define BLACKBOX_PACKED_BLOCK_MAX_VALUES        8
+#define BLACKBOX_PACKED_BLOCK_FLAG_LINEAR       (1 << 6)
+
+uint8_t blackboxPackedBlockWidth(const int32_t *values, int valueCount);
+void blackboxWritePackedBlock(const int32_t *values, int valueCount, uint8_t width, uint8_t flags);
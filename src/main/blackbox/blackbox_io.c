@@ -35,6 +35,8 @@
 #include "config/parameter_group.h"
 #include "config/parameter_group_ids.h"
 
+#include "drivers/time.h"
+
 #include "io/asyncfatfs/asyncfatfs.h"
 #include "io/flashfs.h"
 #include "io/serial.h"
@@ -47,7 +49,7 @@
 #define BLACKBOX_SERIAL_PORT_MODE MODE_TX
 
 // How many bytes can we transmit per loop iteration when writing headers?
-static uint8_t blackboxMaxHeaderBytesPerIteration;
+STATIC_UNIT_TESTED uint8_t blackboxMaxHeaderBytesPerIteration;
 
 // How many bytes can we write *this* iteration without overflowing transmit buffers or overstressing the OpenLog?
 int32_t blackboxHeaderBudget;
@@ -87,60 +89,428 @@ void blackboxOpen(void)
 }
 #endif // UNIT_TEST
 
-void blackboxWrite(uint8_t value)
+static blackboxStats_t blackboxStats;
+
+// Frames which ended in the frame buffer since it was last flushed, they are lost if the device drops the buffer
+static uint16_t blackboxBufferedFrames[BLACKBOX_FRAME_TYPE_COUNT];
+
+// Everything the encoder has put into the frame buffer, used to measure frame sizes
+static uint32_t blackboxFrameBufferTotalBytes;
+
+static struct {
+    bool active;
+    bool dropped;           // Part of the frame was dropped by the device already
+    blackboxFrameType_e type;
+    uint32_t startTicks;
+    uint32_t startBytes;
+} blackboxCurrentFrame;
+
+// Returns the number of bytes the device took, the rest is dropped
+static int blackboxDeviceWrite(const uint8_t *data, int length)
 {
+    int written = 0;
+
     switch (blackboxConfig()->device) {
 #ifdef USE_FLASHFS
     case BLACKBOX_DEVICE_FLASH:
-        flashfsWriteByte(value); // Write byte asynchronously
+    {
+        const uint32_t offset = flashfsGetOffset();
+
+        flashfsWrite(data, length, false); // Write asynchronously, drops the data which doesn't fit into the buffer
+        written = constrain(flashfsGetOffset() - offset, 0, length);
         break;
+    }
 #endif
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
-        afatfs_fputc(blackboxSDCard.logFile, value);
+        written = afatfs_fwrite(blackboxSDCard.logFile, data, length); // Ignore failures due to buffers filling up
         break;
 #endif
     case BLACKBOX_DEVICE_SERIAL:
     default:
-        serialWrite(blackboxPort, value);
+        if (blackboxPort) {
+            if (serialTxBytesFree(blackboxPort) < (uint32_t)length) {
+                // serialWriteBuf() waits for the port to make room
+                blackboxStats.stalls++;
+            }
+            serialWriteBuf(blackboxPort, data, length);
+            written = length;
+        }
         break;
     }
+
+    if (written < length) {
+        blackboxStats.overruns++;
+        blackboxStats.droppedBytes += length - written;
+    }
+
+    return written;
 }
 
-// Print the null-terminated string 's' to the blackbox device and return the number of bytes written
-int blackboxPrint(const char *s)
+// How many bytes the device can take right now without dropping any
+static int32_t blackboxDeviceGetFreeSpace(void)
 {
-    int length;
-    const uint8_t *pos;
-
     switch (blackboxConfig()->device) {
-
+    case BLACKBOX_DEVICE_SERIAL:
+        return blackboxPort ? (int32_t)serialTxBytesFree(blackboxPort) : 0;
 #ifdef USE_FLASHFS
     case BLACKBOX_DEVICE_FLASH:
-        length = strlen(s);
-        flashfsWrite((const uint8_t*) s, length, false); // Write asynchronously
-        break;
+        return flashfsGetWriteBufferFreeSpace();
 #endif
-
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
-        length = strlen(s);
-        afatfs_fwrite(blackboxSDCard.logFile, (const uint8_t*) s, length); // Ignore failures due to buffers filling up
-        break;
+        return afatfs_getFreeBufferSpace();
 #endif
-
-    case BLACKBOX_DEVICE_SERIAL:
     default:
-        pos = (uint8_t*) s;
-        while (*pos) {
-            serialWrite(blackboxPort, *pos);
-            pos++;
+        return 0;
+    }
+}
+
+FASTRAM blackboxFrameBuffer_t blackboxFrameBuffer;
+
+#ifdef USE_BLACKBOX_RING_BUFFER
+
+STATIC_ASSERT((BLACKBOX_RING_BUFFER_SIZE & (BLACKBOX_RING_BUFFER_SIZE - 1)) == 0, blackbox_ring_size_must_be_a_power_of_two);
+
+/*
+ * Positions count every byte that was ever appended since blackboxRingStart(), the ring holds the bytes
+ * from tail up to head. Sync points are kept oldest first and never lie before the tail.
+ */
+static struct {
+    blackboxRingState_e state;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t iterationStart;    // Where the iteration being logged starts while draining
+    bool overflowed;            // Draining couldn't keep up, new frames are dropped until the ring is written out
+    uint8_t syncPointFirst;
+    uint8_t syncPointCount;
+    blackboxRingSyncPoint_t syncPoints[BLACKBOX_RING_SYNC_POINTS];
+    uint8_t data[BLACKBOX_RING_BUFFER_SIZE];
+} blackboxRing;
+
+static blackboxRingSyncPoint_t *blackboxRingSyncPoint(int index)
+{
+    return &blackboxRing.syncPoints[(blackboxRing.syncPointFirst + index) % BLACKBOX_RING_SYNC_POINTS];
+}
+
+static void blackboxRingDropOldestSyncPoint(void)
+{
+    blackboxRing.syncPointFirst = (blackboxRing.syncPointFirst + 1) % BLACKBOX_RING_SYNC_POINTS;
+    blackboxRing.syncPointCount--;
+}
+
+static void blackboxRingReset(void)
+{
+    blackboxRing.head = 0;
+    blackboxRing.tail = 0;
+    blackboxRing.iterationStart = 0;
+    blackboxRing.overflowed = false;
+    blackboxRing.syncPointFirst = 0;
+    blackboxRing.syncPointCount = 0;
+}
+
+/*
+ * Make room for the given number of bytes by discarding the oldest data. Frames before a sync point can't be
+ * decoded without the I-frame they are predicted from, so the tail always moves on a whole sync point at a time.
+ */
+static void blackboxRingEvict(uint32_t length)
+{
+    while (BLACKBOX_RING_BUFFER_SIZE - (blackboxRing.head - blackboxRing.tail) < length) {
+        while (blackboxRing.syncPointCount > 0 && blackboxRingSyncPoint(0)->position <= blackboxRing.tail) {
+            blackboxRingDropOldestSyncPoint();
         }
 
-        length = pos - (uint8_t*) s;
-        break;
+        if (blackboxRing.syncPointCount > 0 && blackboxRingSyncPoint(0)->position <= blackboxRing.head) {
+            blackboxRing.tail = blackboxRingSyncPoint(0)->position;
+        } else {
+            blackboxRing.tail = blackboxRing.head;
+        }
+    }
+}
+
+/*
+ * Returns false if the data was dropped because a committed capture overflowed the ring.
+ */
+static bool blackboxRingAppend(const uint8_t *data, uint32_t length)
+{
+    if (blackboxRing.overflowed) {
+        blackboxStats.droppedBytes += length;
+        return false;
+    }
+
+    if (BLACKBOX_RING_BUFFER_SIZE - (blackboxRing.head - blackboxRing.tail) < length) {
+        if (blackboxRing.state == BLACKBOX_RING_DRAINING) {
+            /*
+             * The device can't keep up. Keep what was committed, cut off the partly logged iteration unless parts
+             * of it were already written, and drop new frames until the ring is written out. Capturing then starts
+             * over, so the next section of the log begins with a logging resume event.
+             */
+            const uint32_t cut = MAX(blackboxRing.iterationStart, blackboxRing.tail);
+
+            blackboxStats.ringOverflows++;
+            blackboxStats.droppedBytes += blackboxRing.head - cut + length;
+            blackboxRing.head = cut;
+            blackboxRing.overflowed = true;
+            return false;
+        }
+
+        blackboxRingEvict(length);
+    }
+
+    while (length > 0) {
+        const uint32_t index = blackboxRing.head & (BLACKBOX_RING_BUFFER_SIZE - 1);
+        const uint32_t chunk = MIN(length, BLACKBOX_RING_BUFFER_SIZE - index);
+
+        memcpy(&blackboxRing.data[index], data, chunk);
+        blackboxRing.head += chunk;
+        data += chunk;
+        length -= chunk;
     }
 
+    return true;
+}
+
+/**
+ * Start sending frames into the ring, whatever is left in the frame buffer still goes to the device.
+ */
+void blackboxRingStart(void)
+{
+    blackboxFrameBufferFlush();
+    blackboxRingReset();
+    blackboxRing.state = BLACKBOX_RING_CAPTURING;
+}
+
+/**
+ * Send frames straight to the device again, discarding anything the ring still holds.
+ */
+void blackboxRingStop(void)
+{
+    blackboxRing.state = BLACKBOX_RING_OFF;
+    blackboxRingReset();
+}
+
+blackboxRingState_e blackboxRingGetState(void)
+{
+    return blackboxRing.state;
+}
+
+/**
+ * Call before encoding the first frame of an iteration the log can be decoded from, i.e. one starting with an I-frame.
+ */
+void blackboxRingMarkSyncPoint(uint32_t iteration, timeUs_t time)
+{
+    if (blackboxRing.state != BLACKBOX_RING_CAPTURING) {
+        return;
+    }
+
+    if (blackboxRing.syncPointCount == BLACKBOX_RING_SYNC_POINTS) {
+        blackboxRingDropOldestSyncPoint();
+    }
+
+    blackboxRingSyncPoint_t *syncPoint = blackboxRingSyncPoint(blackboxRing.syncPointCount++);
+
+    // The frame will be appended to the ring after what's still in the frame buffer
+    syncPoint->position = blackboxRing.head + blackboxFrameBuffer.length;
+    syncPoint->iteration = iteration;
+    syncPoint->time = time;
+}
+
+/**
+ * Call before encoding the first frame of every iteration, a committed capture which overflows the ring is cut
+ * off there.
+ */
+void blackboxRingMarkIteration(void)
+{
+    if (blackboxRing.state == BLACKBOX_RING_DRAINING && !blackboxRing.overflowed) {
+        blackboxRing.iterationStart = blackboxRing.head + blackboxFrameBuffer.length;
+    }
+}
+
+/**
+ * Find the oldest sync point captured at or after the given time, or the newest one if they are all older.
+ *
+ * Returns false if the ring doesn't hold any sync point yet.
+ */
+bool blackboxRingFindSyncPoint(timeUs_t since, blackboxRingSyncPoint_t *syncPoint)
+{
+    blackboxFrameBufferFlush();
+
+    if (blackboxRing.state != BLACKBOX_RING_CAPTURING || blackboxRing.syncPointCount == 0) {
+        return false;
+    }
+
+    for (int i = 0; i < blackboxRing.syncPointCount; i++) {
+        if (cmpTimeUs(blackboxRingSyncPoint(i)->time, since) >= 0 || i == blackboxRing.syncPointCount - 1) {
+            *syncPoint = *blackboxRingSyncPoint(i);
+            break;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Write the ring to the device from the given sync point on. Whatever the frame buffer holds right now is written
+ * to the device first, use it for the frames that introduce the captured data (e.g. a LOGGING_RESUME event).
+ */
+void blackboxRingCommit(const blackboxRingSyncPoint_t *syncPoint)
+{
+    blackboxDeviceWrite(blackboxFrameBuffer.data, blackboxFrameBuffer.length);
+    blackboxFrameBuffer.length = 0;
+
+    blackboxRing.tail = syncPoint->position;
+    blackboxRing.iterationStart = blackboxRing.head;
+    blackboxRing.syncPointCount = 0;
+    blackboxRing.state = BLACKBOX_RING_DRAINING;
+
+    blackboxRingDrain();
+}
+
+/**
+ * Write as much of a committed ring to the device as it accepts without dropping data.
+ *
+ * Returns true if anything was written.
+ */
+bool blackboxRingDrain(void)
+{
+    if (blackboxRing.state != BLACKBOX_RING_DRAINING) {
+        return false;
+    }
+
+    uint32_t budget = MAX(blackboxDeviceGetFreeSpace(), 0);
+    const bool wrote = budget > 0 && blackboxRing.tail != blackboxRing.head;
+
+    while (budget > 0 && blackboxRing.tail != blackboxRing.head) {
+        const uint32_t index = blackboxRing.tail & (BLACKBOX_RING_BUFFER_SIZE - 1);
+        const uint32_t chunk = MIN(MIN(budget, blackboxRing.head - blackboxRing.tail), BLACKBOX_RING_BUFFER_SIZE - index);
+
+        blackboxDeviceWrite(&blackboxRing.data[index], chunk);
+        blackboxRing.tail += chunk;
+        budget -= chunk;
+    }
+
+    if (blackboxRing.tail == blackboxRing.head) {
+        if (blackboxRing.overflowed) {
+            // Frames were dropped, the log can only continue from the next sync point
+            blackboxRingReset();
+            blackboxRing.state = BLACKBOX_RING_CAPTURING;
+        } else {
+            // Caught up, new frames can go to the device directly
+            blackboxRingStop();
+        }
+    }
+
+    return wrote;
+}
+
+#endif
+
+/**
+ * Hand everything the encoder has put into the frame buffer to the device in a single write, or to the ring while
+ * it is in use.
+ */
+void blackboxFrameBufferFlush(void)
+{
+    const int length = blackboxFrameBuffer.length;
+
+    if (length == 0) {
+        return;
+    }
+    blackboxFrameBuffer.length = 0;
+    blackboxFrameBufferTotalBytes += length;
+
+#ifdef USE_BLACKBOX_RING_BUFFER
+    if (blackboxRing.state != BLACKBOX_RING_OFF) {
+        if (!blackboxRingAppend(blackboxFrameBuffer.data, length)) {
+            for (int type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+                blackboxStats.frames[type].dropped += blackboxBufferedFrames[type];
+            }
+            blackboxCurrentFrame.dropped = blackboxCurrentFrame.active;
+        }
+        memset(blackboxBufferedFrames, 0, sizeof(blackboxBufferedFrames));
+        return;
+    }
+#endif
+
+    if (blackboxDeviceWrite(blackboxFrameBuffer.data, length) < length) {
+        // The frames which ended in the buffer are lost, and so is the one still being written
+        for (int type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+            blackboxStats.frames[type].dropped += blackboxBufferedFrames[type];
+        }
+        blackboxCurrentFrame.dropped = blackboxCurrentFrame.active;
+    }
+    memset(blackboxBufferedFrames, 0, sizeof(blackboxBufferedFrames));
+}
+
+void blackboxFrameBegin(blackboxFrameType_e type)
+{
+    blackboxCurrentFrame.active = true;
+    blackboxCurrentFrame.dropped = false;
+    blackboxCurrentFrame.type = type;
+    blackboxCurrentFrame.startBytes = blackboxFrameBufferTotalBytes + blackboxFrameBuffer.length;
+    blackboxCurrentFrame.startTicks = ticks();
+}
+
+void blackboxFrameEnd(void)
+{
+    if (!blackboxCurrentFrame.active) {
+        return;
+    }
+
+    blackboxFrameStats_t *stats = &blackboxStats.frames[blackboxCurrentFrame.type];
+
+    profilerStatsAdd(&stats->encode, ticks() - blackboxCurrentFrame.startTicks);
+    stats->frames++;
+    stats->bytes += blackboxFrameBufferTotalBytes + blackboxFrameBuffer.length - blackboxCurrentFrame.startBytes;
+
+    if (blackboxCurrentFrame.dropped) {
+        stats->dropped++;
+    } else {
+        blackboxBufferedFrames[blackboxCurrentFrame.type]++;
+    }
+
+    blackboxCurrentFrame.active = false;
+}
+
+const blackboxStats_t *blackboxGetStats(void)
+{
+    return &blackboxStats;
+}
+
+void blackboxResetStats(void)
+{
+    memset(&blackboxStats, 0, sizeof(blackboxStats));
+    memset(blackboxBufferedFrames, 0, sizeof(blackboxBufferedFrames));
+    blackboxCurrentFrame.active = false;
+}
+
+char blackboxFrameTypeChar(blackboxFrameType_e type)
+{
+    return "IPSGHE"[type];
+}
+
+void blackboxWriteBuf(const uint8_t *data, int length)
+{
+    while (length > 0) {
+        if (blackboxFrameBuffer.length == BLACKBOX_FRAME_BUFFER_SIZE) {
+            blackboxFrameBufferFlush();
+        }
+
+        const int chunk = MIN(length, BLACKBOX_FRAME_BUFFER_SIZE - blackboxFrameBuffer.length);
+        memcpy(&blackboxFrameBuffer.data[blackboxFrameBuffer.length], data, chunk);
+        blackboxFrameBuffer.length += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+// Print the null-terminated string 's' to the blackbox device and return the number of bytes written
+int blackboxPrint(const char *s)
+{
+    const int length = strlen(s);
+
+    blackboxWriteBuf((const uint8_t*) s, length);
+
     return length;
 }
 
@@ -151,6 +521,11 @@ int blackboxPrint(const char *s)
  */
 void blackboxDeviceFlush(void)
 {
+    blackboxFrameBufferFlush();
+#ifdef USE_BLACKBOX_RING_BUFFER
+    blackboxRingDrain();
+#endif
+
     switch (blackboxConfig()->device) {
 #ifdef USE_FLASHFS
         /*
@@ -174,6 +549,14 @@ void blackboxDeviceFlush(void)
  */
 bool blackboxDeviceFlushForce(void)
 {
+    blackboxFrameBufferFlush();
+#ifdef USE_BLACKBOX_RING_BUFFER
+    blackboxRingDrain();
+    if (blackboxRingGetState() == BLACKBOX_RING_DRAINING) {
+        return false;
+    }
+#endif
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         // Nothing to speed up flushing on serial, as serial is continuously being drained out of its buffer
@@ -203,6 +586,8 @@ bool blackboxDeviceFlushForce(void)
 #ifndef UNIT_TEST
 bool blackboxDeviceOpen(void)
 {
+    blackboxFrameBuffer.length = 0;
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         {
@@ -279,6 +664,11 @@ bool blackboxDeviceOpen(void)
 #ifndef UNIT_TEST
 void blackboxDeviceClose(void)
 {
+    blackboxFrameBufferFlush();
+#ifdef USE_BLACKBOX_RING_BUFFER
+    blackboxRingStop();
+#endif
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         // Since the serial port could be shared with other processes, we have to give it back here
@@ -297,6 +687,7 @@ void blackboxDeviceClose(void)
     case BLACKBOX_DEVICE_FLASH:
         // Some flash device, e.g., NAND devices, require explicit close to flush internally buffered data.
         flashfsClose();
+        flashfsLogFinish();
         break;
 #endif
     default:
@@ -440,9 +831,33 @@ static bool blackboxSDCardBeginLog(void)
  *
  * Keep calling until the function returns true (open is complete).
  */
+#ifdef USE_FLASHFS
+static void blackboxFlashBeginLog(void)
+{
+    rtcTime_t rtcTime;
+    uint8_t flags = 0;
+
+#ifdef USE_BLACKBOX_RING_BUFFER
+    if (blackboxConfig()->mode == BLACKBOX_MODE_TRIGGERED) {
+        flags |= BLACKBOX_LOG_FLAG_TRIGGERED;
+    }
+#endif
+    if (blackboxConfig()->encoding == BLACKBOX_ENCODING_PACKED) {
+        flags |= BLACKBOX_LOG_FLAG_PACKED;
+    }
+
+    flashfsLogStart(rtcGet(&rtcTime) ? rtcTimeGetSeconds(&rtcTime) : 0, flags);
+}
+#endif
+
 bool blackboxDeviceBeginLog(void)
 {
     switch (blackboxConfig()->device) {
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        blackboxFlashBeginLog();
+        return true;
+#endif
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
         return blackboxSDCardBeginLog();
@@ -466,6 +881,8 @@ bool blackboxDeviceEndLog(bool retainLog)
     (void) retainLog;
 #endif
 
+    blackboxFrameBufferFlush();
+
     switch (blackboxConfig()->device) {
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
@@ -488,6 +905,8 @@ bool blackboxDeviceEndLog(bool retainLog)
 
 bool isBlackboxDeviceFull(void)
 {
+    blackboxFrameBufferFlush();
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         return false;
@@ -513,25 +932,9 @@ bool isBlackboxDeviceFull(void)
  */
 void blackboxReplenishHeaderBudget(void)
 {
-    int32_t freeSpace;
+    blackboxFrameBufferFlush();
 
-    switch (blackboxConfig()->device) {
-    case BLACKBOX_DEVICE_SERIAL:
-        freeSpace = serialTxBytesFree(blackboxPort);
-        break;
-#ifdef USE_FLASHFS
-    case BLACKBOX_DEVICE_FLASH:
-        freeSpace = flashfsGetWriteBufferFreeSpace();
-        break;
-#endif
-#ifdef USE_SDCARD
-    case BLACKBOX_DEVICE_SDCARD:
-        freeSpace = afatfs_getFreeBufferSpace();
-        break;
-#endif
-    default:
-        freeSpace = 0;
-    }
+    const int32_t freeSpace = blackboxDeviceGetFreeSpace();
 
     blackboxHeaderBudget = MIN(MIN(freeSpace, blackboxHeaderBudget + blackboxMaxHeaderBytesPerIteration), BLACKBOX_MAX_ACCUMULATED_HEADER_BUDGET);
 }
@@ -556,6 +959,8 @@ void blackboxReplenishHeaderBudget(void)
  */
 blackboxBufferReserveStatus_e blackboxDeviceReserveBufferSpace(int32_t bytes)
 {
+    blackboxFrameBufferFlush();
+
     if (bytes <= blackboxHeaderBudget) {
         return BLACKBOX_RESERVE_SUCCESS;
     }
@@ -22,6 +22,10 @@
 
 #include "platform.h"
 
+#include "build/profiler.h"
+
+#include "common/time.h"
+
 typedef enum BlackboxDevice {
     BLACKBOX_DEVICE_SERIAL = 0,
 
@@ -53,10 +57,109 @@ typedef enum {
  */
 #define BLACKBOX_TARGET_HEADER_BUDGET_PER_ITERATION 64
 
+/*
+ * Encoder output is collected in RAM and handed to the device in blocks, at
+ * the latest once per blackboxUpdate() and whenever the buffer fills up.
+ */
+#define BLACKBOX_FRAME_BUFFER_SIZE 256
+
+typedef struct blackboxFrameBuffer_s {
+    uint16_t length;
+    uint8_t data[BLACKBOX_FRAME_BUFFER_SIZE];
+} blackboxFrameBuffer_t;
+
+/*
+ * Statistics of the current (or last) log, reset when logging starts. Frames that the device didn't take, in full
+ * or in part, are counted as dropped. Encoding time is counted in profiler ticks, from the start of a frame until
+ * it is in the frame buffer, including any device writes in between.
+ */
+typedef enum {
+    BLACKBOX_FRAME_TYPE_INTRA = 0,      // I
+    BLACKBOX_FRAME_TYPE_INTER,          // P
+    BLACKBOX_FRAME_TYPE_SLOW,           // S
+    BLACKBOX_FRAME_TYPE_GPS,            // G
+    BLACKBOX_FRAME_TYPE_GPS_HOME,       // H
+    BLACKBOX_FRAME_TYPE_EVENT,          // E
+    BLACKBOX_FRAME_TYPE_COUNT
+} blackboxFrameType_e;
+
+typedef struct blackboxFrameStats_s {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t dropped;
+    profilerStageStats_t encode;
+} blackboxFrameStats_t;
+
+typedef struct blackboxStats_s {
+    blackboxFrameStats_t frames[BLACKBOX_FRAME_TYPE_COUNT];
+    uint32_t overruns;          // Writes the device didn't take in full
+    uint32_t droppedBytes;
+    uint32_t stalls;            // Writes which had to wait for room in the serial port's buffer
+    uint32_t ringOverflows;     // Triggered captures cut short because the device couldn't keep up
+} blackboxStats_t;
+
+void blackboxFrameBegin(blackboxFrameType_e type);
+void blackboxFrameEnd(void);
+
+const blackboxStats_t *blackboxGetStats(void);
+void blackboxResetStats(void);
+char blackboxFrameTypeChar(blackboxFrameType_e type);
+
 extern int32_t blackboxHeaderBudget;
+extern blackboxFrameBuffer_t blackboxFrameBuffer;
+
+void blackboxFrameBufferFlush(void);
+
+static inline void blackboxWrite(uint8_t value)
+{
+    if (blackboxFrameBuffer.length == BLACKBOX_FRAME_BUFFER_SIZE) {
+        blackboxFrameBufferFlush();
+    }
+    blackboxFrameBuffer.data[blackboxFrameBuffer.length++] = value;
+}
+
+void blackboxWriteBuf(const uint8_t *data, int length);
+
+#ifdef USE_BLACKBOX_RING_BUFFER
+/*
+ * For triggered logging the frame buffer is flushed into a RAM ring instead of the device. Only the newest data
+ * survives there, starting at the oldest sync point (an iteration that begins with an I-frame) which still fits.
+ * Once a trigger fires the ring is committed: logging continues into it while its contents are drained to the
+ * device as fast as the device accepts them, after which the frame buffer goes to the device directly again.
+ */
+#ifndef BLACKBOX_RING_BUFFER_SIZE
+#if defined(STM32H7)
+#define BLACKBOX_RING_BUFFER_SIZE (64 * 1024)
+#else
+#define BLACKBOX_RING_BUFFER_SIZE (16 * 1024)
+#endif
+#endif
+
+#define BLACKBOX_RING_SYNC_POINTS 128
+
+typedef enum {
+    BLACKBOX_RING_OFF = 0,      // Frames go to the device
+    BLACKBOX_RING_CAPTURING,    // Frames go to the ring, old ones are discarded
+    BLACKBOX_RING_DRAINING,     // Frames go to the ring, the ring goes to the device
+} blackboxRingState_e;
+
+typedef struct blackboxRingSyncPoint_s {
+    uint32_t position;
+    uint32_t iteration;
+    timeUs_t time;
+} blackboxRingSyncPoint_t;
+
+void blackboxRingStart(void);
+void blackboxRingStop(void);
+blackboxRingState_e blackboxRingGetState(void);
+void blackboxRingMarkSyncPoint(uint32_t iteration, timeUs_t time);
+void blackboxRingMarkIteration(void);
+bool blackboxRingFindSyncPoint(timeUs_t since, blackboxRingSyncPoint_t *syncPoint);
+void blackboxRingCommit(const blackboxRingSyncPoint_t *syncPoint);
+bool blackboxRingDrain(void);
+#endif
 
 void blackboxOpen(void);
-void blackboxWrite(uint8_t value);
 
 void blackboxDeviceFlush(void);
 bool blackboxDeviceFlushForce(void);
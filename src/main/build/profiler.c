@@ -0,0 +1,140 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "build/build_config.h"
+#include "build/debug.h"
+#include "build/profiler.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/time.h"
+
+static const char * const profilerStageNames[PROFILER_STAGE_COUNT] = {
+    [PROFILER_STAGE_GYRO_FILTER]    = "gyro_filter",
+    [PROFILER_STAGE_IMU]            = "imu",
+    [PROFILER_STAGE_RC]             = "rc",
+    [PROFILER_STAGE_NAVIGATION]     = "navigation",
+    [PROFILER_STAGE_PID]            = "pid",
+    [PROFILER_STAGE_MIXER]          = "mixer",
+    [PROFILER_STAGE_OUTPUT]         = "output",
+    [PROFILER_STAGE_BLACKBOX]       = "blackbox",
+};
+
+STATIC_ASSERT(PROFILER_STAGE_COUNT <= DEBUG32_VALUE_COUNT, profiler_stages_must_fit_debug_values);
+
+STATIC_FASTRAM profilerStageStats_t profilerStats[PROFILER_STAGE_COUNT];
+
+// Time spent in each stage during the current loop, a stage can be marked more than once
+STATIC_FASTRAM uint32_t profilerLoopTicks[PROFILER_STAGE_COUNT];
+STATIC_FASTRAM uint32_t profilerMarkedStages;
+STATIC_FASTRAM uint32_t profilerLastMark;
+
+static uint8_t histogramBucket(uint32_t ticks)
+{
+    if (ticks < (1U << PROFILER_HISTOGRAM_MIN_SHIFT)) {
+        return 0;
+    }
+    return MIN(32 - __builtin_clz(ticks) - PROFILER_HISTOGRAM_MIN_SHIFT, PROFILER_HISTOGRAM_BUCKETS - 1);
+}
+
+// Also used for timings outside of the main loop stages, like blackbox frame encoding
+void profilerStatsAdd(profilerStageStats_t *stats, uint32_t ticks)
+{
+    const uint8_t bucket = histogramBucket(ticks);
+
+    // Halve all counts on overflow so the histogram keeps its shape
+    if (stats->histogram[bucket] == UINT16_MAX) {
+        for (int ii = 0; ii < PROFILER_HISTOGRAM_BUCKETS; ii++) {
+            stats->histogram[ii] >>= 1;
+        }
+    }
+    stats->histogram[bucket]++;
+
+    if (stats->count == 0 || ticks < stats->minTicks) {
+        stats->minTicks = ticks;
+    }
+    stats->maxTicks = MAX(stats->maxTicks, ticks);
+    stats->totalTicks += ticks;
+    stats->count++;
+}
+
+void profilerStart(void)
+{
+    memset(profilerLoopTicks, 0, sizeof(profilerLoopTicks));
+    profilerMarkedStages = 0;
+    profilerLastMark = ticks();
+}
+
+FAST_CODE void profilerMark(profilerStage_e stage)
+{
+    const uint32_t now = ticks();
+
+    profilerLoopTicks[stage] += now - profilerLastMark;
+    profilerMarkedStages |= 1U << stage;
+    profilerLastMark = now;
+}
+
+// Stages that didn't run during this loop are left out of the statistics
+void profilerFinish(void)
+{
+    for (int stage = 0; stage < PROFILER_STAGE_COUNT; stage++) {
+        if (profilerMarkedStages & (1U << stage)) {
+            profilerStatsAdd(&profilerStats[stage], profilerLoopTicks[stage]);
+            DEBUG_SET(DEBUG_LOOP_STAGES, stage, profilerTicksToNs(profilerLoopTicks[stage]));
+        }
+    }
+}
+
+void profilerReset(void)
+{
+    memset(profilerStats, 0, sizeof(profilerStats));
+}
+
+void profilerGetStageStats(profilerStage_e stage, profilerStageStats_t *stats)
+{
+    *stats = profilerStats[stage];
+}
+
+const char *profilerStageName(profilerStage_e stage)
+{
+    return profilerStageNames[stage];
+}
+
+uint32_t profilerTicksPerUs(void)
+{
+    return usTicks;
+}
+
+// Split up so it neither overflows nor needs a 64 bit division
+uint32_t profilerTicksToNs(uint32_t ticks)
+{
+    if (!usTicks) {
+        return 0;
+    }
+    return (ticks / usTicks) * 1000 + (ticks % usTicks) * 1000 / usTicks;
+}
+
+uint32_t profilerHistogramBucketLowerBound(int bucket)
+{
+    return bucket == 0 ? 0 : 1U << (bucket + PROFILER_HISTOGRAM_MIN_SHIFT - 1);
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Section profiler for the stages of taskMainPidLoop(). Time is counted in
+ * ticks(), CPU cycles from the DWT cycle counter on hardware and nanoseconds
+ * on SITL. profilerMark() charges the time since the previous mark to a stage,
+ * so every stage costs a single counter read.
+ */
+typedef enum {
+    PROFILER_STAGE_GYRO_FILTER = 0,
+    PROFILER_STAGE_IMU,
+    PROFILER_STAGE_RC,              // pilot and failsafe actions, arming status, RC interpolation
+    PROFILER_STAGE_NAVIGATION,      // position estimator, navigation and landing detection
+    PROFILER_STAGE_PID,             // throttle compensations and pidController
+    PROFILER_STAGE_MIXER,           // motor and servo mixers
+    PROFILER_STAGE_OUTPUT,          // writing servos and motors
+    PROFILER_STAGE_BLACKBOX,
+    PROFILER_STAGE_COUNT
+} profilerStage_e;
+
+// Log2 bucketed, bucket 0 counts everything below 2^PROFILER_HISTOGRAM_MIN_SHIFT ticks,
+// bucket n > 0 counts [2^(n + MIN_SHIFT - 1), 2^(n + MIN_SHIFT)) ticks and the last bucket everything above
+#define PROFILER_HISTOGRAM_BUCKETS      16
+#define PROFILER_HISTOGRAM_MIN_SHIFT    6
+
+typedef struct profilerStageStats_s {
+    uint32_t count;
+    uint32_t minTicks;
+    uint32_t maxTicks;
+    uint64_t totalTicks;
+    uint16_t histogram[PROFILER_HISTOGRAM_BUCKETS];
+} profilerStageStats_t;
+
+void profilerStart(void);
+void profilerMark(profilerStage_e stage);
+void profilerFinish(void);
+void profilerReset(void);
+
+void profilerGetStageStats(profilerStage_e stage, profilerStageStats_t *stats);
+void profilerStatsAdd(profilerStageStats_t *stats, uint32_t ticks);
+const char *profilerStageName(profilerStage_e stage);
+uint32_t profilerTicksPerUs(void);
+uint32_t profilerTicksToNs(uint32_t ticks);
+uint32_t profilerHistogramBucketLowerBound(int bucket);
@@ -345,4 +345,117 @@ void assignFilterApplyFn(uint8_t filterType, float cutoffFrequency, filterApplyF
             *applyFn = (filterApplyFnPtr) biquadFilterApply;
         }
     }
-}
\ No newline at end of file
+}
+
+/*
+ * Filter bank
+ */
+static void filterBankSetSection(filterBankSection_t *section, float b0, float b1, float b2, float a1, float a2)
+{
+    section->b0 = b0;
+    section->b1 = b1;
+    section->b2 = b2;
+    section->a1 = a1;
+    section->a2 = a2;
+}
+
+// Writes the sections of a low pass stage, returns number of sections used
+static int filterBankSetupLowpass(filterBankSection_t *sections, int maxSections, uint8_t filterType, float cutoffFrequency, uint32_t samplingIntervalUs)
+{
+    const float dT = US2S(samplingIntervalUs);
+    float k;
+
+    if (maxSections < 1) {
+        return 0;
+    }
+
+    switch (filterType) {
+        case FILTER_PT1:
+            k = dT / (pt1ComputeRC(cutoffFrequency) + dT);
+            filterBankSetSection(&sections[0], k, 0.0f, 0.0f, -(1.0f - k), 0.0f);
+            return 1;
+
+        case FILTER_PT2:
+            // Two cascaded PT1 stages with the same gain
+            k = pt2FilterGain(cutoffFrequency, dT);
+            filterBankSetSection(&sections[0], k * k, 0.0f, 0.0f, -2.0f * (1.0f - k), (1.0f - k) * (1.0f - k));
+            return 1;
+
+        case FILTER_PT3:
+            if (maxSections < 2) {
+                return 0;
+            }
+            k = pt3FilterGain(cutoffFrequency, dT);
+            filterBankSetSection(&sections[0], k * k, 0.0f, 0.0f, -2.0f * (1.0f - k), (1.0f - k) * (1.0f - k));
+            filterBankSetSection(&sections[1], k, 0.0f, 0.0f, -(1.0f - k), 0.0f);
+            return 2;
+
+        case FILTER_BIQUAD:
+        default:
+            {
+                biquadFilter_t biquad;
+                biquadFilterInitLPF(&biquad, cutoffFrequency, samplingIntervalUs);
+                filterBankSetSection(&sections[0], biquad.b0, biquad.b1, biquad.b2, biquad.a1, biquad.a2);
+            }
+            return 1;
+    }
+}
+
+void filterBankInit(filterBank_t *bank)
+{
+    memset(bank, 0, sizeof(filterBank_t));
+}
+
+/*
+ * Appends a low pass stage to the bank. Returns stage handle for filterBankUpdateLowpass()
+ * or -1 if cutoff is zero (pass-through) or the bank is full.
+ */
+int8_t filterBankAddLowpass(filterBank_t *bank, uint8_t filterType, float cutoffFrequency, uint32_t samplingIntervalUs)
+{
+    if (!cutoffFrequency) {
+        return -1;
+    }
+
+    const int stage = bank->sectionCount;
+    const int count = filterBankSetupLowpass(&bank->sections[stage], FILTER_BANK_MAX_SECTIONS - stage, filterType, cutoffFrequency, samplingIntervalUs);
+    bank->sectionCount += count;
+
+    return count ? stage : -1;
+}
+
+// Changes cutoff of a stage while keeping filter state
+FAST_CODE void filterBankUpdateLowpass(filterBank_t *bank, int8_t stage, uint8_t filterType, float cutoffFrequency, uint32_t samplingIntervalUs)
+{
+    if (stage < 0 || !cutoffFrequency) {
+        return;
+    }
+
+    filterBankSetupLowpass(&bank->sections[stage], bank->sectionCount - stage, filterType, cutoffFrequency, samplingIntervalUs);
+}
+
+// Filters a three axis sample in place through all sections of the bank
+FAST_CODE void filterBankApply(filterBank_t *bank, float *values)
+{
+    float x[XYZ_AXIS_COUNT] = { values[X], values[Y], values[Z] };
+
+    for (int i = 0; i < bank->sectionCount; i++) {
+        filterBankSection_t *section = &bank->sections[i];
+        const float b0 = section->b0;
+        const float b1 = section->b1;
+        const float b2 = section->b2;
+        const float a1 = section->a1;
+        const float a2 = section->a2;
+
+        // Axes are independent, so their multiply-accumulate chains interleave in the FPU pipeline
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            const float y = b0 * x[axis] + section->s1[axis];
+            section->s1[axis] = b1 * x[axis] - a1 * y + section->s2[axis];
+            section->s2[axis] = b2 * x[axis] - a2 * y;
+            x[axis] = y;
+        }
+    }
+
+    values[X] = x[X];
+    values[Y] = x[Y];
+    values[Z] = x[Z];
+}
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "common/axis.h"
+
 typedef struct rateLimitFilter_s {
     float state;
 } rateLimitFilter_t;
@@ -83,6 +85,25 @@ typedef struct alphaBetaGammaFilter_s {
     pt1Filter_t boostFilter;
 } alphaBetaGammaFilter_t;
 
+/*
+ * Three axis filter bank. Every low pass stage is expressed as one or two second
+ * order sections (PT1 and PT2 as one section, PT3 as two, biquad as one) sharing
+ * coefficients across axes, so all axes and cascaded stages are processed by a
+ * single loop without indirect calls.
+ */
+#define FILTER_BANK_MAX_SECTIONS 4
+
+typedef struct filterBankSection_s {
+    float b0, b1, b2, a1, a2;
+    float s1[XYZ_AXIS_COUNT];   // transposed direct form II state
+    float s2[XYZ_AXIS_COUNT];
+} filterBankSection_t;
+
+typedef struct filterBank_s {
+    uint8_t sectionCount;
+    filterBankSection_t sections[FILTER_BANK_MAX_SECTIONS];
+} filterBank_t;
+
 typedef float (*filterApplyFnPtr)(void *filter, float input);
 typedef float (*filterApply4FnPtr)(void *filter, float input, float f_cut, float dt);
 
@@ -134,4 +155,9 @@ void alphaBetaGammaFilterInit(alphaBetaGammaFilter_t *filter, float alpha, float
 float alphaBetaGammaFilterApply(alphaBetaGammaFilter_t *filter, float input);
 
 void initFilter(uint8_t filterType, filter_t *filter, float cutoffFrequency, uint32_t refreshRate);
-void assignFilterApplyFn(uint8_t filterType, float cutoffFrequency, filterApplyFnPtr *applyFn);
\ No newline at end of file
+void assignFilterApplyFn(uint8_t filterType, float cutoffFrequency, filterApplyFnPtr *applyFn);
+
+void filterBankInit(filterBank_t *bank);
+int8_t filterBankAddLowpass(filterBank_t *bank, uint8_t filterType, float cutoffFrequency, uint32_t samplingIntervalUs);
+void filterBankUpdateLowpass(filterBank_t *bank, int8_t stage, uint8_t filterType, float cutoffFrequency, uint32_t samplingIntervalUs);
+void filterBankApply(filterBank_t *bank, float *values);
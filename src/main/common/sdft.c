@@ -0,0 +1,86 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Alternatively, the contents of this file may be used under the terms
+ * of the GNU General Public License Version 3, as described below:
+ *
+ * This file is free software: you may copy, redistribute and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+#include "common/sdft.h"
+
+/*
+ * Bins firstBin..lastBin are the ones of interest. One extra bin is kept on both
+ * sides of that range so sdftWindowedMagnitude() can apply the Hann window.
+ */
+void sdftInit(sdft_t *sdft, uint8_t windowSize, uint8_t firstBin, uint8_t lastBin)
+{
+    memset(sdft, 0, sizeof(sdft_t));
+
+    sdft->windowSize = MIN(windowSize, SDFT_MAX_WINDOW_SIZE);
+    sdft->startBin = firstBin > 0 ? firstBin - 1 : 0;
+    sdft->endBin = MIN(lastBin + 1, sdft->windowSize / 2);
+    sdft->dampingN = powf(SDFT_DAMPING_FACTOR, sdft->windowSize);
+
+    for (int k = sdft->startBin; k <= sdft->endBin; k++) {
+        const float phi = 2.0f * M_PIf * k / sdft->windowSize;
+        sdft->twiddle[k].re = cos_approx(phi);
+        sdft->twiddle[k].im = sin_approx(phi);
+    }
+}
+
+// Cost is one complex multiply-add per tracked bin
+FAST_CODE void sdftPush(sdft_t *sdft, float sample)
+{
+    const float delta = sample - sdft->dampingN * sdft->samples[sdft->sampleIdx];
+
+    sdft->samples[sdft->sampleIdx] = sample;
+    sdft->sampleIdx = (sdft->sampleIdx + 1) % sdft->windowSize;
+
+    for (int k = sdft->startBin; k <= sdft->endBin; k++) {
+        const float re = SDFT_DAMPING_FACTOR * sdft->data[k].re + delta;
+        const float im = SDFT_DAMPING_FACTOR * sdft->data[k].im;
+
+        sdft->data[k].re = re * sdft->twiddle[k].re - im * sdft->twiddle[k].im;
+        sdft->data[k].im = re * sdft->twiddle[k].im + im * sdft->twiddle[k].re;
+    }
+}
+
+/*
+ * Magnitude of Hann windowed bins firstBin..lastBin, written to output[bin].
+ * The window is applied in the frequency domain as a 3 tap convolution.
+ */
+void sdftWindowedMagnitude(const sdft_t *sdft, float *output, uint8_t firstBin, uint8_t lastBin)
+{
+    firstBin = MAX(firstBin, sdft->startBin + 1);
+    lastBin = MIN(lastBin, sdft->endBin - 1);
+
+    for (int k = firstBin; k <= lastBin; k++) {
+        const float re = 0.5f * sdft->data[k].re - 0.25f * (sdft->data[k - 1].re + sdft->data[k + 1].re);
+        const float im = 0.5f * sdft->data[k].im - 0.25f * (sdft->data[k - 1].im + sdft->data[k + 1].im);
+
+        output[k] = sqrtf(re * re + im * im);
+    }
+}
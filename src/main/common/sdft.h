@@ -0,0 +1,58 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Alternatively, the contents of this file may be used under the terms
+ * of the GNU General Public License Version 3, as described below:
+ *
+ * This file is free software: you may copy, redistribute and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Sliding DFT, updates a range of DFT bins with every new sample instead of
+ * transforming the whole window at once. Bin k holds the DFT of the last
+ * windowSize samples, oldest sample first.
+ */
+#define SDFT_MAX_WINDOW_SIZE    128
+#define SDFT_MAX_BIN_COUNT      (SDFT_MAX_WINDOW_SIZE / 2 + 1)
+
+// Keeps the recursion stable against float rounding, error decays instead of accumulating
+#define SDFT_DAMPING_FACTOR     0.9999f
+
+typedef struct complex_s {
+    float re;
+    float im;
+} complex_t;
+
+typedef struct sdft_s {
+    uint8_t windowSize;
+    uint8_t sampleIdx;
+    uint8_t startBin;           // first updated bin, one below the first bin of interest for windowing
+    uint8_t endBin;             // last updated bin, one above the last bin of interest for windowing
+    float dampingN;             // damping factor to the power of windowSize
+    float samples[SDFT_MAX_WINDOW_SIZE];
+    complex_t data[SDFT_MAX_BIN_COUNT];
+    complex_t twiddle[SDFT_MAX_BIN_COUNT];
+} sdft_t;
+
+void sdftInit(sdft_t *sdft, uint8_t windowSize, uint8_t firstBin, uint8_t lastBin);
+void sdftPush(sdft_t *sdft, float sample);
+void sdftWindowedMagnitude(const sdft_t *sdft, float *output, uint8_t firstBin, uint8_t lastBin);
@@ -315,15 +315,16 @@ bool rtcHasTime(void)
 bool rtcGet(rtcTime_t *t)
 {
 #ifdef SITL_BUILD
-    *t = (rtcTime_t)(time(NULL) * 1000);
-    return true;
-#else 
+    if (sitlClockIsRealtime()) {
+        *t = (rtcTime_t)(time(NULL) * 1000);
+        return true;
+    }
+#endif
     if (!rtcHasTime()) {
         return false;
     }
     *t = started + millis();
     return true;
-#endif
 }
 
 bool rtcSet(rtcTime_t *t)
@@ -82,3 +82,29 @@ bool gyroCheckDataReady(gyroDev_t* gyro)
     }
     return ret;
 }
+
+/*
+ * Called by drivers which batch samples in the sensor FIFO. The sensor samples at fifoRateHz
+ * while the gyro task keeps the requested interval and drains whatever is buffered. When the
+ * interval isn't a whole number of sensor samples (250us at 6.66kHz) the batch size alternates,
+ * e.g. between 1 and 2 samples. A sensor slower than the requested interval sets the interval.
+ */
+void gyroSetFifoSampleRate(gyroDev_t *gyro, uint16_t fifoRateHz)
+{
+    gyro->fifoSampleIntervalUs = 1000000 / fifoRateHz;
+    gyro->sampleRateIntervalUs = constrain(gyro->requestedSampleIntervalUs, gyro->fifoSampleIntervalUs, gyro->fifoSampleIntervalUs * GYRO_FIFO_MAX_SAMPLES);
+}
+
+/*
+ * Drivers call this after unpacking count samples into fifoRaw. The newest sample is mirrored
+ * into gyroADCRaw so calibration and single sample consumers keep working.
+ */
+void gyroFifoCompleteRead(gyroDev_t *gyro, uint8_t count)
+{
+    gyro->fifoCount = count;
+    if (count > 0) {
+        gyro->gyroADCRaw[X] = gyro->fifoRaw[count - 1][X];
+        gyro->gyroADCRaw[Y] = gyro->fifoRaw[count - 1][Y];
+        gyro->gyroADCRaw[Z] = gyro->fifoRaw[count - 1][Z];
+    }
+}
@@ -30,6 +30,9 @@
 #define GYRO_LPF_5HZ        6
 #define GYRO_LPF_NONE       7
 
+#define GYRO_FIFO_MAX_SAMPLES   8                       // Max samples drained from sensor FIFO per gyro task run
+#define GYRO_FIFO_RATE_HZ       8000                    // Preferred sensor ODR when FIFO batching is used
+
 typedef struct {
     uint8_t gyroLpf;
     uint16_t gyroRateHz;
@@ -52,6 +55,11 @@ typedef struct gyroDev_s {
     volatile bool dataReady;
     uint32_t sampleRateIntervalUs;                      // Gyro driver should set this to actual sampling rate as signaled by IRQ
     sensor_align_e gyroAlign;
+    bool useFifo;                                       // Configuration value: batch samples in sensor FIFO if driver supports it
+    sensorGyroReadFuncPtr readFifoFn;                   // read all buffered samples, set by driver only when FIFO batching is active
+    uint32_t fifoSampleIntervalUs;                      // Sensor sampling interval while FIFO batching is active
+    uint8_t fifoCount;                                  // Number of samples in fifoRaw, oldest first
+    int16_t fifoRaw[GYRO_FIFO_MAX_SAMPLES][XYZ_AXIS_COUNT];
 } gyroDev_t;
 
 typedef struct accDev_s {
@@ -66,3 +74,5 @@ typedef struct accDev_s {
 
 const gyroFilterAndRateConfig_t * chooseGyroConfig(uint8_t desiredLpf, uint16_t desiredRateHz, const gyroFilterAndRateConfig_t * configs, int count);
 bool gyroCheckDataReady(struct gyroDev_s *gyro);
+void gyroSetFifoSampleRate(gyroDev_t *gyro, uint16_t fifoRateHz);
+void gyroFifoCompleteRead(gyroDev_t *gyro, uint8_t count);
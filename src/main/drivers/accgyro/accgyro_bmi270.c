@@ -120,12 +120,18 @@ typedef enum {
 #define BMI270_BWP_OSR2 0x10
 #define BMI270_BWP_NORM 0x20
 
+#define BMI270_FIFO_CONFIG_0_STREAM 0x00
+#define BMI270_FIFO_CONFIG_1_GYR_EN 0x80  // headerless mode, gyro frames only
+#define BMI270_FIFO_FRAME_SIZE 6
+#define BMI270_FIFO_EMPTY_SAMPLE ((int16_t)0x8000)
+
 typedef struct __attribute__ ((__packed__)) bmi270ContextData_s {
     uint16_t    chipMagicNumber;
     uint8_t     lastReadStatus;
     uint8_t     __padding_dummy;
     uint8_t     accRaw[6];
     uint8_t     gyroRaw[6];
+    uint8_t     fifoEnabled;
 } bmi270ContextData_t;
 
 STATIC_ASSERT(sizeof(bmi270ContextData_t) < BUS_SCRATCHPAD_MEMORY_SIZE, busDevice_scratchpad_memory_too_small);
@@ -192,6 +198,47 @@ static void bmi270UploadConfig(busDevice_t * busDev)
     delay(1);
 }
 
+static bool bmi270GyroReadFifo(gyroDev_t *gyro)
+{
+    // First byte of every read is the SPI dummy byte
+    uint8_t data[1 + BMI270_FIFO_FRAME_SIZE * GYRO_FIFO_MAX_SAMPLES];
+
+    if (!busReadBuf(gyro->busDev, BMI270_REG_FIFO_LENGTH_LSB, data, 3)) {
+        return false;
+    }
+
+    // Anything above GYRO_FIFO_MAX_SAMPLES is left for the next read
+    const int fifoLength = ((data[2] & 0x3F) << 8) | data[1];
+    const int frameCount = MIN(fifoLength / BMI270_FIFO_FRAME_SIZE, GYRO_FIFO_MAX_SAMPLES);
+    if (frameCount == 0) {
+        return false;
+    }
+
+    if (!busReadBuf(gyro->busDev, BMI270_REG_FIFO_DATA, data, 1 + frameCount * BMI270_FIFO_FRAME_SIZE)) {
+        return false;
+    }
+
+    uint8_t count = 0;
+    for (int i = 0; i < frameCount; i++) {
+        const uint8_t * frame = &data[1 + i * BMI270_FIFO_FRAME_SIZE];
+        const int16_t x = (int16_t)((frame[1] << 8) | frame[0]);
+        const int16_t y = (int16_t)((frame[3] << 8) | frame[2]);
+        const int16_t z = (int16_t)((frame[5] << 8) | frame[4]);
+
+        if (x == BMI270_FIFO_EMPTY_SAMPLE && y == BMI270_FIFO_EMPTY_SAMPLE && z == BMI270_FIFO_EMPTY_SAMPLE) {
+            continue;
+        }
+
+        gyro->fifoRaw[count][X] = x;
+        gyro->fifoRaw[count][Y] = y;
+        gyro->fifoRaw[count][Z] = z;
+        count++;
+    }
+
+    gyroFifoCompleteRead(gyro, count);
+    return count > 0;
+}
+
 static void bmi270AccAndGyroInit(gyroDev_t *gyro)
 {
     busDevice_t * busDev = gyro->busDev;
@@ -219,9 +266,14 @@ static void bmi270AccAndGyroInit(gyroDev_t *gyro)
 
     // Configure the gyro
     // Figure out suitable filter configuration
-    const gyroFilterAndRateConfig_t * config = chooseGyroConfig(gyro->lpf, 1000000 / gyro->requestedSampleIntervalUs, &gyroConfigs[0], ARRAYLEN(gyroConfigs));
+    const uint16_t desiredRateHz = gyro->useFifo ? GYRO_FIFO_RATE_HZ : 1000000 / gyro->requestedSampleIntervalUs;
+    const gyroFilterAndRateConfig_t * config = chooseGyroConfig(gyro->lpf, desiredRateHz, &gyroConfigs[0], ARRAYLEN(gyroConfigs));
 
-    gyro->sampleRateIntervalUs = 1000000 / config->gyroRateHz;
+    if (gyro->useFifo) {
+        gyroSetFifoSampleRate(gyro, config->gyroRateHz);
+    } else {
+        gyro->sampleRateIntervalUs = 1000000 / config->gyroRateHz;
+    }
 
     busWrite(busDev, BMI270_REG_GYRO_CONF, config->gyroConfigValues[0] | BMI270_GYRO_CONF_NOISE_PERF | BMI270_GYRO_CONF_FILTER_PERF);
     delay(1);
@@ -245,6 +297,20 @@ static void bmi270AccAndGyroInit(gyroDev_t *gyro)
     // Enable the gyro and accelerometer
     busWrite(busDev, BMI270_REG_PWR_CTRL, BMI270_PWR_CTRL_GYR_EN | BMI270_PWR_CTRL_ACC_EN);
     delay(1);
+
+    bmi270ContextData_t * ctx = busDeviceGetScratchpadMemory(busDev);
+    ctx->fifoEnabled = gyro->useFifo;
+
+    if (gyro->useFifo) {
+        // Stream gyro frames into FIFO, accelerometer is read from data registers
+        busWrite(busDev, BMI270_REG_FIFO_CONFIG_0, BMI270_FIFO_CONFIG_0_STREAM);
+        delay(1);
+
+        busWrite(busDev, BMI270_REG_FIFO_CONFIG_1, BMI270_FIFO_CONFIG_1_GYR_EN);
+        delay(1);
+
+        gyro->readFifoFn = bmi270GyroReadFifo;
+    }
 }
 
 
@@ -268,6 +334,11 @@ static bool bmi270AccReadScratchpad(accDev_t *acc)
 {
     bmi270ContextData_t * ctx = busDeviceGetScratchpadMemory(acc->busDev);
 
+    // With FIFO batching gyro reads do not fetch the accelerometer registers
+    if (ctx->fifoEnabled) {
+        ctx->lastReadStatus = busReadBuf(acc->busDev, BMI270_REG_ACC_DATA_X_LSB, &ctx->__padding_dummy, 6 + 1);
+    }
+
     if (ctx->lastReadStatus) {
         acc->ADCRaw[X] = (int16_t)((ctx->accRaw[1] << 8) | ctx->accRaw[0]);
         acc->ADCRaw[Y] = (int16_t)((ctx->accRaw[3] << 8) | ctx->accRaw[2]);
@@ -55,6 +55,26 @@
 #define ICM42605_RA_GYRO_DATA_X1                    0x25
 #define ICM42605_RA_ACCEL_DATA_X1                   0x1F
 
+#define ICM42605_RA_FIFO_CONFIG                     0x16
+#define ICM42605_FIFO_MODE_STREAM                   (1 << 6)
+
+#define ICM42605_RA_FIFO_COUNTH                     0x2E
+#define ICM42605_RA_FIFO_DATA                       0x30
+
+#define ICM42605_RA_INTF_CONFIG0                    0x4C
+#define ICM42605_FIFO_COUNT_REC                     (1 << 6)
+#define ICM42605_FIFO_COUNT_ENDIAN_BIG              (1 << 5)
+#define ICM42605_SENSOR_DATA_ENDIAN_BIG             (1 << 4)
+
+#define ICM42605_RA_FIFO_CONFIG1                    0x5F
+#define ICM42605_FIFO_GYRO_EN                       (1 << 1)
+#define ICM42605_FIFO_TEMP_EN                       (1 << 2)
+
+// FIFO packet 2: header, gyro XYZ, temperature
+#define ICM42605_FIFO_PACKET_SIZE                   8
+#define ICM42605_FIFO_HEADER_EMPTY                  (1 << 7)
+#define ICM42605_FIFO_HEADER_GYRO                   (1 << 5)
+
 #define ICM42605_RA_INT_CONFIG                      0x14
 #define ICM42605_INT1_MODE_PULSED                   (0 << 2)
 #define ICM42605_INT1_MODE_LATCHED                  (1 << 2)
@@ -148,12 +168,52 @@ static const gyroFilterAndRateConfig_t icm42605GyroConfigs[] = {
     { GYRO_LPF_10HZ,     500,   { 7,    15 } }  /* 12.5 HZ */
 };
 
+static bool icm42605GyroReadFifo(gyroDev_t *gyro)
+{
+    uint8_t data[ICM42605_FIFO_PACKET_SIZE * GYRO_FIFO_MAX_SAMPLES];
+
+    if (!busReadBuf(gyro->busDev, ICM42605_RA_FIFO_COUNTH, data, 2)) {
+        return false;
+    }
+
+    // Anything above GYRO_FIFO_MAX_SAMPLES is left for the next read
+    const int packetCount = MIN((data[0] << 8) | data[1], GYRO_FIFO_MAX_SAMPLES);
+    if (packetCount == 0) {
+        return false;
+    }
+
+    if (!busReadBuf(gyro->busDev, ICM42605_RA_FIFO_DATA, data, packetCount * ICM42605_FIFO_PACKET_SIZE)) {
+        return false;
+    }
+
+    uint8_t count = 0;
+    for (int i = 0; i < packetCount; i++) {
+        const uint8_t * packet = &data[i * ICM42605_FIFO_PACKET_SIZE];
+        if ((packet[0] & ICM42605_FIFO_HEADER_EMPTY) || !(packet[0] & ICM42605_FIFO_HEADER_GYRO)) {
+            continue;
+        }
+
+        gyro->fifoRaw[count][X] = (int16_t)((packet[1] << 8) | packet[2]);
+        gyro->fifoRaw[count][Y] = (int16_t)((packet[3] << 8) | packet[4]);
+        gyro->fifoRaw[count][Z] = (int16_t)((packet[5] << 8) | packet[6]);
+        count++;
+    }
+
+    gyroFifoCompleteRead(gyro, count);
+    return count > 0;
+}
+
 static void icm42605AccAndGyroInit(gyroDev_t *gyro)
 {
     busDevice_t * dev = gyro->busDev;
-    const gyroFilterAndRateConfig_t * config = chooseGyroConfig(gyro->lpf, 1000000 / gyro->requestedSampleIntervalUs,
+    const uint16_t desiredRateHz = gyro->useFifo ? GYRO_FIFO_RATE_HZ : 1000000 / gyro->requestedSampleIntervalUs;
+    const gyroFilterAndRateConfig_t * config = chooseGyroConfig(gyro->lpf, desiredRateHz,
                                                                 &icm42605GyroConfigs[0], ARRAYLEN(icm42605GyroConfigs));
-    gyro->sampleRateIntervalUs = 1000000 / config->gyroRateHz;
+    if (gyro->useFifo) {
+        gyroSetFifoSampleRate(gyro, config->gyroRateHz);
+    } else {
+        gyro->sampleRateIntervalUs = 1000000 / config->gyroRateHz;
+    }
 
     busSetSpeed(dev, BUS_SPEED_INITIALIZATION);
 
@@ -190,6 +250,20 @@ static void icm42605AccAndGyroInit(gyroDev_t *gyro)
     busWrite(dev, ICM42605_RA_INT_CONFIG1, intConfig1Value);
     delay(15);
 
+    if (gyro->useFifo) {
+        // Gyro only packets streamed into FIFO, count reported in records
+        busWrite(dev, ICM42605_RA_INTF_CONFIG0, ICM42605_FIFO_COUNT_REC | ICM42605_FIFO_COUNT_ENDIAN_BIG | ICM42605_SENSOR_DATA_ENDIAN_BIG);
+        delay(15);
+
+        busWrite(dev, ICM42605_RA_FIFO_CONFIG1, ICM42605_FIFO_GYRO_EN | ICM42605_FIFO_TEMP_EN);
+        delay(15);
+
+        busWrite(dev, ICM42605_RA_FIFO_CONFIG, ICM42605_FIFO_MODE_STREAM);
+        delay(15);
+
+        gyro->readFifoFn = icm42605GyroReadFifo;
+    }
+
     busSetSpeed(dev, BUS_SPEED_FAST);
 }
 
@@ -52,6 +52,9 @@ typedef struct __attribute__ ((__packed__)) lsm6DContextData_s {
 
 static uint8_t lsm6dID = 0x6C;
 
+#define LSM6DSO_GYRO_RATE_HZ        6664
+#define LSM6DSO_FIFO_WORD_SIZE      7   // tag, XYZ
+
 static void lsm6dxxWriteRegister(const  busDevice_t *dev, lsm6dxxRegister_e registerID, uint8_t value, unsigned delayMs)
 {
     busWrite(dev, registerID, value);
@@ -85,11 +88,53 @@ static uint8_t getLsmDlpfBandwidth(gyroDev_t *gyro)
     return 0;
 }
 
+static bool lsm6dsoGyroReadFifo(gyroDev_t *gyro)
+{
+    uint8_t data[LSM6DSO_FIFO_WORD_SIZE * GYRO_FIFO_MAX_SAMPLES];
+
+    if (!busReadBuf(gyro->busDev, LSM6DXX_REG_FIFO_STATUS1, data, 2)) {
+        return false;
+    }
+
+    // Anything above GYRO_FIFO_MAX_SAMPLES is left for the next read
+    const int wordCount = MIN(((data[1] & 0x03) << 8) | data[0], GYRO_FIFO_MAX_SAMPLES);
+    if (wordCount == 0) {
+        return false;
+    }
+
+    // Burst reads of FIFO output registers roll back to the tag register after each word
+    if (!busReadBuf(gyro->busDev, LSM6DXX_REG_FIFO_DATA_OUT_TAG, data, wordCount * LSM6DSO_FIFO_WORD_SIZE)) {
+        return false;
+    }
+
+    uint8_t count = 0;
+    for (int i = 0; i < wordCount; i++) {
+        const uint8_t * word = &data[i * LSM6DSO_FIFO_WORD_SIZE];
+        if ((word[0] >> 3) != LSM6DXX_VAL_FIFO_TAG_GYRO) {
+            continue;
+        }
+
+        gyro->fifoRaw[count][X] = (int16_t)((word[2] << 8) | word[1]);
+        gyro->fifoRaw[count][Y] = (int16_t)((word[4] << 8) | word[3]);
+        gyro->fifoRaw[count][Z] = (int16_t)((word[6] << 8) | word[5]);
+        count++;
+    }
+
+    gyroFifoCompleteRead(gyro, count);
+    return count > 0;
+}
+
 static void lsm6dxxConfig(gyroDev_t *gyro)
 { 
     busDevice_t * dev = gyro->busDev;
     const gyroFilterAndRateConfig_t * config = mpuChooseGyroConfig(gyro->lpf, 1000000 / gyro->requestedSampleIntervalUs);
-    gyro->sampleRateIntervalUs = 1000000 / config->gyroRateHz;
+    // FIFO batching is implemented for LSM6DSO only
+    const bool useFifo = gyro->useFifo && lsm6dID == LSM6DSO_CHIP_ID;
+    if (useFifo) {
+        gyroSetFifoSampleRate(gyro, LSM6DSO_GYRO_RATE_HZ);
+    } else {
+        gyro->sampleRateIntervalUs = 1000000 / config->gyroRateHz;
+    }
 
     busSetSpeed(dev, BUS_SPEED_INITIALIZATION);
     // Reset the device (wait 100ms before continuing config)
@@ -136,6 +181,13 @@ static void lsm6dxxConfig(gyroDev_t *gyro)
         lsm6dxxWriteRegisterBits(dev, LSM6DXX_REG_CTRL9_XL, LSM6DXX_MASK_CTRL9_XL, LSM6DXX_VAL_CTRL9_XL_I3C_DISABLE, 1);
     }
 
+    if (useFifo) {
+        // Batch gyro samples only, accelerometer is read from output registers
+        lsm6dxxWriteRegister(dev, LSM6DXX_REG_FIFO_CTRL3, LSM6DXX_VAL_FIFO_CTRL3_BDR_GY_6667 << 4, 1);
+        lsm6dxxWriteRegister(dev, LSM6DXX_REG_FIFO_CTRL4, LSM6DXX_VAL_FIFO_CTRL4_CONTINUOUS, 1);
+        gyro->readFifoFn = lsm6dsoGyroReadFifo;
+    }
+
     busSetSpeed(dev, BUS_SPEED_FAST);
 }
 
@@ -22,6 +22,8 @@
 
 // LSM6DXX registers (not the complete list)
 typedef enum {
+    LSM6DXX_REG_FIFO_CTRL3 = 0x09, // FIFO batch data rates (LSM6DSO)
+    LSM6DXX_REG_FIFO_CTRL4 = 0x0A, // FIFO mode (LSM6DSO)
     LSM6DXX_REG_COUNTER_BDR1 = 0x0B,// Counter batch data rate register LSM6DSL_REG_DRDY_PULSED_CFG_G
     LSM6DXX_REG_INT1_CTRL = 0x0D,  // int pin 1 control
     LSM6DXX_REG_INT2_CTRL = 0x0E,  // int pin 2 control
@@ -51,6 +53,9 @@ typedef enum {
     LSM6DXX_REG_OUTY_H_A = 0x2B,   // acc Y axis MSB
     LSM6DXX_REG_OUTZ_L_A = 0x2C,   // acc Z axis LSB
     LSM6DXX_REG_OUTZ_H_A = 0x2D,   // acc Z axis MSB
+    LSM6DXX_REG_FIFO_STATUS1 = 0x3A, // FIFO unread words LSB (LSM6DSO)
+    LSM6DXX_REG_FIFO_STATUS2 = 0x3B, // FIFO unread words MSB and flags (LSM6DSO)
+    LSM6DXX_REG_FIFO_DATA_OUT_TAG = 0x78, // FIFO word tag, followed by 6 data bytes (LSM6DSO)
 } lsm6dxxRegister_e;
   
 // LSM6DXX register configuration values
@@ -87,6 +92,9 @@ typedef enum {
     LSM6DXX_VAL_CTRL7_G_HPM_G_260 = 0x02,     // (bits 5:4) gyro HPF cutoff 260mHz
     LSM6DXX_VAL_CTRL7_G_HPM_G_1040 = 0x03,    // (bits 5:4) gyro HPF cutoff 1.04Hz
     LSM6DXX_VAL_CTRL9_XL_I3C_DISABLE = BIT(1),// (bit 1) disable I3C interface
+    LSM6DXX_VAL_FIFO_CTRL3_BDR_GY_6667 = 0x0A,// (bits 7:4) batch gyro into FIFO at 6667hz
+    LSM6DXX_VAL_FIFO_CTRL4_CONTINUOUS = 0x06, // (bits 2:0) continuous FIFO mode
+    LSM6DXX_VAL_FIFO_TAG_GYRO = 0x01,         // (bits 7:3) FIFO word tag of gyro samples
 } lsm6dxxConfigValues_e;
 
 // LSM6DXX register configuration bit masks
@@ -0,0 +1,83 @@
+/*
+ * This file is part of INAV.
+ *
+ * INAV is free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * INAV is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_CRC_HW
+
+#include "common/utils.h"
+
+#include "drivers/crc_hw.h"
+#include "drivers/rcc.h"
+
+/*
+ * The programmable CRC unit of the F7 and H7. It is shared by all callers, a caller that
+ * interrupts another one while the unit is busy gets false and falls back to software.
+ */
+static volatile bool crcHwBusy;
+static bool crcHwClockEnabled;
+
+bool crcHwCalculate(crcHwPolySize_e polySize, uint32_t polynomial, uint32_t *crc, const void *data, uint32_t length)
+{
+    if (crcHwBusy) {
+        return false;
+    }
+
+    crcHwBusy = true;
+
+    if (!crcHwClockEnabled) {
+#if defined(STM32H7)
+        RCC_ClockCmd(RCC_AHB4(CRC), ENABLE);
+#else
+        RCC_ClockCmd(RCC_AHB1(CRC), ENABLE);
+#endif
+        crcHwClockEnabled = true;
+    }
+
+    CRC->POL = polynomial;
+    CRC->INIT = *crc;
+    // Loads INIT into the result register
+    CRC->CR = (polySize == CRC_HW_POLY_8 ? CRC_CR_POLYSIZE_1 : CRC_CR_POLYSIZE_0) | CRC_CR_RESET;
+
+    const uint8_t *p = data;
+
+    // A word is shifted in from bit 31, so the bytes are swapped to keep the buffer order
+    for (; length >= 4; length -= 4, p += 4) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        CRC->DR = __REV(word);
+    }
+
+    for (; length; length--, p++) {
+        *(__IO uint8_t *)&CRC->DR = *p;
+    }
+
+    *crc = polySize == CRC_HW_POLY_8 ? (uint8_t)CRC->DR : (uint16_t)CRC->DR;
+
+    crcHwBusy = false;
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * This file is part of INAV.
+ *
+ * INAV is free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * INAV is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    CRC_HW_POLY_8,
+    CRC_HW_POLY_16,
+} crcHwPolySize_e;
+
+// MSB first CRC without reflection or final XOR, `crc` is the start value and receives the result.
+// Returns false if the unit is in use by an interrupted caller, the CRC has to be computed in software then.
+bool crcHwCalculate(crcHwPolySize_e polySize, uint32_t polynomial, uint32_t *crc, const void *data, uint32_t length);
@@ -31,6 +31,7 @@
 #include "flash.h"
 #include "flash_m25p16.h"
 #include "flash_w25n01g.h"
+#include "flash_file.h"
 
 #include "common/time.h"
 
@@ -50,6 +51,7 @@ static flashDriver_t flashDrivers[] = {
         .eraseSector = m25p16_eraseSector,
         .eraseCompletely = m25p16_eraseCompletely,
         .pageProgram = m25p16_pageProgram,
+        .pageProgramMultiple = m25p16_pageProgramMultiple,
         .readBytes = m25p16_readBytes,
         .getGeometry = m25p16_getGeometry,
         .flush = NULL
@@ -64,6 +66,7 @@ static flashDriver_t flashDrivers[] = {
         .eraseSector = w25n01g_eraseSector,
         .eraseCompletely = w25n01g_eraseCompletely,
         .pageProgram = w25n01g_pageProgram,
+        .pageProgramMultiple = NULL,
         .readBytes = w25n01g_readBytes,
         .getGeometry = w25n01g_getGeometry,
         .flush = w25n01g_flush
@@ -72,6 +75,21 @@ static flashDriver_t flashDrivers[] = {
 
 #endif
 
+#ifdef USE_FLASH_FILE
+    {
+        .init = flashFile_init,
+        .isReady = flashFile_isReady,
+        .waitForReady = flashFile_waitForReady,
+        .eraseSector = flashFile_eraseSector,
+        .eraseCompletely = flashFile_eraseCompletely,
+        .pageProgram = flashFile_pageProgram,
+        .pageProgramMultiple = flashFile_pageProgramMultiple,
+        .readBytes = flashFile_readBytes,
+        .getGeometry = flashFile_getGeometry,
+        .flush = NULL
+    },
+#endif
+
 };
 
 static flashDriver_t *flash;
@@ -122,6 +140,33 @@ uint32_t flashPageProgram(uint32_t address, const uint8_t *data, int length)
     return flash->pageProgram(address, data, length);
 }
 
+/**
+ * Program the concatenation of several buffers into one page, the total length must not cross a page boundary.
+ *
+ * Drivers that support it send all buffers in a single program operation, so the caller doesn't have to wait for
+ * the flash to become ready between them. Others fall back to one program operation per buffer.
+ */
+uint32_t flashPageProgramMultiple(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount)
+{
+    if (flash->pageProgramMultiple) {
+        return flash->pageProgramMultiple(address, buffers, bufferSizes, bufferCount);
+    }
+
+    for (int i = 0; i < bufferCount; i++) {
+        if (bufferSizes[i] > 0) {
+            const uint32_t nextAddress = flash->pageProgram(address, buffers[i], bufferSizes[i]);
+
+            if (nextAddress == address) {
+                // Timeout
+                break;
+            }
+            address = nextAddress;
+        }
+    }
+
+    return address;
+}
+
 int flashReadBytes(uint32_t address, uint8_t *buffer, int length)
 {
     return flash->readBytes(address, buffer, length);
@@ -129,7 +174,10 @@ int flashReadBytes(uint32_t address, uint8_t *buffer, int length)
 
 void flashFlush(void)
 {
-    flash->flush();
+    // Only chips that buffer page programs need a flush
+    if (flash->flush) {
+        flash->flush();
+    }
 }
 
 const flashGeometry_t *flashGetGeometry(void)
@@ -214,11 +262,12 @@ static void flashConfigurePartitions(void)
 #endif
 
 #ifdef USE_FLASHFS
+    createPartition(FLASH_PARTITION_TYPE_FLASHFS_LOG_INDEX, flashGeometry->sectorSize, &endSector);
     flashPartitionSet(FLASH_PARTITION_TYPE_FLASHFS, startSector, endSector);
 #endif
 }
 
-flashPartition_t *flashPartitionFindByType(uint8_t type)
+flashPartition_t *flashPartitionFindByType(flashPartitionType_e type)
 {
     for (int index = 0; index < FLASH_MAX_PARTITIONS; index++) {
         flashPartition_t *candidate = &flashPartitionTable.partitions[index];
@@ -264,6 +313,9 @@ static const char *flashPartitionNames[] = {
     "FIRMWARE ",
     "CONFIG   ",
     "FW UPDT  ",
+    "FW META  ",
+    "UPDATE FW",
+    "LOG INDEX",
 };
 
 const char *flashPartitionGetTypeName(flashPartitionType_e type)
@@ -50,11 +50,15 @@ typedef struct
     void (*eraseSector)(uint32_t address);
     void (*eraseCompletely)(void);
     uint32_t (*pageProgram)(uint32_t address, const uint8_t *data, int length);
+    uint32_t (*pageProgramMultiple)(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount);
     int (*readBytes)(uint32_t address, uint8_t *buffer, int length);
     void (*flush)(void);
     const flashGeometry_t *(*getGeometry)(void);
 } flashDriver_t;
 
+// Most buffers a single flashPageProgramMultiple() call can take
+#define FLASH_PROGRAM_MAX_BUFFERS 3
+
 bool flashInit(void);
 
 bool flashIsReady(void);
@@ -62,6 +66,7 @@ bool flashWaitForReady(timeMs_t timeoutMillis);
 void flashEraseSector(uint32_t address);
 void flashEraseCompletely(void);
 uint32_t flashPageProgram(uint32_t address, const uint8_t *data, int length);
+uint32_t flashPageProgramMultiple(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount);
 int flashReadBytes(uint32_t address, uint8_t *buffer, int length);
 void flashFlush(void);
 const flashGeometry_t *flashGetGeometry(void);
@@ -90,6 +95,7 @@ typedef enum {
     FLASH_PARTITION_TYPE_FULL_BACKUP,
     FLASH_PARTITION_TYPE_FIRMWARE_UPDATE_META,
     FLASH_PARTITION_TYPE_UPDATE_FIRMWARE,
+    FLASH_PARTITION_TYPE_FLASHFS_LOG_INDEX,
     FLASH_MAX_PARTITIONS
 } flashPartitionType_e;
 
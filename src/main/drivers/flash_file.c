@@ -0,0 +1,239 @@
+/*
+ * This file is part of INAV.
+ *
+ * INAV is free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * INAV is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_FLASH_FILE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/flash_file.h"
+#include "drivers/time.h"
+
+/*
+ * A NOR flash chip emulated on top of a memory mapped host file, for the SITL target. Programming can only clear
+ * bits and the chip is busy for the typical program and erase times of a W25Q128 afterwards, so flashfs sees about
+ * the same timing as on a real chip. A new image is created with FLASH_FILE_DEFAULT_SIZE bytes, the size of an
+ * existing image is kept.
+ */
+#define FLASH_FILE_PAGE_SIZE            256
+#define FLASH_FILE_SECTOR_SIZE          (64 * 1024)
+#define FLASH_FILE_DEFAULT_SIZE         (16 * 1024 * 1024)
+
+#define FLASH_FILE_PAGE_PROGRAM_US      400
+#define FLASH_FILE_SECTOR_ERASE_US      150000
+#define FLASH_FILE_CHIP_ERASE_US_PER_SECTOR 150000
+
+static char flashFilePath[260];
+static uint8_t *flashData;
+static flashGeometry_t geometry = { .pageSize = FLASH_FILE_PAGE_SIZE };
+
+// The chip is busy with the last program or erase until this time
+static timeUs_t busyUntilUs;
+
+bool flashFileSetPath(const char *path)
+{
+    if (!path || strlen(path) >= sizeof(flashFilePath)) {
+        return false;
+    }
+
+    strcpy(flashFilePath, path);
+    return true;
+}
+
+static void flashFileSetBusy(timeUs_t durationUs)
+{
+    busyUntilUs = micros() + durationUs;
+}
+
+bool flashFile_isReady(void)
+{
+    return cmpTimeUs(micros(), busyUntilUs) >= 0;
+}
+
+// Waits for the emulated operation to finish instead of polling, so virtual clocks advance as well
+bool flashFile_waitForReady(timeMs_t timeoutMillis)
+{
+    const timeDelta_t remainingUs = cmpTimeUs(busyUntilUs, micros());
+
+    if (remainingUs > 0) {
+        delayMicroseconds(timeoutMillis ? MIN((timeUs_t)remainingUs, (timeUs_t)timeoutMillis * 1000) : (timeUs_t)remainingUs);
+    }
+
+    return flashFile_isReady();
+}
+
+bool flashFile_init(int flashNumToUse)
+{
+    UNUSED(flashNumToUse);
+
+    if (flashData) {
+        return true;
+    }
+
+    if (flashFilePath[0] == '\0') {
+        return false;
+    }
+
+    const int fd = open(flashFilePath, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "[FLASH] Failed to open '%s': %s\n", flashFilePath, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    uint32_t size = st.st_size;
+    const bool created = size == 0;
+
+    if (created) {
+        size = FLASH_FILE_DEFAULT_SIZE;
+    }
+
+    if (size % FLASH_FILE_SECTOR_SIZE || size / FLASH_FILE_SECTOR_SIZE > UINT16_MAX || (created && ftruncate(fd, size) < 0)) {
+        fprintf(stderr, "[FLASH] '%s' can't be used as a flash image of %u bytes\n", flashFilePath, (unsigned)size);
+        close(fd);
+        return false;
+    }
+
+    flashData = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (flashData == MAP_FAILED) {
+        fprintf(stderr, "[FLASH] Failed to map '%s': %s\n", flashFilePath, strerror(errno));
+        flashData = NULL;
+        return false;
+    }
+
+    if (created) {
+        memset(flashData, 0xFF, size);
+    }
+
+    geometry.flashType = FLASH_TYPE_NOR;
+    geometry.sectors = size / FLASH_FILE_SECTOR_SIZE;
+    geometry.sectorSize = FLASH_FILE_SECTOR_SIZE;
+    geometry.pagesPerSector = FLASH_FILE_SECTOR_SIZE / FLASH_FILE_PAGE_SIZE;
+    geometry.totalSize = size;
+
+    fprintf(stderr, "[FLASH] %s '%s', %u KiB\n", created ? "Created" : "Loaded", flashFilePath, (unsigned)(size / 1024));
+
+    return true;
+}
+
+/**
+ * Erase a sector full of bytes to all 1's at the given byte offset in the flash chip.
+ */
+void flashFile_eraseSector(uint32_t address)
+{
+    if (!flashFile_waitForReady(0)) {
+        return;
+    }
+
+    address -= address % FLASH_FILE_SECTOR_SIZE;
+    if (address < geometry.totalSize) {
+        memset(flashData + address, 0xFF, FLASH_FILE_SECTOR_SIZE);
+    }
+
+    flashFileSetBusy(FLASH_FILE_SECTOR_ERASE_US);
+}
+
+void flashFile_eraseCompletely(void)
+{
+    if (!flashFile_waitForReady(0)) {
+        return;
+    }
+
+    memset(flashData, 0xFF, geometry.totalSize);
+
+    flashFileSetBusy((timeUs_t)geometry.sectors * FLASH_FILE_CHIP_ERASE_US_PER_SECTOR);
+}
+
+/**
+ * Write bytes to a flash page. Like on the real chip, bytes past the end of the page wrap around to its start and
+ * bits can only be cleared.
+ */
+uint32_t flashFile_pageProgram(uint32_t address, const uint8_t *data, int length)
+{
+    const uint32_t bufferSize = length;
+
+    return flashFile_pageProgramMultiple(address, &data, &bufferSize, 1);
+}
+
+uint32_t flashFile_pageProgramMultiple(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount)
+{
+    if (!flashFile_waitForReady(0)) {
+        return address;
+    }
+
+    const uint32_t pageStart = address - address % FLASH_FILE_PAGE_SIZE;
+    const uint32_t startAddress = address;
+
+    for (int i = 0; i < bufferCount; i++) {
+        for (uint32_t j = 0; j < bufferSizes[i]; j++, address++) {
+            if (pageStart < geometry.totalSize) {
+                flashData[pageStart + address % FLASH_FILE_PAGE_SIZE] &= buffers[i][j];
+            }
+        }
+    }
+
+    // Programming time grows with the number of bytes
+    flashFileSetBusy(FLASH_FILE_PAGE_PROGRAM_US * MAX(address - startAddress, 16U) / FLASH_FILE_PAGE_SIZE);
+
+    return address;
+}
+
+/**
+ * Read `length` bytes into the provided `buffer` from the flash starting from the given `address`.
+ *
+ * The number of bytes actually read is returned, which can be zero if the address is past the end of the chip.
+ */
+int flashFile_readBytes(uint32_t address, uint8_t *buffer, int length)
+{
+    if (!flashFile_waitForReady(0) || address >= geometry.totalSize) {
+        return 0;
+    }
+
+    length = MIN((uint32_t)length, geometry.totalSize - address);
+    memcpy(buffer, flashData + address, length);
+
+    return length;
+}
+
+const flashGeometry_t* flashFile_getGeometry(void)
+{
+    return &geometry;
+}
+
+#endif
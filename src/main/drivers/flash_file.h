@@ -0,0 +1,41 @@
+/*
+ * This file is part of INAV.
+ *
+ * INAV is free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * INAV is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "flash.h"
+
+bool flashFileSetPath(const char *path);
+
+bool flashFile_init(int flashNumToUse);
+
+void flashFile_eraseSector(uint32_t address);
+void flashFile_eraseCompletely(void);
+
+uint32_t flashFile_pageProgram(uint32_t address, const uint8_t *data, int length);
+uint32_t flashFile_pageProgramMultiple(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount);
+
+int flashFile_readBytes(uint32_t address, uint8_t *buffer, int length);
+
+bool flashFile_isReady(void);
+bool flashFile_waitForReady(timeMs_t timeoutMillis);
+
+const flashGeometry_t* flashFile_getGeometry(void);
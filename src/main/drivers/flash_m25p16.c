@@ -23,6 +23,7 @@
 #ifdef USE_FLASH_M25P16
 
 #include "flash_m25p16.h"
+#include "common/utils.h"
 #include "drivers/io.h"
 #include "drivers/bus.h"
 #include "drivers/time.h"
@@ -66,6 +67,16 @@
 #define SECTOR_ERASE_TIMEOUT_MILLIS  5000
 #define BULK_ERASE_TIMEOUT_MILLIS    21000
 
+/*
+ * The status register isn't polled before a full page program could have finished (typically 0.4 to 0.8ms,
+ * scaled down for shorter programs), and then only every PAGE_PROGRAM_POLL_INTERVAL_US. Erases take tens of
+ * milliseconds at least, so they are polled at a slower pace. This keeps the bus free for other devices and
+ * flashfs doesn't spend a bus transfer on every call while the chip is busy.
+ */
+#define PAGE_PROGRAM_FIRST_POLL_US      200
+#define PAGE_PROGRAM_POLL_INTERVAL_US   50
+#define ERASE_POLL_INTERVAL_US          1000
+
 static flashGeometry_t geometry = {.pageSize = M25P16_PAGESIZE};
 
 static busDevice_t * busDev = NULL;
@@ -79,6 +90,11 @@ static uint32_t timeoutAt = 0;
  */
 static bool couldBeBusy = false;
 
+// While couldBeBusy is set, the status register is read again only pollDelayUs after lastPollAt
+static timeUs_t lastPollAt = 0;
+static timeUs_t pollDelayUs = 0;
+static timeUs_t pollIntervalUs = 0;
+
 /**
  * Send the given command byte to the device.
  */
@@ -112,15 +128,27 @@ static uint8_t m25p16_readStatus(void)
 bool m25p16_isReady(void)
 {
     // If couldBeBusy is false, don't bother to poll the flash chip for its status
-    couldBeBusy = couldBeBusy && ((m25p16_readStatus() & M25P16_STATUS_FLAG_WRITE_IN_PROGRESS) != 0);
+    if (couldBeBusy && micros() - lastPollAt >= pollDelayUs) {
+        couldBeBusy = (m25p16_readStatus() & M25P16_STATUS_FLAG_WRITE_IN_PROGRESS) != 0;
+        lastPollAt = micros();
+        pollDelayUs = pollIntervalUs;
+    }
 
     return !couldBeBusy;
 }
 
+static void m25p16_setPollTiming(timeUs_t firstPollUs, timeUs_t intervalUs)
+{
+    lastPollAt = micros();
+    pollDelayUs = firstPollUs;
+    pollIntervalUs = intervalUs;
+}
+
 static void m25p16_setTimeout(uint32_t timeoutMillis)
 {
     uint32_t now = millis();
     timeoutAt = now + timeoutMillis;
+    pollDelayUs = 0;
 }
 
 bool m25p16_waitForReady(uint32_t timeoutMillis)
@@ -277,6 +305,7 @@ void m25p16_eraseSector(uint32_t address)
     busTransfer(busDev, NULL, out, isLargeFlash ? 5 : 4);
 
     m25p16_setTimeout(SECTOR_ERASE_TIMEOUT_MILLIS);
+    m25p16_setPollTiming(ERASE_POLL_INTERVAL_US, ERASE_POLL_INTERVAL_US);
 }
 
 void m25p16_eraseCompletely(void)
@@ -290,6 +319,7 @@ void m25p16_eraseCompletely(void)
     m25p16_performOneByteCommand(M25P16_INSTRUCTION_BULK_ERASE);
 
     m25p16_setTimeout(BULK_ERASE_TIMEOUT_MILLIS);
+    m25p16_setPollTiming(ERASE_POLL_INTERVAL_US, ERASE_POLL_INTERVAL_US);
 }
 
 /**
@@ -304,17 +334,43 @@ void m25p16_eraseCompletely(void)
  * Datasheet indicates typical programming time is 0.8ms for 256 bytes, 0.2ms for 64 bytes, 0.05ms for 16 bytes.
  * (Although the maximum possible write time is noted as 5ms).
  *
- * If you want to write multiple buffers (whose sum of sizes is still not more than the page size) then you can
- * break this operation up into one beginProgram call, one or more continueProgram calls, and one finishProgram call.
+ * If you want to write multiple buffers (whose sum of sizes is still not more than the page size) then use
+ * m25p16_pageProgramMultiple(), which programs them with a single operation.
  */
 uint32_t m25p16_pageProgram(uint32_t address, const uint8_t *data, int length)
+{
+    const uint32_t bufferSize = length;
+
+    return m25p16_pageProgramMultiple(address, &data, &bufferSize, 1);
+}
+
+/**
+ * Write the concatenation of up to FLASH_PROGRAM_MAX_BUFFERS buffers to a flash page with a single page program
+ * instruction. The total length must not cross a page boundary.
+ */
+uint32_t m25p16_pageProgramMultiple(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount)
 {
     uint8_t command[5] = { M25P16_INSTRUCTION_PAGE_PROGRAM };
 
-    busTransferDescriptor_t txn[2] = {
-        { NULL, command, isLargeFlash ? 5 : 4 },
-        { NULL, data, length }
+    busTransferDescriptor_t txn[1 + FLASH_PROGRAM_MAX_BUFFERS] = {
+        { NULL, command, isLargeFlash ? 5 : 4 }
     };
+    int txnCount = 1;
+    uint32_t length = 0;
+
+    for (int i = 0; i < bufferCount && txnCount < (int)ARRAYLEN(txn); i++) {
+        if (bufferSizes[i] > 0) {
+            txn[txnCount].rxBuf = NULL;
+            txn[txnCount].txBuf = buffers[i];
+            txn[txnCount].length = bufferSizes[i];
+            txnCount++;
+            length += bufferSizes[i];
+        }
+    }
+
+    if (length == 0) {
+        return address;
+    }
 
     m25p16_setCommandAddress(&command[1], address, isLargeFlash);
 
@@ -325,9 +381,10 @@ uint32_t m25p16_pageProgram(uint32_t address, const uint8_t *data, int length)
 
     m25p16_writeEnable();
 
-    busTransferMultiple(busDev, txn, 2);
+    busTransferMultiple(busDev, txn, txnCount);
 
     m25p16_setTimeout(DEFAULT_TIMEOUT_MILLIS);
+    m25p16_setPollTiming(PAGE_PROGRAM_FIRST_POLL_US * length / geometry.pageSize, PAGE_PROGRAM_POLL_INTERVAL_US);
 
     return address + length;
 }
@@ -29,6 +29,7 @@ void m25p16_eraseSector(uint32_t address);
 void m25p16_eraseCompletely(void);
 
 uint32_t m25p16_pageProgram(uint32_t address, const uint8_t *data, int length);
+uint32_t m25p16_pageProgramMultiple(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount);
 
 int m25p16_readBytes(uint32_t address, uint8_t *buffer, int length);
 
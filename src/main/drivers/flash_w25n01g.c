@@ -117,6 +117,12 @@
 #define W25N01G_TIMEOUT_BLOCK_ERASE_MS      15  // tBEmax = 10ms
 #define W25N01G_TIMEOUT_RESET_MS            500 // tRSTmax = 500ms
 
+// The status register isn't polled before a program or erase could have finished, and then only at this pace
+#define W25N01G_PAGE_PROGRAM_FIRST_POLL_US      200 // tPPtyp = 250us
+#define W25N01G_PAGE_PROGRAM_POLL_INTERVAL_US   50
+#define W25N01G_BLOCK_ERASE_FIRST_POLL_US       1000 // tBEtyp = 2ms
+#define W25N01G_BLOCK_ERASE_POLL_INTERVAL_US    500
+
 // Sizes (in bits)
 #define W28N01G_STATUS_REGISTER_SIZE        8
 #define W28N01G_STATUS_PAGE_ADDRESS_SIZE    16
@@ -137,6 +143,11 @@ static bool couldBeBusy = false;
 
 static timeMs_t timeoutAt = 0;
 
+// While couldBeBusy is set, the status register is read again only pollDelayUs after lastPollAt
+static timeUs_t lastPollAt = 0;
+static timeUs_t pollDelayUs = 0;
+static timeUs_t pollIntervalUs = 0;
+
 static bool w25n01g_waitForReadyInternal(void);
 
 static void w25n01g_setTimeout(timeMs_t timeoutMillis)
@@ -144,6 +155,14 @@ static void w25n01g_setTimeout(timeMs_t timeoutMillis)
     timeMs_t now = millis();
     timeoutAt = now + timeoutMillis;
     couldBeBusy = true;
+    pollDelayUs = 0;
+}
+
+static void w25n01g_setPollTiming(timeUs_t firstPollUs, timeUs_t intervalUs)
+{
+    lastPollAt = micros();
+    pollDelayUs = firstPollUs;
+    pollIntervalUs = intervalUs;
 }
 
 /**
@@ -192,10 +211,12 @@ static void w25n01g_deviceReset(void)
 
 bool w25n01g_isReady(void)
 {
-    uint8_t status = w25n01g_readRegister(W25N01G_STAT_REG);
-
     // If couldBeBusy is false, don't bother to poll the flash chip for its status
-    couldBeBusy = couldBeBusy && ((status & W25N01G_STATUS_FLAG_BUSY) != 0);
+    if (couldBeBusy && micros() - lastPollAt >= pollDelayUs) {
+        couldBeBusy = (w25n01g_readRegister(W25N01G_STAT_REG) & W25N01G_STATUS_FLAG_BUSY) != 0;
+        lastPollAt = micros();
+        pollDelayUs = pollIntervalUs;
+    }
 
     return !couldBeBusy;
 }
@@ -283,6 +304,7 @@ void w25n01g_eraseSector(uint32_t address)
     w25n01g_writeEnable();
     w25n01g_performCommandWithPageAddress(W25N01G_INSTRUCTION_BLOCK_ERASE, W25N01G_LINEAR_TO_PAGE(address));
     w25n01g_setTimeout(W25N01G_TIMEOUT_BLOCK_ERASE_MS);
+    w25n01g_setPollTiming(W25N01G_BLOCK_ERASE_FIRST_POLL_US, W25N01G_BLOCK_ERASE_POLL_INTERVAL_US);
 }
 
 // W25N01G does not support full chip erase.
@@ -323,6 +345,7 @@ static void w25n01g_programExecute(uint32_t pageAddress)
     w25n01g_waitForReadyInternal();
     w25n01g_performCommandWithPageAddress(W25N01G_INSTRUCTION_PROGRAM_EXECUTE, pageAddress);
     w25n01g_setTimeout(W25N01G_TIMEOUT_PAGE_PROGRAM_MS);
+    w25n01g_setPollTiming(W25N01G_PAGE_PROGRAM_FIRST_POLL_US, W25N01G_PAGE_PROGRAM_POLL_INTERVAL_US);
 }
 
 // Writes are done in three steps:
@@ -0,0 +1,411 @@
+/*
+ * This file is part of INAV.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_SDCARD_FILE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/utils.h"
+
+#include "drivers/time.h"
+
+#include "drivers/sdcard/sdcard.h"
+#include "drivers/sdcard/sdcard_file.h"
+#include "drivers/sdcard/sdcard_impl.h"
+
+#include "io/asyncfatfs/fat_standard.h"
+
+/*
+ * An SD card emulated on top of a host file (a raw disk image), for the SITL target. Operations complete in
+ * sdcard_poll() once the card's busy time has passed on the SITL clock, so the filesystem sees about the same
+ * behaviour as with a real card on SPI.
+ *
+ * The timing is a rough model of a class 10 card: a fixed time per block, less inside a multi-block write, and a
+ * long busy time whenever writing moves on to a new allocation unit which the card has to erase first. Blocks
+ * covered by a pre-erase hint (ACMD23) don't pay for that.
+ *
+ * A new image is created with SDCARD_FILE_DEFAULT_SIZE bytes and formatted FAT32 with a single partition.
+ */
+#define SDCARD_FILE_DEFAULT_SIZE            (1024 * 1024 * 1024)
+
+#define SDCARD_FILE_INIT_US                 100000
+#define SDCARD_FILE_READ_US                 300
+#define SDCARD_FILE_WRITE_US                700
+#define SDCARD_FILE_MULTI_WRITE_US          60
+#define SDCARD_FILE_STOP_TRANSMISSION_US    300
+#define SDCARD_FILE_ALLOCATION_UNIT_BLOCKS  8192 // 4 MiB
+#define SDCARD_FILE_ALLOCATION_UNIT_US      40000
+
+// Layout of new images
+#define SDCARD_FILE_PARTITION_START         2048
+#define SDCARD_FILE_RESERVED_SECTORS        32
+#define SDCARD_FILE_SECTORS_PER_CLUSTER     8
+#define SDCARD_FILE_FSINFO_SECTOR           1
+#define SDCARD_FILE_BACKUP_BOOT_SECTOR      6
+
+static char sdcardFilePath[260];
+static int sdcardFd = -1;
+
+// The card is busy with the current operation until this time
+static timeUs_t busyUntilUs;
+
+static uint32_t preEraseStartBlock;
+static uint32_t preEraseEndBlock;
+
+bool sdcardFileSetPath(const char *path)
+{
+    if (!path || strlen(path) >= sizeof(sdcardFilePath)) {
+        return false;
+    }
+
+    strcpy(sdcardFilePath, path);
+    return true;
+}
+
+static void sdcardFileSetBusy(timeUs_t durationUs)
+{
+    busyUntilUs = micros() + durationUs;
+}
+
+static bool sdcardFileWriteSector(uint32_t sectorIndex, const uint8_t *sector)
+{
+    return pwrite(sdcardFd, sector, SDCARD_BLOCK_SIZE, (off_t)sectorIndex * SDCARD_BLOCK_SIZE) == SDCARD_BLOCK_SIZE;
+}
+
+/**
+ * Write an MBR with a single FAT32 partition and an empty filesystem into it. The image must be filled with zeroes.
+ */
+static bool sdcardFileFormat(uint32_t numBlocks)
+{
+    uint8_t sector[SDCARD_BLOCK_SIZE];
+
+    const uint32_t partitionSectors = numBlocks - SDCARD_FILE_PARTITION_START;
+    // FAT size as given by the FAT32 specification
+    const uint32_t fatDivisor = (256 * SDCARD_FILE_SECTORS_PER_CLUSTER + 2) / 2;
+    const uint32_t fatSectors = (partitionSectors - SDCARD_FILE_RESERVED_SECTORS + fatDivisor - 1) / fatDivisor;
+
+    // MBR
+    memset(sector, 0, sizeof(sector));
+    mbrPartitionEntry_t *partition = (mbrPartitionEntry_t *) (sector + 446);
+    partition->type = MBR_PARTITION_TYPE_FAT32_LBA;
+    partition->lbaBegin = SDCARD_FILE_PARTITION_START;
+    partition->numSectors = partitionSectors;
+    sector[510] = FAT_VOLUME_ID_SIGNATURE_1;
+    sector[511] = FAT_VOLUME_ID_SIGNATURE_2;
+
+    if (!sdcardFileWriteSector(0, sector)) {
+        return false;
+    }
+
+    // Volume ID, and its backup
+    memset(sector, 0, sizeof(sector));
+    fatVolumeID_t *volume = (fatVolumeID_t *) sector;
+    volume->jmpBoot[0] = 0xEB;
+    volume->jmpBoot[1] = 0x58;
+    volume->jmpBoot[2] = 0x90;
+    memcpy(volume->oemName, "INAVSITL", sizeof(volume->oemName));
+    volume->bytesPerSector = SDCARD_BLOCK_SIZE;
+    volume->sectorsPerCluster = SDCARD_FILE_SECTORS_PER_CLUSTER;
+    volume->reservedSectorCount = SDCARD_FILE_RESERVED_SECTORS;
+    volume->numFATs = 2;
+    volume->media = 0xF8;
+    volume->hiddenSectors = SDCARD_FILE_PARTITION_START;
+    volume->totalSectors32 = partitionSectors;
+    volume->fatDescriptor.fat32.FATSize32 = fatSectors;
+    volume->fatDescriptor.fat32.rootCluster = FAT_SMALLEST_LEGAL_CLUSTER_NUMBER;
+    volume->fatDescriptor.fat32.fsInfo = SDCARD_FILE_FSINFO_SECTOR;
+    volume->fatDescriptor.fat32.backupBootSector = SDCARD_FILE_BACKUP_BOOT_SECTOR;
+    volume->fatDescriptor.fat32.driveNumber = 0x80;
+    volume->fatDescriptor.fat32.bootSignature = 0x29;
+    volume->fatDescriptor.fat32.volumeID = 0x494E4156;
+    memcpy(volume->fatDescriptor.fat32.volumeLabel, "INAV SITL  ", sizeof(volume->fatDescriptor.fat32.volumeLabel));
+    memcpy(volume->fatDescriptor.fat32.fileSystemType, "FAT32   ", sizeof(volume->fatDescriptor.fat32.fileSystemType));
+    sector[510] = FAT_VOLUME_ID_SIGNATURE_1;
+    sector[511] = FAT_VOLUME_ID_SIGNATURE_2;
+
+    if (!sdcardFileWriteSector(SDCARD_FILE_PARTITION_START, sector)
+        || !sdcardFileWriteSector(SDCARD_FILE_PARTITION_START + SDCARD_FILE_BACKUP_BOOT_SECTOR, sector)) {
+        return false;
+    }
+
+    // FS information sector, the free cluster count and next free cluster are left unknown
+    memset(sector, 0, sizeof(sector));
+    uint32_t *fsInfo = (uint32_t *) sector;
+    fsInfo[0] = 0x41615252;
+    fsInfo[121] = 0x61417272;
+    fsInfo[122] = 0xFFFFFFFF;
+    fsInfo[123] = 0xFFFFFFFF;
+    fsInfo[127] = 0xAA550000;
+
+    if (!sdcardFileWriteSector(SDCARD_FILE_PARTITION_START + SDCARD_FILE_FSINFO_SECTOR, sector)
+        || !sdcardFileWriteSector(SDCARD_FILE_PARTITION_START + SDCARD_FILE_BACKUP_BOOT_SECTOR + SDCARD_FILE_FSINFO_SECTOR, sector)) {
+        return false;
+    }
+
+    // Both FATs, with the reserved entries and the root directory in a single cluster (which is all zeroes already)
+    memset(sector, 0, sizeof(sector));
+    uint32_t *fat = (uint32_t *) sector;
+    fat[0] = 0x0FFFFFF8;
+    fat[1] = 0x0FFFFFFF;
+    fat[FAT_SMALLEST_LEGAL_CLUSTER_NUMBER] = 0x0FFFFFFF;
+
+    for (int i = 0; i < 2; i++) {
+        if (!sdcardFileWriteSector(SDCARD_FILE_PARTITION_START + SDCARD_FILE_RESERVED_SECTORS + i * fatSectors, sector)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool sdcardFileOpen(void)
+{
+    struct stat st;
+
+    sdcardFd = open(sdcardFilePath, O_RDWR | O_CREAT, 0644);
+
+    if (sdcardFd < 0 || fstat(sdcardFd, &st) < 0) {
+        fprintf(stderr, "[SDCARD] Failed to open '%s': %s\n", sdcardFilePath, strerror(errno));
+        return false;
+    }
+
+    const bool created = st.st_size == 0;
+    const off_t size = created ? SDCARD_FILE_DEFAULT_SIZE : st.st_size;
+
+    if (created && (ftruncate(sdcardFd, size) < 0 || !sdcardFileFormat(size / SDCARD_BLOCK_SIZE))) {
+        fprintf(stderr, "[SDCARD] Failed to create '%s': %s\n", sdcardFilePath, strerror(errno));
+        return false;
+    }
+
+    memset(&sdcard.metadata, 0, sizeof(sdcard.metadata));
+    sdcard.metadata.numBlocks = size / SDCARD_BLOCK_SIZE;
+    memcpy(sdcard.metadata.productName, "SITL", sizeof("SITL"));
+
+    fprintf(stderr, "[SDCARD] %s '%s', %u MiB\n", created ? "Created" : "Loaded", sdcardFilePath, (unsigned)(size / (1024 * 1024)));
+
+    return true;
+}
+
+static void sdcardFile_init(void)
+{
+    sdcard.state = SDCARD_STATE_NOT_PRESENT;
+    sdcard.multiWriteBlocksRemain = 0;
+
+    if (sdcardFd < 0 && (sdcardFilePath[0] == '\0' || !sdcardFileOpen())) {
+        if (sdcardFd >= 0) {
+            close(sdcardFd);
+            sdcardFd = -1;
+        }
+        return;
+    }
+
+    sdcard.state = SDCARD_STATE_CARD_INIT_IN_PROGRESS;
+    sdcardFileSetBusy(SDCARD_FILE_INIT_US);
+}
+
+static bool sdcardFile_isFunctional(void)
+{
+    return sdcard.state != SDCARD_STATE_NOT_PRESENT;
+}
+
+static bool sdcardFile_isInitialized(void)
+{
+    return sdcard.state >= SDCARD_STATE_READY;
+}
+
+static const sdcardMetadata_t* sdcardFile_getMetadata(void)
+{
+    return &sdcard.metadata;
+}
+
+static void sdcardFileEndWriteBlocks(void)
+{
+    sdcard.multiWriteBlocksRemain = 0;
+    sdcard.state = SDCARD_STATE_STOPPING_MULTIPLE_BLOCK_WRITE;
+    sdcardFileSetBusy(SDCARD_FILE_STOP_TRANSMISSION_US);
+}
+
+/**
+ * Finish the operation in progress once the card's busy time has passed. Returns true if the card is ready to
+ * accept a new operation.
+ */
+static bool sdcardFile_poll(void)
+{
+    if (cmpTimeUs(micros(), busyUntilUs) < 0) {
+        return false;
+    }
+
+    const off_t offset = (off_t)sdcard.pendingOperation.blockIndex * SDCARD_BLOCK_SIZE;
+    bool success;
+
+    switch (sdcard.state) {
+        case SDCARD_STATE_CARD_INIT_IN_PROGRESS:
+        case SDCARD_STATE_STOPPING_MULTIPLE_BLOCK_WRITE:
+            sdcard.state = SDCARD_STATE_READY;
+            break;
+
+        case SDCARD_STATE_READING:
+            success = pread(sdcardFd, sdcard.pendingOperation.buffer, SDCARD_BLOCK_SIZE, offset) == SDCARD_BLOCK_SIZE;
+            sdcard.state = SDCARD_STATE_READY;
+
+            sdcard.pendingOperation.callback(SDCARD_BLOCK_OPERATION_READ, sdcard.pendingOperation.blockIndex,
+                success ? sdcard.pendingOperation.buffer : NULL, sdcard.pendingOperation.callbackData);
+            break;
+
+        case SDCARD_STATE_SENDING_WRITE:
+            success = pwrite(sdcardFd, sdcard.pendingOperation.buffer, SDCARD_BLOCK_SIZE, offset) == SDCARD_BLOCK_SIZE;
+
+            if (sdcard.multiWriteBlocksRemain > 1) {
+                sdcard.multiWriteBlocksRemain--;
+                sdcard.multiWriteNextBlock++;
+                sdcard.state = SDCARD_STATE_WRITING_MULTIPLE_BLOCKS;
+            } else if (sdcard.multiWriteBlocksRemain == 1) {
+                // This function changes the sd card state for us whether immediately succesful or delayed:
+                sdcardFileEndWriteBlocks();
+            } else {
+                sdcard.state = SDCARD_STATE_READY;
+            }
+
+            if (sdcard.pendingOperation.callback) {
+                sdcard.pendingOperation.callback(SDCARD_BLOCK_OPERATION_WRITE, sdcard.pendingOperation.blockIndex,
+                    success ? sdcard.pendingOperation.buffer : NULL, sdcard.pendingOperation.callbackData);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return sdcard.state == SDCARD_STATE_READY || sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS;
+}
+
+/**
+ * Read the 512-byte block with the given index into the given 512-byte buffer. The callback is called from
+ * sdcard_poll() once the read completes.
+ *
+ * Returns true if the operation was successfully queued for later completion, false if the card is busy.
+ */
+static bool sdcardFile_readBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS) {
+        sdcardFileEndWriteBlocks();
+        return false;
+    }
+
+    if (sdcard.state != SDCARD_STATE_READY || blockIndex >= sdcard.metadata.numBlocks) {
+        return false;
+    }
+
+    sdcard.pendingOperation.buffer = buffer;
+    sdcard.pendingOperation.blockIndex = blockIndex;
+    sdcard.pendingOperation.callback = callback;
+    sdcard.pendingOperation.callbackData = callbackData;
+
+    sdcard.state = SDCARD_STATE_READING;
+    sdcardFileSetBusy(SDCARD_FILE_READ_US);
+
+    return true;
+}
+
+/**
+ * Write the 512-byte block from the given buffer into the block with the given index. The buffer must remain valid
+ * until the callback is called from sdcard_poll().
+ */
+static sdcardOperationStatus_e sdcardFile_writeBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS && blockIndex != sdcard.multiWriteNextBlock) {
+        // A write to some other block ends the multi-block write
+        sdcardFileEndWriteBlocks();
+        return SDCARD_OPERATION_BUSY;
+    }
+
+    if (sdcard.state != SDCARD_STATE_READY && sdcard.state != SDCARD_STATE_WRITING_MULTIPLE_BLOCKS) {
+        return SDCARD_OPERATION_BUSY;
+    }
+
+    if (blockIndex >= sdcard.metadata.numBlocks) {
+        return SDCARD_OPERATION_FAILURE;
+    }
+
+    timeUs_t durationUs = sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS ? SDCARD_FILE_MULTI_WRITE_US : SDCARD_FILE_WRITE_US;
+
+    if (blockIndex % SDCARD_FILE_ALLOCATION_UNIT_BLOCKS == 0 && (blockIndex < preEraseStartBlock || blockIndex >= preEraseEndBlock)) {
+        durationUs += SDCARD_FILE_ALLOCATION_UNIT_US;
+    }
+
+    sdcard.pendingOperation.buffer = buffer;
+    sdcard.pendingOperation.blockIndex = blockIndex;
+    sdcard.pendingOperation.callback = callback;
+    sdcard.pendingOperation.callbackData = callbackData;
+
+    sdcard.state = SDCARD_STATE_SENDING_WRITE;
+    sdcardFileSetBusy(durationUs);
+
+    return SDCARD_OPERATION_IN_PROGRESS;
+}
+
+/**
+ * Begin writing a series of consecutive blocks beginning at the given block index, the blocks are pre-erased.
+ */
+static sdcardOperationStatus_e sdcardFile_beginWriteBlocks(uint32_t blockIndex, uint32_t blockCount)
+{
+    if (sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS) {
+        if (blockIndex == sdcard.multiWriteNextBlock) {
+            // Assume that the caller wants to continue the multi-block write they already have in progress!
+            return SDCARD_OPERATION_SUCCESS;
+        }
+
+        sdcardFileEndWriteBlocks();
+        return SDCARD_OPERATION_BUSY;
+    }
+
+    if (sdcard.state != SDCARD_STATE_READY) {
+        return SDCARD_OPERATION_BUSY;
+    }
+
+    sdcard.state = SDCARD_STATE_WRITING_MULTIPLE_BLOCKS;
+    sdcard.multiWriteBlocksRemain = blockCount;
+    sdcard.multiWriteNextBlock = blockIndex;
+
+    preEraseStartBlock = blockIndex;
+    preEraseEndBlock = blockIndex + blockCount;
+
+    return SDCARD_OPERATION_SUCCESS;
+}
+
+sdcardVTable_t sdcardFileVTable = {
+    .init = &sdcardFile_init,
+    .readBlock = &sdcardFile_readBlock,
+    .beginWriteBlocks = &sdcardFile_beginWriteBlocks,
+    .writeBlock = &sdcardFile_writeBlock,
+    .poll = &sdcardFile_poll,
+    .isFunctional = &sdcardFile_isFunctional,
+    .isInitialized = &sdcardFile_isInitialized,
+    .getMetadata = &sdcardFile_getMetadata,
+};
+
+#endif
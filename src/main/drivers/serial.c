@@ -17,9 +17,12 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "platform.h"
 
+#include "common/maths.h"
+
 #include "serial.h"
 
 void serialPrint(serialPort_t *instance, const char *str)
@@ -71,6 +74,68 @@ uint8_t serialRead(serialPort_t *instance)
     return instance->vTable->serialRead(instance);
 }
 
+/*
+ * Returns the number of received bytes that can be read in place at *data, up to the end of the
+ * port's buffer. The bytes stay in the buffer until they are consumed with serialSkip(). Ports
+ * without direct buffer access always return 0, they have to be read with serialRead().
+ */
+uint32_t serialPeekContiguous(serialPort_t *instance, const uint8_t **data)
+{
+    if (instance->vTable->peekContiguous) {
+        return instance->vTable->peekContiguous(instance, data);
+    }
+
+    return 0;
+}
+
+void serialSkip(serialPort_t *instance, uint32_t count)
+{
+    if (instance->vTable->skip) {
+        instance->vTable->skip(instance, count);
+    } else {
+        while (count--) {
+            serialRead(instance);
+        }
+    }
+}
+
+uint32_t serialReadBuf(serialPort_t *instance, uint8_t *data, uint32_t maxCount)
+{
+    uint32_t count = 0;
+    const uint8_t *span;
+    uint32_t spanLength;
+
+    // Two spans at most, before and after the end of the ring
+    while (count < maxCount && (spanLength = serialPeekContiguous(instance, &span)) > 0) {
+        spanLength = MIN(spanLength, maxCount - count);
+        memcpy(data + count, span, spanLength);
+        serialSkip(instance, spanLength);
+        count += spanLength;
+    }
+
+    while (count < maxCount && serialRxBytesWaiting(instance)) {
+        data[count++] = serialRead(instance);
+    }
+
+    return count;
+}
+
+uint32_t serialRingPeekContiguous(serialPort_t *instance, const uint8_t **data)
+{
+    const uint32_t waiting = serialRxBytesWaiting(instance);
+    const uint32_t tail = instance->rxBufferTail;
+
+    // Bytes up to the head are complete, the writer never touches them before the tail has moved on
+    *data = (const uint8_t *)&instance->rxBuffer[tail];
+
+    return MIN(waiting, instance->rxBufferSize - tail);
+}
+
+void serialRingSkip(serialPort_t *instance, uint32_t count)
+{
+    instance->rxBufferTail = (instance->rxBufferTail + count) % instance->rxBufferSize;
+}
+
 void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate)
 {
     instance->vTable->serialSetBaudRate(instance, baudRate);
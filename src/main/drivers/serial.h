@@ -101,6 +101,10 @@ struct serialPortVTable {
 
     bool (*isIdle)(serialPort_t *instance);
 
+    // Optional direct access to the RX buffer, used by parsers to consume whole spans.
+    uint32_t (*peekContiguous)(serialPort_t *instance, const uint8_t **data);
+    void (*skip)(serialPort_t *instance, uint32_t count);
+
     // Optional functions used to buffer large writes.
     void (*beginWrite)(serialPort_t *instance);
     void (*endWrite)(serialPort_t *instance);
@@ -111,6 +115,9 @@ uint32_t serialRxBytesWaiting(const serialPort_t *instance);
 uint32_t serialTxBytesFree(const serialPort_t *instance);
 void serialWriteBuf(serialPort_t *instance, const uint8_t *data, int count);
 uint8_t serialRead(serialPort_t *instance);
+uint32_t serialReadBuf(serialPort_t *instance, uint8_t *data, uint32_t maxCount);
+uint32_t serialPeekContiguous(serialPort_t *instance, const uint8_t **data);
+void serialSkip(serialPort_t *instance, uint32_t count);
 void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate);
 void serialSetMode(serialPort_t *instance, portMode_t mode);
 bool isSerialTransmitBufferEmpty(const serialPort_t *instance);
@@ -123,3 +130,7 @@ bool serialIsIdle(serialPort_t *instance);
 void serialWriteBufShim(void *instance, const uint8_t *data, int count);
 void serialBeginWrite(serialPort_t *instance);
 void serialEndWrite(serialPort_t *instance);
+
+// peekContiguous/skip for ports using rxBuffer and rxBufferTail as a ring, with serialTotalRxWaiting giving its fill level
+uint32_t serialRingPeekContiguous(serialPort_t *instance, const uint8_t **data);
+void serialRingSkip(serialPort_t *instance, uint32_t count);
@@ -641,6 +641,8 @@ static const struct serialPortVTable softSerialVTable = {
     .beginWrite = NULL,
     .endWrite = NULL,
     .isIdle = NULL,
+    .peekContiguous = serialRingPeekContiguous,
+    .skip = serialRingSkip,
 };
 
 #endif
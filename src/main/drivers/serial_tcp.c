@@ -281,6 +281,16 @@ uint8_t tcpRead(serialPort_t *instance)
     return ch;
 }
 
+void tcpSkip(serialPort_t *instance, uint32_t count)
+{
+    tcpPort_t *port = (tcpPort_t*)instance;
+    pthread_mutex_lock(&port->receiveMutex);
+
+    port->serialPort.rxBufferTail = (port->serialPort.rxBufferTail + count) % port->serialPort.rxBufferSize;
+
+    pthread_mutex_unlock(&port->receiveMutex);
+}
+
 void tcpWritBuf(serialPort_t *instance, const void *data, int count)
 {
     tcpPort_t *port = (tcpPort_t*)instance;
@@ -365,6 +375,8 @@ static const struct serialPortVTable tcpVTable[] = {
         .beginWrite = NULL,
         .endWrite = NULL,
         .isIdle = NULL,
+        .peekContiguous = serialRingPeekContiguous,
+        .skip = tcpSkip,
     }
 };
 
@@ -260,5 +260,7 @@ const struct serialPortVTable uartVTable[] = {
         .beginWrite = NULL,
         .endWrite = NULL,
         .isIdle = isUartIdle,
+        .peekContiguous = serialRingPeekContiguous,
+        .skip = serialRingSkip,
     }
 };
@@ -271,5 +271,7 @@ const struct serialPortVTable uartVTable[] = {
         .beginWrite = NULL,
         .endWrite = NULL,
         .isIdle = isUartIdle,
+        .peekContiguous = serialRingPeekContiguous,
+        .skip = serialRingSkip,
     }
 };
@@ -189,6 +189,8 @@ static const struct serialPortVTable usbVTable[] = {
         .beginWrite = usbVcpBeginWrite,
         .endWrite = usbVcpEndWrite,
         .isIdle = NULL,
+        .peekContiguous = NULL,
+        .skip = NULL,
     }
 };
 
@@ -28,6 +28,7 @@
 bool cliMode = false;
 
 #include "blackbox/blackbox.h"
+#include "blackbox/blackbox_io.h"
 
 #include "build/assert.h"
 #include "build/build_config.h"
@@ -123,6 +124,7 @@ bool cliMode = false;
 #include "telemetry/frsky_d.h"
 #include "telemetry/telemetry.h"
 #include "build/debug.h"
+#include "build/profiler.h"
 
 extern timeDelta_t cycleTime; // FIXME dependency on mw.c
 extern uint8_t detectedSensors[SENSOR_INDEX_COUNT];
@@ -2315,6 +2317,17 @@ static void cliFlashInfo(char *cmdline)
             FLASH_PARTITION_SECTOR_COUNT(flashPartition) * layout->sectorSize,
             flashfsGetOffset()
     );
+
+    flashfsLogIterator_t iterator;
+    flashfsLogEntry_t entry;
+    flashfsLogIteratorInit(&iterator);
+    for (int index = 0; flashfsLogIteratorNext(&iterator, &entry); index++) {
+        if (index == 0) {
+            cliPrintLine("Logs:");
+        }
+        cliPrintLinef("  %d: start=%u length=%u time=%u flags=%u%s", index, entry.start, entry.length,
+            entry.time, entry.flags, entry.finished ? "" : " unfinished");
+    }
 #endif
 }
 
@@ -2607,6 +2620,11 @@ static void cliFeature(char *cmdline)
     }
 }
 
+static void cliPrintNsAsUs(uint32_t ns)
+{
+    cliPrintf(" %5d.%02d", (int)(ns / 1000), (int)(ns % 1000) / 10);
+}
+
 #ifdef USE_BLACKBOX
 static void printBlackbox(uint8_t dumpMask, const blackboxConfig_t *config, const blackboxConfig_t *configDefault)
 {
@@ -2634,6 +2652,42 @@ static void printBlackbox(uint8_t dumpMask, const blackboxConfig_t *config, cons
 
 }
 
+static void cliBlackboxStatus(void)
+{
+    const blackboxStats_t *stats = blackboxGetStats();
+
+    cliPrintLine("Frame     count       bytes   dropped   avg/us   max/us");
+    for (blackboxFrameType_e type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+        const blackboxFrameStats_t *frameStats = &stats->frames[type];
+        const uint32_t averageTicks = frameStats->frames ? frameStats->encode.totalTicks / frameStats->frames : 0;
+
+        cliPrintf("%c    %10d  %10d  %8d", blackboxFrameTypeChar(type), (int)frameStats->frames, (int)frameStats->bytes, (int)frameStats->dropped);
+        cliPrintNsAsUs(profilerTicksToNs(averageTicks));
+        cliPrintNsAsUs(profilerTicksToNs(frameStats->encode.maxTicks));
+        cliPrintLinefeed();
+    }
+    cliPrintLinef("Device overruns: %d, dropped bytes: %d, serial stalls: %d, ring overflows: %d", (int)stats->overruns, (int)stats->droppedBytes, (int)stats->stalls, (int)stats->ringOverflows);
+
+    cliPrint("Histograms/us");
+    for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+        const uint32_t lowerBoundNs = profilerTicksToNs(profilerHistogramBucketLowerBound(bucket));
+        if (lowerBoundNs >= 10000) {
+            cliPrintf(" %5d", (int)(lowerBoundNs / 1000));
+        } else {
+            cliPrintf(" %2d.%02d", (int)(lowerBoundNs / 1000), (int)(lowerBoundNs % 1000) / 10);
+        }
+    }
+    cliPrintLinefeed();
+
+    for (blackboxFrameType_e type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+        cliPrintf("%c            ", blackboxFrameTypeChar(type));
+        for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+            cliPrintf(" %5d", (int)stats->frames[type].encode.histogram[bucket]);
+        }
+        cliPrintLinefeed();
+    }
+}
+
 static void cliBlackbox(char *cmdline)
 {
     uint32_t len = strlen(cmdline);
@@ -2650,6 +2704,8 @@ static void cliBlackbox(char *cmdline)
                 cliPrintf("%s ", blackboxIncludeFlagNames[i]);
         }
         cliPrintLinefeed();
+    } else if (sl_strcasecmp(cmdline, "status") == 0) {
+        cliBlackboxStatus();
     } else if (sl_strncasecmp(cmdline, "list", len) == 0) {
         cliPrint("Available: ");
         for (uint32_t i = 0; ; i++) {
@@ -3475,9 +3531,58 @@ static void cliStatus(char *cmdline)
     }
 }
 
+static void cliTasksDetail(const char *cmdline)
+{
+    static const char * const histogramNames[TASK_HISTOGRAM_COUNT] = { "exec", "late", "period" };
+    int onlyTaskId = -1;
+
+    const char *ptr = nextArg(cmdline);
+    if (ptr) {
+        onlyTaskId = fastA2I(ptr);
+        if (onlyTaskId < 0 || onlyTaskId >= TASK_COUNT) {
+            cliShowArgumentRangeError("task", 0, TASK_COUNT - 1);
+            return;
+        }
+    }
+
+    cliPrint("Histograms/us  ");
+    for (int bucket = 0; bucket < TASK_HISTOGRAM_BUCKETS; bucket++) {
+        const uint32_t lowerBound = bucket == 0 ? 0 : 1 << (bucket - 1);
+        if (lowerBound >= 1000) {
+            cliPrintf(" %4dk", (int)(lowerBound / 1000));
+        } else {
+            cliPrintf(" %5d", (int)lowerBound);
+        }
+    }
+    cliPrintLinefeed();
+
+    for (cfTaskId_e taskId = 0; taskId < TASK_COUNT; taskId++) {
+        cfTaskInfo_t taskInfo;
+        getTaskInfo(taskId, &taskInfo);
+        if (!taskInfo.isEnabled || (onlyTaskId >= 0 && taskId != (cfTaskId_e)onlyTaskId)) {
+            continue;
+        }
+
+        taskHistogram_t histogram;
+        getTaskHistogram(taskId, &histogram);
+        cliPrintLinef("%2d - %12s period %d us", taskId, taskInfo.taskName, (int)taskInfo.desiredPeriod);
+        for (int type = 0; type < TASK_HISTOGRAM_COUNT; type++) {
+            cliPrintf("     %-10s", histogramNames[type]);
+            for (int bucket = 0; bucket < TASK_HISTOGRAM_BUCKETS; bucket++) {
+                cliPrintf(" %5d", histogram.buckets[type][bucket]);
+            }
+            cliPrintLinefeed();
+        }
+    }
+}
+
 static void cliTasks(char *cmdline)
 {
-    UNUSED(cmdline);
+    if (sl_strncasecmp(cmdline, "detail", 6) == 0) {
+        cliTasksDetail(cmdline);
+        return;
+    }
+
     int maxLoadSum = 0;
     int averageLoadSum = 0;
     cfCheckFuncInfo_t checkFuncInfo;
@@ -3504,6 +3609,50 @@ static void cliTasks(char *cmdline)
     cliPrintLinef("Total (excluding SERIAL) %21d.%1d%% %4d.%1d%%", maxLoadSum/10, maxLoadSum%10, averageLoadSum/10, averageLoadSum%10);
 }
 
+static void cliLoopStages(char *cmdline)
+{
+    if (sl_strcasecmp(cmdline, "reset") == 0) {
+        profilerReset();
+        cliPrintLine("Loop stage statistics reset");
+        return;
+    }
+
+    cliPrintLinef("Stage             count   min/us   avg/us   max/us  (%d ticks/us)", (int)profilerTicksPerUs());
+    for (profilerStage_e stage = 0; stage < PROFILER_STAGE_COUNT; stage++) {
+        profilerStageStats_t stats;
+        profilerGetStageStats(stage, &stats);
+
+        const uint32_t averageTicks = stats.count ? stats.totalTicks / stats.count : 0;
+        cliPrintf("%-12s %10d", profilerStageName(stage), (int)stats.count);
+        cliPrintNsAsUs(profilerTicksToNs(stats.minTicks));
+        cliPrintNsAsUs(profilerTicksToNs(averageTicks));
+        cliPrintNsAsUs(profilerTicksToNs(stats.maxTicks));
+        cliPrintLinefeed();
+    }
+
+    cliPrint("Histograms/us");
+    for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+        const uint32_t lowerBoundNs = profilerTicksToNs(profilerHistogramBucketLowerBound(bucket));
+        if (lowerBoundNs >= 10000) {
+            cliPrintf(" %5d", (int)(lowerBoundNs / 1000));
+        } else {
+            cliPrintf(" %2d.%02d", (int)(lowerBoundNs / 1000), (int)(lowerBoundNs % 1000) / 10);
+        }
+    }
+    cliPrintLinefeed();
+
+    for (profilerStage_e stage = 0; stage < PROFILER_STAGE_COUNT; stage++) {
+        profilerStageStats_t stats;
+        profilerGetStageStats(stage, &stats);
+
+        cliPrintf("%-13s", profilerStageName(stage));
+        for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+            cliPrintf(" %5d", stats.histogram[bucket]);
+        }
+        cliPrintLinefeed();
+    }
+}
+
 static void cliVersion(char *cmdline)
 {
     UNUSED(cmdline);
@@ -3878,6 +4027,7 @@ const clicmd_t cmdTable[] = {
 #ifdef USE_BLACKBOX
     CLI_COMMAND_DEF("blackbox", "configure blackbox fields",
         "list\r\n"
+        "\tstatus\r\n"
         "\t<+|->[name]", cliBlackbox),
 #endif
 #ifdef USE_FLASHFS
@@ -3896,6 +4046,7 @@ const clicmd_t cmdTable[] = {
 #ifdef USE_LED_STRIP
     CLI_COMMAND_DEF("led", "configure leds", NULL, cliLed),
 #endif
+    CLI_COMMAND_DEF("loop_stages", "show pid loop stage timings", "[reset]", cliLoopStages),
     CLI_COMMAND_DEF("map", "configure rc channel order", "[<map>]", cliMap),
     CLI_COMMAND_DEF("memory", "view memory usage", NULL, cliMemory),
     CLI_COMMAND_DEF("mmix", "custom motor mixer", NULL, cliMotorMix),
@@ -3940,7 +4091,7 @@ const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("sd_info", "sdcard info", NULL, cliSdInfo),
 #endif
     CLI_COMMAND_DEF("status", "show status", NULL, cliStatus),
-    CLI_COMMAND_DEF("tasks", "show task stats", NULL, cliTasks),
+    CLI_COMMAND_DEF("tasks", "show task stats", "[detail [<task>]]", cliTasks),
 #ifdef USE_TEMPERATURE_SENSOR
     CLI_COMMAND_DEF("temp_sensor", "change temp sensor settings", NULL, cliTempSensor),
 #endif
@@ -24,6 +24,7 @@
 #include "blackbox/blackbox.h"
 
 #include "build/debug.h"
+#include "build/profiler.h"
 
 #include "common/maths.h"
 #include "common/axis.h"
@@ -852,14 +853,18 @@ void taskMainPidLoop(timeUs_t currentTimeUs)
         processDelayedSave();
     }
 
+    profilerStart();
+
 #if defined(SITL_BUILD)
     if (lockMainPID()) {
 #endif
 
     gyroFilter();
+    profilerMark(PROFILER_STAGE_GYRO_FILTER);
 
     imuUpdateAccelerometer();
     imuUpdateAttitude(currentTimeUs);
+    profilerMark(PROFILER_STAGE_IMU);
 
 #if defined(SITL_BUILD)
     }
@@ -872,6 +877,7 @@ void taskMainPidLoop(timeUs_t currentTimeUs)
     if (rxConfig()->rcFilterFrequency) {
         rcInterpolationApply(isRXDataNew, currentTimeUs);
     }
+    profilerMark(PROFILER_STAGE_RC);
 
     if (isRXDataNew) {
         updateWaypointsAndNavigationMode();
@@ -880,6 +886,7 @@ void taskMainPidLoop(timeUs_t currentTimeUs)
 
     updatePositionEstimator();
     applyWaypointNavigationAndAltitudeHold();
+    profilerMark(PROFILER_STAGE_NAVIGATION);
 
     // Apply throttle tilt compensation
     if (!STATE(FIXED_WING_LEGACY)) {
@@ -909,6 +916,7 @@ void taskMainPidLoop(timeUs_t currentTimeUs)
 
     // Calculate stabilisation
     pidController(dT);
+    profilerMark(PROFILER_STAGE_PID);
 
     mixTable();
 
@@ -916,6 +924,7 @@ void taskMainPidLoop(timeUs_t currentTimeUs)
         servoMixer(dT);
         processServoAutotrim(dT);
     }
+    profilerMark(PROFILER_STAGE_MIXER);
 
     //Servos should be filtered or written only when mixer is using servos or special feaures are enabled
 
@@ -938,16 +947,23 @@ void taskMainPidLoop(timeUs_t currentTimeUs)
         writeMotors();
     }
 #endif
+    profilerMark(PROFILER_STAGE_OUTPUT);
+
     // Check if landed, FW and MR
     if (STATE(ALTITUDE_CONTROL)) {
         updateLandingStatus(US2MS(currentTimeUs));
     }
+    profilerMark(PROFILER_STAGE_NAVIGATION);
 
 #ifdef USE_BLACKBOX
     if (!cliMode && feature(FEATURE_BLACKBOX)) {
         blackboxUpdate(micros());
     }
 #endif
+    profilerMark(PROFILER_STAGE_BLACKBOX);
+
+    // LOOP_STAGES debug values get logged with the next blackbox frame
+    profilerFinish();
 }
 
 // This function is called in a busy-loop, everything called from here should do it's own
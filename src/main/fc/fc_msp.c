@@ -25,8 +25,10 @@
 #include "platform.h"
 
 #include "blackbox/blackbox.h"
+#include "blackbox/blackbox_io.h"
 
 #include "build/debug.h"
+#include "build/profiler.h"
 #include "build/version.h"
 
 #include "common/axis.h"
@@ -34,6 +36,7 @@
 #include "common/maths.h"
 #include "common/streambuf.h"
 #include "common/bitarray.h"
+#include "common/crc.h"
 #include "common/time.h"
 #include "common/utils.h"
 #include "programming/global_variables.h"
@@ -289,7 +292,9 @@ static void serializeSDCardSummaryReply(sbuf_t *dst)
     sbufWriteU8(dst, afatfs_getLastError());
     // Write free space and total space in kilobytes
     sbufWriteU32(dst, afatfs_getContiguousFreeSpace() / 1024);
-    sbufWriteU32(dst, sdcard_getMetadata()->numBlocks / 2); // Block size is half a kilobyte
+    // No metadata while the card isn't initialized, e.g. with blackbox logging to another device
+    const sdcardMetadata_t *metadata = sdcard_getMetadata();
+    sbufWriteU32(dst, metadata ? metadata->numBlocks / 2 : 0); // Block size is half a kilobyte
 #else
     sbufWriteU8(dst, 0);
     sbufWriteU8(dst, 0);
@@ -336,6 +341,219 @@ static void serializeDataflashReadReply(sbuf_t *dst, uint32_t address, uint16_t
     const int bytesRead = flashfsReadAbs(address, sbufPtr(dst), readLen);
     sbufAdvance(dst, bytesRead);
 }
+
+#define DATAFLASH_LOGS_MAX_ENTRIES  16
+
+static void mspFcDataflashLogsCommand(sbuf_t *dst, sbuf_t *src)
+{
+    flashfsLogEntry_t entries[DATAFLASH_LOGS_MAX_ENTRIES];
+    uint16_t first;
+
+    // Request payload:
+    //  uint16_t    - number of the first log to list (optional)
+    if (!sbufReadU16Safe(&first, src)) {
+        first = 0;
+    }
+
+    const int logCount = flashfsLogGetEntries(first, entries, DATAFLASH_LOGS_MAX_ENTRIES);
+    const int entryCount = constrain(logCount - first, 0, DATAFLASH_LOGS_MAX_ENTRIES);
+
+    sbufWriteU16(dst, logCount);
+    sbufWriteU16(dst, first);
+    sbufWriteU8(dst, entryCount);
+    for (int i = 0; i < entryCount; i++) {
+        sbufWriteU32(dst, entries[i].start);
+        sbufWriteU32(dst, entries[i].length);
+        sbufWriteU32(dst, entries[i].time);
+        sbufWriteU8(dst, entries[i].flags);
+        sbufWriteU8(dst, entries[i].finished ? 1 : 0);
+    }
+}
+
+/*
+ * Streaming dataflash download. Instead of answering one MSP_DATAFLASH_READ per chunk, the host opens a window
+ * with MSP2_INAV_DATAFLASH_STREAM and the FC pushes the chunks back to back from the serial task, as fast as the
+ * TX buffer of the port takes them. The protocol is described in docs/API/MSP_extensions.md.
+ */
+#define DATAFLASH_STREAM_FLAG_PACKBITS          (1 << 0)
+#define DATAFLASH_STREAM_SUPPORTED_FLAGS        (DATAFLASH_STREAM_FLAG_PACKBITS)
+#define DATAFLASH_STREAM_HEADER_SIZE            10  // sequence, address, raw length, CRC
+#define DATAFLASH_STREAM_MSP_OVERHEAD           9   // MSPv2 native header and checksum
+#define DATAFLASH_STREAM_MAX_CHUNKS_PER_CALL    4
+
+// Worst case growth of PackBits encoded data, one literal header per 128 bytes plus rounding
+#define PACKBITS_MAX_OVERHEAD(len)              ((len) / 128 + 2)
+
+typedef struct mspDataflashStream_s {
+    serialPort_t *port;         // NULL while no stream is open
+    uint32_t address;
+    uint32_t endAddress;
+    uint16_t chunkSize;
+    uint16_t sequence;
+    uint8_t flags;
+} mspDataflashStream_t;
+
+static mspDataflashStream_t dataflashStream;
+static uint8_t dataflashStreamFrame[DATAFLASH_STREAM_HEADER_SIZE + MSP_PORT_DATAFLASH_BUFFER_SIZE + PACKBITS_MAX_OVERHEAD(MSP_PORT_DATAFLASH_BUFFER_SIZE)];
+
+/*
+ * PackBits run length encoding: a header byte n in 0..127 is followed by n + 1 literal bytes, a header byte
+ * in -127..-1 by one byte to repeat 1 - n times. The output may overlap the input, as long as the input starts
+ * at least PACKBITS_MAX_OVERHEAD(len) bytes after the output.
+ */
+static int packBitsEncode(uint8_t *dst, const uint8_t *src, int len)
+{
+    uint8_t *out = dst;
+    int i = 0;
+
+    while (i < len) {
+        int run = 1;
+        while (i + run < len && run < 128 && src[i + run] == src[i]) {
+            run++;
+        }
+
+        if (run >= 3) {
+            const uint8_t value = src[i];
+            *out++ = (uint8_t)(1 - run);
+            *out++ = value;
+            i += run;
+        } else {
+            // Literals last until the next run worth encoding
+            const int start = i;
+            while (i < len && i - start < 128 && !(i + 2 < len && src[i] == src[i + 1] && src[i] == src[i + 2])) {
+                i++;
+            }
+            *out++ = i - start - 1;
+            memmove(out, &src[start], i - start);
+            out += i - start;
+        }
+    }
+
+    return out - dst;
+}
+
+// On UARTs keep every frame small enough for the TX buffer, so pushing one never blocks
+static uint16_t mspDataflashStreamMaxChunkSize(const serialPort_t *port)
+{
+    if (port->txBufferSize > DATAFLASH_STREAM_MSP_OVERHEAD + DATAFLASH_STREAM_HEADER_SIZE + 64) {
+        const uint32_t space = port->txBufferSize - DATAFLASH_STREAM_MSP_OVERHEAD - DATAFLASH_STREAM_HEADER_SIZE;
+        return MIN(space - PACKBITS_MAX_OVERHEAD(space), (uint32_t)MSP_PORT_DATAFLASH_BUFFER_SIZE);
+    }
+
+    return MSP_PORT_DATAFLASH_BUFFER_SIZE;
+}
+
+static void mspDataflashStreamOpenFn(serialPort_t *serialPort)
+{
+    dataflashStream.port = serialPort;
+}
+
+static mspResult_e mspFcDataflashStreamCommand(sbuf_t *dst, sbuf_t *src, serialPort_t *port, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    const unsigned int dataSize = sbufBytesRemaining(src);
+
+    // An empty request closes the stream
+    if (dataSize == 0) {
+        dataflashStream.port = NULL;
+        sbufWriteU32(dst, dataflashStream.address);
+        return MSP_RESULT_ACK;
+    }
+
+    // Request payload:
+    //  uint32_t    - address to start at
+    //  uint32_t    - number of bytes, 0 for everything up to the end of the used space
+    //  uint16_t    - maximum chunk size, 0 for the largest supported one
+    //  uint8_t     - flags
+    // The stream needs a serial port to push to and doesn't compete with the blackbox for the flash
+    if (dataSize < 11 || !port || !mspPostProcessFn || ARMING_FLAG(ARMED) || !flashfsIsReady()) {
+        return MSP_RESULT_ERROR;
+    }
+
+    const uint32_t address = sbufReadU32(src);
+    uint32_t length = sbufReadU32(src);
+    uint16_t chunkSize = sbufReadU16(src);
+    const uint8_t flags = sbufReadU8(src) & DATAFLASH_STREAM_SUPPORTED_FLAGS;
+
+    const uint32_t size = length ? flashfsGetSize() : flashfsGetOffset();
+    if (address > size) {
+        return MSP_RESULT_ERROR;
+    }
+    length = length ? MIN(length, size - address) : size - address;
+    const uint16_t maxChunkSize = mspDataflashStreamMaxChunkSize(port);
+    chunkSize = chunkSize ? MIN(chunkSize, maxChunkSize) : maxChunkSize;
+
+    // The stream starts once the reply has gone out
+    dataflashStream.port = NULL;
+    dataflashStream.address = address;
+    dataflashStream.endAddress = address + length;
+    dataflashStream.chunkSize = chunkSize;
+    dataflashStream.sequence = 0;
+    dataflashStream.flags = flags;
+    *mspPostProcessFn = mspDataflashStreamOpenFn;
+
+    sbufWriteU32(dst, address);
+    sbufWriteU32(dst, length);
+    sbufWriteU16(dst, chunkSize);
+    sbufWriteU8(dst, flags);
+
+    return MSP_RESULT_ACK;
+}
+
+/*
+ * Push the next chunks of an open stream. Each chunk is read from the flash only once the port has room for it.
+ * A chunk without data marks the end of the stream.
+ */
+void mspFcDataflashStreamProcess(void)
+{
+    if (!dataflashStream.port) {
+        return;
+    }
+
+    // The port may have been closed or turned into the CLI port
+    mspPort_t *mspPort = mspSerialPortFind(dataflashStream.port);
+    if (!mspPort || ARMING_FLAG(ARMED)) {
+        dataflashStream.port = NULL;
+        return;
+    }
+
+    uint8_t *frame = dataflashStreamFrame;
+    uint8_t *data = &frame[DATAFLASH_STREAM_HEADER_SIZE];
+    const bool packBits = dataflashStream.flags & DATAFLASH_STREAM_FLAG_PACKBITS;
+
+    for (int i = 0; i < DATAFLASH_STREAM_MAX_CHUNKS_PER_CALL; i++) {
+        const uint16_t chunkLength = MIN(dataflashStream.chunkSize, dataflashStream.endAddress - dataflashStream.address);
+        const uint32_t maxFrameLength = DATAFLASH_STREAM_MSP_OVERHEAD + DATAFLASH_STREAM_HEADER_SIZE + chunkLength +
+            (packBits ? PACKBITS_MAX_OVERHEAD(chunkLength) : 0);
+
+        if (!isSerialTransmitBufferEmpty(dataflashStream.port) && serialTxBytesFree(dataflashStream.port) < maxFrameLength) {
+            break;
+        }
+
+        // Compressed in place, the raw data goes behind the space the encoding may grow into
+        uint8_t *raw = packBits ? data + PACKBITS_MAX_OVERHEAD(chunkLength) : data;
+        const uint16_t rawLength = chunkLength ? flashfsReadAbs(dataflashStream.address, raw, chunkLength) : 0;
+        const uint16_t crc = crc16_ccitt_update(0, raw, rawLength);
+        const int dataLength = packBits ? packBitsEncode(data, raw, rawLength) : rawLength;
+
+        sbuf_t header = { .ptr = frame, .end = data };
+        sbufWriteU16(&header, dataflashStream.sequence);
+        sbufWriteU32(&header, dataflashStream.address);
+        sbufWriteU16(&header, rawLength);
+        sbufWriteU16(&header, crc);
+
+        if (!mspSerialPushPort(MSP2_INAV_DATAFLASH_STREAM, frame, DATAFLASH_STREAM_HEADER_SIZE + dataLength, mspPort, MSP_V2_NATIVE)) {
+            break;
+        }
+
+        dataflashStream.sequence++;
+        dataflashStream.address += rawLength;
+
+        if (rawLength == 0) {
+            dataflashStream.port = NULL;
+            break;
+        }
+    }
+}
 #endif
 
 /*
@@ -1568,6 +1786,57 @@ static bool mspFcProcessOutCommand(uint16_t cmdMSP, sbuf_t *dst, mspPostProcessF
         break;
 #endif
 
+    case MSP2_INAV_LOOP_STAGES:
+        sbufWriteU32(dst, profilerTicksPerUs());
+        sbufWriteU8(dst, PROFILER_STAGE_COUNT);
+        sbufWriteU8(dst, PROFILER_HISTOGRAM_BUCKETS);
+        for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+            sbufWriteU32(dst, profilerHistogramBucketLowerBound(bucket));
+        }
+        for (profilerStage_e stage = 0; stage < PROFILER_STAGE_COUNT; stage++) {
+            profilerStageStats_t stats;
+            profilerGetStageStats(stage, &stats);
+            sbufWriteU32(dst, stats.count);
+            sbufWriteU32(dst, stats.minTicks);
+            sbufWriteU32(dst, stats.count ? stats.totalTicks / stats.count : 0);
+            sbufWriteU32(dst, stats.maxTicks);
+            for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+                sbufWriteU16(dst, stats.histogram[bucket]);
+            }
+        }
+        break;
+
+#ifdef USE_BLACKBOX
+    case MSP2_INAV_BLACKBOX_STATS:
+        {
+            const blackboxStats_t *stats = blackboxGetStats();
+
+            sbufWriteU32(dst, profilerTicksPerUs());
+            sbufWriteU8(dst, BLACKBOX_FRAME_TYPE_COUNT);
+            sbufWriteU8(dst, PROFILER_HISTOGRAM_BUCKETS);
+            for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+                sbufWriteU32(dst, profilerHistogramBucketLowerBound(bucket));
+            }
+            for (blackboxFrameType_e type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+                const blackboxFrameStats_t *frameStats = &stats->frames[type];
+                sbufWriteU8(dst, blackboxFrameTypeChar(type));
+                sbufWriteU32(dst, frameStats->frames);
+                sbufWriteU32(dst, frameStats->bytes);
+                sbufWriteU32(dst, frameStats->dropped);
+                sbufWriteU32(dst, frameStats->frames ? frameStats->encode.totalTicks / frameStats->frames : 0);
+                sbufWriteU32(dst, frameStats->encode.maxTicks);
+                for (int bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+                    sbufWriteU16(dst, frameStats->encode.histogram[bucket]);
+                }
+            }
+            sbufWriteU32(dst, stats->overruns);
+            sbufWriteU32(dst, stats->droppedBytes);
+            sbufWriteU32(dst, stats->stalls);
+            sbufWriteU32(dst, stats->ringOverflows);
+        }
+        break;
+#endif
+
     default:
         return false;
     }
@@ -1591,6 +1860,31 @@ static mspResult_e mspFcSafeHomeOutCommand(sbuf_t *dst, sbuf_t *src)
 #endif
 
 
+static mspResult_e mspFcTaskHistogramCommand(sbuf_t *dst, sbuf_t *src)
+{
+    const uint8_t taskId = sbufReadU8(src);
+    if (taskId >= TASK_COUNT) {
+        return MSP_RESULT_ERROR;
+    }
+
+    cfTaskInfo_t taskInfo;
+    taskHistogram_t histogram;
+    getTaskInfo(taskId, &taskInfo);
+    getTaskHistogram(taskId, &histogram);
+
+    sbufWriteU8(dst, taskId);
+    sbufWriteU8(dst, taskInfo.isEnabled);
+    sbufWriteU32(dst, taskInfo.desiredPeriod);
+    sbufWriteU8(dst, TASK_HISTOGRAM_COUNT);
+    sbufWriteU8(dst, TASK_HISTOGRAM_BUCKETS);
+    for (int type = 0; type < TASK_HISTOGRAM_COUNT; type++) {
+        for (int bucket = 0; bucket < TASK_HISTOGRAM_BUCKETS; bucket++) {
+            sbufWriteU16(dst, histogram.buckets[type][bucket]);
+        }
+    }
+    return MSP_RESULT_ACK;
+}
+
 static mspResult_e mspFcLogicConditionCommand(sbuf_t *dst, sbuf_t *src) {
     const uint8_t idx = sbufReadU8(src);
     if (idx < MAX_LOGIC_CONDITIONS) {
@@ -2510,6 +2804,7 @@ static mspResult_e mspFcProcessInCommand(uint16_t cmdMSP, sbuf_t *src)
 
 #ifdef USE_FLASHFS
     case MSP_DATAFLASH_ERASE:
+        dataflashStream.port = NULL;
         flashfsEraseCompletely();
         break;
 #endif
@@ -3406,6 +3701,11 @@ bool mspFCProcessInOutCommand(uint16_t cmdMSP, sbuf_t *dst, sbuf_t *src, mspResu
         mspFcDataFlashReadCommand(dst, src);
         *ret = MSP_RESULT_ACK;
         break;
+
+    case MSP2_INAV_DATAFLASH_LOGS:
+        mspFcDataflashLogsCommand(dst, src);
+        *ret = MSP_RESULT_ACK;
+        break;
 #endif
 
     case MSP2_COMMON_SETTING:
@@ -3455,6 +3755,10 @@ bool mspFCProcessInOutCommand(uint16_t cmdMSP, sbuf_t *dst, sbuf_t *src, mspResu
         break;
 #endif
 
+    case MSP2_INAV_TASK_HISTOGRAM:
+        *ret = dataSize >= 1 ? mspFcTaskHistogramCommand(dst, src) : MSP_RESULT_ERROR;
+        break;
+
 #ifdef USE_PROGRAMMING_FRAMEWORK
     case MSP2_INAV_LOGIC_CONDITIONS_SINGLE:
         *ret = mspFcLogicConditionCommand(dst, src);
@@ -3685,6 +3989,273 @@ static mspResult_e mspProcessSensorCommand(uint16_t cmdMSP, sbuf_t *src)
     return MSP_RESULT_NO_REPLY;
 }
 
+#define MSP_BATCH_COMMAND_HEADER_SIZE   3   // cmd (u16), size (u8)
+#define MSP_BATCH_REPLY_HEADER_SIZE     5   // cmd (u16), result (i8), size (u16)
+
+/*
+ * MSP2_COMMON_BATCH carries commands as cmd (u16), size (u8) and payload. They are run in order, the reply
+ * starts with the number of commands that ran (u8), followed by cmd (u16), result (i8), size (u16) and the
+ * reply of each. A command only runs while MSP_MAX_REPLY_SIZE bytes are left for its reply, the host sends
+ * the remaining ones again. A command that needs post processing (e.g. a reboot) ends the batch. A reply
+ * buffer too small for even one command (512 bytes on targets without flashfs) fails the batch, the host
+ * then falls back to single requests.
+ */
+static mspResult_e mspFcBatchCommand(sbuf_t *dst, sbuf_t *src, serialPort_t *port, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    // Check the framing first, so a malformed batch doesn't run any command
+    for (sbuf_t check = *src; sbufBytesRemaining(&check); ) {
+        if (sbufBytesRemaining(&check) < MSP_BATCH_COMMAND_HEADER_SIZE) {
+            return MSP_RESULT_ERROR;
+        }
+        sbufAdvance(&check, 2);
+        const uint8_t size = sbufReadU8(&check);
+        if (sbufBytesRemaining(&check) < size) {
+            return MSP_RESULT_ERROR;
+        }
+        sbufAdvance(&check, size);
+    }
+
+    if (sbufBytesRemaining(src) && sbufBytesRemaining(dst) < 1 + MSP_BATCH_REPLY_HEADER_SIZE + MSP_MAX_REPLY_SIZE) {
+        return MSP_RESULT_ERROR;
+    }
+
+    uint8_t * const countPtr = sbufPtr(dst);
+    uint8_t count = 0;
+
+    sbufWriteU8(dst, 0);
+
+    while (sbufBytesRemaining(src) && sbufBytesRemaining(dst) >= MSP_BATCH_REPLY_HEADER_SIZE + MSP_MAX_REPLY_SIZE &&
+           count < UINT8_MAX && !*mspPostProcessFn) {
+        const uint16_t cmdMSP = sbufReadU16(src);
+        const uint8_t size = sbufReadU8(src);
+        uint8_t * const replyHeader = sbufPtr(dst);
+
+        mspPacket_t command = {
+            .buf = { .ptr = sbufPtr(src), .end = sbufPtr(src) + size, },
+            .cmd = cmdMSP,
+            .flags = 0,
+            .result = 0,
+            .port = port,
+        };
+        mspPacket_t reply = {
+            .buf = { .ptr = replyHeader + MSP_BATCH_REPLY_HEADER_SIZE, .end = dst->end, },
+            .cmd = -1,
+            .flags = 0,
+            .result = 0,
+        };
+
+        const mspResult_e result = cmdMSP == MSP2_COMMON_BATCH ? MSP_RESULT_ERROR : mspFcProcessCommand(&command, &reply, mspPostProcessFn);
+        const uint16_t replySize = result == MSP_RESULT_NO_REPLY ? 0 : reply.buf.ptr - (replyHeader + MSP_BATCH_REPLY_HEADER_SIZE);
+
+        sbufWriteU16(dst, cmdMSP);
+        sbufWriteU8(dst, (int8_t)result);
+        sbufWriteU16(dst, replySize);
+        sbufAdvance(dst, replySize);
+        sbufAdvance(src, size);
+        count++;
+    }
+
+    *countPtr = count;
+    return MSP_RESULT_ACK;
+}
+
+/*
+ * Subscriptions: a host sets the out messages it wants with MSP2_COMMON_SUBSCRIBE, each with an interval, and the
+ * FC pushes them from the serial task instead of the host polling them. A message is only built when the TX buffer
+ * of the port can take it, the ones that don't fit are pushed in the next runs. The protocol is described in
+ * docs/API/MSP_extensions.md.
+ */
+#define MSP_SUBSCRIPTION_MAX_COUNT          8
+#define MSP_SUBSCRIPTION_MIN_INTERVAL_MS    10  // The serial task runs at 100 Hz
+#define MSP_SUBSCRIPTION_ENTRY_SIZE         4   // cmd (u16), interval (u16)
+#define MSP_SUBSCRIPTION_MSP_OVERHEAD       9   // MSPv2 native header and checksum
+
+typedef struct mspSubscription_s {
+    uint16_t cmd;
+    uint16_t intervalMs;
+    uint16_t lastSize;          // Size of the last push, to skip building messages that won't fit
+    timeMs_t lastPushMs;
+} mspSubscription_t;
+
+typedef struct mspSubscriptions_s {
+    serialPort_t *port;         // NULL for an unused slot
+    uint8_t count;
+    uint8_t next;               // Where the next run starts, so large messages don't starve the others
+    mspSubscription_t entries[MSP_SUBSCRIPTION_MAX_COUNT];
+} mspSubscriptions_t;
+
+static mspSubscriptions_t subscriptions[MAX_MSP_PORT_COUNT];
+static mspSubscriptions_t pendingSubscriptions;     // Set by the command, bound to the port once the reply is out
+
+static void mspSubscriptionsOpenFn(serialPort_t *serialPort)
+{
+    mspSubscriptions_t *slot = NULL;
+
+    for (int i = 0; i < MAX_MSP_PORT_COUNT; i++) {
+        if (subscriptions[i].port == serialPort) {
+            slot = &subscriptions[i];
+            break;
+        }
+        if (!slot && !subscriptions[i].port) {
+            slot = &subscriptions[i];
+        }
+    }
+
+    if (slot) {
+        *slot = pendingSubscriptions;
+        slot->port = pendingSubscriptions.count ? serialPort : NULL;
+    }
+}
+
+// Telemetry out messages that can be subscribed to. They are read only, take no payload and need no post processing.
+static const uint16_t mspSubscribableCommands[] = {
+    MSP_STATUS, MSP_STATUS_EX, MSP2_INAV_STATUS, MSP_SENSOR_STATUS, MSP_ACTIVEBOXES,
+    MSP_RAW_IMU, MSP_ATTITUDE, MSP_ALTITUDE, MSP_SONAR_ALTITUDE, MSP2_INAV_OPTICAL_FLOW, MSP2_INAV_AIR_SPEED,
+    MSP_RC, MSP_MOTOR, MSP_SERVO,
+    MSP_ANALOG, MSP2_INAV_ANALOG, MSP2_INAV_MISC2, MSP_RTC,
+#ifdef USE_GPS
+    MSP_RAW_GPS, MSP_COMP_GPS, MSP_NAV_STATUS, MSP_GPSSTATISTICS,
+#endif
+#ifdef USE_PROGRAMMING_FRAMEWORK
+    MSP2_INAV_LOGIC_CONDITIONS_STATUS, MSP2_INAV_GVAR_STATUS, MSP2_INAV_PROGRAMMING_PID_STATUS,
+#endif
+#ifdef USE_TEMPERATURE_SENSOR
+    MSP2_INAV_TEMPERATURES,
+#endif
+#ifdef USE_ESC_SENSOR
+    MSP2_INAV_ESC_RPM,
+#endif
+#ifdef USE_BLACKBOX
+    MSP2_INAV_BLACKBOX_STATS,
+#endif
+    MSP_DEBUG, MSP2_INAV_DEBUG, MSP2_INAV_LOOP_STAGES,
+};
+
+static bool mspIsSubscribableCommand(uint16_t cmdMSP)
+{
+    for (unsigned i = 0; i < ARRAYLEN(mspSubscribableCommands); i++) {
+        if (mspSubscribableCommands[i] == cmdMSP) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static mspResult_e mspFcSubscribeCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    // Request payload, replacing the subscriptions of the port, empty to remove them:
+    //  uint16_t    - command
+    //  uint16_t    - interval in ms
+    // Commands that aren't in mspSubscribableCommands are left out of the reply.
+    if (sbufBytesRemaining(src) % MSP_SUBSCRIPTION_ENTRY_SIZE || !mspPostProcessFn || *mspPostProcessFn ||
+        sbufBytesRemaining(dst) < MSP_SUBSCRIPTION_MAX_COUNT * MSP_SUBSCRIPTION_ENTRY_SIZE) {
+        return MSP_RESULT_ERROR;
+    }
+
+    const timeMs_t currentTimeMs = millis();
+
+    pendingSubscriptions.count = 0;
+    pendingSubscriptions.next = 0;
+
+    while (sbufBytesRemaining(src) && pendingSubscriptions.count < MSP_SUBSCRIPTION_MAX_COUNT) {
+        const uint16_t cmdMSP = sbufReadU16(src);
+        const uint16_t intervalMs = MAX(sbufReadU16(src), MSP_SUBSCRIPTION_MIN_INTERVAL_MS);
+
+        if (!mspIsSubscribableCommand(cmdMSP)) {
+            continue;
+        }
+
+        // Pushed in the first run after the reply, which also finds out its size
+        pendingSubscriptions.entries[pendingSubscriptions.count++] = (mspSubscription_t) {
+            .cmd = cmdMSP,
+            .intervalMs = intervalMs,
+            .lastSize = 0,
+            .lastPushMs = currentTimeMs - intervalMs,
+        };
+
+        sbufWriteU16(dst, cmdMSP);
+        sbufWriteU16(dst, intervalMs);
+    }
+
+    *mspPostProcessFn = mspSubscriptionsOpenFn;
+
+    return MSP_RESULT_ACK;
+}
+
+// Unlike replies, pushes never block on a frame larger than the free space
+static bool mspSubscriptionPortHasRoom(serialPort_t *port, uint16_t size)
+{
+    return serialTxBytesFree(port) >= (uint32_t)size + MSP_SUBSCRIPTION_MSP_OVERHEAD;
+}
+
+static bool mspSubscriptionFitsPort(serialPort_t *port, uint16_t size)
+{
+    return !port->txBufferSize || port->txBufferSize >= (uint32_t)size + MSP_SUBSCRIPTION_MSP_OVERHEAD;
+}
+
+/*
+ * Push the subscribed messages that are due, while the TX buffer of the port has room for them.
+ */
+void mspFcSubscriptionsProcess(void)
+{
+    const timeMs_t currentTimeMs = millis();
+
+    for (int i = 0; i < MAX_MSP_PORT_COUNT; i++) {
+        mspSubscriptions_t *slot = &subscriptions[i];
+
+        if (!slot->port) {
+            continue;
+        }
+
+        // The port may have been closed or turned into the CLI port
+        mspPort_t *mspPort = mspSerialPortFind(slot->port);
+        if (!mspPort) {
+            slot->port = NULL;
+            continue;
+        }
+
+        for (int j = 0; j < slot->count; j++) {
+            const int index = (slot->next + j) % slot->count;
+            mspSubscription_t *entry = &slot->entries[index];
+
+            if (currentTimeMs - entry->lastPushMs < entry->intervalMs) {
+                continue;
+            }
+
+            if (mspSubscriptionFitsPort(slot->port, entry->lastSize) && !mspSubscriptionPortHasRoom(slot->port, entry->lastSize)) {
+                slot->next = index;
+                break;
+            }
+
+            uint8_t buf[MSP_MAX_REPLY_SIZE];
+            sbuf_t dst = { .ptr = buf, .end = buf + sizeof(buf) };
+            mspPostProcessFnPtr postProcessFn = NULL;
+
+            // Subscribable messages are always handled and never set a post processing function
+            mspFcProcessOutCommand(entry->cmd, &dst, &postProcessFn);
+
+            entry->lastSize = dst.ptr - buf;
+
+            // Messages larger than the TX buffer, e.g. on a UART, can't be pushed
+            if (!mspSubscriptionFitsPort(slot->port, entry->lastSize)) {
+                entry->lastPushMs = currentTimeMs;
+                continue;
+            }
+
+            if (!mspSubscriptionPortHasRoom(slot->port, entry->lastSize)) {
+                slot->next = index;
+                break;
+            }
+
+            mspSerialPushPort(entry->cmd, buf, entry->lastSize, mspPort, MSP_V2_NATIVE);
+
+            // Keep the pace of the interval, unless a push is late by a whole interval
+            entry->lastPushMs = currentTimeMs - entry->lastPushMs < 2 * entry->intervalMs ? entry->lastPushMs + entry->intervalMs : currentTimeMs;
+        }
+    }
+}
+
 /*
  * Returns MSP_RESULT_ACK, MSP_RESULT_ERROR or MSP_RESULT_NO_REPLY
  */
@@ -3699,11 +4270,19 @@ mspResult_e mspFcProcessCommand(mspPacket_t *cmd, mspPacket_t *reply, mspPostPro
 
     if (MSP2_IS_SENSOR_MESSAGE(cmdMSP)) {
         ret = mspProcessSensorCommand(cmdMSP, src);
+    } else if (cmdMSP == MSP2_COMMON_BATCH) {
+        ret = mspFcBatchCommand(dst, src, cmd->port, mspPostProcessFn);
+    } else if (cmdMSP == MSP2_COMMON_SUBSCRIBE) {
+        ret = mspFcSubscribeCommand(dst, src, mspPostProcessFn);
     } else if (mspFcProcessOutCommand(cmdMSP, dst, mspPostProcessFn)) {
         ret = MSP_RESULT_ACK;
     } else if (cmdMSP == MSP_SET_PASSTHROUGH) {
         mspFcSetPassthroughCommand(dst, src, mspPostProcessFn);
         ret = MSP_RESULT_ACK;
+#ifdef USE_FLASHFS
+    } else if (cmdMSP == MSP2_INAV_DATAFLASH_STREAM) {
+        ret = mspFcDataflashStreamCommand(dst, src, cmd->port, mspPostProcessFn);
+#endif
     } else {
         if (!mspFCProcessInOutCommand(cmdMSP, dst, src, &ret)) {
             ret = mspFcProcessInCommand(cmdMSP, src);
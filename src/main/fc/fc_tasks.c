@@ -101,6 +101,12 @@ void taskHandleSerial(timeUs_t currentTimeUs)
     // Allow MSP processing even if in CLI mode
     mspSerialProcess(ARMING_FLAG(ARMED) ? MSP_SKIP_NON_MSP_DATA : MSP_EVALUATE_NON_MSP_DATA, mspFcProcessCommand);
 
+#ifdef USE_FLASHFS
+    mspFcDataflashStreamProcess();
+#endif
+
+    mspFcSubscriptionsProcess();
+
 #if defined(USE_DJI_HD_OSD)
     // DJI OSD uses a special flavour of MSP (subset of Betaflight 4.1.1 MSP) - process as part of serial task
     djiOsdSerialProcess();
@@ -46,19 +46,17 @@
 #include "gyroanalyse.h"
 
 enum {
+    STEP_WINDOW,
     STEP_ARM_CFFT_F32,
     STEP_BITREVERSAL_AND_STAGE_RFFT_F32,
     STEP_MAGNITUDE_AND_FREQUENCY,
-    STEP_UPDATE_FILTERS_AND_HANNING,
     STEP_COUNT
 };
 
 // The FFT splits the frequency domain into an number of bins
-// A sampling frequency of 1000 and max frequency of 500 at a window size of 32 gives 16 frequency bins each 31.25Hz wide
-// Eg [0,31), [31,62), [62, 93) etc
-// for gyro loop >= 4KHz, sample rate 2000 defines FFT range to 1000Hz, 16 bins each 62.5 Hz wide
-// NB  FFT_WINDOW_SIZE is set to 32 in gyroanalyse.h
-#define FFT_BIN_COUNT             (FFT_WINDOW_SIZE / 2)
+// A sampling frequency of 1000 and max frequency of 500 at a window size of 64 gives 32 frequency bins each 15.6Hz wide
+// Eg [0,15.6), [15.6,31.2), [31.2, 46.8) etc
+// A window of 128 halves the bin width, so does zero padding a window of 64 samples to 128 (interpolated bins)
 // smoothing frequency for FFT centre frequency
 #define DYN_NOTCH_SMOOTH_FREQ_HZ  25
 
@@ -72,24 +70,64 @@ enum {
 void gyroDataAnalyseStateInit(
     gyroAnalyseState_t *state, 
     uint16_t minFrequency,
+    uint8_t fftSize,
+    bool zeroPadding,
+    uint8_t overlapPercent,
+    uint8_t engine,
     uint32_t targetLooptimeUs
 ) {
     state->minFrequency = minFrequency;
+#if !defined(USE_DYNAMIC_NOTCH_EXTENDED)
+    // 64 point FFT only, the larger buffers of the 128 point FFT and sliding DFT are not built in
+    UNUSED(fftSize);
+    UNUSED(engine);
+    state->engine = DYNAMIC_NOTCH_ENGINE_FFT;
+    state->fftSize = 64;
+#else
+#ifdef USE_ARM_MATH
+    state->engine = engine;
+#else
+    // FFT needs CMSIS DSP, host builds only have the sliding DFT
+    UNUSED(engine);
+    state->engine = DYNAMIC_NOTCH_ENGINE_SDFT;
+#endif
+    state->fftSize = fftSize == DYNAMIC_NOTCH_FFT_SIZE_128 ? 128 : 64;
+#endif
+
+    // Sliding DFT has no use for zero padding, its bins are always up to date
+    state->windowSize = (zeroPadding && state->engine == DYNAMIC_NOTCH_ENGINE_FFT) ? state->fftSize / 2 : state->fftSize;
+    state->fftBinCount = state->fftSize / 2;
+    state->hopSamples = MAX(1, state->windowSize * (100 - overlapPercent) / 100);
 
     state->fftSamplingRateHz = 1e6f / targetLooptimeUs / FFT_SAMPLING_DENOMINATOR;
     state->maxFrequency = state->fftSamplingRateHz / 2; //max possible frequency is half the sampling rate
-    state->fftResolution = (float)state->maxFrequency / FFT_BIN_COUNT;
+    state->fftResolution = (float)state->maxFrequency / state->fftBinCount;
 
-    state->fftStartBin = state->minFrequency / lrintf(state->fftResolution);
+    state->fftStartBin = MAX(1, state->minFrequency / lrintf(state->fftResolution));
 
-    for (int i = 0; i < FFT_WINDOW_SIZE; i++) {
-        state->hanningWindow[i] = (0.5f - 0.5f * cos_approx(2 * M_PIf * i / (FFT_WINDOW_SIZE - 1)));
+    for (int i = 0; i < state->windowSize; i++) {
+        state->hanningWindow[i] = (0.5f - 0.5f * cos_approx(2 * M_PIf * i / (state->windowSize - 1)));
     }
 
-    arm_rfft_fast_init_f32(&state->fftInstance, FFT_WINDOW_SIZE);
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+    if (state->engine == DYNAMIC_NOTCH_ENGINE_SDFT) {
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sdftInit(&state->sdft[axis], state->windowSize, state->fftStartBin, state->fftBinCount - 1);
+        }
+    } else
+#endif
+    {
+#ifdef USE_ARM_MATH
+        arm_rfft_fast_init_f32(&state->fftInstance, state->fftSize);
+#endif
+    }
 
-    // Frequency filter is executed every 12 cycles. 4 steps per cycle, 3 axises
-    const uint32_t filterUpdateUs = targetLooptimeUs * STEP_COUNT * XYZ_AXIS_COUNT;
+    /*
+     * Each axis is analysed once every hopSamples downsampled samples, but not more often
+     * than the update pipeline allows: 4 steps per axis for FFT, 2 for sliding DFT
+     */
+    const uint32_t pipelineLoops = (state->engine == DYNAMIC_NOTCH_ENGINE_SDFT ? 2 : STEP_COUNT) * XYZ_AXIS_COUNT;
+    const uint32_t filterUpdateUs = targetLooptimeUs * MAX(pipelineLoops, (uint32_t)state->hopSamples * FFT_SAMPLING_DENOMINATOR);
 
     for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
         
@@ -115,25 +153,34 @@ void gyroDataAnalyse(gyroAnalyseState_t *state)
 {
     state->filterUpdateExecute = false; //This will be changed to true only if new data is present
 
-    static uint8_t samplingIndex = 0;
-
-    if (samplingIndex == 0) {
-        // calculate mean value of accumulated samples
+    if (state->samplingIndex == 0) {
         for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-            state->downsampledGyroData[axis][state->circularBufferIdx] = state->currentSample[axis];
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+            if (state->engine == DYNAMIC_NOTCH_ENGINE_SDFT) {
+                sdftPush(&state->sdft[axis], state->currentSample[axis]);
+            } else
+#endif
+            {
+                state->downsampledGyroData[axis][state->circularBufferIdx] = state->currentSample[axis];
+            }
+
+            if (state->pendingSamples[axis] < UINT8_MAX) {
+                state->pendingSamples[axis]++;
+            }
         }
 
-        state->circularBufferIdx = (state->circularBufferIdx + 1) % FFT_WINDOW_SIZE;
+        state->circularBufferIdx = (state->circularBufferIdx + 1) % state->windowSize;
     }
 
-    samplingIndex = (samplingIndex + 1) % FFT_SAMPLING_DENOMINATOR;
+    state->samplingIndex = (state->samplingIndex + 1) % FFT_SAMPLING_DENOMINATOR;
 
     gyroDataAnalyseUpdate(state);
 }
 
+#ifdef USE_ARM_MATH
 void stage_rfft_f32(arm_rfft_fast_instance_f32 *S, float32_t *p, float32_t *pOut);
-void arm_cfft_radix8by4_f32(arm_cfft_instance_f32 *S, float32_t *p1);
 void arm_bitreversal_32(uint32_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTable);
+#endif
 
 static float computeParabolaMean(gyroAnalyseState_t *state, uint8_t peakBinIndex) {
     float preciseBin = peakBinIndex;
@@ -141,7 +188,7 @@ static float computeParabolaMean(gyroAnalyseState_t *state, uint8_t peakBinIndex
     // Height of peak bin (y1) and shoulder bins (y0, y2)
     const float y0 = state->fftData[peakBinIndex - 1];
     const float y1 = state->fftData[peakBinIndex];
-    const float y2 = state->fftData[peakBinIndex - 1];
+    const float y2 = state->fftData[peakBinIndex + 1];
 
     // Estimate true peak position aka. preciseBin (fit parabola y(x) over y0, y1 and y2, solve dy/dx=0 for x)
     const float denom = 2.0f * (y0 - 2 * y1 + y2);
@@ -154,18 +201,50 @@ static float computeParabolaMean(gyroAnalyseState_t *state, uint8_t peakBinIndex
 }
 
 /*
- * Analyse last gyro data from the last FFT_WINDOW_SIZE milliseconds
+ * Analyse gyro data from the last window, one step per call to keep the time spent in each loop bounded
  */
 static NOINLINE void gyroDataAnalyseUpdate(gyroAnalyseState_t *state)
 {
-
+#ifdef USE_ARM_MATH
     arm_cfft_instance_f32 *Sint = &(state->fftInstance.Sint);
+#endif
 
     switch (state->updateStep) {
+        case STEP_WINDOW:
+        {
+            // Overlap control, wait for enough new samples on this axis
+            if (state->pendingSamples[state->updateAxis] < state->hopSamples) {
+                return;
+            }
+            state->pendingSamples[state->updateAxis] = 0;
+
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+            if (state->engine == DYNAMIC_NOTCH_ENGINE_SDFT) {
+                // Bins are already there, window them and skip the FFT steps
+                sdftWindowedMagnitude(&state->sdft[state->updateAxis], state->fftData, state->fftStartBin, state->fftBinCount - 1);
+                state->updateStep = STEP_MAGNITUDE_AND_FREQUENCY;
+                return;
+            }
+#endif
+
+            // apply hanning window to gyro samples in chronological order and store result in fftData,
+            // with zero padding the rest of the FFT input stays zero
+            const float *samples = state->downsampledGyroData[state->updateAxis];
+            int idx = state->circularBufferIdx;
+            for (int i = 0; i < state->windowSize; i++) {
+                state->fftData[i] = samples[idx] * state->hanningWindow[i];
+                idx = (idx + 1) % state->windowSize;
+            }
+            for (int i = state->windowSize; i < state->fftSize; i++) {
+                state->fftData[i] = 0.0f;
+            }
+            break;
+        }
+#ifdef USE_ARM_MATH
         case STEP_ARM_CFFT_F32:
         {
-            // Important this works only with FFT windows size of 64 elements!
-            arm_cfft_radix8by4_f32(Sint, state->fftData);
+            // Butterflies only, bit reversal is done in the next step
+            arm_cfft_f32(Sint, state->fftData, 0, 0);
             break;
         }
         case STEP_BITREVERSAL_AND_STAGE_RFFT_F32:
@@ -174,10 +253,15 @@ static NOINLINE void gyroDataAnalyseUpdate(gyroAnalyseState_t *state)
             stage_rfft_f32(&state->fftInstance, state->fftData, state->rfftData);
             break;
         }
+#endif
         case STEP_MAGNITUDE_AND_FREQUENCY:
         {
-            // 8us
-            arm_cmplx_mag_f32(state->rfftData, state->fftData, FFT_BIN_COUNT);
+#ifdef USE_ARM_MATH
+            if (state->engine == DYNAMIC_NOTCH_ENGINE_FFT) {
+                // 8us for 32 bins
+                arm_cmplx_mag_f32(state->rfftData, state->fftData, state->fftBinCount);
+            }
+#endif
 
             //Zero the data structure
             for (int i = 0; i < DYN_NOTCH_PEAK_COUNT; i++) {
@@ -186,7 +270,7 @@ static NOINLINE void gyroDataAnalyseUpdate(gyroAnalyseState_t *state)
             }
 
             // Find peaks
-            for (int bin = (state->fftStartBin + 1); bin < FFT_BIN_COUNT - 1; bin++) {
+            for (int bin = (state->fftStartBin + 1); bin < state->fftBinCount - 1; bin++) {
                 /*
                  * Peak is defined if the current bin is greater than the previous bin and the next bin
                  */
@@ -225,18 +309,13 @@ static NOINLINE void gyroDataAnalyseUpdate(gyroAnalyseState_t *state)
                 }
             }
 
-            break;
-        }
-        case STEP_UPDATE_FILTERS_AND_HANNING:
-        {
-
             /*
              * Update frequencies
              */
             for (int i = 0; i < DYN_NOTCH_PEAK_COUNT; i++) {
 
                 if (state->peaks[i].bin > 0) {
-                    const int bin = constrain(state->peaks[i].bin, state->fftStartBin, FFT_BIN_COUNT - 1);
+                    const int bin = constrain(state->peaks[i].bin, state->fftStartBin, state->fftBinCount - 1);
                     float frequency = computeParabolaMean(state, bin) * state->fftResolution;
 
                     state->centerFrequency[state->updateAxis][i] = pt1FilterApply(&state->detectedFrequencyFilter[state->updateAxis][i], frequency);
@@ -253,10 +332,6 @@ static NOINLINE void gyroDataAnalyseUpdate(gyroAnalyseState_t *state)
 
             //Switch to the next axis
             state->updateAxis = (state->updateAxis + 1) % XYZ_AXIS_COUNT;
-            
-            // apply hanning window to gyro samples and store result in fftData
-            // hanning starts and ends with 0, could be skipped for minor speed improvement
-            arm_mult_f32(state->downsampledGyroData[state->updateAxis], state->hanningWindow, state->fftData, FFT_WINDOW_SIZE);
         }
     }
 
@@ -22,14 +22,20 @@
 
 #ifdef USE_DYNAMIC_FILTERS
 
+#ifdef USE_ARM_MATH
 #include "arm_math.h"
+#endif
 #include "common/filter.h"
+#include "common/sdft.h"
+#include "common/utils.h"
 
-/*
- * Current code works only with 64 window size. Changing it do a different size would require
- * adapting the gyroDataAnalyseUpdate in STEP_ARM_CFFT_F32 step
- */
-#define FFT_WINDOW_SIZE 64
+// Largest FFT supported, actual size comes from dynamic_gyro_notch_fft_size
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+#define FFT_MAX_WINDOW_SIZE 128
+#else
+#define FFT_MAX_WINDOW_SIZE 64
+#endif
+#define FFT_MAX_BIN_COUNT   (FFT_MAX_WINDOW_SIZE / 2)
 
 typedef struct peak_s {
     int bin;
@@ -40,17 +46,31 @@ typedef struct gyroAnalyseState_s {
     // accumulator for oversampled data => no aliasing and less noise
     float currentSample[XYZ_AXIS_COUNT];
 
-    // downsampled gyro data circular buffer for frequency analysis
+    uint8_t engine;
+    uint8_t fftSize;            // FFT length, bins are fftSize / 2
+    uint8_t windowSize;         // gyro samples per analysis, fftSize / 2 with zero padding
+    uint8_t hopSamples;         // new samples required before an axis is analysed again
+    uint8_t pendingSamples[XYZ_AXIS_COUNT];
+    uint8_t samplingIndex;
+
+    // downsampled gyro data circular buffer for frequency analysis, only one engine is active
     uint8_t circularBufferIdx;
-    float downsampledGyroData[XYZ_AXIS_COUNT][FFT_WINDOW_SIZE];
+    union {
+        float downsampledGyroData[XYZ_AXIS_COUNT][FFT_MAX_WINDOW_SIZE];
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+        sdft_t sdft[XYZ_AXIS_COUNT];
+#endif
+    };
 
     // update state machine step information
     uint8_t updateStep;
     uint8_t updateAxis;
 
+#ifdef USE_ARM_MATH
     arm_rfft_fast_instance_f32 fftInstance;
-    float fftData[FFT_WINDOW_SIZE];
-    float rfftData[FFT_WINDOW_SIZE];
+    float rfftData[FFT_MAX_WINDOW_SIZE];
+#endif
+    float fftData[FFT_MAX_WINDOW_SIZE];
 
     pt1Filter_t detectedFrequencyFilter[XYZ_AXIS_COUNT][DYN_NOTCH_PEAK_COUNT];
     float centerFrequency[XYZ_AXIS_COUNT][DYN_NOTCH_PEAK_COUNT];
@@ -63,21 +83,29 @@ typedef struct gyroAnalyseState_s {
 
     uint16_t fftSamplingRateHz;
     uint8_t fftStartBin;
+    uint8_t fftBinCount;
     float fftResolution;
     uint16_t minFrequency;
     uint16_t maxFrequency;
 
     // Hanning window, see https://en.wikipedia.org/wiki/Window_function#Hann_.28Hanning.29_window
-    float hanningWindow[FFT_WINDOW_SIZE];
+    float hanningWindow[FFT_MAX_WINDOW_SIZE];
 } gyroAnalyseState_t;
 
-STATIC_ASSERT(FFT_WINDOW_SIZE <= (uint8_t) -1, window_size_greater_than_underlying_type);
+STATIC_ASSERT(FFT_MAX_WINDOW_SIZE <= (uint8_t) -1, window_size_greater_than_underlying_type);
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+STATIC_ASSERT(FFT_MAX_WINDOW_SIZE <= SDFT_MAX_WINDOW_SIZE, sdft_window_smaller_than_fft_window);
+#endif
 
 void gyroDataAnalyseStateInit(
     gyroAnalyseState_t *state, 
     uint16_t minFrequency,
+    uint8_t fftSize,
+    bool zeroPadding,
+    uint8_t overlapPercent,
+    uint8_t engine,
     uint32_t targetLooptimeUs
 );
 void gyroDataAnalysePush(gyroAnalyseState_t *gyroAnalyse, int axis, float sample);
 void gyroDataAnalyse(gyroAnalyseState_t *gyroAnalyse);
-#endif
\ No newline at end of file
+#endif
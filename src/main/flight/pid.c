@@ -86,13 +86,12 @@ typedef struct {
     // Rate filtering
     rateLimitFilter_t axisAccelFilter;
     pt1Filter_t ptermLpfState;
-    filter_t dtermLpfState;
-    filter_t dtermLpf2State;
 
     float stickPosition;
 
     float previousRateTarget;
     float previousRateGyro;
+    float dTermDelta;               // gyro rate delta after D-term low pass filtering
 
 #ifdef USE_D_BOOST
     pt1Filter_t dBoostLpf;
@@ -157,8 +156,7 @@ static EXTENDED_FASTRAM uint8_t usedPidControllerType;
 
 typedef void (*pidControllerFnPtr)(pidState_t *pidState, flight_dynamics_index_t axis, float dT);
 static EXTENDED_FASTRAM pidControllerFnPtr pidControllerApplyFn;
-static EXTENDED_FASTRAM filterApplyFnPtr dTermLpfFilterApplyFn;
-static EXTENDED_FASTRAM filterApplyFnPtr dTermLpf2FilterApplyFn;
+static EXTENDED_FASTRAM filterBank_t dTermLpfBank;
 static EXTENDED_FASTRAM bool levelingEnabled = false;
 
 #define FIXED_WING_LEVEL_TRIM_MAX_ANGLE 10.0f // Max angle auto trimming can demand
@@ -309,6 +307,15 @@ PG_RESET_TEMPLATE(pidProfile_t, pidProfile,
 #endif
 );
 
+/*
+ * initFilter() and assignFilterApplyFn() have always fallen through to BIQUAD for every
+ * type but PT3. Keep the D-term response tuned configurations were flown with.
+ */
+static uint8_t dTermLpfEffectiveType(uint8_t filterType)
+{
+    return filterType == FILTER_PT3 ? FILTER_PT3 : FILTER_BIQUAD;
+}
+
 bool pidInitFilters(void)
 {
     const uint32_t refreshRate = getLooptime();
@@ -317,10 +324,9 @@ bool pidInitFilters(void)
         return false;
     }
 
-    for (int axis = 0; axis < 3; ++ axis) {
-        initFilter(pidProfile()->dterm_lpf_type, &pidState[axis].dtermLpfState, pidProfile()->dterm_lpf_hz, refreshRate);
-        initFilter(pidProfile()->dterm_lpf2_type, &pidState[axis].dtermLpf2State, pidProfile()->dterm_lpf2_hz, refreshRate);
-    }
+    filterBankInit(&dTermLpfBank);
+    filterBankAddLowpass(&dTermLpfBank, dTermLpfEffectiveType(pidProfile()->dterm_lpf_type), pidProfile()->dterm_lpf_hz, refreshRate);
+    filterBankAddLowpass(&dTermLpfBank, dTermLpfEffectiveType(pidProfile()->dterm_lpf2_type), pidProfile()->dterm_lpf2_hz, refreshRate);
 
     for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
         pt1FilterInit(&windupLpf[i], pidProfile()->iterm_relax_cutoff, US2S(refreshRate));
@@ -722,13 +728,8 @@ static float dTermProcess(pidState_t *pidState, float currentRateTarget, float d
         // optimisation for when D is zero, often used by YAW axis
         newDTerm = 0;
     } else {
-        float delta = pidState->previousRateGyro - pidState->gyroRate;
-
-        delta = dTermLpfFilterApplyFn((filter_t *) &pidState->dtermLpfState, delta);
-        delta = dTermLpf2FilterApplyFn((filter_t *) &pidState->dtermLpf2State, delta);
-
         // Calculate derivative
-        newDTerm =  delta * (pidState->kD / dT) * applyDBoost(pidState, currentRateTarget, dT);
+        newDTerm =  pidState->dTermDelta * (pidState->kD / dT) * applyDBoost(pidState, currentRateTarget, dT);
     }
     return(newDTerm);
 }
@@ -1114,6 +1115,16 @@ void FAST_CODE pidController(float dT)
 #endif
     }
 
+    // D-term low pass filters run on all three axes at once
+    float dTermDelta[XYZ_AXIS_COUNT];
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        dTermDelta[axis] = pidState[axis].previousRateGyro - pidState[axis].gyroRate;
+    }
+    filterBankApply(&dTermLpfBank, dTermDelta);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        pidState[axis].dTermDelta = dTermDelta[axis];
+    }
+
     // Step 3: Run control for ANGLE_MODE, HORIZON_MODE, and HEADING_LOCK
     const float horizonRateMagnitude = calcHorizonRateMagnitude();
     levelingEnabled = false;
@@ -1232,9 +1243,6 @@ void pidInit(void)
         usedPidControllerType = pidProfile()->pidControllerType;
     }
 
-    assignFilterApplyFn(pidProfile()->dterm_lpf_type, pidProfile()->dterm_lpf_hz, &dTermLpfFilterApplyFn);
-    assignFilterApplyFn(pidProfile()->dterm_lpf2_type, pidProfile()->dterm_lpf2_hz, &dTermLpf2FilterApplyFn);
-
     if (usedPidControllerType == PID_TYPE_PIFF) {
         pidControllerApplyFn = pidApplyFixedWingRateController;
     } else if (usedPidControllerType == PID_TYPE_PID) {
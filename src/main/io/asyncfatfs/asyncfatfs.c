@@ -38,7 +38,19 @@
     #define ONLY_EXPOSE_FOR_TESTING static
 #endif
 
+/*
+ * A larger cache lets more data pile up while the SD card is busy (e.g. erasing), which rides out the card's latency
+ * spikes. Targets can set their own size, the cache indexes are stored in an int8_t.
+ */
+#ifndef AFATFS_NUM_CACHE_SECTORS
+#if defined(STM32H7)
+#define AFATFS_NUM_CACHE_SECTORS 32
+#elif defined(STM32F7)
+#define AFATFS_NUM_CACHE_SECTORS 16
+#else
 #define AFATFS_NUM_CACHE_SECTORS 8
+#endif
+#endif
 
 // FAT filesystems are allowed to differ from these parameters, but we choose not to support those weird filesystems:
 #define AFATFS_SECTOR_SIZE  512
@@ -51,9 +63,18 @@
 
 /*
  * How many blocks will we write in a row before we bother using the SDcard's multiple block write method?
- * If this define is omitted, this disables multi-block write.
+ * If this define is omitted, this disables multi-block write. Targets can set their own count.
  */
+#ifndef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
 #define AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT 4
+#endif
+
+/*
+ * While the next sector of a multi-block write is still being filled, flushing any other sector would end the
+ * multi-block write. Flushes of other sectors are held back for up to this many afatfs_flush() calls, as long as no
+ * more than half of the cache is dirty.
+ */
+#define AFATFS_MAX_MULTIPLE_BLOCK_WRITE_DEFERRALS 32
 
 #define AFATFS_FILES_PER_DIRECTORY_SECTOR (AFATFS_SECTOR_SIZE / sizeof(fatDirectoryEntry_t))
 
@@ -446,6 +467,11 @@ typedef struct afatfs_t {
     int cacheDirtyEntries; // The number of cache entries in the AFATFS_CACHE_STATE_DIRTY state
     bool cacheFlushInProgress;
 
+#ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
+    uint32_t multiWriteNextSector; // The sector that continues the multi-block write in progress, or zero if none
+    uint8_t multiWriteDeferrals; // Number of flushes held back to keep the multi-block write going
+#endif
+
     afatfsFile_t openFiles[AFATFS_MAX_OPEN_FILES];
 
 #ifdef AFATFS_USE_FREEFILE
@@ -666,6 +692,9 @@ static void afatfs_sdcardWriteComplete(sdcardBlockOperation_e operation, uint32_
                 // Write failed, remark the sector as dirty
                 afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_DIRTY;
                 afatfs.cacheDirtyEntries++;
+#ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
+                afatfs.multiWriteNextSector = 0;
+#endif
             } else {
                 afatfs_assert(afatfs_cacheSectorGetMemory(i) == buffer);
 
@@ -677,9 +706,10 @@ static void afatfs_sdcardWriteComplete(sdcardBlockOperation_e operation, uint32_
 }
 
 /**
- * Attempt to flush the dirty cache entry with the given index to the SDcard.
+ * Attempt to flush the dirty cache entry with the given index to the SDcard. Returns true if the card accepted the
+ * write.
  */
-static void afatfs_cacheFlushSector(int cacheIndex)
+static bool afatfs_cacheFlushSector(int cacheIndex)
 {
     afatfsCacheBlockDescriptor_t *cacheDescriptor = &afatfs.cacheDescriptor[cacheIndex];
 
@@ -706,8 +736,16 @@ static void afatfs_cacheFlushSector(int cacheIndex)
         case SDCARD_OPERATION_BUSY:
         case SDCARD_OPERATION_FAILURE:
         default:
-            ;
+            return false;
     }
+
+#ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
+    // Remember where the multi-block write carries on, so afatfs_flush() can keep it going
+    afatfs.multiWriteNextSector = cacheDescriptor->consecutiveEraseBlockCount > 1 ? cacheDescriptor->sectorIndex + 1 : 0;
+    afatfs.multiWriteDeferrals = 0;
+#endif
+
+    return true;
 }
 
 /**
@@ -813,6 +851,30 @@ static int afatfs_allocateCacheSector(uint32_t sectorIndex)
 bool afatfs_flush(void)
 {
     if (afatfs.cacheDirtyEntries > 0) {
+#ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
+        afatfsCacheBlockDescriptor_t *nextDescriptor = NULL;
+        bool flushedNextSectors = false;
+
+        /*
+         * Hand the card the consecutive sectors of a multi-block write for as long as they are ready, so they go out
+         * as one long write (the SDIO driver gathers them into a single DMA transfer).
+         */
+        while (afatfs.multiWriteNextSector != 0) {
+            nextDescriptor = afatfs_findCacheSector(afatfs.multiWriteNextSector);
+
+            if (nextDescriptor == NULL || nextDescriptor->state != AFATFS_CACHE_STATE_DIRTY || nextDescriptor->locked
+                || !afatfs_cacheFlushSector(nextDescriptor - afatfs.cacheDescriptor)) {
+                break;
+            }
+
+            flushedNextSectors = true;
+        }
+
+        if (flushedNextSectors) {
+            return false;
+        }
+#endif
+
         // Flush the oldest flushable sector
         uint32_t earliestSectorTime = 0xFFFFFFFF;
         int earliestSectorIndex = -1;
@@ -827,6 +889,18 @@ bool afatfs_flush(void)
         }
 
         if (earliestSectorIndex > -1) {
+#ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
+            // The next sector of the multi-block write is still being filled by the application
+            if (
+                nextDescriptor != NULL && nextDescriptor->locked && nextDescriptor->state == AFATFS_CACHE_STATE_DIRTY
+                && afatfs.cacheDirtyEntries <= AFATFS_NUM_CACHE_SECTORS / 2
+                && afatfs.multiWriteDeferrals < AFATFS_MAX_MULTIPLE_BLOCK_WRITE_DEFERRALS
+            ) {
+                afatfs.multiWriteDeferrals++;
+                return false;
+            }
+#endif
+
             afatfs_cacheFlushSector(earliestSectorIndex);
 
             // That flush will take time to complete so we may as well tell caller to come back later
@@ -1884,6 +1958,18 @@ static uint8_t* afatfs_fileLockCursorSectorForWrite(afatfsFilePtr_t file)
             uint32_t cursorOffsetInSupercluster = file->cursorOffset & (afatfs_superClusterSize() - 1);
 
             eraseBlockCount = afatfs_fatEntriesPerSector() * afatfs.sectorsPerCluster - cursorOffsetInSupercluster / AFATFS_SECTOR_SIZE;
+
+#ifdef AFATFS_USE_FREEFILE
+            /*
+             * The file grows by taking the first supercluster of the freefile. If that follows on from this supercluster
+             * then the multi-block write can run on across the boundary.
+             */
+            uint32_t clusterAfterSupercluster = file->cursorCluster + afatfs_fatEntriesPerSector() - cursorOffsetInSupercluster / afatfs_clusterSize();
+
+            if (clusterAfterSupercluster == afatfs.freeFile.firstCluster) {
+                eraseBlockCount += afatfs.freeFile.logicalSize / AFATFS_SECTOR_SIZE;
+            }
+#endif
         } else {
             eraseBlockCount = 0;
         }
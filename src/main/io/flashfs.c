@@ -34,12 +34,45 @@
 
 #if defined(USE_FLASHFS)
 
+#include "common/crc.h"
+#include "common/maths.h"
+
 #include "drivers/flash.h"
 
 #include "io/flashfs.h"
 
 static flashPartition_t *flashPartition;
 
+/*
+ * The log index is a partition of its own, holding one record for the start and one for the end of every log.
+ * Records are appended one after the other and never modified, so the index works the same on NOR and NAND
+ * flash. On NAND every record gets a page of its own. It lets the start of the free space be found at boot
+ * without searching through the log data, and the logs be listed without reading them.
+ *
+ * The index is only used when it starts out erased or with a valid record. On a chip that held logs before the
+ * index existed, the index stays unused until the next full erase.
+ */
+#define LOG_INDEX_RECORD_START      'S'
+#define LOG_INDEX_RECORD_END        'E'
+#define LOG_INDEX_MAX_RECORDS       512U
+
+typedef struct flashfsLogRecord_s {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t crc;       // CRC16-CCITT of the record with this field set to zero
+    uint32_t start;
+    uint32_t end;       // Only valid in END records
+    uint32_t time;
+} flashfsLogRecord_t;
+
+static flashPartition_t *logIndexPartition;
+static bool logIndexValid;
+static uint16_t logIndexRecordCount;    // The next record goes into this slot
+static uint16_t logIndexCapacity;
+static uint32_t logIndexStride;
+static bool logIndexLogOpen;
+static flashfsLogRecord_t logIndexOpenRecord;
+
 static uint8_t flashWriteBuffer[FLASHFS_WRITE_BUFFER_SIZE];
 
 /* The position of our head and tail in the circular flash write buffer.
@@ -49,7 +82,7 @@ static uint8_t flashWriteBuffer[FLASHFS_WRITE_BUFFER_SIZE];
  *
  * When the circular buffer is empty, head == tail
  */
-static uint8_t bufferHead = 0, bufferTail = 0;
+static uint16_t bufferHead = 0, bufferTail = 0;
 
 // The position of the buffer's tail in the overall flash address space:
 static uint32_t tailAddress = 0;
@@ -71,7 +104,20 @@ static void flashfsSetTailAddress(uint32_t address)
 
 void flashfsEraseCompletely(void)
 {
-    flashPartitionErase(flashPartition);
+    // Without other partitions on the chip, a chip erase clears the logs and their index at once
+    if (logIndexPartition && flashPartitionCount() == 2) {
+        flashEraseCompletely();
+    } else {
+        flashPartitionErase(flashPartition);
+        if (logIndexPartition) {
+            flashPartitionErase(logIndexPartition);
+        }
+    }
+
+    logIndexValid = logIndexPartition != NULL;
+    logIndexRecordCount = 0;
+    logIndexLogOpen = false;
+
     flashfsClearBuffer();
     flashfsSetTailAddress(0);
 }
@@ -168,7 +214,7 @@ uint32_t flashfsGetWriteBufferFreeSpace(void)
  *
  * Modifies the supplied buffer pointers and sizes to reflect how many bytes remain in each of them.
  *
- * bufferCount: the number of buffers provided
+ * bufferCount: the number of buffers provided, at most FLASH_PROGRAM_MAX_BUFFERS
  * buffers: an array of pointers to the beginning of buffers
  * bufferSizes: an array of the sizes of those buffers
  * sync: true if we should wait for the device to be idle before writes, otherwise if the device is busy the
@@ -197,7 +243,9 @@ static uint32_t flashfsWriteBuffers(uint8_t const **buffers, uint32_t *bufferSiz
     while (bytesTotalRemaining > 0) {
         uint32_t bytesTotalThisIteration;
         uint32_t bytesRemainThisIteration;
-        uint32_t currentFlashAddress = tailAddress;
+        const uint8_t *programBuffers[FLASH_PROGRAM_MAX_BUFFERS];
+        uint32_t programBufferSizes[FLASH_PROGRAM_MAX_BUFFERS];
+        int programBufferCount = 0;
 
         /*
          * Each page needs to be saved in a separate program operation, so
@@ -219,29 +267,24 @@ static uint32_t flashfsWriteBuffers(uint8_t const **buffers, uint32_t *bufferSiz
 
         bytesRemainThisIteration = bytesTotalThisIteration;
 
-        for (i = 0; i < bufferCount; i++) {
+        for (i = 0; i < bufferCount && bytesRemainThisIteration > 0; i++) {
             if (bufferSizes[i] > 0) {
-                // Is buffer larger than our write limit? Write our limit out of it
-                if (bufferSizes[i] >= bytesRemainThisIteration) {
-                    currentFlashAddress = flashPageProgram(currentFlashAddress, buffers[i], bytesRemainThisIteration);
-
-                    buffers[i] += bytesRemainThisIteration;
-                    bufferSizes[i] -= bytesRemainThisIteration;
-
-                    bytesRemainThisIteration = 0;
-                    break;
-                } else {
-                    // We'll still have more to write after finishing this buffer off
-                    currentFlashAddress = flashPageProgram(currentFlashAddress, buffers[i], bufferSizes[i]);
+                // Is buffer larger than our write limit? Take our limit out of it
+                const uint32_t bytesFromBuffer = MIN(bufferSizes[i], bytesRemainThisIteration);
 
-                    bytesRemainThisIteration -= bufferSizes[i];
+                programBuffers[programBufferCount] = buffers[i];
+                programBufferSizes[programBufferCount] = bytesFromBuffer;
+                programBufferCount++;
 
-                    buffers[i] += bufferSizes[i];
-                    bufferSizes[i] = 0;
-                }
+                buffers[i] += bytesFromBuffer;
+                bufferSizes[i] -= bytesFromBuffer;
+                bytesRemainThisIteration -= bytesFromBuffer;
             }
         }
 
+        // The pieces of the page are programmed with a single operation, without waiting for the flash in between
+        flashPageProgramMultiple(tailAddress, programBuffers, programBufferSizes, programBufferCount);
+
         bytesTotalRemaining -= bytesTotalThisIteration;
 
         // Advance the cursor in the file system to match the bytes we wrote
@@ -494,18 +537,244 @@ int flashfsReadAbs(uint32_t address, uint8_t *buffer, unsigned int len)
     return bytesRead;
 }
 
+static bool flashfsIsErasedAt(uint32_t address, int length)
+{
+    uint8_t buffer[16];
+
+    if (flashReadBytes(address, buffer, length) < length) {
+        return false;
+    }
+
+    for (int i = 0; i < length; i++) {
+        if (buffer[i] != 0xFF) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static uint32_t logIndexSlotAddress(int slot)
+{
+    return logIndexPartition->startSector * flashGetGeometry()->sectorSize + slot * logIndexStride;
+}
+
+static uint16_t logIndexRecordCrc(const flashfsLogRecord_t *record)
+{
+    flashfsLogRecord_t copy = *record;
+
+    copy.crc = 0;
+    return crc16_ccitt_update(0, &copy, sizeof(copy));
+}
+
+static bool logIndexReadRecord(int slot, flashfsLogRecord_t *record)
+{
+    if (flashReadBytes(logIndexSlotAddress(slot), (uint8_t *)record, sizeof(*record)) < (int)sizeof(*record)) {
+        return false;
+    }
+
+    return (record->type == LOG_INDEX_RECORD_START || record->type == LOG_INDEX_RECORD_END) && record->crc == logIndexRecordCrc(record);
+}
+
+// A record can be lost to a power loss while it's programmed, those are skipped
+static bool logIndexReadLastRecord(flashfsLogRecord_t *record)
+{
+    if (!logIndexValid) {
+        return false;
+    }
+
+    for (int slot = logIndexRecordCount - 1; slot >= 0; slot--) {
+        if (logIndexReadRecord(slot, record)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool logIndexAppend(flashfsLogRecord_t *record)
+{
+    if (!logIndexValid || logIndexRecordCount >= logIndexCapacity) {
+        return false;
+    }
+
+    record->crc = 0;
+    record->crc = logIndexRecordCrc(record);
+
+    flashPageProgram(logIndexSlotAddress(logIndexRecordCount++), (const uint8_t *)record, sizeof(*record));
+    flashFlush();
+
+    return true;
+}
+
+static void logIndexInit(void)
+{
+    logIndexPartition = flashPartitionFindByType(FLASH_PARTITION_TYPE_FLASHFS_LOG_INDEX);
+    logIndexValid = false;
+    logIndexRecordCount = 0;
+    logIndexLogOpen = false;
+
+    if (!logIndexPartition) {
+        return;
+    }
+
+    const flashGeometry_t *geometry = flashGetGeometry();
+    logIndexStride = geometry->flashType == FLASH_TYPE_NAND ? geometry->pageSize : sizeof(flashfsLogRecord_t);
+    logIndexCapacity = MIN(flashPartitionSize(logIndexPartition) / logIndexStride, LOG_INDEX_MAX_RECORDS);
+
+    // Records are appended without gaps, so a binary search finds the first free slot
+    int left = 0;
+    int right = logIndexCapacity;
+
+    while (left < right) {
+        const int mid = (left + right) / 2;
+
+        if (flashfsIsErasedAt(logIndexSlotAddress(mid), sizeof(flashfsLogRecord_t))) {
+            right = mid;
+        } else {
+            left = mid + 1;
+        }
+    }
+
+    logIndexRecordCount = left;
+
+    flashfsLogRecord_t record;
+    logIndexValid = logIndexRecordCount == 0 || logIndexReadRecord(0, &record);
+}
+
 /**
- * Find the offset of the start of the free space on the device (or the size of the device if it is full).
+ * Record the start of a log at the current offset in the log index.
+ *
+ * time: seconds since 1970, 0 if unknown
+ * flags: whatever the writer of the log wants to find in the log's entry
  */
-int flashfsIdentifyStartOfFreeSpace(void)
+void flashfsLogStart(uint32_t time, uint8_t flags)
+{
+    flashfsFlushSync();
+
+    logIndexOpenRecord = (flashfsLogRecord_t) {
+        .type = LOG_INDEX_RECORD_START,
+        .flags = flags,
+        .start = flashfsGetOffset(),
+        .end = UINT32_MAX,
+        .time = time,
+    };
+    logIndexLogOpen = logIndexAppend(&logIndexOpenRecord);
+}
+
+/**
+ * Record the end of the log started by flashfsLogStart() at the current offset. Call after flashfsClose().
+ */
+void flashfsLogFinish(void)
+{
+    if (!logIndexLogOpen) {
+        return;
+    }
+
+    flashfsFlushSync();
+
+    flashfsLogRecord_t record = logIndexOpenRecord;
+    record.type = LOG_INDEX_RECORD_END;
+    record.end = flashfsGetOffset();
+    logIndexAppend(&record);
+
+    logIndexLogOpen = false;
+}
+
+/**
+ * Start listing the logs in the index, beginning with the oldest.
+ */
+void flashfsLogIteratorInit(flashfsLogIterator_t *iterator)
+{
+    iterator->slot = 0;
+}
+
+/**
+ * Fill `entry` with the next log from the index. Returns false when there are no more logs.
+ */
+bool flashfsLogIteratorNext(flashfsLogIterator_t *iterator, flashfsLogEntry_t *entry)
+{
+    flashfsLogRecord_t record;
+
+    if (!logIndexValid) {
+        return false;
+    }
+
+    // END records of logs that lost their START are skipped
+    do {
+        if (iterator->slot >= logIndexRecordCount) {
+            return false;
+        }
+    } while (!logIndexReadRecord(iterator->slot++, &record) || record.type != LOG_INDEX_RECORD_START);
+
+    *entry = (flashfsLogEntry_t) {
+        .start = record.start,
+        .time = record.time,
+        .flags = record.flags,
+        .finished = false,
+    };
+
+    while (iterator->slot < logIndexRecordCount) {
+        if (!logIndexReadRecord(iterator->slot, &record)) {
+            iterator->slot++;
+            continue;
+        }
+
+        // A log without an end lasted until the next one started, which is left for the next call
+        if (record.type == LOG_INDEX_RECORD_START) {
+            entry->length = record.start - entry->start;
+            return true;
+        }
+
+        iterator->slot++;
+
+        if (record.start == entry->start) {
+            entry->length = record.end - record.start;
+            entry->finished = true;
+            return true;
+        }
+    }
+
+    // The last log may still be written to
+    entry->length = flashfsGetOffset() - entry->start;
+    return true;
+}
+
+/**
+ * Fill `entries` with up to `maxEntries` logs from the index, beginning with log number `first`.
+ *
+ * Returns the total number of logs in the index, which may be more than the number of entries filled.
+ */
+int flashfsLogGetEntries(int first, flashfsLogEntry_t *entries, int maxEntries)
+{
+    flashfsLogIterator_t iterator;
+    flashfsLogEntry_t entry;
+    int logCount = 0;
+
+    flashfsLogIteratorInit(&iterator);
+
+    while (flashfsLogIteratorNext(&iterator, &entry)) {
+        const int entryIndex = logCount++ - first;
+        if (entryIndex >= 0 && entryIndex < maxEntries) {
+            entries[entryIndex] = entry;
+        }
+    }
+
+    return logCount;
+}
+
+/**
+ * Search for the start of the free space on the device at or after `from`, which must be the start of
+ * written data or free space.
+ */
+static int flashfsSearchStartOfFreeSpace(uint32_t from)
 {
     /* Find the start of the free space on the device by examining the beginning of blocks with a binary search,
      * looking for ones that appear to be erased. We can achieve this with good accuracy because an erased block
      * is all bits set to 1, which pretty much never appears in reasonable size substrings of blackbox logs.
      *
-     * To do better we might write a volume header instead, which would mark how much free space remains. But keeping
-     * a header up to date while logging would incur more writes to the flash, which would consume precious write
-     * bandwidth and block more often.
+     * Usually the log index knows where the free space starts, then this search is only needed after a power loss
+     * during logging, and only over the last log.
      */
 
     enum {
@@ -524,7 +793,7 @@ int flashfsIdentifyStartOfFreeSpace(void)
         uint32_t ints[FREE_BLOCK_TEST_SIZE_INTS];
     } testBuffer;
 
-    int left = 0; // Smallest block index in the search region
+    int left = from / FREE_BLOCK_SIZE; // Smallest block index in the search region
     int right = flashfsGetSize() / FREE_BLOCK_SIZE; // One past the largest block index in the search region
     int mid;
     int result = right;
@@ -563,6 +832,26 @@ int flashfsIdentifyStartOfFreeSpace(void)
     return result * FREE_BLOCK_SIZE;
 }
 
+/**
+ * Find the offset of the start of the free space on the device (or the size of the device if it is full).
+ */
+int flashfsIdentifyStartOfFreeSpace(void)
+{
+    flashfsLogRecord_t record;
+
+    if (logIndexReadLastRecord(&record)) {
+        if (record.type == LOG_INDEX_RECORD_END && record.end <= flashfsGetSize()
+                && flashfsIsErasedAt(record.end, MIN(flashfsGetSize() - record.end, 16U))) {
+            return record.end;
+        }
+
+        // The last log wasn't finished, or logs were written while the index was full
+        return flashfsSearchStartOfFreeSpace(record.start);
+    }
+
+    return flashfsSearchStartOfFreeSpace(0);
+}
+
 /**
  * Returns true if the file pointer is at the end of the device.
  */
@@ -577,6 +866,7 @@ bool flashfsIsEOF(void)
 void flashfsInit(void)
 {
     flashPartition = flashPartitionFindByType(FLASH_PARTITION_TYPE_FLASHFS);
+    logIndexInit();
 
     if (flashPartition) {
         // Start the file pointer off at the beginning of free space so caller can start writing immediately
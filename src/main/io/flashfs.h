@@ -17,15 +17,17 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "drivers/flash.h"
 
-#define FLASHFS_WRITE_BUFFER_SIZE 128
+// Two NOR flash pages, so the next page can fill up while the flash programs the last one
+#define FLASHFS_WRITE_BUFFER_SIZE 512
 #define FLASHFS_WRITE_BUFFER_USABLE (FLASHFS_WRITE_BUFFER_SIZE - 1)
 
-// Automatically trigger a flush when this much data is in the buffer
-#define FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN 64
+// Automatically trigger a flush when this much data is in the buffer, a full page gets programmed in one go
+#define FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN 256
 
 void flashfsEraseCompletely(void);
 void flashfsEraseRange(uint32_t start, uint32_t end);
@@ -51,5 +53,23 @@ void flashfsFlushSync(void);
 
 void flashfsInit(void);
 
+typedef struct flashfsLogEntry_s {
+    uint32_t start;
+    uint32_t length;
+    uint32_t time;      // Seconds since 1970 at the start of the log, 0 if the time wasn't known
+    uint8_t flags;      // Defined by the writer of the log
+    bool finished;      // False if the log was never closed, e.g. on a power loss. Its length is then a guess.
+} flashfsLogEntry_t;
+
+typedef struct flashfsLogIterator_s {
+    uint16_t slot;      // Next record of the index to read
+} flashfsLogIterator_t;
+
+void flashfsLogStart(uint32_t time, uint8_t flags);
+void flashfsLogFinish(void);
+void flashfsLogIteratorInit(flashfsLogIterator_t *iterator);
+bool flashfsLogIteratorNext(flashfsLogIterator_t *iterator, flashfsLogEntry_t *entry);
+int flashfsLogGetEntries(int first, flashfsLogEntry_t *entries, int maxEntries);
+
 bool flashfsIsReady(void);
 bool flashfsIsEOF(void);
@@ -816,6 +816,46 @@ static bool gpsNewFrameUBLOX(uint8_t data)
     return parsed;
 }
 
+/*
+ * Feeds a span of received bytes to gpsNewFrameUBLOX(). Noise before a sync char is skipped and all payload
+ * bytes but the last one are checksummed and copied in one go. Stops after a frame with new data, which is
+ * reported in *newData, and returns the number of bytes consumed.
+ */
+static uint32_t gpsNewSpanUBLOX(const uint8_t *data, uint32_t count, bool *newData)
+{
+    uint32_t pos = 0;
+
+    while (pos < count) {
+        if (_step == 0) {
+            const uint8_t *sync = memchr(data + pos, PREAMBLE1, count - pos);
+            if (!sync) {
+                return count;
+            }
+            pos = sync - data;
+        }
+        else if (_step == 6 && _payload_counter + 1 < _payload_length) {
+            // _payload_length is limited to MAX_UBLOX_PAYLOAD_SIZE, the copy stays within _buffer
+            const uint32_t len = MIN(count - pos, (uint32_t)(_payload_length - 1 - _payload_counter));
+
+            for (uint32_t i = 0; i < len; i++) {
+                _ck_b += (_ck_a += data[pos + i]);
+            }
+            memcpy(&_buffer.bytes[_payload_counter], &data[pos], len);
+
+            _payload_counter += len;
+            pos += len;
+            continue;
+        }
+
+        if (gpsNewFrameUBLOX(data[pos++])) {
+            *newData = true;
+            break;
+        }
+    }
+
+    return pos;
+}
+
 STATIC_PROTOTHREAD(gpsConfigure)
 {
     ptBegin(gpsConfigure);
@@ -983,8 +1023,18 @@ STATIC_PROTOTHREAD(gpsProtocolReceiverThread)
 
         // Consume bytes until buffer empty of until we have full message received
         while (serialRxBytesWaiting(gpsState.gpsPort)) {
-            uint8_t newChar = serialRead(gpsState.gpsPort);
-            if (gpsNewFrameUBLOX(newChar)) {
+            const uint8_t *data;
+            const uint32_t count = serialPeekContiguous(gpsState.gpsPort, &data);
+            bool newData = false;
+
+            if (count) {
+                serialSkip(gpsState.gpsPort, gpsNewSpanUBLOX(data, count, &newData));
+            } else {
+                const uint8_t newChar = serialRead(gpsState.gpsPort);
+                gpsNewSpanUBLOX(&newChar, 1, &newData);
+            }
+
+            if (newData) {
                 ptSemaphoreSignal(semNewDataReady);
                 break;
             }
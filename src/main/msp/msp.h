@@ -30,6 +30,10 @@ typedef enum {
 
 #define MSP_VERSION_MAGIC_INITIALIZER { 'M', 'M', 'X' }
 
+// Upper bound for the replies of fixed size, the largest is MSP2_INAV_LOGIC_CONDITIONS with 896 bytes.
+// Commands with variable sized replies (e.g. MSP_DATAFLASH_READ) fill at most the space left in the reply buffer.
+#define MSP_MAX_REPLY_SIZE      1024
+
 // return positive for ACK, negative on error, zero for no reply
 typedef enum {
     MSP_RESULT_ACK = 1,
@@ -37,17 +41,19 @@ typedef enum {
     MSP_RESULT_NO_REPLY = 0
 } mspResult_e;
 
+struct serialPort_s;
+
 typedef struct mspPacket_s {
     sbuf_t buf;
     int16_t cmd;
     uint8_t flags;
     int16_t result;
+    struct serialPort_s *port;  // Port a command came in on, NULL if it didn't come from an MSP serial port
 } mspPacket_t;
 
 typedef enum {
     MSP_FLAG_DONT_REPLY           = (1 << 0),
 } mspFlags_e;
 
-struct serialPort_s;
 typedef void (*mspPostProcessFnPtr)(struct serialPort_s *port); // msp post process function, used for gracefully handling reboots, etc.
 typedef mspResult_e (*mspProcessCommandFnPtr)(mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn);
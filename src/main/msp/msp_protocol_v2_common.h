@@ -33,3 +33,6 @@
 #define MSP2_COMMON_SET_RADAR_POS       0x100B //SET radar position information
 #define MSP2_COMMON_SET_RADAR_ITD       0x100C //SET radar information to display
 
+#define MSP2_COMMON_BATCH               0x100D //in/out message    Runs several commands, returns all their replies in one frame
+#define MSP2_COMMON_SUBSCRIBE           0x100E //in/out message    Sets the messages the FC pushes to this port and their intervals
+
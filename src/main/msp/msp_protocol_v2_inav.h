@@ -85,6 +85,11 @@
 #define MSP2_INAV_LOGIC_CONDITIONS_SINGLE       0x203B
 
 #define MSP2_INAV_ESC_RPM                       0x2040
+#define MSP2_INAV_TASK_HISTOGRAM                0x2041
+#define MSP2_INAV_LOOP_STAGES                   0x2042
+#define MSP2_INAV_DATAFLASH_STREAM              0x2043
+#define MSP2_INAV_DATAFLASH_LOGS                0x2044
+#define MSP2_INAV_BLACKBOX_STATS                0x2045
 
 #define MSP2_INAV_LED_STRIP_CONFIG_EX           0x2048
 #define MSP2_INAV_SET_LED_STRIP_CONFIG_EX       0x2049
@@ -37,6 +37,13 @@
 #include "msp/msp.h"
 #include "msp/msp_serial.h"
 
+// Header and both checksums of an MSPv2 over MSPv1 jumbo frame
+#define MSP_MAX_FRAME_OVERHEAD              (MSP_MAX_HEADER_SIZE + 2)
+
+// Requests the host sends back to back are answered in the same run, up to this many
+#define MSP_SERIAL_MAX_REQUESTS_PER_RUN     8
+#define MSP_SERIAL_PIPELINE_TX_FREE_MIN     (MSP_MAX_REPLY_SIZE + MSP_MAX_FRAME_OVERHEAD)
+
 static mspPort_t mspPorts[MAX_MSP_PORT_COUNT];
 
 
@@ -257,14 +264,6 @@ static bool mspSerialProcessReceivedData(mspPort_t *mspPort, uint8_t c)
     return true;
 }
 
-static uint8_t mspSerialChecksumBuf(uint8_t checksum, const uint8_t *data, int len)
-{
-    while (len-- > 0) {
-        checksum ^= *data++;
-    }
-    return checksum;
-}
-
 #define JUMBO_FRAME_SIZE_LIMIT 255
 static int mspSerialSendFrame(mspPort_t *msp, const uint8_t * hdr, int hdrLen, const uint8_t * data, int dataLen, const uint8_t * crc, int crcLen)
 {
@@ -287,12 +286,10 @@ static int mspSerialSendFrame(mspPort_t *msp, const uint8_t * hdr, int hdrLen, c
     if (!isSerialTransmitBufferEmpty(port) && ((int)serialTxBytesFree(port) < totalFrameLength))
         return 0;
 
-    // Transmit frame
-    serialBeginWrite(port);
+    // Transmit frame, the caller brackets it with serialBeginWrite()/serialEndWrite()
     serialWriteBuf(port, hdr, hdrLen);
     serialWriteBuf(port, data, dataLen);
     serialWriteBuf(port, crc, crcLen);
-    serialEndWrite(port);
 
     return totalFrameLength;
 }
@@ -325,8 +322,8 @@ static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet, mspVersion_e msp
         }
 
         // Pre-calculate CRC
-        crcBuf[crcLen] = mspSerialChecksumBuf(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
-        crcBuf[crcLen] = mspSerialChecksumBuf(crcBuf[crcLen], sbufPtr(&packet->buf), dataLen);
+        crcBuf[crcLen] = crc8_xor_update(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
+        crcBuf[crcLen] = crc8_xor_update(crcBuf[crcLen], sbufPtr(&packet->buf), dataLen);
         crcLen++;
     }
     else if (mspVersion == MSP_V2_OVER_V1) {
@@ -363,9 +360,9 @@ static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet, mspVersion_e msp
         crcLen++;
 
         // V1 CRC: All headers + data payload + V2 CRC byte
-        crcBuf[crcLen] = mspSerialChecksumBuf(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
-        crcBuf[crcLen] = mspSerialChecksumBuf(crcBuf[crcLen], sbufPtr(&packet->buf), dataLen);
-        crcBuf[crcLen] = mspSerialChecksumBuf(crcBuf[crcLen], crcBuf, crcLen);
+        crcBuf[crcLen] = crc8_xor_update(0, hdrBuf + V1_CHECKSUM_STARTPOS, hdrLen - V1_CHECKSUM_STARTPOS);
+        crcBuf[crcLen] = crc8_xor_update(crcBuf[crcLen], sbufPtr(&packet->buf), dataLen);
+        crcBuf[crcLen] = crc8_xor_update(crcBuf[crcLen], crcBuf, crcLen);
         crcLen++;
     }
     else if (mspVersion == MSP_V2_NATIVE) {
@@ -389,12 +386,12 @@ static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet, mspVersion_e msp
     return mspSerialSendFrame(msp, hdrBuf, hdrLen, sbufPtr(&packet->buf), dataLen, crcBuf, crcLen);
 }
 
-static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn)
+static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn, int maxReplySize)
 {
     uint8_t outBuf[MSP_PORT_OUTBUF_SIZE];
 
     mspPacket_t reply = {
-        .buf = { .ptr = outBuf, .end = ARRAYEND(outBuf), },
+        .buf = { .ptr = outBuf, .end = outBuf + MIN(maxReplySize, MSP_PORT_OUTBUF_SIZE), },
         .cmd = -1,
         .flags = 0,
         .result = 0,
@@ -406,6 +403,7 @@ static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspPr
         .cmd = msp->cmdMSP,
         .flags = msp->cmdFlags,
         .result = 0,
+        .port = msp->port,
     };
 
     mspPostProcessFnPtr mspPostProcessFn = NULL;
@@ -433,6 +431,55 @@ static void mspEvaluateNonMspData(mspPort_t * mspPort, uint8_t receivedChar)
     }
 }
 
+/*
+ * Feeds received bytes to the parser, stops after a complete command. Payloads are copied and
+ * checksummed a span at a time and noise between frames is skipped, the state machine only sees
+ * the headers, the last payload byte and the checksums. Returns the number of bytes consumed.
+ */
+static uint32_t mspSerialProcessReceivedSpan(mspPort_t *mspPort, const uint8_t *data, uint32_t count, mspEvaluateNonMspData_e evaluateNonMspData)
+{
+    uint32_t pos = 0;
+
+    while (pos < count && mspPort->c_state != MSP_COMMAND_RECEIVED) {
+        const uint8_t *span = data + pos;
+        const mspState_e state = mspPort->c_state;
+
+        if (state == MSP_IDLE && evaluateNonMspData != MSP_EVALUATE_NON_MSP_DATA) {
+            const uint8_t *start = memchr(span, '$', count - pos);
+            if (!start) {
+                return count;
+            }
+            pos = start - data;
+        }
+        else if ((state == MSP_PAYLOAD_V1 || state == MSP_PAYLOAD_V2_OVER_V1 || state == MSP_PAYLOAD_V2_NATIVE) &&
+                 mspPort->offset + 1 < mspPort->dataSize) {
+            // The last payload byte goes through the state machine to switch to the checksum
+            const uint32_t len = MIN(count - pos, mspPort->dataSize - mspPort->offset - 1);
+
+            memcpy(&mspPort->inBuf[mspPort->offset], span, len);
+            if (state != MSP_PAYLOAD_V2_NATIVE) {
+                mspPort->checksum1 = crc8_xor_update(mspPort->checksum1, span, len);
+            }
+            if (state != MSP_PAYLOAD_V1) {
+                mspPort->checksum2 = crc8_dvb_s2_update(mspPort->checksum2, span, len);
+            }
+
+            mspPort->offset += len;
+            pos += len;
+            continue;
+        }
+
+        const uint8_t c = data[pos++];
+        const bool consumed = mspSerialProcessReceivedData(mspPort, c);
+
+        if (!consumed && evaluateNonMspData == MSP_EVALUATE_NON_MSP_DATA) {
+            mspEvaluateNonMspData(mspPort, c);
+        }
+    }
+
+    return pos;
+}
+
 static void mspProcessPendingRequest(mspPort_t * mspPort)
 {
     // If no request is pending or 100ms guard time has not elapsed - do nothing
@@ -458,30 +505,62 @@ static void mspProcessPendingRequest(mspPort_t * mspPort)
     }
 }
 
+// Parses received bytes until a command is complete, ports without direct buffer access are read byte by byte
+static void mspSerialReceive(mspPort_t *mspPort, mspEvaluateNonMspData_e evaluateNonMspData)
+{
+    while (mspPort->c_state != MSP_COMMAND_RECEIVED) {
+        const uint8_t *data;
+        const uint32_t count = serialPeekContiguous(mspPort->port, &data);
+
+        if (count) {
+            serialSkip(mspPort->port, mspSerialProcessReceivedSpan(mspPort, data, count, evaluateNonMspData));
+        }
+        else if (serialRxBytesWaiting(mspPort->port)) {
+            const uint8_t c = serialRead(mspPort->port);
+            mspSerialProcessReceivedSpan(mspPort, &c, 1, evaluateNonMspData);
+        }
+        else {
+            break;
+        }
+    }
+}
+
 void mspSerialProcessOnePort(mspPort_t * const mspPort, mspEvaluateNonMspData_e evaluateNonMspData, mspProcessCommandFnPtr mspProcessCommandFn)
 {
     mspPostProcessFnPtr mspPostProcessFn = NULL;
 
-    if (serialRxBytesWaiting(mspPort->port)) {
+    if (serialRxBytesWaiting(mspPort->port) || mspPort->c_state == MSP_COMMAND_RECEIVED) {
         // There are bytes incoming - abort pending request
         mspPort->lastActivityMs = millis();
         mspPort->pendingRequest = MSP_PENDING_NONE;
 
-        // Process incoming bytes
-        while (serialRxBytesWaiting(mspPort->port)) {
-            const uint8_t c = serialRead(mspPort->port);
-            const bool consumed = mspSerialProcessReceivedData(mspPort, c);
+        // Replies to the requests handled in this run are sent as one burst
+        serialBeginWrite(mspPort->port);
+
+        for (int requestCount = 0; requestCount < MSP_SERIAL_MAX_REQUESTS_PER_RUN && !mspPostProcessFn; requestCount++) {
+            mspSerialReceive(mspPort, evaluateNonMspData);
 
-            if (!consumed && evaluateNonMspData == MSP_EVALUATE_NON_MSP_DATA) {
-                mspEvaluateNonMspData(mspPort, c);
+            if (mspPort->c_state != MSP_COMMAND_RECEIVED) {
+                break;
             }
 
-            if (mspPort->c_state == MSP_COMMAND_RECEIVED) {
-                mspPostProcessFn = mspSerialProcessReceivedCommand(mspPort, mspProcessCommandFn);
-                break; // process one command at a time so as not to block.
+            int maxReplySize = MSP_PORT_OUTBUF_SIZE;
+
+            if (requestCount > 0) {
+                // Further requests the host sent without waiting for the replies are answered only while
+                // their reply can't be dropped for lack of TX space, otherwise they wait for the next run
+                const int txFree = serialTxBytesFree(mspPort->port);
+                if (txFree < MSP_SERIAL_PIPELINE_TX_FREE_MIN) {
+                    break;
+                }
+                maxReplySize = txFree - MSP_MAX_FRAME_OVERHEAD;
             }
+
+            mspPostProcessFn = mspSerialProcessReceivedCommand(mspPort, mspProcessCommandFn, maxReplySize);
         }
 
+        serialEndWrite(mspPort->port);
+
         if (mspPostProcessFn) {
             waitForSerialPortToFinishTransmitting(mspPort->port);
             mspPostProcessFn(mspPort->port);
@@ -515,19 +594,22 @@ void mspSerialInit(void)
 
 int mspSerialPushPort(uint16_t cmd, const uint8_t *data, int datalen, mspPort_t *mspPort, mspVersion_e version)
 {
-    uint8_t pushBuf[MSP_PORT_OUTBUF_SIZE];
-
+    // Encoded straight from the caller's buffer, pushes can be as large as replies without another copy on the stack
     mspPacket_t push = {
-        .buf = { .ptr = pushBuf, .end = ARRAYEND(pushBuf), },
+        .buf = { .ptr = (uint8_t *)data, .end = (uint8_t *)data + datalen, },
         .cmd = cmd,
         .result = 0,
     };
 
-    sbufWriteData(&push.buf, data, datalen);
+    if (!mspPort->port) {
+        return 0;
+    }
 
-    sbufSwitchToReader(&push.buf, pushBuf);
+    serialBeginWrite(mspPort->port);
+    const int frameLength = mspSerialEncode(mspPort, &push, version);
+    serialEndWrite(mspPort->port);
 
-    return mspSerialEncode(mspPort, &push, version);
+    return frameLength;
 }
 
 int mspSerialPush(uint8_t cmd, const uint8_t *data, int datalen)
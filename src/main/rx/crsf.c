@@ -43,6 +43,7 @@
 #include "telemetry/crsf.h"
 #define CRSF_TIME_NEEDED_PER_FRAME_US   1100 // 700 ms + 400 ms for potential ad-hoc request
 #define CRSF_TIME_BETWEEN_FRAMES_US     6667 // At fastest, frames are sent by the transmitter every 6.667 milliseconds, 150 Hz
+#define CRSF_TIME_PER_BYTE_US           24   // 10 bits at 420 kbaud
 
 #define CRSF_DIGITAL_CHANNEL_MIN 172
 #define CRSF_DIGITAL_CHANNEL_MAX 1811
@@ -56,6 +57,8 @@ STATIC_UNIT_TESTED uint32_t crsfChannelData[CRSF_MAX_CHANNEL];
 
 static serialPort_t *serialPort;
 static timeUs_t crsfFrameStartAt = 0;
+static uint8_t crsfRxBuffer[CRSF_FRAME_SIZE_MAX];   // The frame being received, from its sync byte on
+static uint8_t crsfRxBufferLength = 0;
 static uint8_t telemetryBuf[CRSF_FRAME_SIZE_MAX];
 static uint8_t telemetryBufLen = 0;
 
@@ -125,142 +128,186 @@ typedef struct crsfPayloadLinkStatistics_s {
 
 typedef struct crsfPayloadLinkStatistics_s crsfPayloadLinkStatistics_t;
 
-STATIC_UNIT_TESTED uint8_t crsfFrameCRC(void)
+// CRC of the type and payload of a frame
+static uint8_t crsfFrameCRC(const uint8_t *frame)
 {
-    // CRC includes type and payload
-    uint8_t crc = crc8_dvb_s2(0, crsfFrame.frame.type);
-    for (int ii = 0; ii < crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC; ++ii) {
-        crc = crc8_dvb_s2(crc, crsfFrame.frame.payload[ii]);
-    }
-    return crc;
+    return crc8_dvb_s2_update(0, frame + CRSF_PAYLOAD_OFFSET, frame[1] - CRSF_FRAME_LENGTH_CRC);
 }
 
-// Receive ISR callback, called back from serial port
-STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c, void *rxCallbackData)
+// Drops the sync byte of the frame being received and continues from the next one received after it
+static void crsfRxBufferResync(void)
 {
-    UNUSED(rxCallbackData);
+    const uint8_t *next = memchr(crsfRxBuffer + 1, CRSF_SYNC_BYTE, crsfRxBufferLength - 1);
+    const uint8_t drop = next ? next - crsfRxBuffer : crsfRxBufferLength;
 
-    static uint8_t crsfFramePosition = 0;
-    const timeUs_t now = micros();
+    crsfRxBufferLength -= drop;
+    memmove(crsfRxBuffer, crsfRxBuffer + drop, crsfRxBufferLength);
+}
 
-#ifdef DEBUG_CRSF_PACKETS
-    debug[2] = now - crsfFrameStartAt;
-#endif
+/*
+ * Feeds received bytes to the frame being received, stops once a frame with a valid CRC is complete in crsfFrame.
+ * The sync byte is searched for with memchr and the rest of the frame copied a span at a time. Returns the number
+ * of bytes consumed.
+ */
+STATIC_UNIT_TESTED uint32_t crsfProcessReceivedSpan(const uint8_t *data, uint32_t count, uint32_t bytesWaiting)
+{
+    uint32_t pos = 0;
 
-    if (now > crsfFrameStartAt + CRSF_TIME_NEEDED_PER_FRAME_US) {
-        // We've received a character after max time needed to complete a frame,
-        // so this must be the start of a new frame.
-        crsfFramePosition = 0;
-    }
+    while (!crsfFrameDone) {
+        if (crsfRxBufferLength == 0) {
+            const uint8_t *start = memchr(data + pos, CRSF_SYNC_BYTE, count - pos);
+            if (!start) {
+                return count;
+            }
+            pos = start - data;
+            // The frame started when the bytes still waiting from its sync byte on began to arrive
+            crsfFrameStartAt = micros() - (bytesWaiting - pos) * CRSF_TIME_PER_BYTE_US;
+        }
 
-    if (crsfFramePosition == 0) {
-        crsfFrameStartAt = now;
-    }
-    // assume frame is 5 bytes long until we have received the frame length
-    // full frame length includes the length of the address and framelength fields
-    const int fullFrameLength = crsfFramePosition < 3 ? 5 : crsfFrame.frame.frameLength + CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH;
-
-    if (crsfFramePosition < fullFrameLength) {
-        crsfFrame.bytes[crsfFramePosition++] = (uint8_t)c;
-        crsfFrameDone = crsfFramePosition < fullFrameLength ? false : true;
-        if (crsfFrameDone) {
-            crsfFramePosition = 0;
-            if (crsfFrame.frame.type != CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
-                const uint8_t crc = crsfFrameCRC();
-                if (crc == crsfFrame.bytes[fullFrameLength - 1]) {
-                    switch (crsfFrame.frame.type)
-                    {
-#if defined(USE_MSP_OVER_TELEMETRY)
-                        case CRSF_FRAMETYPE_MSP_REQ:
-                        case CRSF_FRAMETYPE_MSP_WRITE: {
-                            uint8_t *frameStart = (uint8_t *)&crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE;
-                            if (bufferCrsfMspFrame(frameStart, CRSF_FRAME_RX_MSP_FRAME_SIZE)) {
-                                crsfScheduleMspResponse();
-                            }
-                            break;
-                        }
-#endif
-                        default:
-                            break;
-                    }
-                }
+        // Until the length is in, assume the shortest frame
+        const uint8_t frameLength = crsfRxBufferLength > 1 ? crsfRxBuffer[1] : CRSF_FRAME_LENGTH_TYPE_CRC;
+        const uint8_t fullFrameLength = frameLength + CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH;
+
+        if (frameLength < CRSF_FRAME_LENGTH_TYPE_CRC || fullFrameLength > CRSF_FRAME_SIZE_MAX) {
+            crsfRxBufferResync();
+            continue;
+        }
+
+        if (crsfRxBufferLength < fullFrameLength) {
+            if (pos == count) {
+                break;
             }
+            const uint32_t length = MIN(count - pos, (uint32_t)(fullFrameLength - crsfRxBufferLength));
+            memcpy(crsfRxBuffer + crsfRxBufferLength, data + pos, length);
+            crsfRxBufferLength += length;
+            pos += length;
+            continue;
+        }
+
+        if (crsfFrameCRC(crsfRxBuffer) != crsfRxBuffer[fullFrameLength - 1]) {
+            crsfRxBufferResync();
+            continue;
         }
+
+        // Bytes after the frame, left over from a resync, start the next one
+        memcpy(crsfFrame.bytes, crsfRxBuffer, fullFrameLength);
+        crsfRxBufferLength -= fullFrameLength;
+        memmove(crsfRxBuffer, crsfRxBuffer + fullFrameLength, crsfRxBufferLength);
+        crsfFrameDone = true;
     }
+
+    return pos;
 }
 
-STATIC_UNIT_TESTED uint8_t crsfFrameStatus(rxRuntimeConfig_t *rxRuntimeConfig)
+// Parses the received bytes in place until a frame is complete, returns false if they run out first
+STATIC_UNIT_TESTED bool crsfReceiveFrame(void)
+{
+    while (!crsfFrameDone) {
+        const uint8_t *data;
+        const uint32_t bytesWaiting = serialRxBytesWaiting(serialPort);
+        const uint32_t count = serialPeekContiguous(serialPort, &data);
+
+        if (count) {
+            serialSkip(serialPort, crsfProcessReceivedSpan(data, count, bytesWaiting));
+        }
+        else if (bytesWaiting) {
+            // Ports without direct buffer access are read byte by byte
+            const uint8_t c = serialRead(serialPort);
+            crsfProcessReceivedSpan(&c, 1, bytesWaiting);
+        }
+        else {
+            break;
+        }
+    }
+
+    return crsfFrameDone;
+}
+
+static uint8_t crsfProcessFrame(rxRuntimeConfig_t *rxRuntimeConfig)
 {
     UNUSED(rxRuntimeConfig);
 
-    if (crsfFrameDone) {
-        crsfFrameDone = false;
-        if (crsfFrame.frame.type == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
-            // CRC includes type and payload of each frame
-            const uint8_t crc = crsfFrameCRC();
-            if (crc != crsfFrame.frame.payload[CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE]) {
-                return RX_FRAME_PENDING;
-            }
-            crsfFrame.frame.frameLength = CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE + CRSF_FRAME_LENGTH_TYPE_CRC;
-
-            // unpack the RC channels
-            const crsfPayloadRcChannelsPacked_t* rcChannels = (crsfPayloadRcChannelsPacked_t*)&crsfFrame.frame.payload;
-            crsfChannelData[0] = rcChannels->chan0;
-            crsfChannelData[1] = rcChannels->chan1;
-            crsfChannelData[2] = rcChannels->chan2;
-            crsfChannelData[3] = rcChannels->chan3;
-            crsfChannelData[4] = rcChannels->chan4;
-            crsfChannelData[5] = rcChannels->chan5;
-            crsfChannelData[6] = rcChannels->chan6;
-            crsfChannelData[7] = rcChannels->chan7;
-            crsfChannelData[8] = rcChannels->chan8;
-            crsfChannelData[9] = rcChannels->chan9;
-            crsfChannelData[10] = rcChannels->chan10;
-            crsfChannelData[11] = rcChannels->chan11;
-            crsfChannelData[12] = rcChannels->chan12;
-            crsfChannelData[13] = rcChannels->chan13;
-            crsfChannelData[14] = rcChannels->chan14;
-            crsfChannelData[15] = rcChannels->chan15;
-            return RX_FRAME_COMPLETE;
+    crsfFrameDone = false;
+
+    if (crsfFrame.frame.type == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
+        if (crsfFrame.frame.frameLength != CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE + CRSF_FRAME_LENGTH_TYPE_CRC) {
+            return RX_FRAME_PENDING;
+        }
+
+        // unpack the RC channels
+        const crsfPayloadRcChannelsPacked_t* rcChannels = (crsfPayloadRcChannelsPacked_t*)&crsfFrame.frame.payload;
+        crsfChannelData[0] = rcChannels->chan0;
+        crsfChannelData[1] = rcChannels->chan1;
+        crsfChannelData[2] = rcChannels->chan2;
+        crsfChannelData[3] = rcChannels->chan3;
+        crsfChannelData[4] = rcChannels->chan4;
+        crsfChannelData[5] = rcChannels->chan5;
+        crsfChannelData[6] = rcChannels->chan6;
+        crsfChannelData[7] = rcChannels->chan7;
+        crsfChannelData[8] = rcChannels->chan8;
+        crsfChannelData[9] = rcChannels->chan9;
+        crsfChannelData[10] = rcChannels->chan10;
+        crsfChannelData[11] = rcChannels->chan11;
+        crsfChannelData[12] = rcChannels->chan12;
+        crsfChannelData[13] = rcChannels->chan13;
+        crsfChannelData[14] = rcChannels->chan14;
+        crsfChannelData[15] = rcChannels->chan15;
+        return RX_FRAME_COMPLETE;
+    }
+    else if (crsfFrame.frame.type == CRSF_FRAMETYPE_LINK_STATISTICS) {
+        if (crsfFrame.frame.frameLength != CRSF_FRAME_LINK_STATISTICS_PAYLOAD_SIZE + CRSF_FRAME_LENGTH_TYPE_CRC) {
+            return RX_FRAME_PENDING;
         }
-        else if (crsfFrame.frame.type == CRSF_FRAMETYPE_LINK_STATISTICS) {
-            // CRC includes type and payload of each frame
-            const uint8_t crc = crsfFrameCRC();
-            if (crc != crsfFrame.frame.payload[CRSF_FRAME_LINK_STATISTICS_PAYLOAD_SIZE]) {
-                return RX_FRAME_PENDING;
-            }
-            crsfFrame.frame.frameLength = CRSF_FRAME_LINK_STATISTICS_PAYLOAD_SIZE + CRSF_FRAME_LENGTH_TYPE_CRC;
 
-            const crsfPayloadLinkStatistics_t* linkStats = (crsfPayloadLinkStatistics_t*)&crsfFrame.frame.payload;
-            const uint8_t crsftxpowerindex = (linkStats->uplinkTXPower < CRSF_POWER_COUNT) ? linkStats->uplinkTXPower : 0;
+        const crsfPayloadLinkStatistics_t* linkStats = (crsfPayloadLinkStatistics_t*)&crsfFrame.frame.payload;
+        const uint8_t crsftxpowerindex = (linkStats->uplinkTXPower < CRSF_POWER_COUNT) ? linkStats->uplinkTXPower : 0;
 
-            rxLinkStatistics.uplinkRSSI = -1* (linkStats->activeAntenna ? linkStats->uplinkRSSIAnt2 : linkStats->uplinkRSSIAnt1);
-            rxLinkStatistics.uplinkLQ = linkStats->uplinkLQ;
-            rxLinkStatistics.uplinkSNR = linkStats->uplinkSNR;
-            rxLinkStatistics.rfMode = linkStats->rfMode;
-            rxLinkStatistics.uplinkTXPower = crsfTxPowerStatesmW[crsftxpowerindex];
-            rxLinkStatistics.activeAntenna = linkStats->activeAntenna;
+        rxLinkStatistics.uplinkRSSI = -1* (linkStats->activeAntenna ? linkStats->uplinkRSSIAnt2 : linkStats->uplinkRSSIAnt1);
+        rxLinkStatistics.uplinkLQ = linkStats->uplinkLQ;
+        rxLinkStatistics.uplinkSNR = linkStats->uplinkSNR;
+        rxLinkStatistics.rfMode = linkStats->rfMode;
+        rxLinkStatistics.uplinkTXPower = crsfTxPowerStatesmW[crsftxpowerindex];
+        rxLinkStatistics.activeAntenna = linkStats->activeAntenna;
 
 #ifdef USE_OSD
-            if (rxLinkStatistics.uplinkLQ > 0) {
-                int16_t uplinkStrength;   // RSSI dBm converted to %
-                uplinkStrength = constrain((100 * sq((osdConfig()->rssi_dbm_max - osdConfig()->rssi_dbm_min)) - (100 * sq((osdConfig()->rssi_dbm_max  - rxLinkStatistics.uplinkRSSI)))) / sq((osdConfig()->rssi_dbm_max - osdConfig()->rssi_dbm_min)),0,100);
-                if (rxLinkStatistics.uplinkRSSI >= osdConfig()->rssi_dbm_max )
-                    uplinkStrength = 99;
-                else if (rxLinkStatistics.uplinkRSSI < osdConfig()->rssi_dbm_min)
-                    uplinkStrength = 0;
-                lqTrackerSet(rxRuntimeConfig->lqTracker, scaleRange(uplinkStrength, 0, 99, 0, RSSI_MAX_VALUE));
-            } else {
-                lqTrackerSet(rxRuntimeConfig->lqTracker, 0);
-            }
+        if (rxLinkStatistics.uplinkLQ > 0) {
+            int16_t uplinkStrength;   // RSSI dBm converted to %
+            uplinkStrength = constrain((100 * sq((osdConfig()->rssi_dbm_max - osdConfig()->rssi_dbm_min)) - (100 * sq((osdConfig()->rssi_dbm_max  - rxLinkStatistics.uplinkRSSI)))) / sq((osdConfig()->rssi_dbm_max - osdConfig()->rssi_dbm_min)),0,100);
+            if (rxLinkStatistics.uplinkRSSI >= osdConfig()->rssi_dbm_max )
+                uplinkStrength = 99;
+            else if (rxLinkStatistics.uplinkRSSI < osdConfig()->rssi_dbm_min)
+                uplinkStrength = 0;
+            lqTrackerSet(rxRuntimeConfig->lqTracker, scaleRange(uplinkStrength, 0, 99, 0, RSSI_MAX_VALUE));
+        } else {
+            lqTrackerSet(rxRuntimeConfig->lqTracker, 0);
+        }
 #endif
-            // This is not RC channels frame, update channel value but don't indicate frame completion
-            return RX_FRAME_PENDING;
+    }
+#if defined(USE_MSP_OVER_TELEMETRY)
+    else if (crsfFrame.frame.type == CRSF_FRAMETYPE_MSP_REQ || crsfFrame.frame.type == CRSF_FRAMETYPE_MSP_WRITE) {
+        uint8_t *frameStart = (uint8_t *)&crsfFrame.frame.payload + CRSF_FRAME_ORIGIN_DEST_SIZE;
+        if (bufferCrsfMspFrame(frameStart, CRSF_FRAME_RX_MSP_FRAME_SIZE)) {
+            crsfScheduleMspResponse();
         }
     }
+#endif
+
+    // Not an RC channels frame, channel values aren't updated
     return RX_FRAME_PENDING;
 }
 
+STATIC_UNIT_TESTED uint8_t crsfFrameStatus(rxRuntimeConfig_t *rxRuntimeConfig)
+{
+    uint8_t frameStatus = RX_FRAME_PENDING;
+
+    // Handle all frames received since the last call, the newest channel values win
+    while (crsfReceiveFrame()) {
+        frameStatus |= crsfProcessFrame(rxRuntimeConfig);
+    }
+
+    return frameStatus;
+}
+
 STATIC_UNIT_TESTED uint16_t crsfReadRawRC(const rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
 {
     UNUSED(rxRuntimeConfig);
@@ -288,7 +335,11 @@ void crsfRxSendTelemetryData(void)
     if (telemetryBufLen > 0) {
         // check that we are not in bi dir mode or that we are not currently receiving data (ie in the middle of an RX frame)
         // and that there is time to send the telemetry frame before the next RX frame arrives
-        if (CRSF_PORT_OPTIONS & SERIAL_BIDIR) {
+        if (serialPort->options & SERIAL_BIDIR) {
+            // crsfFrameStartAt only moves on once the bytes of a new frame are parsed, until then the line is busy
+            if (serialRxBytesWaiting(serialPort) > 0) {
+                return;
+            }
             const timeDelta_t timeSinceStartOfFrame = cmpTimeUs(micros(), crsfFrameStartAt);
             if ((timeSinceStartOfFrame < CRSF_TIME_NEEDED_PER_FRAME_US) ||
                 (timeSinceStartOfFrame > CRSF_TIME_BETWEEN_FRAMES_US - CRSF_TIME_NEEDED_PER_FRAME_US)) {
@@ -317,7 +368,7 @@ bool crsfRxInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
 
     serialPort = openSerialPort(portConfig->identifier,
         FUNCTION_RX_SERIAL,
-        crsfDataReceive,
+        NULL,
         NULL,
         CRSF_BAUDRATE,
         CRSF_PORT_MODE,
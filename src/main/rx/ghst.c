@@ -130,11 +130,8 @@ void ghstRxSendTelemetryData(void)
 STATIC_UNIT_TESTED uint8_t ghstFrameCRC(ghstFrame_t *pGhstFrame)
 {
     // CRC includes type and payload
-    uint8_t crc = crc8_dvb_s2(0, pGhstFrame->frame.type);
-    for (int i = 0; i < pGhstFrame->frame.len - GHST_FRAME_LENGTH_TYPE_CRC - 1; ++i) {
-        crc = crc8_dvb_s2(crc, pGhstFrame->frame.payload[i]);
-    }
-    return crc;
+    const uint8_t crc = crc8_dvb_s2(0, pGhstFrame->frame.type);
+    return crc8_dvb_s2_update(crc, pGhstFrame->frame.payload, pGhstFrame->frame.len - GHST_FRAME_LENGTH_TYPE_CRC - 1);
 }
 
 // Receive ISR callback, called back from serial port
@@ -40,6 +40,24 @@ STATIC_FASTRAM uint32_t totalWaitingTasksSamples;
 FASTRAM uint16_t averageSystemLoadPercent = 0;
 
 
+/*
+ * Tasks are kept in three structures:
+ *  - taskQueueArray: all enabled tasks ordered by static priority. Only used for
+ *    bookkeeping, a task's position in this queue breaks dynamic priority ties.
+ *  - taskHeap: time driven tasks which are not due yet, as a binary min-heap keyed
+ *    by the time they become due (lastExecutedAt + desiredPeriod).
+ *  - taskReadyArray: tasks which are due (or signalled by their checkFunc) and
+ *    compete for execution, ordered as in taskQueueArray.
+ * Event driven tasks additionally live in eventTaskArray so their checkFunc can
+ * be polled without walking the whole queue.
+ */
+typedef enum {
+    TASK_QUEUE_NONE = 0,    // task is disabled
+    TASK_QUEUE_HEAP,        // time driven task waiting to become due
+    TASK_QUEUE_EVENT,       // event driven task waiting for checkFunc to signal
+    TASK_QUEUE_READY,       // task is ready to be executed
+} taskQueueState_e;
+
 STATIC_FASTRAM int taskQueuePos = 0;
 STATIC_FASTRAM int taskQueueSize = 0;
 // No need for a linked list for the queue, since items are only inserted at startup
@@ -48,11 +66,164 @@ STATIC_FASTRAM_UNIT_TESTED cfTask_t* taskQueueArray[TASK_COUNT + 2]; // 1 extra
 #else
 STATIC_FASTRAM cfTask_t* taskQueueArray[TASK_COUNT + 1]; // extra item for NULL pointer at end of queue
 #endif
+
+STATIC_FASTRAM int taskHeapSize = 0;
+STATIC_FASTRAM cfTask_t* taskHeap[TASK_COUNT];
+
+STATIC_FASTRAM int taskReadyCount = 0;
+STATIC_FASTRAM cfTask_t* taskReadyArray[TASK_COUNT];
+
+STATIC_FASTRAM int eventTaskCount = 0;
+STATIC_FASTRAM cfTask_t* eventTaskArray[TASK_COUNT];
+
+static inline timeUs_t taskDueAt(const cfTask_t *task)
+{
+    return task->lastExecutedAt + task->desiredPeriod;
+}
+
+static inline bool taskDueBefore(const cfTask_t *a, const cfTask_t *b)
+{
+    return cmpTimeUs(taskDueAt(a), taskDueAt(b)) < 0;
+}
+
+static inline void heapSet(int index, cfTask_t *task)
+{
+    taskHeap[index] = task;
+    task->heapIndex = index;
+}
+
+static void heapSiftUp(int index)
+{
+    cfTask_t *task = taskHeap[index];
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (!taskDueBefore(task, taskHeap[parent])) {
+            break;
+        }
+        heapSet(index, taskHeap[parent]);
+        index = parent;
+    }
+    heapSet(index, task);
+}
+
+static void heapSiftDown(int index)
+{
+    cfTask_t *task = taskHeap[index];
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= taskHeapSize) {
+            break;
+        }
+        if (child + 1 < taskHeapSize && taskDueBefore(taskHeap[child + 1], taskHeap[child])) {
+            child++;
+        }
+        if (!taskDueBefore(taskHeap[child], task)) {
+            break;
+        }
+        heapSet(index, taskHeap[child]);
+        index = child;
+    }
+    heapSet(index, task);
+}
+
+static void heapInsert(cfTask_t *task)
+{
+    task->queueState = TASK_QUEUE_HEAP;
+    heapSet(taskHeapSize++, task);
+    heapSiftUp(task->heapIndex);
+}
+
+static void heapRemove(cfTask_t *task)
+{
+    const int index = task->heapIndex;
+    cfTask_t *last = taskHeap[--taskHeapSize];
+    task->queueState = TASK_QUEUE_NONE;
+    if (last != task) {
+        heapSet(index, last);
+        heapSiftUp(index);
+        heapSiftDown(last->heapIndex);
+    }
+}
+
+static void readyInsert(cfTask_t *task)
+{
+    int ii = taskReadyCount;
+    while (ii > 0 && taskReadyArray[ii - 1]->queueRank > task->queueRank) {
+        taskReadyArray[ii] = taskReadyArray[ii - 1];
+        ii--;
+    }
+    taskReadyArray[ii] = task;
+    taskReadyCount++;
+    task->queueState = TASK_QUEUE_READY;
+}
+
+static void readyRemove(cfTask_t *task)
+{
+    for (int ii = 0; ii < taskReadyCount; ++ii) {
+        if (taskReadyArray[ii] == task) {
+            memmove(&taskReadyArray[ii], &taskReadyArray[ii + 1], sizeof(task) * (taskReadyCount - ii - 1));
+            taskReadyCount--;
+            break;
+        }
+    }
+    task->queueState = TASK_QUEUE_NONE;
+}
+
+static void eventTaskRemove(cfTask_t *task)
+{
+    for (int ii = 0; ii < eventTaskCount; ++ii) {
+        if (eventTaskArray[ii] == task) {
+            memmove(&eventTaskArray[ii], &eventTaskArray[ii + 1], sizeof(task) * (eventTaskCount - ii - 1));
+            eventTaskCount--;
+            break;
+        }
+    }
+}
+
+// Puts a task which is not ready into the structure it waits in
+static void taskPark(cfTask_t *task)
+{
+    if (task->checkFunc) {
+        task->queueState = TASK_QUEUE_EVENT;
+    } else {
+        heapInsert(task);
+    }
+}
+
+// Takes a task out of whichever structure it currently waits in
+static void taskUnpark(cfTask_t *task)
+{
+    switch (task->queueState) {
+    case TASK_QUEUE_HEAP:
+        heapRemove(task);
+        break;
+    case TASK_QUEUE_READY:
+        readyRemove(task);
+        break;
+    default:
+        task->queueState = TASK_QUEUE_NONE;
+        break;
+    }
+}
+
+static void queueUpdateRanks(void)
+{
+    for (int ii = 0; ii < taskQueueSize; ++ii) {
+        taskQueueArray[ii]->queueRank = ii;
+    }
+}
+
 STATIC_UNIT_TESTED void queueClear(void)
 {
+    for (int ii = 0; ii < taskQueueSize; ++ii) {
+        taskQueueArray[ii]->queueState = TASK_QUEUE_NONE;
+    }
     memset(taskQueueArray, 0, sizeof(taskQueueArray));
     taskQueuePos = 0;
     taskQueueSize = 0;
+    taskHeapSize = 0;
+    taskReadyCount = 0;
+    eventTaskCount = 0;
 }
 
 #ifdef UNIT_TEST
@@ -82,6 +253,11 @@ STATIC_UNIT_TESTED bool queueAdd(cfTask_t *task)
             memmove(&taskQueueArray[ii+1], &taskQueueArray[ii], sizeof(task) * (taskQueueSize - ii));
             taskQueueArray[ii] = task;
             ++taskQueueSize;
+            queueUpdateRanks();
+            if (task->checkFunc) {
+                eventTaskArray[eventTaskCount++] = task;
+            }
+            taskPark(task);
             return true;
         }
     }
@@ -94,6 +270,11 @@ STATIC_UNIT_TESTED bool queueRemove(cfTask_t *task)
         if (taskQueueArray[ii] == task) {
             memmove(&taskQueueArray[ii], &taskQueueArray[ii+1], sizeof(task) * (taskQueueSize - ii));
             --taskQueueSize;
+            queueUpdateRanks();
+            taskUnpark(task);
+            if (task->checkFunc) {
+                eventTaskRemove(task);
+            }
             return true;
         }
     }
@@ -141,6 +322,34 @@ void getCheckFuncInfo(cfCheckFuncInfo_t *checkFuncInfo)
     checkFuncInfo->averageExecutionTime = checkFuncMovingSumExecutionTime / TASK_MOVING_SUM_COUNT;
 }
 
+STATIC_FASTRAM taskHistogram_t taskHistograms[TASK_COUNT];
+
+static uint8_t histogramBucket(timeDelta_t value)
+{
+    if (value <= 0) {
+        return 0;
+    }
+    return MIN(32 - __builtin_clz((uint32_t)value), TASK_HISTOGRAM_BUCKETS - 1);
+}
+
+static void histogramAdd(uint16_t *buckets, timeDelta_t value)
+{
+    const uint8_t bucket = histogramBucket(value);
+
+    // Halve all counts on overflow so the histogram keeps its shape
+    if (buckets[bucket] == UINT16_MAX) {
+        for (int ii = 0; ii < TASK_HISTOGRAM_BUCKETS; ii++) {
+            buckets[ii] >>= 1;
+        }
+    }
+    buckets[bucket]++;
+}
+
+void getTaskHistogram(cfTaskId_e taskId, taskHistogram_t *taskHistogram)
+{
+    *taskHistogram = taskHistograms[taskId];
+}
+
 void getTaskInfo(cfTaskId_e taskId, cfTaskInfo_t * taskInfo)
 {
     taskInfo->taskName = cfTasks[taskId].taskName;
@@ -155,12 +364,21 @@ void getTaskInfo(cfTaskId_e taskId, cfTaskInfo_t * taskInfo)
 
 void rescheduleTask(cfTaskId_e taskId, timeDelta_t newPeriodUs)
 {
+    cfTask_t *task;
     if (taskId == TASK_SELF) {
-        cfTask_t *task = currentTask;
-        task->desiredPeriod = MAX(SCHEDULER_DELAY_LIMIT, newPeriodUs);  // Limit delay to 100us (10 kHz) to prevent scheduler clogging
+        task = currentTask;
     } else if (taskId < TASK_COUNT) {
-        cfTask_t *task = &cfTasks[taskId];
-        task->desiredPeriod = MAX(SCHEDULER_DELAY_LIMIT, newPeriodUs);  // Limit delay to 100us (10 kHz) to prevent scheduler clogging
+        task = &cfTasks[taskId];
+    } else {
+        return;
+    }
+
+    task->desiredPeriod = MAX(SCHEDULER_DELAY_LIMIT, newPeriodUs);  // Limit delay to 100us (10 kHz) to prevent scheduler clogging
+
+    // Due time changed, restore heap order
+    if (task->queueState == TASK_QUEUE_HEAP) {
+        heapSiftUp(task->heapIndex);
+        heapSiftDown(task->heapIndex);
     }
 }
 
@@ -193,9 +411,11 @@ void schedulerResetTaskStatistics(cfTaskId_e taskId)
         currentTask->movingSumExecutionTime = 0;
         currentTask->totalExecutionTime = 0;
         currentTask->maxExecutionTime = 0;
+        memset(&taskHistograms[currentTask - cfTasks], 0, sizeof(taskHistogram_t));
     } else if (taskId < TASK_COUNT) {
         cfTasks[taskId].movingSumExecutionTime = 0;
         cfTasks[taskId].totalExecutionTime = 0;
+        memset(&taskHistograms[taskId], 0, sizeof(taskHistogram_t));
     }
 }
 
@@ -215,31 +435,44 @@ void FAST_CODE NOINLINE scheduler(void)
     uint16_t selectedTaskDynamicPriority = 0;
     bool forcedRealTimeTask = false;
 
-    // Update task dynamic priorities
+    // Move time driven tasks which became due to the ready list
+    while (taskHeapSize > 0 && cmpTimeUs(currentTimeUs, taskDueAt(taskHeap[0])) >= 0) {
+        cfTask_t *task = taskHeap[0];
+        heapRemove(task);
+        readyInsert(task);
+    }
+
+    // Poll event driven tasks which are not signalled yet
+    for (int ii = 0; ii < eventTaskCount; ++ii) {
+        cfTask_t *task = eventTaskArray[ii];
+        if (task->queueState != TASK_QUEUE_EVENT) {
+            continue;
+        }
+
+        const timeUs_t currentTimeBeforeCheckFuncCallUs = micros();
+        if (task->checkFunc(currentTimeBeforeCheckFuncCallUs, currentTimeBeforeCheckFuncCallUs - task->lastExecutedAt)) {
+            const timeUs_t checkFuncExecutionTime = micros() - currentTimeBeforeCheckFuncCallUs;
+            checkFuncMovingSumExecutionTime -= checkFuncMovingSumExecutionTime / TASK_MOVING_SUM_COUNT;
+            checkFuncMovingSumExecutionTime += checkFuncExecutionTime;
+            checkFuncTotalExecutionTime += checkFuncExecutionTime;   // time consumed by scheduler + task
+            checkFuncMaxExecutionTime = MAX(checkFuncMaxExecutionTime, checkFuncExecutionTime);
+            task->lastSignaledAt = currentTimeBeforeCheckFuncCallUs;
+            readyInsert(task);
+        } else {
+            task->taskAgeCycles = 0;
+        }
+    }
+
+    // Update dynamic priorities of ready tasks only
     uint16_t waitingTasks = 0;
-    for (cfTask_t *task = queueFirst(); task != NULL; task = queueNext()) {
-        // Task has checkFunc - event driven
-        if (task->checkFunc) {
-            const timeUs_t currentTimeBeforeCheckFuncCallUs = micros();
+    for (int ii = 0; ii < taskReadyCount; ++ii) {
+        cfTask_t *task = taskReadyArray[ii];
 
+        if (task->checkFunc) {
             // Increase priority for event driven tasks
-            if (task->dynamicPriority > 0) {
-                task->taskAgeCycles = 1 + ((timeDelta_t)(currentTimeUs - task->lastSignaledAt)) / task->desiredPeriod;
-                task->dynamicPriority = 1 + task->staticPriority * task->taskAgeCycles;
-                waitingTasks++;
-            } else if (task->checkFunc(currentTimeBeforeCheckFuncCallUs, currentTimeBeforeCheckFuncCallUs - task->lastExecutedAt)) {
-                const timeUs_t checkFuncExecutionTime = micros() - currentTimeBeforeCheckFuncCallUs;
-                checkFuncMovingSumExecutionTime -= checkFuncMovingSumExecutionTime / TASK_MOVING_SUM_COUNT;
-                checkFuncMovingSumExecutionTime += checkFuncExecutionTime;
-                checkFuncTotalExecutionTime += checkFuncExecutionTime;   // time consumed by scheduler + task
-                checkFuncMaxExecutionTime = MAX(checkFuncMaxExecutionTime, checkFuncExecutionTime);
-                task->lastSignaledAt = currentTimeBeforeCheckFuncCallUs;
-                task->taskAgeCycles = 1;
-                task->dynamicPriority = 1 + task->staticPriority;
-                waitingTasks++;
-            } else {
-                task->taskAgeCycles = 0;
-            }
+            task->taskAgeCycles = 1 + ((timeDelta_t)(currentTimeUs - task->lastSignaledAt)) / task->desiredPeriod;
+            task->dynamicPriority = 1 + task->staticPriority * task->taskAgeCycles;
+            waitingTasks++;
         } else if (task->staticPriority == TASK_PRIORITY_REALTIME) {
             //realtime tasks take absolute priority. Any RT tasks that is overdue, should be execute immediately
             if (((timeDelta_t)(currentTimeUs - task->lastExecutedAt)) > task->desiredPeriod) {
@@ -255,6 +488,13 @@ void FAST_CODE NOINLINE scheduler(void)
             if (task->taskAgeCycles > 0) {
                 task->dynamicPriority = 1 + task->staticPriority * task->taskAgeCycles;
                 waitingTasks++;
+            } else {
+                // Period was extended after the task became due, wait for the new due time
+                task->dynamicPriority = 0;
+                readyRemove(task);
+                heapInsert(task);
+                ii--;
+                continue;
             }
         }
 
@@ -271,10 +511,21 @@ void FAST_CODE NOINLINE scheduler(void)
 
     if (selectedTask) {
         // Found a task that should be run
+        taskHistogram_t *histogram = &taskHistograms[selectedTask - cfTasks];
         selectedTask->taskLatestDeltaTime = (timeDelta_t)(currentTimeUs - selectedTask->lastExecutedAt);
+        if (selectedTask->checkFunc) {
+            histogramAdd(histogram->buckets[TASK_HISTOGRAM_LATENESS], (timeDelta_t)(currentTimeUs - selectedTask->lastSignaledAt));
+        } else {
+            histogramAdd(histogram->buckets[TASK_HISTOGRAM_LATENESS], selectedTask->taskLatestDeltaTime - selectedTask->desiredPeriod);
+        }
+        histogramAdd(histogram->buckets[TASK_HISTOGRAM_PERIOD], selectedTask->taskLatestDeltaTime);
         selectedTask->lastExecutedAt = currentTimeUs;
         selectedTask->dynamicPriority = 0;
 
+        // Park the task before running it, so it can reschedule or disable itself
+        readyRemove(selectedTask);
+        taskPark(selectedTask);
+
         // Execute task
         const timeUs_t currentTimeBeforeTaskCall = micros();
         selectedTask->taskFunc(currentTimeBeforeTaskCall);
@@ -282,8 +533,9 @@ void FAST_CODE NOINLINE scheduler(void)
         selectedTask->movingSumExecutionTime += taskExecutionTime - selectedTask->movingSumExecutionTime / TASK_MOVING_SUM_COUNT;
         selectedTask->totalExecutionTime += taskExecutionTime;   // time consumed by scheduler + task
         selectedTask->maxExecutionTime = MAX(selectedTask->maxExecutionTime, taskExecutionTime);
-    } 
-    
+        histogramAdd(histogram->buckets[TASK_HISTOGRAM_EXECUTION_TIME], (timeDelta_t)taskExecutionTime);
+    }
+
     if (!selectedTask || forcedRealTimeTask) {
         // Execute system real-time callbacks and account for them to SYSTEM account
         const timeUs_t currentTimeBeforeTaskCall = micros();
@@ -46,6 +46,21 @@ typedef struct {
     timeDelta_t     latestDeltaTime;
 } cfTaskInfo_t;
 
+// Log2 bucketed histograms, bucket n > 0 counts values in [2^(n-1), 2^n) us,
+// bucket 0 counts zeroes and the last bucket everything above
+#define TASK_HISTOGRAM_BUCKETS  16
+
+typedef enum {
+    TASK_HISTOGRAM_EXECUTION_TIME = 0,  // time spent in taskFunc
+    TASK_HISTOGRAM_LATENESS,            // start time past due time (or past signal time for event driven tasks)
+    TASK_HISTOGRAM_PERIOD,              // time between consecutive invocations
+    TASK_HISTOGRAM_COUNT
+} taskHistogramType_e;
+
+typedef struct {
+    uint16_t buckets[TASK_HISTOGRAM_COUNT][TASK_HISTOGRAM_BUCKETS];
+} taskHistogram_t;
+
 typedef enum {
     /* Actual tasks */
     TASK_SYSTEM = 0,
@@ -141,6 +156,9 @@ typedef struct {
     timeUs_t lastExecutedAt;        // last time of invocation
     timeUs_t lastSignaledAt;        // time of invocation event for event-driven tasks
     timeDelta_t taskLatestDeltaTime;
+    uint8_t queueState;             // scheduler structure currently holding the task
+    uint8_t queueRank;              // position in priority ordered queue, used to break priority ties
+    uint8_t heapIndex;              // position in due time heap while waiting
 
     /* Statistics */
     timeUs_t movingSumExecutionTime;  // moving sum over 32 samples
@@ -153,6 +171,7 @@ extern uint16_t averageSystemLoadPercent;
 
 void getCheckFuncInfo(cfCheckFuncInfo_t *checkFuncInfo);
 void getTaskInfo(cfTaskId_e taskId, cfTaskInfo_t *taskInfo);
+void getTaskHistogram(cfTaskId_e taskId, taskHistogram_t *taskHistogram);
 void rescheduleTask(cfTaskId_e taskId, timeDelta_t newPeriodUs);
 void setTaskEnabled(cfTaskId_e taskId, bool newEnabledState);
 timeDelta_t getTaskDeltaTime(cfTaskId_e taskId);
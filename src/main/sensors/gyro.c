@@ -81,11 +81,14 @@ STATIC_UNIT_TESTED gyroDev_t gyroDev[MAX_GYRO_COUNT];  // Not in FASTRAM since i
 STATIC_FASTRAM int16_t gyroTemperature[MAX_GYRO_COUNT];
 STATIC_FASTRAM_UNIT_TESTED zeroCalibrationVector_t gyroCalibration[MAX_GYRO_COUNT];
 
-STATIC_FASTRAM filterApplyFnPtr gyroLpfApplyFn;
-STATIC_FASTRAM filter_t gyroLpfState[XYZ_AXIS_COUNT];
+STATIC_FASTRAM filterBank_t gyroLpfBank;
 
-STATIC_FASTRAM filterApplyFnPtr gyroLpf2ApplyFn;
-STATIC_FASTRAM filter_t gyroLpf2State[XYZ_AXIS_COUNT];
+// Older samples of the last FIFO batch, the newest one is in gyro.gyroADCf
+STATIC_FASTRAM float gyroFifoADCf[GYRO_FIFO_MAX_SAMPLES - 1][XYZ_AXIS_COUNT];
+STATIC_FASTRAM uint8_t gyroFifoCount;
+
+STATIC_FASTRAM filterBank_t gyroLpf2Bank;
+STATIC_FASTRAM int8_t gyroLpf2Stage;
 
 #ifdef USE_DYNAMIC_FILTERS
 
@@ -95,10 +98,11 @@ EXTENDED_FASTRAM secondaryDynamicGyroNotchState_t secondaryDynamicGyroNotchState
 
 #endif
 
-PG_REGISTER_WITH_RESET_TEMPLATE(gyroConfig_t, gyroConfig, PG_GYRO_CONFIG, 5);
+PG_REGISTER_WITH_RESET_TEMPLATE(gyroConfig_t, gyroConfig, PG_GYRO_CONFIG, 7);
 
 PG_RESET_TEMPLATE(gyroConfig_t, gyroConfig,
     .gyro_lpf = SETTING_GYRO_HARDWARE_LPF_DEFAULT,
+    .useFifo = SETTING_GYRO_USE_FIFO_DEFAULT,
     .gyro_anti_aliasing_lpf_hz = SETTING_GYRO_ANTI_ALIASING_LPF_HZ_DEFAULT,
     .gyro_anti_aliasing_lpf_type = SETTING_GYRO_ANTI_ALIASING_LPF_TYPE_DEFAULT,
     .gyroMovementCalibrationThreshold = SETTING_MORON_THRESHOLD_DEFAULT,
@@ -118,6 +122,14 @@ PG_RESET_TEMPLATE(gyroConfig_t, gyroConfig,
     .dynamicGyroNotchEnabled = SETTING_DYNAMIC_GYRO_NOTCH_ENABLED_DEFAULT,
     .dynamicGyroNotchMode = SETTING_DYNAMIC_GYRO_NOTCH_MODE_DEFAULT,
     .dynamicGyroNotch3dQ = SETTING_DYNAMIC_GYRO_NOTCH_3D_Q_DEFAULT,
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+    .dynamicGyroNotchFftSize = SETTING_DYNAMIC_GYRO_NOTCH_FFT_SIZE_DEFAULT,
+#endif
+    .dynamicGyroNotchZeroPadding = SETTING_DYNAMIC_GYRO_NOTCH_ZERO_PADDING_DEFAULT,
+    .dynamicGyroNotchOverlap = SETTING_DYNAMIC_GYRO_NOTCH_OVERLAP_DEFAULT,
+#ifdef USE_DYNAMIC_NOTCH_EXTENDED
+    .dynamicGyroNotchEngine = SETTING_DYNAMIC_GYRO_NOTCH_ENGINE_DEFAULT,
+#endif
 #endif
 #ifdef USE_GYRO_KALMAN
     .kalman_q = SETTING_SETPOINT_KALMAN_Q_DEFAULT,
@@ -234,35 +246,16 @@ STATIC_UNIT_TESTED gyroSensor_e gyroDetect(gyroDev_t *dev, gyroSensor_e gyroHard
     return gyroHardware;
 }
 
-static void initGyroFilter(filterApplyFnPtr *applyFn, filter_t state[], uint8_t type, uint16_t cutoff, uint32_t looptime)
-{
-    *applyFn = nullFilterApply;
-    if (cutoff > 0) {
-        switch (type)
-        {
-            case FILTER_PT1:
-                *applyFn = (filterApplyFnPtr)pt1FilterApply;
-                for (int axis = 0; axis < 3; axis++) {
-                    pt1FilterInit(&state[axis].pt1, cutoff, US2S(looptime));
-                }
-                break;
-            case FILTER_BIQUAD:
-                *applyFn = (filterApplyFnPtr)biquadFilterApply;
-                for (int axis = 0; axis < 3; axis++) {
-                    biquadFilterInitLPF(&state[axis].biquad, cutoff, looptime);
-                }
-                break;
-        }
-    }
-}
-
 static void gyroInitFilters(void)
 {
-    //First gyro LPF running at full gyro frequency 8kHz
-    initGyroFilter(&gyroLpfApplyFn, gyroLpfState, gyroConfig()->gyro_anti_aliasing_lpf_type, gyroConfig()->gyro_anti_aliasing_lpf_hz, getGyroLooptime());
+    //First gyro LPF running at full gyro frequency 8kHz, with FIFO batching that is the sensor sampling rate
+    const uint32_t gyroSampleLooptime = gyroDev[0].readFifoFn ? gyroDev[0].fifoSampleIntervalUs : getGyroLooptime();
+    filterBankInit(&gyroLpfBank);
+    filterBankAddLowpass(&gyroLpfBank, gyroConfig()->gyro_anti_aliasing_lpf_type, gyroConfig()->gyro_anti_aliasing_lpf_hz, gyroSampleLooptime);
 
     //Second gyro LPF runnig and PID frequency - this filter is dynamic when gyro_use_dyn_lpf = ON
-    initGyroFilter(&gyroLpf2ApplyFn, gyroLpf2State, gyroConfig()->gyro_main_lpf_type, gyroConfig()->gyro_main_lpf_hz, getLooptime());
+    filterBankInit(&gyroLpf2Bank);
+    gyroLpf2Stage = filterBankAddLowpass(&gyroLpf2Bank, gyroConfig()->gyro_main_lpf_type, gyroConfig()->gyro_main_lpf_hz, getLooptime());
 
 #ifdef USE_GYRO_KALMAN
     if (gyroConfig()->kalmanEnabled) {
@@ -297,6 +290,7 @@ bool gyroInit(void)
 
     // Driver initialisation
     gyroDev[0].lpf = gyroConfig()->gyro_lpf;
+    gyroDev[0].useFifo = gyroConfig()->useFifo;
     gyroDev[0].requestedSampleIntervalUs = TASK_GYRO_LOOPTIME;
     gyroDev[0].sampleRateIntervalUs = TASK_GYRO_LOOPTIME;
     gyroDev[0].initFn(&gyroDev[0]);
@@ -315,6 +309,10 @@ bool gyroInit(void)
     gyroDataAnalyseStateInit(
         &gyroAnalyseState,
         gyroConfig()->dynamicGyroNotchMinHz,
+        gyroConfig()->dynamicGyroNotchFftSize,
+        gyroConfig()->dynamicGyroNotchZeroPadding,
+        gyroConfig()->dynamicGyroNotchOverlap,
+        gyroConfig()->dynamicGyroNotchEngine,
         getLooptime()
     );
 #endif
@@ -392,11 +390,33 @@ void gyroGetMeasuredRotationRate(fpVector3_t *measuredRotationRate)
     }
 }
 
+static void gyroConvertSample(const gyroDev_t * gyroDev, const int16_t * raw, float * gyroADCf)
+{
+    int32_t gyroADCtmp[XYZ_AXIS_COUNT];
+
+    // Copy gyro value into int32_t (to prevent overflow) and then apply calibration and alignment
+    gyroADCtmp[X] = (int32_t)raw[X] - (int32_t)gyroDev->gyroZero[X];
+    gyroADCtmp[Y] = (int32_t)raw[Y] - (int32_t)gyroDev->gyroZero[Y];
+    gyroADCtmp[Z] = (int32_t)raw[Z] - (int32_t)gyroDev->gyroZero[Z];
+
+    // Apply sensor alignment
+    applySensorAlignment(gyroADCtmp, gyroADCtmp, gyroDev->gyroAlign);
+    applyBoardAlignment(gyroADCtmp);
+
+    // Convert to deg/s and store in unified data
+    gyroADCf[X] = (float)gyroADCtmp[X] * gyroDev->scale;
+    gyroADCf[Y] = (float)gyroADCtmp[Y] * gyroDev->scale;
+    gyroADCf[Z] = (float)gyroADCtmp[Z] * gyroDev->scale;
+}
+
 static bool FAST_CODE NOINLINE gyroUpdateAndCalibrate(gyroDev_t * gyroDev, zeroCalibrationVector_t * gyroCal, float * gyroADCf)
 {
+    gyroFifoCount = 0;
 
     // range: +/- 8192; +/- 2000 deg/sec
-    if (gyroDev->readFn(gyroDev)) {
+    // FIFO read leaves the newest sample in gyroADCRaw as well
+    const bool gyroReadOk = gyroDev->readFifoFn ? gyroDev->readFifoFn(gyroDev) : gyroDev->readFn(gyroDev);
+    if (gyroReadOk) {
 
 #ifndef USE_IMU_FAKE // fixes Test Unit compilation error
     if (!gyroConfig()->init_gyro_cal_enabled) {
@@ -410,21 +430,14 @@ static bool FAST_CODE NOINLINE gyroUpdateAndCalibrate(gyroDev_t * gyroDev, zeroC
 #endif
 
         if (zeroCalibrationIsCompleteV(gyroCal)) {
-            int32_t gyroADCtmp[XYZ_AXIS_COUNT];
-
-            // Copy gyro value into int32_t (to prevent overflow) and then apply calibration and alignment
-            gyroADCtmp[X] = (int32_t)gyroDev->gyroADCRaw[X] - (int32_t)gyroDev->gyroZero[X];
-            gyroADCtmp[Y] = (int32_t)gyroDev->gyroADCRaw[Y] - (int32_t)gyroDev->gyroZero[Y];
-            gyroADCtmp[Z] = (int32_t)gyroDev->gyroADCRaw[Z] - (int32_t)gyroDev->gyroZero[Z];
-
-            // Apply sensor alignment
-            applySensorAlignment(gyroADCtmp, gyroADCtmp, gyroDev->gyroAlign);
-            applyBoardAlignment(gyroADCtmp);
+            if (gyroDev->readFifoFn) {
+                // Older samples of the batch, they only pass the anti-aliasing LPF
+                for (int i = 0; i < gyroDev->fifoCount - 1; i++) {
+                    gyroConvertSample(gyroDev, gyroDev->fifoRaw[i], gyroFifoADCf[gyroFifoCount++]);
+                }
+            }
 
-            // Convert to deg/s and store in unified data
-            gyroADCf[X] = (float)gyroADCtmp[X] * gyroDev->scale;
-            gyroADCf[Y] = (float)gyroADCtmp[Y] * gyroDev->scale;
-            gyroADCf[Z] = (float)gyroADCtmp[Z] * gyroDev->scale;
+            gyroConvertSample(gyroDev, gyroDev->gyroADCRaw, gyroADCf);
 
             return true;
         } else {
@@ -449,14 +462,16 @@ void FAST_CODE NOINLINE gyroFilter()
         return;
     }
 
-    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-        float gyroADCf = gyro.gyroADCf[axis];
-
 #ifdef USE_RPM_FILTER
-        gyroADCf = rpmFilterGyroApply(axis, gyroADCf);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        gyro.gyroADCf[axis] = rpmFilterGyroApply(axis, gyro.gyroADCf[axis]);
+    }
 #endif
 
-        gyroADCf = gyroLpf2ApplyFn((filter_t *) &gyroLpf2State[axis], gyroADCf);
+    filterBankApply(&gyroLpf2Bank, gyro.gyroADCf);
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        float gyroADCf = gyro.gyroADCf[axis];
 
 #ifdef USE_DYNAMIC_FILTERS
         if (dynamicGyroNotchState.enabled) {
@@ -522,20 +537,20 @@ void FAST_CODE NOINLINE gyroUpdate()
         return;
     }
 
+    // At this point gyro.gyroADCf contains unfiltered gyro value [deg/s]
+    // Set raw gyro for blackbox purposes
     for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-        // At this point gyro.gyroADCf contains unfiltered gyro value [deg/s]
-        float gyroADCf = gyro.gyroADCf[axis];
-
-        // Set raw gyro for blackbox purposes
-        gyro.gyroRaw[axis] = gyroADCf;
-
-        /*
-         * First gyro LPF is the only filter applied with the full gyro sampling speed
-         */
-        gyroADCf = gyroLpfApplyFn((filter_t *) &gyroLpfState[axis], gyroADCf);
+        gyro.gyroRaw[axis] = gyro.gyroADCf[axis];
+    }
 
-        gyro.gyroADCf[axis] = gyroADCf;
+    /*
+     * First gyro LPF is the only filter applied with the full gyro sampling speed.
+     * Samples batched in the sensor FIFO pass it oldest first.
+     */
+    for (int i = 0; i < gyroFifoCount; i++) {
+        filterBankApply(&gyroLpfBank, gyroFifoADCf[i]);
     }
+    filterBankApply(&gyroLpfBank, gyro.gyroADCf);
 }
 
 bool gyroReadTemperature(void)
@@ -571,15 +586,7 @@ int16_t gyroRateDps(int axis)
 }
 
 void gyroUpdateDynamicLpf(float cutoffFreq) {
-    if (gyroConfig()->gyro_main_lpf_type == FILTER_PT1) {
-        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-            pt1FilterUpdateCutoff(&gyroLpf2State[axis].pt1, cutoffFreq);
-        }
-    } else if (gyroConfig()->gyro_main_lpf_type == FILTER_BIQUAD) {
-        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-            biquadFilterUpdate(&gyroLpf2State[axis].biquad, cutoffFreq, getLooptime(), BIQUAD_Q, FILTER_LPF);
-        }
-    }
+    filterBankUpdateLowpass(&gyroLpf2Bank, gyroLpf2Stage, gyroConfig()->gyro_main_lpf_type, cutoffFreq, getLooptime());
 }
 
 float averageAbsGyroRates(void)
@@ -53,6 +53,16 @@ typedef enum {
     DYNAMIC_NOTCH_MODE_3D
 } dynamicGyroNotchMode_e;
 
+typedef enum {
+    DYNAMIC_NOTCH_FFT_SIZE_64 = 0,
+    DYNAMIC_NOTCH_FFT_SIZE_128,
+} dynamicGyroNotchFftSize_e;
+
+typedef enum {
+    DYNAMIC_NOTCH_ENGINE_FFT = 0,   // windowed FFT computed over a few PID loops
+    DYNAMIC_NOTCH_ENGINE_SDFT,      // sliding DFT updated with every downsampled gyro sample
+} dynamicGyroNotchEngine_e;
+
 typedef struct gyro_s {
     bool initialized;
     uint32_t targetLooptime;
@@ -67,6 +77,7 @@ typedef struct gyroConfig_s {
     uint8_t  gyroMovementCalibrationThreshold; // people keep forgetting that moving model while init results in wrong gyro offsets. and then they never reset gyro. so this is now on by default.
     uint16_t looptime;                      // imu loop time in us
     uint8_t  gyro_lpf;                      // gyro LPF setting - values are driver specific, in case of invalid number, a reasonable default ~30-40HZ is chosen.
+    bool     useFifo;                       // batch gyro samples in sensor FIFO when supported by the driver
     uint16_t  gyro_anti_aliasing_lpf_hz;
     uint8_t  gyro_anti_aliasing_lpf_type;
 #ifdef USE_DUAL_GYRO
@@ -84,6 +95,10 @@ typedef struct gyroConfig_s {
     uint8_t dynamicGyroNotchEnabled;
     uint8_t dynamicGyroNotchMode;
     uint16_t dynamicGyroNotch3dQ;
+    uint8_t dynamicGyroNotchFftSize;
+    uint8_t dynamicGyroNotchZeroPadding;
+    uint8_t dynamicGyroNotchOverlap;
+    uint8_t dynamicGyroNotchEngine;
 #endif
 #ifdef USE_GYRO_KALMAN
     uint16_t kalman_q;
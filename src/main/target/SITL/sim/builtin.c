@@ -0,0 +1,539 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Alternatively, the contents of this file may be used under the terms
+ * of the GNU General Public License Version 3, as described below:
+ *
+ * This file is free software: you may copy, redistribute and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/*
+ * Built-in rigid body model, a headless stand-in for an external simulator.
+ *
+ * The model is driven by the motor and servo outputs of the mixers and runs in the
+ * main loop, one step every BUILTIN_STEP_US. Physics are calculated in the
+ * aerospace convention (body FRD, earth NED) and converted to the INAV sensor
+ * frame when the fake sensors are fed.
+ *
+ * Control effectiveness is derived from the mixer configuration: a positive
+ * stabilised roll/pitch/yaw input is assumed to rotate the aircraft in the positive
+ * direction of the corresponding gyro axis. So any correctly configured motor mixer
+ * or servo mixer (elevons, V-tail, ...) flies without further setup.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "platform.h"
+
+#include "target.h"
+#include "target/SITL/sim/builtin.h"
+#include "target/SITL/sim/simHelper.h"
+#include "fc/runtime_config.h"
+#include "drivers/time.h"
+#include "drivers/accgyro/accgyro_fake.h"
+#include "drivers/barometer/barometer_fake.h"
+#include "drivers/pitotmeter/pitotmeter_fake.h"
+#include "drivers/compass/compass_fake.h"
+#include "drivers/rangefinder/rangefinder_virtual.h"
+#include "sensors/battery_sensor_fake.h"
+#include "sensors/barometer.h"
+#include "sensors/acceleration.h"
+#include "io/rangefinder.h"
+#include "io/gps.h"
+#include "common/utils.h"
+#include "common/maths.h"
+#include "common/quaternion.h"
+#include "flight/mixer.h"
+#include "flight/servos.h"
+#include "flight/imu.h"
+
+// Somewhere on a flat field
+#define BUILTIN_HOME_LAT 472580000  // deg * 1e7
+#define BUILTIN_HOME_LON 113300000
+#define BUILTIN_HOME_ALT_M 600.0f
+
+#define BUILTIN_MAX_CATCHUP_STEPS 10
+#define BUILTIN_GPS_DIVIDER 100     // 10 Hz GPS
+#define BUILTIN_BATTERY_VOLTAGE 1680
+
+#define AIR_DENSITY 1.225f
+
+// Multirotor, roughly a 7" quad with 4:1 thrust to weight
+#define MR_MASS_KG 1.0f
+#define MR_INERTIA_XX 0.008f
+#define MR_INERTIA_YY 0.008f
+#define MR_INERTIA_ZZ 0.015f
+#define MR_HOVER_THROTTLE 0.5f      // Matches the default nav_mc_hover_thr
+#define MR_ARM_LENGTH_M 0.12f
+#define MR_YAW_TORQUE_M 0.015f      // Reaction torque per Newton of thrust
+#define MR_MOTOR_TAU_S 0.03f
+#define MR_LINEAR_DRAG 0.25f        // N per m/s
+#define MR_ROTATIONAL_DRAG 0.002f   // Nm per rad/s
+
+// Airplane, roughly a 1.2m flying wing or trainer
+#define FW_MASS_KG 1.2f
+#define FW_INERTIA_XX 0.03f
+#define FW_INERTIA_YY 0.04f
+#define FW_INERTIA_ZZ 0.06f
+#define FW_WING_AREA_M2 0.30f
+#define FW_SPAN_M 1.2f
+#define FW_CHORD_M 0.25f
+#define FW_MAX_THRUST_N 14.0f
+#define FW_MAX_SPEED_MPS 40.0f
+#define FW_CL0 0.25f
+#define FW_CL_ALPHA 4.5f
+#define FW_CL_MAX 1.1f
+#define FW_CD0 0.04f
+#define FW_CD_K 0.06f
+#define FW_CY_BETA -0.6f
+#define FW_CL_AILERON 0.20f
+#define FW_CL_P -0.45f
+#define FW_CM0 0.02f
+#define FW_CM_ALPHA -0.6f
+#define FW_CM_ELEVATOR 0.45f
+#define FW_CM_Q -8.0f
+#define FW_CN_BETA 0.08f
+#define FW_CN_RUDDER 0.05f
+#define FW_CN_R -0.15f
+#define FW_MIN_AERO_SPEED_MPS 0.5f
+#define FW_GROUND_FRICTION 0.05f
+
+typedef struct {
+    fpVector3_t pos;        // earth NED, m, relative to home
+    fpVector3_t vel;        // earth NED, m/s
+    fpQuaternion_t att;     // body FRD to earth NED
+    fpVector3_t rate;       // body FRD, rad/s
+    fpVector3_t accel;      // specific force, body FRD, m/s^2
+    float motorThrust[MAX_SUPPORTED_MOTORS];
+    bool onGround;
+} builtinState_t;
+
+static builtinState_t state;
+static bool useImu = false;
+static bool initalized = false;
+static timeUs_t nextStepAt = 0;
+static uint32_t stepCount = 0;
+
+static fpVector3_t vecCross(const fpVector3_t *a, const fpVector3_t *b)
+{
+    fpVector3_t r = { .v = {
+        a->y * b->z - a->z * b->y,
+        a->z * b->x - a->x * b->z,
+        a->x * b->y - a->y * b->x
+    }};
+    return r;
+}
+
+// Rotate a vector with the attitude quaternion, body to earth if inverse is false
+static fpVector3_t rotate(const fpQuaternion_t *q, const fpVector3_t *v, bool inverse)
+{
+    const fpVector3_t u = { .v = { inverse ? -q->q1 : q->q1, inverse ? -q->q2 : q->q2, inverse ? -q->q3 : q->q3 } };
+    fpVector3_t t = vecCross(&u, v);
+    t.x *= 2.0f; t.y *= 2.0f; t.z *= 2.0f;
+    const fpVector3_t ut = vecCross(&u, &t);
+    fpVector3_t r = { .v = {
+        v->x + q->q0 * t.x + ut.x,
+        v->y + q->q0 * t.y + ut.y,
+        v->z + q->q0 * t.z + ut.z
+    }};
+    return r;
+}
+
+static void integrateAttitude(fpQuaternion_t *q, const fpVector3_t *w, float dt)
+{
+    const float hdt = 0.5f * dt;
+    const fpQuaternion_t dq = {
+        .q0 = -q->q1 * w->x - q->q2 * w->y - q->q3 * w->z,
+        .q1 =  q->q0 * w->x + q->q2 * w->z - q->q3 * w->y,
+        .q2 =  q->q0 * w->y - q->q1 * w->z + q->q3 * w->x,
+        .q3 =  q->q0 * w->z + q->q1 * w->y - q->q2 * w->x
+    };
+    q->q0 += dq.q0 * hdt;
+    q->q1 += dq.q1 * hdt;
+    q->q2 += dq.q2 * hdt;
+    q->q3 += dq.q3 * hdt;
+
+    const float norm = sqrtf(q->q0 * q->q0 + q->q1 * q->q1 + q->q2 * q->q2 + q->q3 * q->q3);
+    q->q0 /= norm;
+    q->q1 /= norm;
+    q->q2 /= norm;
+    q->q3 /= norm;
+}
+
+static void attitudeToEuler(const fpQuaternion_t *q, float *roll, float *pitch, float *yaw)
+{
+    *roll = atan2f(2.0f * (q->q0 * q->q1 + q->q2 * q->q3), 1.0f - 2.0f * (q->q1 * q->q1 + q->q2 * q->q2));
+    *pitch = asinf(constrainf(2.0f * (q->q0 * q->q2 - q->q3 * q->q1), -1.0f, 1.0f));
+    *yaw = atan2f(2.0f * (q->q0 * q->q3 + q->q1 * q->q2), 1.0f - 2.0f * (q->q2 * q->q2 + q->q3 * q->q3));
+}
+
+static void levelAttitude(fpQuaternion_t *q)
+{
+    float roll, pitch, yaw;
+    attitudeToEuler(q, &roll, &pitch, &yaw);
+    q->q0 = cosf(yaw * 0.5f);
+    q->q1 = 0;
+    q->q2 = 0;
+    q->q3 = sinf(yaw * 0.5f);
+}
+
+static float motorThrottle(int index)
+{
+    return constrainf(PWM_TO_FLOAT_0_1(motor[index]), 0.0f, 1.0f);
+}
+
+// Torque in the INAV gyro frame (FLU) to aerospace body frame (FRD)
+static fpVector3_t gyroFrameToBody(float roll, float pitch, float yaw)
+{
+    fpVector3_t r = { .v = { roll, -pitch, -yaw } };
+    return r;
+}
+
+// Effective, normalised [-1:1] control surface deflection per stabilised axis, reconstructed from the servo outputs
+static void servoDeflections(float deflection[3])
+{
+    int ruleCount[3] = { 0 };
+
+    for (int axis = 0; axis < 3; axis++) {
+        deflection[axis] = 0;
+    }
+
+    for (int i = 0; i < MAX_SERVO_RULES; i++) {
+        const servoMixer_t *rule = customServoMixers(i);
+        if (rule->rate == 0) {
+            break;
+        }
+
+        int axis;
+        switch (rule->inputSource) {
+            case INPUT_STABILIZED_ROLL:
+                axis = FD_ROLL;
+                break;
+            case INPUT_STABILIZED_PITCH:
+                axis = FD_PITCH;
+                break;
+            case INPUT_STABILIZED_YAW:
+                axis = FD_YAW;
+                break;
+            default:
+                continue;
+        }
+
+        const servoParam_t *param = servoParams(rule->targetChannel);
+        const float throw = (servo[rule->targetChannel] - param->middle) / 500.0f;
+        const bool reversed = (rule->rate < 0) != (param->rate < 0);
+        deflection[axis] += reversed ? -throw : throw;
+        ruleCount[axis]++;
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (ruleCount[axis]) {
+            deflection[axis] = constrainf(deflection[axis] / ruleCount[axis], -1.0f, 1.0f);
+        }
+    }
+}
+
+static void multirotorForces(float dt, fpVector3_t *force, fpVector3_t *torque)
+{
+    const int motorCount = getMotorCount();
+    const float yawDirection = mixerConfig()->motorDirectionInverted ? -1.0f : 1.0f;
+
+    float throttleWeight = 0;
+    for (int i = 0; i < motorCount; i++) {
+        throttleWeight += primaryMotorMixer(i)->throttle;
+    }
+    if (throttleWeight <= 0) {
+        return;
+    }
+
+    // Thrust is quadratic with throttle, hover at MR_HOVER_THROTTLE
+    const float maxThrust = MR_MASS_KG * GRAVITY_MSS / (throttleWeight * sq(MR_HOVER_THROTTLE));
+    const float lag = constrainf(dt / MR_MOTOR_TAU_S, 0.0f, 1.0f);
+    float roll = 0, pitch = 0, yaw = 0, thrust = 0;
+
+    for (int i = 0; i < motorCount; i++) {
+        const motorMixer_t *mix = primaryMotorMixer(i);
+        const float target = maxThrust * mix->throttle * sq(motorThrottle(i));
+        state.motorThrust[i] += (target - state.motorThrust[i]) * lag;
+
+        thrust += state.motorThrust[i];
+        roll += mix->roll * state.motorThrust[i];
+        pitch += mix->pitch * state.motorThrust[i];
+        yaw += -yawDirection * mix->yaw * state.motorThrust[i];
+    }
+
+    force->z -= thrust;
+    const fpVector3_t mixTorque = gyroFrameToBody(roll * MR_ARM_LENGTH_M, pitch * MR_ARM_LENGTH_M, yaw * MR_YAW_TORQUE_M);
+    for (int axis = 0; axis < 3; axis++) {
+        torque->v[axis] += mixTorque.v[axis] - state.rate.v[axis] * MR_ROTATIONAL_DRAG;
+    }
+
+    const fpVector3_t airspeed = rotate(&state.att, &state.vel, true);
+    for (int axis = 0; axis < 3; axis++) {
+        force->v[axis] -= airspeed.v[axis] * MR_LINEAR_DRAG;
+    }
+}
+
+static void airplaneForces(fpVector3_t *force, fpVector3_t *torque)
+{
+    float throttle = 0;
+    for (int i = 0; i < getMotorCount(); i++) {
+        throttle = MAX(throttle, motorThrottle(i));
+    }
+
+    const fpVector3_t air = rotate(&state.att, &state.vel, true);
+    const float speed = sqrtf(sq(air.x) + sq(air.y) + sq(air.z));
+
+    force->x += FW_MAX_THRUST_N * throttle * constrainf(1.0f - air.x / FW_MAX_SPEED_MPS, 0.0f, 1.0f);
+
+    if (speed < FW_MIN_AERO_SPEED_MPS) {
+        return;
+    }
+
+    const float alpha = atan2f(air.z, air.x);
+    const float beta = asinf(constrainf(air.y / speed, -1.0f, 1.0f));
+    const float qbarS = 0.5f * AIR_DENSITY * sq(speed) * FW_WING_AREA_M2;
+
+    float cl = FW_CL0 + FW_CL_ALPHA * alpha;
+    if (fabsf(alpha) > DEGREES_TO_RADIANS(15)) {
+        // Stalled, lift collapses
+        cl *= 0.5f;
+    }
+    cl = constrainf(cl, -FW_CL_MAX, FW_CL_MAX);
+    const float cd = FW_CD0 + FW_CD_K * sq(cl);
+
+    // Lift is perpendicular to the airflow in the symmetry plane, drag opposes it
+    force->x += qbarS * (cl * sinf(alpha) - cd * air.x / speed);
+    force->y += qbarS * (FW_CY_BETA * beta - cd * air.y / speed);
+    force->z += qbarS * (-cl * cosf(alpha) - cd * air.z / speed);
+
+    float deflection[3];
+    servoDeflections(deflection);
+
+    const fpVector3_t control = gyroFrameToBody(
+        FW_CL_AILERON * FW_SPAN_M * deflection[FD_ROLL],
+        FW_CM_ELEVATOR * FW_CHORD_M * deflection[FD_PITCH],
+        FW_CN_RUDDER * FW_SPAN_M * deflection[FD_YAW]
+    );
+
+    torque->x += qbarS * (control.x + FW_SPAN_M * FW_CL_P * state.rate.x * FW_SPAN_M / (2.0f * speed));
+    torque->y += qbarS * (control.y + FW_CHORD_M * (FW_CM0 + FW_CM_ALPHA * alpha + FW_CM_Q * state.rate.y * FW_CHORD_M / (2.0f * speed)));
+    torque->z += qbarS * (control.z + FW_SPAN_M * (FW_CN_BETA * beta + FW_CN_R * state.rate.z * FW_SPAN_M / (2.0f * speed)));
+}
+
+static void physicsStep(float dt)
+{
+    const bool isAirplane = STATE(AIRPLANE);
+    const float mass = isAirplane ? FW_MASS_KG : MR_MASS_KG;
+    const fpVector3_t inertia = isAirplane ?
+        (fpVector3_t){ .v = { FW_INERTIA_XX, FW_INERTIA_YY, FW_INERTIA_ZZ } } :
+        (fpVector3_t){ .v = { MR_INERTIA_XX, MR_INERTIA_YY, MR_INERTIA_ZZ } };
+
+    fpVector3_t force = { .v = { 0, 0, 0 } };
+    fpVector3_t torque = { .v = { 0, 0, 0 } };
+
+    if (isAirplane) {
+        airplaneForces(&force, &torque);
+    } else {
+        multirotorForces(dt, &force, &torque);
+    }
+
+    // Translation
+    const fpVector3_t forceEarth = rotate(&state.att, &force, false);
+    const fpVector3_t lastVel = state.vel;
+    state.vel.x += forceEarth.x / mass * dt;
+    state.vel.y += forceEarth.y / mass * dt;
+    state.vel.z += (forceEarth.z / mass + GRAVITY_MSS) * dt;
+
+    // Rotation, Euler's equations
+    const fpVector3_t momentum = { .v = { inertia.x * state.rate.x, inertia.y * state.rate.y, inertia.z * state.rate.z } };
+    const fpVector3_t gyroscopic = vecCross(&state.rate, &momentum);
+    for (int axis = 0; axis < 3; axis++) {
+        state.rate.v[axis] += (torque.v[axis] - gyroscopic.v[axis]) / inertia.v[axis] * dt;
+    }
+
+    // Ground contact, NED z is positive down
+    state.onGround = state.pos.z + state.vel.z * dt >= 0 && state.vel.z >= 0;
+    if (state.onGround) {
+        state.vel.z = 0;
+        if (isAirplane) {
+            const float friction = constrainf(1.0f - FW_GROUND_FRICTION * dt, 0.0f, 1.0f);
+            state.vel.x *= friction;
+            state.vel.y *= friction;
+        } else {
+            state.vel.x = 0;
+            state.vel.y = 0;
+        }
+        state.rate.x = 0;
+        state.rate.y = 0;
+        state.rate.z *= 0.9f;
+        levelAttitude(&state.att);
+    }
+
+    state.pos.x += state.vel.x * dt;
+    state.pos.y += state.vel.y * dt;
+    state.pos.z = MIN(state.pos.z + state.vel.z * dt, 0.0f);
+    integrateAttitude(&state.att, &state.rate, dt);
+
+    // Accelerometers measure the specific force, kinematic acceleration minus gravity
+    const fpVector3_t specificForce = { .v = {
+        (state.vel.x - lastVel.x) / dt,
+        (state.vel.y - lastVel.y) / dt,
+        (state.vel.z - lastVel.z) / dt - GRAVITY_MSS
+    }};
+    state.accel = rotate(&state.att, &specificForce, true);
+}
+
+static void updateSensors(void)
+{
+    float roll, pitch, yaw;
+    attitudeToEuler(&state.att, &roll, &pitch, &yaw);
+
+    const int16_t roll_inav = lrintf(RADIANS_TO_DECIDEGREES(roll));
+    const int16_t pitch_inav = lrintf(-RADIANS_TO_DECIDEGREES(pitch));
+    int16_t yaw_inav = lrintf(RADIANS_TO_DECIDEGREES(yaw));
+    if (yaw_inav < 0) {
+        yaw_inav += 3600;
+    }
+
+    if (!useImu) {
+        imuSetAttitudeRPY(roll_inav, pitch_inav, yaw_inav);
+        imuUpdateAttitude(micros());
+    }
+
+    fakeGyroSet(
+        constrainToInt16(RADIANS_TO_DEGREES(state.rate.x) * 16.0f),
+        constrainToInt16(-RADIANS_TO_DEGREES(state.rate.y) * 16.0f),
+        constrainToInt16(-RADIANS_TO_DEGREES(state.rate.z) * 16.0f)
+    );
+
+    fakeAccSet(
+        constrainToInt16(state.accel.x * 1000),
+        constrainToInt16(-state.accel.y * 1000),
+        constrainToInt16(-state.accel.z * 1000)
+    );
+
+    const float altitude = BUILTIN_HOME_ALT_M - state.pos.z;
+    fakeBaroSet(lrintf(altitudeToPressure(altitude * 100)), DEGREES_TO_CENTIDEGREES(21));
+
+    const fpVector3_t air = rotate(&state.att, &state.vel, true);
+    fakePitotSetAirspeed(MAX(air.x, 0.0f) * 100);
+
+    fakeBattSensorSetVbat(BUILTIN_BATTERY_VOLTAGE);
+
+    const int32_t altitudeOverGround = lrintf(-state.pos.z * 100);
+    if (altitudeOverGround > 0 && altitudeOverGround <= RANGEFINDER_VIRTUAL_MAX_RANGE_CM) {
+        fakeRangefindersSetData(altitudeOverGround);
+    } else {
+        fakeRangefindersSetData(-1);
+    }
+
+    fpQuaternion_t quat;
+    fpVector3_t north;
+    north.x = 1.0f;
+    north.y = 0;
+    north.z = 0;
+    computeQuaternionFromRPY(&quat, roll_inav, pitch_inav, yaw_inav);
+    transformVectorEarthToBody(&north, &quat);
+    fakeMagSet(
+        constrainToInt16(north.x * 16000.0f),
+        constrainToInt16(north.y * 16000.0f),
+        constrainToInt16(north.z * 16000.0f)
+    );
+
+    if (stepCount % BUILTIN_GPS_DIVIDER == 0) {
+        // Offsets are small, float is precise enough for them
+        const float earthRadius = EARTH_RADIUS * 1000;
+        const float homeLat = DEGREES_TO_RADIANS(BUILTIN_HOME_LAT / 10000000.0f);
+        const int32_t lat = BUILTIN_HOME_LAT + lrintf(RADIANS_TO_DEGREES(state.pos.x / earthRadius) * 10000000.0f);
+        const int32_t lon = BUILTIN_HOME_LON + lrintf(RADIANS_TO_DEGREES(state.pos.y / (earthRadius * cosf(homeLat))) * 10000000.0f);
+        const float groundSpeed = sqrtf(sq(state.vel.x) + sq(state.vel.y));
+        int16_t course = lrintf(RADIANS_TO_DECIDEGREES(atan2f(state.vel.y, state.vel.x)));
+        if (course < 0) {
+            course += 3600;
+        }
+
+        gpsFakeSet(
+            GPS_FIX_3D,
+            16,
+            lat,
+            lon,
+            lrintf(altitude * 100),
+            lrintf(groundSpeed * 100),
+            course,
+            lrintf(state.vel.x * 100),
+            lrintf(state.vel.y * 100),
+            lrintf(state.vel.z * 100),
+            0
+        );
+    }
+}
+
+void simBuiltinUpdate(timeUs_t currentTimeUs)
+{
+    if (!initalized) {
+        return;
+    }
+
+    int steps = 0;
+    while (cmpTimeUs(currentTimeUs, nextStepAt) >= 0 && steps < BUILTIN_MAX_CATCHUP_STEPS) {
+        physicsStep(BUILTIN_STEP_US * 1e-6f);
+        stepCount++;
+        nextStepAt += BUILTIN_STEP_US;
+        steps++;
+    }
+
+    if (steps == 0) {
+        return;
+    }
+
+    // Host too slow, drop the backlog instead of running behind forever
+    if (cmpTimeUs(currentTimeUs, nextStepAt) >= 0) {
+        nextStepAt = currentTimeUs + BUILTIN_STEP_US;
+    }
+
+    updateSensors();
+    unlockMainPID();
+    // Lockstep: let the clock run until the next step is due
+    sitlClockStep(cmpTimeUs(nextStepAt, currentTimeUs));
+}
+
+bool simBuiltinInit(bool imu)
+{
+    useImu = imu;
+
+    memset(&state, 0, sizeof(state));
+    state.att.q0 = 1.0f;
+    state.onGround = true;
+    stepCount = 0;
+    nextStepAt = micros();
+
+    // Start at rest on the ground
+    state.accel.z = -GRAVITY_MSS;
+    updateSensors();
+
+    ENABLE_ARMING_FLAG(SIMULATOR_MODE_SITL);
+    // Sensors are perfect, there is nothing to calibrate
+    ENABLE_STATE(ACCELEROMETER_CALIBRATED);
+    initalized = true;
+
+    return true;
+}
@@ -274,7 +274,7 @@ static void exchangeData(void)
         0xFFF, servoValues[0], servoValues[1], servoValues[2], servoValues[3], servoValues[4], servoValues[5], servoValues[6], servoValues[7], servoValues[8], servoValues[9], servoValues[10], servoValues[11]);
     char* response = endRequest();
 
-    //rfValues.m_currentPhysicsTime_SEC = getDoubleFromResponse(response, "m-currentPhysicsTime-SEC");
+    rfValues.m_currentPhysicsTime_SEC = getDoubleFromResponse(response, "m-currentPhysicsTime-SEC");
     //rfValues.m_currentPhysicsSpeedMultiplier = getDoubleFromResponse(response, "m-currentPhysicsSpeedMultiplier");
     rfValues.m_airspeed_MPS = getDoubleFromResponse(response, "m-airspeed-MPS");
     rfValues.m_altitudeASL_MTR = getDoubleFromResponse(response, "m-altitudeASL-MTR");
@@ -417,8 +417,15 @@ static void* soapWorker(void* arg)
             isInitalised = true;  
         }
 
+        const double lastPhysicsTime = rfValues.m_currentPhysicsTime_SEC;
         exchangeData();
         unlockMainPID();
+
+        // Step the clock by the simulated time, ignore resets and pauses of the simulation
+        const double physicsStep = rfValues.m_currentPhysicsTime_SEC - lastPhysicsTime;
+        if (physicsStep > 0 && physicsStep < (double)1.0) {
+            sitlClockStep((uint32_t)round(physicsStep * (double)1000000));
+        }
     }
 
     return NULL;
@@ -61,6 +61,8 @@
 
 #define XP_PORT 49000
 #define XPLANE_JOYSTICK_AXIS_COUNT 8
+// All drefs are requested at 100 Hz, in lockstep mode each packet advances the clock by one period
+#define XPLANE_LOCKSTEP_US (1000000 / 100)
 
 
 static uint8_t pwmMapping[XP_MAX_PWM_OUTS];
@@ -434,6 +436,7 @@ static void* listenWorker(void* arg)
         }
 
         unlockMainPID();
+        sitlClockStep(XPLANE_LOCKSTEP_US);
     }
 
     return NULL;
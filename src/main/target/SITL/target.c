@@ -39,16 +39,21 @@
 #include "target.h"
 
 #include "fc/runtime_config.h"
+#include "common/maths.h"
 #include "common/utils.h"
 #include "scheduler/scheduler.h"
 #include "drivers/system.h"
+#include "drivers/time.h"
 #include "drivers/pwm_mapping.h"
 #include "drivers/timer.h"
 #include "drivers/serial.h"
+#include "drivers/flash_file.h"
+#include "drivers/sdcard/sdcard_file.h"
 #include "config/config_streamer.h"
 
 #include "target/SITL/sim/realFlight.h"
 #include "target/SITL/sim/xplane.h"
+#include "target/SITL/sim/builtin.h"
 
 // More dummys
 const int timerHardwareCount = 0;
@@ -66,6 +71,13 @@ static bool useImu = false;
 static char *simIp = NULL;
 static int simPort = 0;
 
+static SitlClock_e sitlClock = SITL_CLOCK_REALTIME;
+static uint32_t clockStepUs = SITL_CLOCK_STEP_US;
+static uint64_t virtualTimeUs = 0;
+static uint64_t lockstepTargetUs = 0;
+static pthread_mutex_t clockLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t clockCond = PTHREAD_COND_INITIALIZER;
+
 static char **c_argv;
 
 void systemInit(void) {
@@ -89,6 +101,17 @@ void systemInit(void) {
         exit(1);
     }
 
+    switch (sitlClock) {
+        case SITL_CLOCK_LOCKSTEP:
+            fprintf(stderr, "[CLOCK] Lockstep, time is advanced by the simulator.\n");
+            break;
+        case SITL_CLOCK_FAST:
+            fprintf(stderr, "[CLOCK] Free running, %u us per scheduler pass.\n", (unsigned)clockStepUs);
+            break;
+        default:
+            break;
+    }
+
     if (sitlSim != SITL_SIM_NONE) {
         fprintf(stderr, "[SIM] Waiting for connection...\n");
     }
@@ -118,6 +141,11 @@ void systemInit(void) {
                 fprintf(stderr, "[SIM] Connection with X-PLane NOT established.\n");
             }
             break;
+        case SITL_SIM_BUILTIN:
+            if (simBuiltinInit(useImu)) {
+                fprintf(stderr, "[SIM] Built-in simulator running.\n");
+            }
+            break;
         default:
           fprintf(stderr, "[SIM] No interface specified. Configurator only.\n");
           break;
@@ -165,10 +193,15 @@ void printCmdLineOptions(void)
 {
     fprintf(stderr, "Avaiable options:\n");
     fprintf(stderr, "--path=[path]                        Path and filename of eeprom.bin. If not specified 'eeprom.bin' in program directory is used.\n");
-    fprintf(stderr, "--sim=[rf|xp]                        Simulator interface: rf = RealFligt, xp = XPlane. Example: --sim=rf\n");
+    fprintf(stderr, "--sim=[rf|xp|builtin]                Simulator interface: rf = RealFligt, xp = XPlane, builtin = built-in physics model, no external simulator. Example: --sim=rf\n");
     fprintf(stderr, "--simip=[ip]                         IP-Address oft the simulator host. If not specified localhost (127.0.0.1) is used.\n");
     fprintf(stderr, "--simport=[port]                     Port oft the simulator host.\n");
+    fprintf(stderr, "--clock=[rt|lockstep|fast]           Time source: rt = wall clock (default), lockstep = time only advances when the simulator steps it,\n");
+    fprintf(stderr, "                                     fast = virtual time, runs as fast as possible. Example: --clock=fast\n");
+    fprintf(stderr, "--clockstep=[us]                     Virtual time in us consumed by each scheduler pass in lockstep and fast mode. Default: %d\n", SITL_CLOCK_STEP_US);
     fprintf(stderr, "--useimu                             Use IMU sensor data from the simulator instead of using attitude data from the simulator directly (experimental, not recommended).\n");
+    fprintf(stderr, "--flash=[path]                       Emulate a 16 MiB dataflash chip for blackbox in this image file, it is created if it doesn't exist.\n");
+    fprintf(stderr, "--sdcard=[path]                      Emulate an SD card for blackbox in this disk image, a 1 GiB FAT32 image is created if it doesn't exist.\n");
     fprintf(stderr, "--chanmap=[mapstring]                Channel mapping. Maps INAVs motor and servo PWM outputs to the virtual receiver output in the simulator.\n");
     fprintf(stderr, "                                     The mapstring has the following format: M(otor)|S(servo)<INAV-OUT>-<RECEIVER-OUT>,... All numbers must have two digits\n");
     fprintf(stderr, "                                     For example: Map motor 1 to virtal receiver output 1, servo 1 to output 2 and servo 2 to output 3:\n");
@@ -192,6 +225,10 @@ void parseArguments(int argc, char *argv[])
             {"simport", required_argument, 0, 'p'},
             {"help", no_argument, 0, 'h'},
             {"path", required_argument, 0, 'e'},
+            {"clock", required_argument, 0, 't'},
+            {"clockstep", required_argument, 0, 'd'},
+            {"flash", required_argument, 0, 'f'},
+            {"sdcard", required_argument, 0, 'r'},
             {NULL, 0, NULL, 0}
         };
 
@@ -205,6 +242,8 @@ void parseArguments(int argc, char *argv[])
                     sitlSim = SITL_SIM_REALFLIGHT;
                 } else if (strcmp(optarg, "xp") == 0){
                     sitlSim = SITL_SIM_XPLANE;
+                } else if (strcmp(optarg, "builtin") == 0){
+                    sitlSim = SITL_SIM_BUILTIN;
                 } else {
                     fprintf(stderr, "[SIM] Unsupported simulator %s.\n", optarg);
                 }
@@ -231,6 +270,34 @@ void parseArguments(int argc, char *argv[])
                     fprintf(stderr, "[EEPROM] Invalid path, using eeprom file in program directory\n.");
                 }
                 break;
+            case 't':
+                if (strcmp(optarg, "rt") == 0) {
+                    sitlClock = SITL_CLOCK_REALTIME;
+                } else if (strcmp(optarg, "lockstep") == 0) {
+                    sitlClock = SITL_CLOCK_LOCKSTEP;
+                } else if (strcmp(optarg, "fast") == 0) {
+                    sitlClock = SITL_CLOCK_FAST;
+                } else {
+                    fprintf(stderr, "[CLOCK] Unsupported clock %s, using wall clock.\n", optarg);
+                }
+                break;
+            case 'd':
+                if (atoi(optarg) > 0) {
+                    clockStepUs = atoi(optarg);
+                } else {
+                    fprintf(stderr, "[CLOCK] Invalid clock step %s.\n", optarg);
+                }
+                break;
+            case 'f':
+                if (!flashFileSetPath(optarg)) {
+                    fprintf(stderr, "[FLASH] Invalid path %s.\n", optarg);
+                }
+                break;
+            case 'r':
+                if (!sdcardFileSetPath(optarg)) {
+                    fprintf(stderr, "[SDCARD] Invalid path %s.\n", optarg);
+                }
+                break;
             case 'h':
                 printCmdLineOptions();
                 exit(0);
@@ -254,8 +321,92 @@ void unlockMainPID(void)
     pthread_mutex_unlock(&mainLoopLock);
 }
 
+// Virtual clock
+//
+// In lockstep and fast mode micros() no longer follows the wall clock. Each pass of the
+// main loop consumes clockStepUs of virtual time (sitlClockUpdate()), delays advance the
+// clock directly. In lockstep mode the clock is additionally held back until the simulator
+// has stepped it (sitlClockStep()), in fast mode it runs as fast as the host allows.
+// Time is deterministic as long as no wall clock driven input (TCP, simulator) is involved.
+
+static uint64_t virtualMicros(void)
+{
+    return __atomic_load_n(&virtualTimeUs, __ATOMIC_ACQUIRE);
+}
+
+static void virtualAdvance(uint64_t us)
+{
+    pthread_mutex_lock(&clockLock);
+    __atomic_store_n(&virtualTimeUs, virtualTimeUs + us, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&clockCond);
+    pthread_mutex_unlock(&clockLock);
+}
+
+bool sitlClockIsRealtime(void)
+{
+    return sitlClock == SITL_CLOCK_REALTIME;
+}
+
+void sitlClockStep(uint32_t stepUs)
+{
+    if (sitlClock != SITL_CLOCK_LOCKSTEP) {
+        return;
+    }
+
+    pthread_mutex_lock(&clockLock);
+    // Don't let the simulator run ahead, wait until the FC has consumed the previous step
+    while (virtualTimeUs < lockstepTargetUs) {
+        pthread_cond_wait(&clockCond, &clockLock);
+    }
+    // Delays may have moved the clock past the last step
+    lockstepTargetUs = virtualTimeUs + stepUs;
+    pthread_cond_broadcast(&clockCond);
+    pthread_mutex_unlock(&clockLock);
+}
+
+void sitlClockUpdate(void)
+{
+    // The built-in simulator runs in the main loop and steps the clock itself
+    if (sitlSim == SITL_SIM_BUILTIN) {
+        simBuiltinUpdate(micros());
+    }
+
+    switch (sitlClock) {
+        case SITL_CLOCK_FAST:
+            virtualAdvance(clockStepUs);
+            break;
+
+        case SITL_CLOCK_LOCKSTEP:
+            pthread_mutex_lock(&clockLock);
+            if (virtualTimeUs < lockstepTargetUs) {
+                __atomic_store_n(&virtualTimeUs, MIN(virtualTimeUs + clockStepUs, lockstepTargetUs), __ATOMIC_RELEASE);
+                pthread_cond_broadcast(&clockCond);
+            } else {
+                // Wait for the next step. Wake up now and then, event driven
+                // tasks (MSP, RX) are still served while the time is frozen.
+                struct timespec timeout;
+                clock_gettime(CLOCK_REALTIME, &timeout);
+                timeout.tv_nsec += 10 * 1000000;
+                if (timeout.tv_nsec >= 1000000000) {
+                    timeout.tv_sec++;
+                    timeout.tv_nsec -= 1000000000;
+                }
+                pthread_cond_timedwait(&clockCond, &clockLock, &timeout);
+            }
+            pthread_mutex_unlock(&clockLock);
+            break;
+
+        default:
+            break;
+    }
+}
+
 // Replacements for system functions
 timeUs_t micros(void) {
+    if (sitlClock != SITL_CLOCK_REALTIME) {
+        return virtualMicros();
+    }
+
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
 
@@ -267,12 +418,28 @@ uint64_t microsISR(void)
     return micros();
 }
 
+// No cycle counter, ticks are wall clock nanoseconds
+uint32_t usTicks = 1000;
+
+uint32_t ticks(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)now.tv_sec * 1000000000U + now.tv_nsec;
+}
+
 uint32_t millis(void) {
     return (uint32_t)(micros() / 1000);
 }
 
 void delayMicroseconds(timeUs_t us)
 {
+    if (sitlClock != SITL_CLOCK_REALTIME) {
+        virtualAdvance(us);
+        return;
+    }
+
     usleep(us);
 }
 
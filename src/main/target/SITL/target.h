@@ -54,6 +54,7 @@
 
 #define SERIAL_PORT_COUNT 8
 #define SITL_SERIAL_TASK_US (500)
+#define SITL_CLOCK_STEP_US (10)
 
 #define DEFAULT_RX_FEATURE      FEATURE_RX_MSP
 #define DEFAULT_FEATURES        (FEATURE_GPS |  FEATURE_OSD | FEATURE_CURRENT_METER | FEATURE_VBAT)
@@ -98,6 +99,14 @@
 #undef USE_I2C
 #undef USE_SPI
 
+#define BLACKBOX_RING_BUFFER_SIZE (256 * 1024)
+
+// Flash chip and SD card emulated with host files, see --flash and --sdcard
+#define USE_FLASHFS
+#define USE_FLASH_FILE
+#define USE_SDCARD
+#define USE_SDCARD_FILE
+
 // Some dummys
 #define TARGET_FLASH_SIZE 2048
 
@@ -184,8 +193,20 @@ typedef enum
     SITL_SIM_NONE,
     SITL_SIM_REALFLIGHT,
     SITL_SIM_XPLANE,
+    SITL_SIM_BUILTIN,
 } SitlSim_e;
 
+typedef enum
+{
+    SITL_CLOCK_REALTIME,
+    SITL_CLOCK_LOCKSTEP,
+    SITL_CLOCK_FAST,
+} SitlClock_e;
+
+bool sitlClockIsRealtime(void);
+void sitlClockStep(uint32_t stepUs);
+void sitlClockUpdate(void);
+
 bool lockMainPID(void);
 void unlockMainPID(void);
 void parseArguments(int argc, char *argv[]);
@@ -50,9 +50,22 @@
 #define USE_SERVO_SBUS
 #endif
 
+#if defined(STM32F7) || defined(STM32H7)
+#define USE_CRC_HW
+#endif
+
+// Slicing-by-4 tables for the CRCs, 3 KiB of flash
+#if (MCU_FLASH_SIZE > 512) || defined(SITL_BUILD)
+#define USE_CRC_SLICING
+#endif
+
 #define USE_ADC_AVERAGING
 #define USE_64BIT_TIME
 #define USE_BLACKBOX
+// Triggered logging keeps a RAM ring of 64kB on H7, F7 targets with RAM to spare can add it for 16kB in target.h
+#if defined(STM32H7) || defined(SITL_BUILD)
+#define USE_BLACKBOX_RING_BUFFER
+#endif
 #define USE_GPS
 #define USE_GPS_PROTO_UBLOX
 #define USE_GPS_PROTO_MSP
@@ -75,6 +88,9 @@
 #define USE_PITOT_ADC
 
 #define USE_DYNAMIC_FILTERS
+#if defined(STM32F7) || defined(STM32H7)
+#define USE_DYNAMIC_NOTCH_EXTENDED
+#endif
 #define USE_GYRO_KALMAN
 #define USE_SMITH_PREDICTOR
 #define USE_RATE_DYNAMICS
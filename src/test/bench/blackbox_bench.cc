@@ -0,0 +1,686 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Blackbox encoder benchmark
+ *
+ * Replays flight state snapshots through the firmware blackbox code: every
+ * snapshot is loaded into the variables loadMainState() and the slow and GPS
+ * frames read, then blackboxUpdate() encodes it to a serial port which only
+ * counts the bytes. Reports host time per loop iteration, bytes per second
+ * and, from the blackbox statistics, frames, bytes and encode time per frame
+ * type.
+ *
+ * Usage: blackbox_bench [options] [log.csv]
+ *   --denom <n>                log every nth loop iteration (blackbox_rate_denom, default 1)
+ *   --packed                   use the packed encoding
+ *   --rate-div <n>             log all field groups but pid, gyro and motors on every nth frame only
+ *   --looptime <us>            override loop time taken from the log
+ *   --synthetic <seconds>      use generated data instead of a log (default 10)
+ *   --repeat <n>               timing repetitions, best one is reported (default 5)
+ *   --json <file>              also write the results as JSON, for tracking across releases
+ *   --out <file>               write the encoded log, to check it with blackbox_decode
+ *   --quick                    short run, checks the benchmark works
+ *
+ * The log is a blackbox log decoded to CSV (blackbox_decode), columns are
+ * matched by name, fields missing in the log stay zero.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "blackbox/blackbox.h"
+    #include "blackbox/blackbox_io.h"
+    #include "build/debug.h"
+    #include "build/profiler.h"
+    #include "build/version.h"
+    #include "common/axis.h"
+    #include "common/maths.h"
+    #include "common/time.h"
+    #include "config/feature.h"
+    #include "config/parameter_group_ids.h"
+    #include "drivers/serial.h"
+    #include "fc/config.h"
+    #include "fc/controlrate_profile.h"
+    #include "fc/fc_core.h"
+    #include "fc/rc_controls.h"
+    #include "fc/rc_modes.h"
+    #include "fc/runtime_config.h"
+    #include "flight/failsafe.h"
+    #include "flight/imu.h"
+    #include "flight/mixer.h"
+    #include "flight/pid.h"
+    #include "flight/servos.h"
+    #include "io/gps.h"
+    #include "navigation/navigation.h"
+    #include "rx/rx.h"
+    #include "sensors/acceleration.h"
+    #include "sensors/barometer.h"
+    #include "sensors/battery.h"
+    #include "sensors/compass.h"
+    #include "sensors/diagnostics.h"
+    #include "sensors/gyro.h"
+
+    extern serialPort_t *blackboxPort;
+    extern uint8_t blackboxMaxHeaderBytesPerIteration;
+    extern const blackboxConfig_t pgResetTemplate_blackboxConfig;
+
+    PG_REGISTER(accelerometerConfig_t, accelerometerConfig, PG_ACCELEROMETER_CONFIG, 0);
+    PG_REGISTER(barometerConfig_t, barometerConfig, PG_BAROMETER_CONFIG, 0);
+    PG_REGISTER(batteryMetersConfig_t, batteryMetersConfig, PG_BATTERY_METERS_CONFIG, 0);
+    PG_REGISTER(compassConfig_t, compassConfig, PG_COMPASS_CONFIG, 0);
+    PG_REGISTER(featureConfig_t, featureConfig, PG_FEATURE_CONFIG, 0);
+    PG_REGISTER(gyroConfig_t, gyroConfig, PG_GYRO_CONFIG, 0);
+    PG_REGISTER(motorConfig_t, motorConfig, PG_MOTOR_CONFIG, 0);
+    PG_REGISTER(rcControlsConfig_t, rcControlsConfig, PG_RC_CONTROLS_CONFIG, 0);
+    PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+    PG_REGISTER(systemConfig_t, systemConfig, PG_SYSTEM_CONFIG, 0);
+    PG_REGISTER_PROFILE(pidProfile_t, pidProfile, PG_PID_PROFILE, 0);
+}
+
+#define BENCH_MOTOR_COUNT   4
+#define BENCH_GPS_RATE_HZ   10
+
+/*
+ * Snapshot values in the order of benchFields[], as named in decoded logs.
+ * applySnapshot() has to follow the same order.
+ */
+typedef struct {
+    const char *name;
+    int count;
+} benchField_t;
+
+static const benchField_t benchFields[] = {
+    { "axisRate", XYZ_AXIS_COUNT },
+    { "axisP", XYZ_AXIS_COUNT },
+    { "axisI", XYZ_AXIS_COUNT },
+    { "axisD", XYZ_AXIS_COUNT },
+    { "axisF", XYZ_AXIS_COUNT },
+    { "gyroADC", XYZ_AXIS_COUNT },
+    { "gyroRaw", XYZ_AXIS_COUNT },
+    { "accSmooth", XYZ_AXIS_COUNT },
+    { "magADC", XYZ_AXIS_COUNT },
+    { "attitude", XYZ_AXIS_COUNT },
+    { "rcData", 4 },
+    { "rcCommand", 4 },
+    { "motor", BENCH_MOTOR_COUNT },
+    { "vbat", 1 },
+    { "amperage", 1 },
+    { "BaroAlt", 1 },
+    { "rssi", 1 },
+    { "navState", 1 },
+    { "navFlags", 1 },
+    { "navEPH", 1 },
+    { "navEPV", 1 },
+    { "navPos", XYZ_AXIS_COUNT },
+    { "navVel", XYZ_AXIS_COUNT },
+    { "navAcc", XYZ_AXIS_COUNT },
+    { "navTgtVel", XYZ_AXIS_COUNT },
+    { "navTgtPos", XYZ_AXIS_COUNT },
+    { "navSurf", 1 },
+};
+
+typedef std::vector<int32_t> benchSnapshot_t;
+typedef std::vector<benchSnapshot_t> benchLog_t;
+
+typedef struct {
+    double nsPerIteration;
+    double bytesPerSecond;
+    uint32_t bytes;
+} benchResult_t;
+
+static int benchValueCount(void)
+{
+    int count = 0;
+    for (const benchField_t &field : benchFields) {
+        count += field.count;
+    }
+    return count;
+}
+
+static timeDelta_t benchLooptime = 1000;
+static timeUs_t benchTimeUs;
+static int16_t benchRcData[4];
+static uint16_t benchVbat;
+static int16_t benchAmperage;
+static uint16_t benchRssi;
+static uint32_t benchBytes;
+static FILE *benchOutput;
+static serialPort_t benchPort;
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void applySnapshot(const benchSnapshot_t &snapshot)
+{
+    const int32_t *value = snapshot.data();
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) axisPID_Setpoint[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) axisPID_P[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) axisPID_I[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) axisPID_D[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) axisPID_F[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) gyro.gyroADCf[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) gyro.gyroRaw[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) acc.accADCf[axis] = *value++ / (float)acc.dev.acc_1G;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) mag.magADC[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) attitude.raw[axis] = *value++;
+    for (int i = 0; i < 4; i++) benchRcData[i] = *value++;
+    for (int i = 0; i < 4; i++) rcCommand[i] = *value++;
+    for (int i = 0; i < BENCH_MOTOR_COUNT; i++) motor[i] = *value++;
+    benchVbat = *value++;
+    benchAmperage = *value++;
+    baro.BaroAlt = *value++;
+    benchRssi = *value++;
+    navCurrentState = *value++;
+    navFlags = *value++;
+    navEPH = *value++;
+    navEPV = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) navLatestActualPosition[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) navActualVelocity[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) navAccNEU[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) navDesiredVelocity[axis] = *value++;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) navTargetPosition[axis] = *value++;
+    navActualSurface = *value++;
+}
+
+static std::vector<std::string> splitCsvLine(char *line)
+{
+    std::vector<std::string> fields;
+
+    for (char *token = strtok(line, ",\r\n"); token; token = strtok(NULL, ",\r\n")) {
+        while (*token == ' ') {
+            token++;
+        }
+        fields.push_back(token);
+    }
+
+    return fields;
+}
+
+static int findColumn(const std::vector<std::string> &header, const char *name)
+{
+    for (size_t i = 0; i < header.size(); i++) {
+        if (header[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool loadLog(const char *path, benchLog_t &log, timeDelta_t *looptime)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open %s\n", path);
+        return false;
+    }
+
+    static char line[16384];
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return false;
+    }
+
+    const std::vector<std::string> header = splitCsvLine(line);
+    const int timeColumn = findColumn(header, "time (us)");
+    std::vector<int> columns;
+    int found = 0;
+
+    for (const benchField_t &field : benchFields) {
+        for (int i = 0; i < field.count; i++) {
+            char name[32];
+            if (field.count > 1) {
+                snprintf(name, sizeof(name), "%s[%d]", field.name, i);
+            } else {
+                snprintf(name, sizeof(name), "%s", field.name);
+            }
+            columns.push_back(findColumn(header, name));
+            found += columns.back() >= 0;
+        }
+    }
+
+    printf("Input: %s, %d of %d fields\n", path, found, (int)columns.size());
+
+    std::vector<int64_t> deltas;
+    int64_t lastTime = -1;
+
+    while (fgets(line, sizeof(line), file)) {
+        const std::vector<std::string> fields = splitCsvLine(line);
+        if (fields.size() < header.size()) {
+            continue;
+        }
+
+        benchSnapshot_t snapshot(columns.size());
+        for (size_t i = 0; i < columns.size(); i++) {
+            snapshot[i] = columns[i] >= 0 ? atoi(fields[columns[i]].c_str()) : 0;
+        }
+        log.push_back(snapshot);
+
+        if (timeColumn >= 0) {
+            const int64_t time = atoll(fields[timeColumn].c_str());
+            if (lastTime >= 0 && time > lastTime) {
+                deltas.push_back(time - lastTime);
+            }
+            lastTime = time;
+        }
+    }
+    fclose(file);
+
+    if (!deltas.empty()) {
+        std::nth_element(deltas.begin(), deltas.begin() + deltas.size() / 2, deltas.end());
+        *looptime = deltas[deltas.size() / 2];
+    }
+
+    return !log.empty();
+}
+
+static int32_t noise(int32_t amplitude)
+{
+    return amplitude ? rand() % (2 * amplitude + 1) - amplitude : 0;
+}
+
+// Slow stick motion with the PID terms, gyro and motors following it, a noise floor and a slow position drift
+static void generateLog(benchLog_t &log, float seconds)
+{
+    const int count = seconds * 1e6f / benchLooptime;
+    const float dT = US2S(benchLooptime);
+
+    srand(1);
+
+    for (int n = 0; n < count; n++) {
+        const float t = n * dT;
+        benchSnapshot_t snapshot;
+        int32_t setpoint[XYZ_AXIS_COUNT];
+        int32_t gyroRate[XYZ_AXIS_COUNT];
+
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            setpoint[axis] = lrintf(200.0f * sinf(2.0f * M_PIf * (0.3f + 0.2f * axis) * t));
+            gyroRate[axis] = setpoint[axis] + noise(8);
+        }
+
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(setpoint[axis]);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back((setpoint[axis] - gyroRate[axis]) * 4);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(lrintf(20.0f * sinf(0.1f * t + axis)));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(noise(30));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(setpoint[axis] / 10);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(gyroRate[axis]);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(gyroRate[axis] + noise(40));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back((axis == Z ? 4096 : 0) + noise(60));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(lrintf(400.0f * cosf(0.05f * t + axis)) + noise(2));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(lrintf(300.0f * sinf(0.2f * t + axis)));
+        for (int i = 0; i < 4; i++) snapshot.push_back(1500 + (i < 3 ? setpoint[i] : 100) + noise(1));
+        for (int i = 0; i < 4; i++) snapshot.push_back(i < 3 ? setpoint[i] : 1500);
+        for (int i = 0; i < BENCH_MOTOR_COUNT; i++) snapshot.push_back(1500 + ((i & 1) ? 1 : -1) * setpoint[i % XYZ_AXIS_COUNT] / 4 + noise(20));
+        snapshot.push_back(1560 - n / 1000);
+        snapshot.push_back(1200 + noise(50));
+        snapshot.push_back(lrintf(100.0f * t));
+        snapshot.push_back(1000);
+        snapshot.push_back(1);
+        snapshot.push_back(0);
+        snapshot.push_back(150);
+        snapshot.push_back(200);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(lrintf(500.0f * t) * (axis + 1));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(500 * (axis + 1) + noise(5));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(noise(100));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(500 * (axis + 1));
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) snapshot.push_back(lrintf(500.0f * t) * (axis + 1) + 100);
+        snapshot.push_back(-1);
+
+        log.push_back(snapshot);
+    }
+}
+
+// GPS fixes at BENCH_GPS_RATE_HZ, moving along with the navigation position
+static void updateGps(int iteration)
+{
+    const int interval = MAX(1, 1000000 / BENCH_GPS_RATE_HZ / benchLooptime);
+
+    if (iteration % interval) {
+        return;
+    }
+
+    gpsSol.fixType = GPS_FIX_3D;
+    gpsSol.numSat = 12;
+    gpsSol.llh.lat = 473000000 + navLatestActualPosition[X];
+    gpsSol.llh.lon = 85000000 + navLatestActualPosition[Y];
+    gpsSol.llh.alt = navLatestActualPosition[Z];
+    gpsSol.groundSpeed = 500;
+    gpsSol.groundCourse = 450;
+    gpsSol.hdop = 120;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        gpsSol.velNED[axis] = navActualVelocity[axis];
+    }
+}
+
+// One log: start, headers, a snapshot per loop iteration, end of log. Returns host time spent in the blackbox
+static uint64_t runLog(const benchLog_t &log)
+{
+    benchTimeUs = 0;
+    benchBytes = 0;
+    memset(&gpsSol, 0, sizeof(gpsSol));
+
+    blackboxInit();
+    blackboxStart();
+
+    uint64_t elapsed = 0;
+    for (size_t i = 0; i < log.size(); i++) {
+        applySnapshot(log[i]);
+        updateGps(i);
+
+        const uint64_t start = nanos();
+        blackboxUpdate(benchTimeUs);
+        elapsed += nanos() - start;
+
+        benchTimeUs += benchLooptime;
+    }
+
+    blackboxFinish();
+    for (int i = 0; i < 1000 && blackboxPort; i++) {
+        blackboxUpdate(benchTimeUs);
+        benchTimeUs += benchLooptime;
+    }
+
+    return elapsed;
+}
+
+static void report(const benchLog_t &log, const benchResult_t &result)
+{
+    const blackboxStats_t *stats = blackboxGetStats();
+
+    printf("%d iterations of %d us, %.1f ns/iteration, %u bytes, %.0f bytes/s\n",
+        (int)log.size(), (int)benchLooptime, result.nsPerIteration, (unsigned)result.bytes, result.bytesPerSecond);
+
+    printf("%-6s %10s %12s %10s %12s %12s\n", "Frame", "count", "bytes", "bytes/fr", "avg ns", "max ns");
+    for (int type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+        const blackboxFrameStats_t *frame = &stats->frames[type];
+        if (!frame->frames) {
+            continue;
+        }
+        printf("%-6c %10u %12u %10.1f %12.1f %12u\n", blackboxFrameTypeChar((blackboxFrameType_e)type),
+            (unsigned)frame->frames, (unsigned)frame->bytes, (double)frame->bytes / frame->frames,
+            (double)frame->encode.totalTicks / frame->frames, (unsigned)frame->encode.maxTicks);
+    }
+}
+
+static bool writeJson(const char *path, const benchLog_t &log, const benchResult_t &result)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Can't write %s\n", path);
+        return false;
+    }
+
+    const blackboxStats_t *stats = blackboxGetStats();
+
+    fprintf(file, "{\n  \"iterations\": %d,\n  \"looptime_us\": %d,\n  \"rate_denom\": %d,\n  \"encoding\": %d,\n",
+        (int)log.size(), (int)benchLooptime, blackboxConfig()->rate_denom, blackboxConfig()->encoding);
+    fprintf(file, "  \"ns_per_iteration\": %.3f,\n  \"bytes\": %u,\n  \"bytes_per_s\": %.0f,\n  \"frames\": [\n",
+        result.nsPerIteration, (unsigned)result.bytes, result.bytesPerSecond);
+    for (int type = 0; type < BLACKBOX_FRAME_TYPE_COUNT; type++) {
+        const blackboxFrameStats_t *frame = &stats->frames[type];
+        fprintf(file, "    { \"type\": \"%c\", \"count\": %u, \"bytes\": %u, \"avg_ns\": %.1f, \"max_ns\": %u }%s\n",
+            blackboxFrameTypeChar((blackboxFrameType_e)type), (unsigned)frame->frames, (unsigned)frame->bytes,
+            frame->frames ? (double)frame->encode.totalTicks / frame->frames : 0.0, (unsigned)frame->encode.maxTicks,
+            type + 1 < BLACKBOX_FRAME_TYPE_COUNT ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: blackbox_bench [--denom <n>] [--packed] [--rate-div <n>] [--looptime <us>] [--synthetic <seconds>]\n"
+                    "                      [--repeat <n>] [--json <file>] [--out <file>] [--quick] [log.csv]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *logPath = NULL;
+    const char *jsonPath = NULL;
+    const char *outputPath = NULL;
+    float syntheticSeconds = 10;
+    timeDelta_t looptimeOverride = 0;
+    int rateDenom = 1;
+    int groupRateDiv = 1;
+    bool packed = false;
+    int repeat = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--denom") && hasValue) {
+            rateDenom = MAX(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--packed")) {
+            packed = true;
+        } else if (!strcmp(argv[i], "--rate-div") && hasValue) {
+            groupRateDiv = constrain(atoi(argv[++i]), 1, 255);
+        } else if (!strcmp(argv[i], "--looptime") && hasValue) {
+            looptimeOverride = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--synthetic") && hasValue) {
+            syntheticSeconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--repeat") && hasValue) {
+            repeat = MAX(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--json") && hasValue) {
+            jsonPath = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && hasValue) {
+            outputPath = argv[++i];
+        } else if (!strcmp(argv[i], "--quick")) {
+            syntheticSeconds = 1;
+            repeat = 1;
+        } else if (argv[i][0] != '-' && !logPath) {
+            logPath = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    benchLog_t log;
+    if (logPath) {
+        if (!loadLog(logPath, log, &benchLooptime)) {
+            return 1;
+        }
+        if (looptimeOverride) {
+            benchLooptime = looptimeOverride;
+        }
+    } else {
+        if (looptimeOverride) {
+            benchLooptime = looptimeOverride;
+        }
+        generateLog(log, syntheticSeconds);
+    }
+
+    if (log.empty() || (int)log[0].size() != benchValueCount()) {
+        fprintf(stderr, "No input\n");
+        return 1;
+    }
+
+    memcpy(blackboxConfigMutable(), &pgResetTemplate_blackboxConfig, sizeof(blackboxConfig_t));
+    blackboxConfigMutable()->device = BLACKBOX_DEVICE_SERIAL;
+    blackboxConfigMutable()->rate_num = 1;
+    blackboxConfigMutable()->rate_denom = rateDenom;
+    for (int group = 0; group < BLACKBOX_RATE_GROUP_COUNT; group++) {
+        if (group != BLACKBOX_RATE_GROUP_PID && group != BLACKBOX_RATE_GROUP_GYRO && group != BLACKBOX_RATE_GROUP_MOTORS) {
+            blackboxConfigMutable()->groupRateDiv[group] = groupRateDiv;
+        }
+    }
+    blackboxConfigMutable()->encoding = packed ? BLACKBOX_ENCODING_PACKED : BLACKBOX_ENCODING_STANDARD;
+    gyroConfigMutable()->looptime = benchLooptime;
+    featureConfigMutable()->enabledFeatures = FEATURE_BLACKBOX | FEATURE_GPS | FEATURE_VBAT | FEATURE_CURRENT_METER;
+    acc.dev.acc_1G = 4096;
+
+    // Profiler ticks are host nanoseconds
+    usTicks = 1000;
+
+    benchResult_t result = { 0, 0, 0 };
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < repeat; i++) {
+        benchOutput = outputPath && i == repeat - 1 ? fopen(outputPath, "wb") : NULL;
+        best = std::min(best, runLog(log));
+        if (benchOutput) {
+            fclose(benchOutput);
+        }
+    }
+
+    result.nsPerIteration = (double)best / log.size();
+    result.bytes = benchBytes;
+    result.bytesPerSecond = benchBytes / (log.size() * US2S(benchLooptime));
+
+    report(log, result);
+
+    if (jsonPath && !writeJson(jsonPath, log, result)) {
+        return 1;
+    }
+
+    return 0;
+}
+
+// STUBS
+
+extern "C" {
+uint32_t usTicks;
+uint32_t stateFlags;
+int32_t debug[DEBUG32_VALUE_COUNT];
+uint8_t debugMode;
+const char * const targetName = "BENCH";
+const char * const shortGitRevision = "bench";
+const char * const buildDate = "Jan  1 2024";
+const char * const buildTime = "00:00:00";
+
+int32_t axisPID_P[FLIGHT_DYNAMICS_INDEX_COUNT], axisPID_I[FLIGHT_DYNAMICS_INDEX_COUNT], axisPID_D[FLIGHT_DYNAMICS_INDEX_COUNT];
+int32_t axisPID_F[FLIGHT_DYNAMICS_INDEX_COUNT], axisPID_Setpoint[FLIGHT_DYNAMICS_INDEX_COUNT];
+gyro_t gyro;
+acc_t acc;
+mag_t mag;
+baro_t baro;
+attitudeEulerAngles_t attitude;
+int16_t rcCommand[4];
+int16_t motor[MAX_SUPPORTED_MOTORS];
+int16_t servo[MAX_SUPPORTED_SERVOS];
+boxBitmask_t rcModeActivationMask;
+gpsSolutionData_t gpsSol;
+gpsLocation_t GPS_home;
+
+int16_t navCurrentState;
+int16_t navActualVelocity[3];
+int16_t navDesiredVelocity[3];
+int32_t navTargetPosition[3];
+int32_t navLatestActualPosition[3];
+int16_t navActualSurface;
+uint16_t navFlags;
+uint16_t navEPH;
+uint16_t navEPV;
+int16_t navAccNEU[3];
+
+static const controlRateConfig_t benchControlRateProfile = {};
+const controlRateConfig_t *currentControlRateProfile = &benchControlRateProfile;
+static navigationPIDControllers_t benchNavigationPIDControllers;
+
+uint32_t ticks(void) {return (uint32_t)nanos();}
+timeUs_t micros(void) {return benchTimeUs;}
+timeMs_t millis(void) {return benchTimeUs / 1000;}
+uint32_t getLooptime(void) {return benchLooptime;}
+
+bool blackboxDeviceOpen(void)
+{
+    blackboxPort = &benchPort;
+    blackboxMaxHeaderBytesPerIteration = BLACKBOX_TARGET_HEADER_BUDGET_PER_ITERATION;
+    blackboxFrameBuffer.length = 0;
+    return true;
+}
+void blackboxDeviceClose(void)
+{
+    blackboxFrameBufferFlush();
+    blackboxPort = NULL;
+}
+
+void serialWrite(serialPort_t *, uint8_t ch)
+{
+    benchBytes++;
+    if (benchOutput) {
+        fputc(ch, benchOutput);
+    }
+}
+void serialWriteBuf(serialPort_t *, const uint8_t *data, int count)
+{
+    benchBytes += count;
+    if (benchOutput) {
+        fwrite(data, 1, count, benchOutput);
+    }
+}
+uint32_t serialTxBytesFree(const serialPort_t *) {return 4096;}
+bool isSerialTransmitBufferEmpty(const serialPort_t *) {return true;}
+
+bool feature(uint32_t mask) {return featureConfig()->enabledFeatures & mask;}
+bool sensors(uint32_t) {return true;}
+bool IS_RC_MODE_ACTIVE(boxId_e) {return false;}
+bool isModeActivationConditionPresent(boxId_e) {return false;}
+uint32_t getArmingBeepTimeMicros(void) {return 0;}
+disarmReason_t getDisarmReason(void) {return DISARM_NONE;}
+failsafePhase_e failsafePhase(void) {return FAILSAFE_IDLE;}
+bool rtcGetDateTime(dateTime_t *) {return false;}
+bool dateTimeFormatLocal(char *buf, dateTime_t *) {buf[0] = '\0'; return false;}
+
+int16_t rxGetChannelValue(unsigned channelNumber) {return channelNumber < 4 ? benchRcData[channelNumber] : 1500;}
+bool rxAreFlightChannelsValid(void) {return true;}
+bool rxIsReceivingSignal(void) {return true;}
+uint16_t getRSSI(void) {return benchRssi;}
+rssiSource_e getRSSISource(void) {return RSSI_SOURCE_NONE;}
+uint16_t getRcUpdateFrequency(void) {return 50;}
+
+uint16_t getBatteryRawVoltage(void) {return benchVbat;}
+uint16_t getBatterySagCompensatedVoltage(void) {return benchVbat;}
+int16_t getAmperage(void) {return benchAmperage;}
+uint16_t getPowerSupplyImpedance(void) {return 0;}
+bool getBaroTemperature(int16_t *temperature) {*temperature = 250; return true;}
+bool getIMUTemperature(int16_t *temperature) {*temperature = 300; return true;}
+uint32_t getEscUpdateFrequency(void) {return 0;}
+
+uint8_t getMotorCount(void) {return BENCH_MOTOR_COUNT;}
+int getThrottleIdleValue(void) {return 1150;}
+bool isMixerUsingServos(void) {return false;}
+const pidBank_t * pidBank(void) {return &pidProfile()->bank_mc;}
+const navigationPIDControllers_t* getNavigationPIDControllers(void) {return &benchNavigationPIDControllers;}
+int getWaypointCount(void) {return 0;}
+bool isWaypointListValid(void) {return false;}
+
+hardwareSensorStatus_e getHwGyroStatus(void) {return HW_SENSOR_OK;}
+hardwareSensorStatus_e getHwAccelerometerStatus(void) {return HW_SENSOR_OK;}
+hardwareSensorStatus_e getHwCompassStatus(void) {return HW_SENSOR_OK;}
+hardwareSensorStatus_e getHwBarometerStatus(void) {return HW_SENSOR_OK;}
+hardwareSensorStatus_e getHwGPSStatus(void) {return HW_SENSOR_OK;}
+hardwareSensorStatus_e getHwRangefinderStatus(void) {return HW_SENSOR_NONE;}
+hardwareSensorStatus_e getHwPitotmeterStatus(void) {return HW_SENSOR_NONE;}
+}
@@ -0,0 +1,668 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Gyro filter chain benchmark
+ *
+ * Streams gyro samples from a blackbox log decoded to CSV (blackbox_decode)
+ * through the firmware gyro filter code and reports:
+ *  - host time per sample of each filter stage and of gyroUpdate() + gyroFilter()
+ *  - phase delay of the whole chain, from cross correlation of input and output
+ *  - noise spectra of input and output
+ *
+ * Usage: gyro_filter_bench [options] <log.csv>
+ *   --set <setting>=<value>    change a gyro setting, see benchSettings[] for names
+ *   --looptime <us>            override sample interval taken from the log
+ *   --repeat <n>               timing repetitions, best one is reported (default 5)
+ *   --spectrum <file.csv>      write input and output spectra
+ *   --synthetic <seconds>      use generated data instead of a log
+ *
+ * The log has gyroRaw[] only when it was recorded with the gyro raw field
+ * enabled, otherwise the filtered gyroADC[] is used. Logs recorded with a
+ * blackbox rate below the PID rate give a lower sample rate than the firmware
+ * runs the filters at, --looptime can't bring the missing samples back.
+ * RPM filter is not part of the chain, per motor RPM is not in the log.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/axis.h"
+    #include "common/filter.h"
+    #include "common/maths.h"
+    #include "common/time.h"
+    #include "drivers/accgyro/accgyro_fake.h"
+    #include "flight/dynamic_gyro_notch.h"
+    #include "flight/gyroanalyse.h"
+    #include "flight/kalman.h"
+    #include "flight/secondary_dynamic_gyro_notch.h"
+    #include "io/beeper.h"
+    #include "scheduler/scheduler.h"
+    #include "sensors/acceleration.h"
+    #include "sensors/gyro.h"
+    #include "sensors/sensors.h"
+
+    extern const gyroConfig_t pgResetTemplate_gyroConfig;
+    extern gyroAnalyseState_t gyroAnalyseState;
+    extern secondaryDynamicGyroNotchState_t secondaryDynamicGyroNotchState;
+}
+
+#define FAKE_GYRO_LSB_PER_DPS   16      // accgyro_fake scale is 1/16 dps
+#define SPECTRUM_SIZE           256
+#define SPECTRUM_BANDS          8
+#define MAX_DELAY_SAMPLES       64
+
+typedef struct {
+    float gyro[XYZ_AXIS_COUNT];
+    float setpoint[XYZ_AXIS_COUNT];
+} benchSample_t;
+
+typedef std::vector<benchSample_t> benchLog_t;
+
+static timeDelta_t benchLooptime = 1000;
+
+/*
+ * Settings
+ */
+typedef struct {
+    const char *name;
+    void (*set)(gyroConfig_t *config, int value);
+} benchSetting_t;
+
+static int parseFilterType(const char *value)
+{
+    if (!strcasecmp(value, "PT1")) {
+        return FILTER_PT1;
+    }
+    if (!strcasecmp(value, "BIQUAD")) {
+        return FILTER_BIQUAD;
+    }
+    if (!strcasecmp(value, "OFF") || !strcasecmp(value, "FFT") || !strcmp(value, "64")) {
+        return 0;
+    }
+    if (!strcasecmp(value, "ON") || !strcasecmp(value, "SDFT") || !strcmp(value, "128")) {
+        return 1;
+    }
+    return atoi(value);
+}
+
+static const benchSetting_t benchSettings[] = {
+    { "gyro_anti_aliasing_lpf_hz",       [](gyroConfig_t *c, int v) { c->gyro_anti_aliasing_lpf_hz = v; } },
+    { "gyro_anti_aliasing_lpf_type",     [](gyroConfig_t *c, int v) { c->gyro_anti_aliasing_lpf_type = v; } },
+    { "gyro_main_lpf_hz",                [](gyroConfig_t *c, int v) { c->gyro_main_lpf_hz = v; } },
+    { "gyro_main_lpf_type",              [](gyroConfig_t *c, int v) { c->gyro_main_lpf_type = v; } },
+    { "dynamic_gyro_notch_enabled",      [](gyroConfig_t *c, int v) { c->dynamicGyroNotchEnabled = v; } },
+    { "dynamic_gyro_notch_q",            [](gyroConfig_t *c, int v) { c->dynamicGyroNotchQ = v; } },
+    { "dynamic_gyro_notch_min_hz",       [](gyroConfig_t *c, int v) { c->dynamicGyroNotchMinHz = v; } },
+    { "dynamic_gyro_notch_mode",         [](gyroConfig_t *c, int v) { c->dynamicGyroNotchMode = v; } },
+    { "dynamic_gyro_notch_3d_q",         [](gyroConfig_t *c, int v) { c->dynamicGyroNotch3dQ = v; } },
+    { "dynamic_gyro_notch_fft_size",     [](gyroConfig_t *c, int v) { c->dynamicGyroNotchFftSize = v; } },
+    { "dynamic_gyro_notch_zero_padding", [](gyroConfig_t *c, int v) { c->dynamicGyroNotchZeroPadding = v; } },
+    { "dynamic_gyro_notch_overlap",      [](gyroConfig_t *c, int v) { c->dynamicGyroNotchOverlap = v; } },
+    { "setpoint_kalman_enabled",         [](gyroConfig_t *c, int v) { c->kalmanEnabled = v; } },
+    { "setpoint_kalman_q",               [](gyroConfig_t *c, int v) { c->kalman_q = v; } },
+};
+
+static bool applySetting(const char *arg)
+{
+    const char *eq = strchr(arg, '=');
+    if (!eq) {
+        return false;
+    }
+
+    const std::string name(arg, eq - arg);
+    for (const benchSetting_t &setting : benchSettings) {
+        if (name == setting.name) {
+            setting.set(gyroConfigMutable(), parseFilterType(eq + 1));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Input
+ */
+static std::vector<std::string> splitCsvLine(char *line)
+{
+    std::vector<std::string> fields;
+
+    for (char *token = strtok(line, ",\r\n"); token; token = strtok(NULL, ",\r\n")) {
+        while (*token == ' ') {
+            token++;
+        }
+        fields.push_back(token);
+    }
+
+    return fields;
+}
+
+static int findColumn(const std::vector<std::string> &header, const char *name)
+{
+    for (size_t i = 0; i < header.size(); i++) {
+        if (header[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool loadLog(const char *path, benchLog_t &log, timeDelta_t *looptime)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open %s\n", path);
+        return false;
+    }
+
+    static char line[16384];
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return false;
+    }
+
+    const std::vector<std::string> header = splitCsvLine(line);
+    const int timeColumn = findColumn(header, "time (us)");
+    int gyroColumns[XYZ_AXIS_COUNT];
+    int setpointColumns[XYZ_AXIS_COUNT];
+    const char *gyroField = findColumn(header, "gyroRaw[0]") >= 0 ? "gyroRaw" : "gyroADC";
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s[%d]", gyroField, axis);
+        gyroColumns[axis] = findColumn(header, name);
+        snprintf(name, sizeof(name), "axisRate[%d]", axis);
+        setpointColumns[axis] = findColumn(header, name);
+
+        if (gyroColumns[axis] < 0) {
+            fprintf(stderr, "%s: no %s column\n", path, name);
+            fclose(file);
+            return false;
+        }
+    }
+
+    printf("Input: %s, field %s\n", path, gyroField);
+
+    std::vector<int64_t> deltas;
+    int64_t lastTime = -1;
+
+    while (fgets(line, sizeof(line), file)) {
+        const std::vector<std::string> fields = splitCsvLine(line);
+        if (fields.size() < header.size()) {
+            continue;
+        }
+
+        benchSample_t sample;
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sample.gyro[axis] = atof(fields[gyroColumns[axis]].c_str());
+            sample.setpoint[axis] = setpointColumns[axis] >= 0 ? atof(fields[setpointColumns[axis]].c_str()) : 0.0f;
+        }
+        log.push_back(sample);
+
+        if (timeColumn >= 0) {
+            const int64_t time = atoll(fields[timeColumn].c_str());
+            if (lastTime >= 0 && time > lastTime) {
+                deltas.push_back(time - lastTime);
+            }
+            lastTime = time;
+        }
+    }
+    fclose(file);
+
+    if (!deltas.empty()) {
+        std::nth_element(deltas.begin(), deltas.begin() + deltas.size() / 2, deltas.end());
+        *looptime = deltas[deltas.size() / 2];
+    }
+
+    return !log.empty();
+}
+
+// Slow stick motion, two motor noise lines sweeping with throttle and broadband noise
+static void generateLog(benchLog_t &log, float seconds)
+{
+    const int count = seconds * 1e6f / benchLooptime;
+    const float dT = US2S(benchLooptime);
+    float motorPhase = 0.0f;
+
+    srand(1);
+
+    for (int i = 0; i < count; i++) {
+        const float t = i * dT;
+        const float motorHz = 180.0f + 80.0f * sinf(2.0f * M_PIf * 0.2f * t);
+        motorPhase += 2.0f * M_PIf * motorHz * dT;
+
+        benchSample_t sample;
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            const float stick = 200.0f * sinf(2.0f * M_PIf * (0.5f + axis * 0.3f) * t);
+            const float noise = (rand() / (float)RAND_MAX - 0.5f) * 20.0f;
+
+            sample.setpoint[axis] = stick;
+            sample.gyro[axis] = lrintf(stick + 40.0f * sinf(motorPhase + axis) + 15.0f * sinf(2.0f * motorPhase) + noise);
+        }
+        log.push_back(sample);
+    }
+
+    printf("Input: synthetic, %.1fs\n", (double)seconds);
+}
+
+/*
+ * Timing
+ */
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+typedef struct {
+    const char *name;
+    uint64_t bestNs;
+} benchStage_t;
+
+enum {
+    STAGE_ANTI_ALIASING_LPF = 0,
+    STAGE_MAIN_LPF,
+    STAGE_DYN_NOTCH_ANALYSIS,
+    STAGE_DYN_NOTCH,
+    STAGE_SECONDARY_NOTCH,
+    STAGE_KALMAN,
+    STAGE_CHAIN,
+    STAGE_COUNT
+};
+
+static benchStage_t stages[STAGE_COUNT] = {
+    { "anti aliasing lpf",          UINT64_MAX },
+    { "main lpf",                   UINT64_MAX },
+    { "dyn notch analysis",         UINT64_MAX },
+    { "dyn notch analysis + apply", UINT64_MAX },
+    { "secondary dyn notch",        UINT64_MAX },
+    { "kalman",                     UINT64_MAX },
+    { "gyroUpdate + gyroFilter",    UINT64_MAX },
+};
+
+static void stageDone(int stage, uint64_t startNs)
+{
+    stages[stage].bestNs = std::min(stages[stage].bestNs, nanos() - startNs);
+}
+
+static void initFirmwareFilters(void)
+{
+    memset(&gyroAnalyseState, 0, sizeof(gyroAnalyseState));
+    gyroInit();
+    gyroStartCalibration();
+    fakeGyroSet(0, 0, 0);
+    while (!gyroIsCalibrationComplete()) {
+        gyroUpdate();
+    }
+}
+
+/*
+ * Each stage runs over the whole log on the output of the previous one,
+ * using the same calls gyroUpdate()/gyroFilter() make
+ */
+static void runStages(const benchLog_t &log)
+{
+    std::vector<benchSample_t> data(log);
+    const size_t count = data.size();
+    uint64_t start;
+
+    initFirmwareFilters();
+
+    filterBank_t antiAliasingLpf;
+    filterBankInit(&antiAliasingLpf);
+    filterBankAddLowpass(&antiAliasingLpf, gyroConfig()->gyro_anti_aliasing_lpf_type, gyroConfig()->gyro_anti_aliasing_lpf_hz, benchLooptime);
+
+    start = nanos();
+    for (size_t i = 0; i < count; i++) {
+        filterBankApply(&antiAliasingLpf, data[i].gyro);
+    }
+    stageDone(STAGE_ANTI_ALIASING_LPF, start);
+
+    filterBank_t mainLpf;
+    filterBankInit(&mainLpf);
+    filterBankAddLowpass(&mainLpf, gyroConfig()->gyro_main_lpf_type, gyroConfig()->gyro_main_lpf_hz, benchLooptime);
+
+    start = nanos();
+    for (size_t i = 0; i < count; i++) {
+        filterBankApply(&mainLpf, data[i].gyro);
+    }
+    stageDone(STAGE_MAIN_LPF, start);
+
+    if (dynamicGyroNotchState.enabled) {
+        // Analysis alone first, then again together with the notches it drives
+        start = nanos();
+        for (size_t i = 0; i < count; i++) {
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                gyroDataAnalysePush(&gyroAnalyseState, axis, data[i].gyro[axis]);
+            }
+            gyroDataAnalyse(&gyroAnalyseState);
+        }
+        stageDone(STAGE_DYN_NOTCH_ANALYSIS, start);
+
+        initFirmwareFilters();
+
+        start = nanos();
+        for (size_t i = 0; i < count; i++) {
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                gyroDataAnalysePush(&gyroAnalyseState, axis, data[i].gyro[axis]);
+                data[i].gyro[axis] = dynamicGyroNotchFiltersApply(&dynamicGyroNotchState, axis, data[i].gyro[axis]);
+            }
+            gyroDataAnalyse(&gyroAnalyseState);
+            if (gyroAnalyseState.filterUpdateExecute) {
+                const int axis = gyroAnalyseState.filterUpdateAxis;
+                dynamicGyroNotchFiltersUpdate(&dynamicGyroNotchState, axis, gyroAnalyseState.centerFrequency[axis]);
+                secondaryDynamicGyroNotchFiltersUpdate(&secondaryDynamicGyroNotchState, axis, gyroAnalyseState.centerFrequency[axis]);
+            }
+        }
+        stageDone(STAGE_DYN_NOTCH, start);
+    }
+
+    start = nanos();
+    for (size_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            data[i].gyro[axis] = secondaryDynamicGyroNotchFiltersApply(&secondaryDynamicGyroNotchState, axis, data[i].gyro[axis]);
+        }
+    }
+    stageDone(STAGE_SECONDARY_NOTCH, start);
+
+    if (gyroConfig()->kalmanEnabled) {
+        start = nanos();
+        for (size_t i = 0; i < count; i++) {
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                gyroKalmanUpdateSetpoint(axis, data[i].setpoint[axis]);
+                data[i].gyro[axis] = gyroKalmanUpdate(axis, data[i].gyro[axis]);
+            }
+        }
+        stageDone(STAGE_KALMAN, start);
+    }
+}
+
+// The real thing, fake gyro driver in, gyro.gyroADCf out
+static void runChain(const benchLog_t &log, benchLog_t &output)
+{
+    output.resize(log.size());
+
+    initFirmwareFilters();
+
+    const uint64_t start = nanos();
+    for (size_t i = 0; i < log.size(); i++) {
+        fakeGyroSet(
+            lrintf(log[i].gyro[X] * FAKE_GYRO_LSB_PER_DPS),
+            lrintf(log[i].gyro[Y] * FAKE_GYRO_LSB_PER_DPS),
+            lrintf(log[i].gyro[Z] * FAKE_GYRO_LSB_PER_DPS)
+        );
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            gyroKalmanUpdateSetpoint(axis, log[i].setpoint[axis]);
+        }
+        gyroUpdate();
+        gyroFilter();
+        memcpy(output[i].gyro, gyro.gyroADCf, sizeof(gyro.gyroADCf));
+    }
+    stageDone(STAGE_CHAIN, start);
+}
+
+/*
+ * Analysis
+ */
+
+// Lag in samples where input and output correlate best, refined with a parabola
+static float estimateDelay(const benchLog_t &input, const benchLog_t &output, int axis)
+{
+    const size_t count = input.size();
+    double mean = 0;
+    for (size_t i = 0; i < count; i++) {
+        mean += input[i].gyro[axis];
+    }
+    mean /= count;
+
+    double correlation[MAX_DELAY_SAMPLES + 1];
+    int best = 0;
+    for (int lag = 0; lag <= MAX_DELAY_SAMPLES; lag++) {
+        correlation[lag] = 0;
+        for (size_t i = lag; i < count; i++) {
+            correlation[lag] += (input[i - lag].gyro[axis] - mean) * (output[i].gyro[axis] - mean);
+        }
+        if (correlation[lag] > correlation[best]) {
+            best = lag;
+        }
+    }
+
+    double lag = best;
+    if (best > 0 && best < MAX_DELAY_SAMPLES) {
+        const double y0 = correlation[best - 1];
+        const double y1 = correlation[best];
+        const double y2 = correlation[best + 1];
+        const double denom = 2 * (y0 - 2 * y1 + y2);
+        if (denom != 0) {
+            lag += (y0 - y2) / denom;
+        }
+    }
+
+    return lag;
+}
+
+// Welch power spectrum in dB, Hann window, 50% overlap
+static void powerSpectrum(const benchLog_t &log, int axis, double *spectrum)
+{
+    const int bins = SPECTRUM_SIZE / 2;
+    int segments = 0;
+
+    for (int k = 0; k < bins; k++) {
+        spectrum[k] = 0;
+    }
+
+    for (size_t offset = 0; offset + SPECTRUM_SIZE <= log.size(); offset += SPECTRUM_SIZE / 2) {
+        double mean = 0;
+        for (int n = 0; n < SPECTRUM_SIZE; n++) {
+            mean += log[offset + n].gyro[axis];
+        }
+        mean /= SPECTRUM_SIZE;
+
+        for (int k = 0; k < bins; k++) {
+            double re = 0;
+            double im = 0;
+            for (int n = 0; n < SPECTRUM_SIZE; n++) {
+                const double hann = 0.5 - 0.5 * cos(2 * M_PI * n / SPECTRUM_SIZE);
+                const double x = (log[offset + n].gyro[axis] - mean) * hann;
+                re += x * cos(2 * M_PI * k * n / SPECTRUM_SIZE);
+                im -= x * sin(2 * M_PI * k * n / SPECTRUM_SIZE);
+            }
+            spectrum[k] += re * re + im * im;
+        }
+        segments++;
+    }
+
+    for (int k = 0; k < bins; k++) {
+        spectrum[k] = 10 * log10(spectrum[k] / MAX(segments, 1) + 1e-12);
+    }
+}
+
+static void report(const benchLog_t &input, const benchLog_t &output, const char *spectrumPath)
+{
+    const size_t count = input.size();
+    const double sampleRateHz = 1e6 / benchLooptime;
+
+    printf("Samples: %zu at %dus (%.0fHz)\n\n", count, (int)benchLooptime, sampleRateHz);
+
+    printf("%-28s %10s\n", "Stage", "ns/sample");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        if (stages[i].bestNs != UINT64_MAX) {
+            printf("%-28s %10.1f\n", stages[i].name, (double)stages[i].bestNs / count);
+        }
+    }
+
+    printf("\n%-6s %10s %10s\n", "Axis", "delay/us", "delay/smp");
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        const float lag = estimateDelay(input, output, axis);
+        printf("%-6d %10.0f %10.2f\n", axis, (double)(lag * benchLooptime), (double)lag);
+    }
+
+    static double inSpectrum[XYZ_AXIS_COUNT][SPECTRUM_SIZE / 2];
+    static double outSpectrum[XYZ_AXIS_COUNT][SPECTRUM_SIZE / 2];
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        powerSpectrum(input, axis, inSpectrum[axis]);
+        powerSpectrum(output, axis, outSpectrum[axis]);
+    }
+
+    const double binHz = sampleRateHz / SPECTRUM_SIZE;
+    const int bandBins = SPECTRUM_SIZE / 2 / SPECTRUM_BANDS;
+
+    printf("\nMean noise power in dB, input -> output\n%-12s", "Band/Hz");
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        printf(" %17s%d", "axis ", axis);
+    }
+    printf("\n");
+    for (int band = 0; band < SPECTRUM_BANDS; band++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%.0f-%.0f", band * bandBins * binHz, (band + 1) * bandBins * binHz);
+        printf("%-12s", name);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            double in = 0;
+            double out = 0;
+            for (int k = band * bandBins; k < (band + 1) * bandBins; k++) {
+                in += inSpectrum[axis][k];
+                out += outSpectrum[axis][k];
+            }
+            printf(" %8.1f -> %7.1f", in / bandBins, out / bandBins);
+        }
+        printf("\n");
+    }
+
+    if (spectrumPath) {
+        FILE *file = fopen(spectrumPath, "w");
+        if (!file) {
+            fprintf(stderr, "Can't write %s\n", spectrumPath);
+            return;
+        }
+        fprintf(file, "frequency,in[0],out[0],in[1],out[1],in[2],out[2]\n");
+        for (int k = 0; k < SPECTRUM_SIZE / 2; k++) {
+            fprintf(file, "%.2f", k * binHz);
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                fprintf(file, ",%.2f,%.2f", inSpectrum[axis][k], outSpectrum[axis][k]);
+            }
+            fprintf(file, "\n");
+        }
+        fclose(file);
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: gyro_filter_bench [--set <setting>=<value>]... [--looptime <us>] [--repeat <n>]\n"
+                    "                         [--spectrum <file.csv>] (<log.csv> | --synthetic <seconds>)\n"
+                    "Settings:");
+    for (const benchSetting_t &setting : benchSettings) {
+        fprintf(stderr, " %s", setting.name);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *logPath = NULL;
+    const char *spectrumPath = NULL;
+    float syntheticSeconds = 0;
+    timeDelta_t looptimeOverride = 0;
+    int repeat = 5;
+
+    memcpy(gyroConfigMutable(), &pgResetTemplate_gyroConfig, sizeof(gyroConfig_t));
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--set") && hasValue) {
+            if (!applySetting(argv[++i])) {
+                fprintf(stderr, "Unknown setting %s\n", argv[i]);
+                usage();
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--looptime") && hasValue) {
+            looptimeOverride = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--repeat") && hasValue) {
+            repeat = MAX(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--spectrum") && hasValue) {
+            spectrumPath = argv[++i];
+        } else if (!strcmp(argv[i], "--synthetic") && hasValue) {
+            syntheticSeconds = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && !logPath) {
+            logPath = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    benchLog_t input;
+    if (syntheticSeconds > 0) {
+        if (looptimeOverride) {
+            benchLooptime = looptimeOverride;
+        }
+        generateLog(input, syntheticSeconds);
+    } else if (logPath) {
+        if (!loadLog(logPath, input, &benchLooptime)) {
+            return 1;
+        }
+        if (looptimeOverride) {
+            benchLooptime = looptimeOverride;
+        }
+    } else {
+        usage();
+        return 1;
+    }
+
+    if (input.size() < SPECTRUM_SIZE) {
+        fprintf(stderr, "Not enough samples\n");
+        return 1;
+    }
+
+    benchLog_t output;
+    for (int i = 0; i < repeat; i++) {
+        runStages(input);
+        runChain(input, output);
+    }
+
+    report(input, output, spectrumPath);
+
+    return 0;
+}
+
+// STUBS
+
+extern "C" {
+static timeMs_t milliTime = 0;
+timeMs_t millis(void) {return milliTime++;}
+uint32_t micros(void) {return 0;}
+void beeper(beeperMode_e) {}
+uint8_t detectedSensors[] = { GYRO_NONE, ACC_NONE };
+timeDelta_t getLooptime(void) {return benchLooptime;}
+timeDelta_t getGyroLooptime(void) {return benchLooptime;}
+void sensorsSet(uint32_t) {}
+void schedulerResetTaskStatistics(cfTaskId_e) {}
+}
@@ -0,0 +1,471 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of the hot path math in common/maths.c and common/filter.c
+ *
+ * For every function reports host time per call and the largest error against
+ * a double precision reference over the function's useful input range.
+ *
+ * Usage: maths_bench [options]
+ *   --json <file>      also write the results as JSON, for tracking across commits
+ *   --repeat <n>       timing repetitions, best one is reported (default 5)
+ *   --match <text>     only run benchmarks with <text> in their name
+ *   --quick            few iterations, checks the benchmark works
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/axis.h"
+    #include "common/filter.h"
+    #include "common/maths.h"
+    #include "common/time.h"
+}
+
+#define INPUT_COUNT         1024
+#define ERROR_SAMPLE_COUNT  100000
+#define LOOPTIME_US         1000
+
+typedef enum {
+    ERROR_ABSOLUTE = 0,
+    ERROR_RELATIVE,
+} benchErrorType_e;
+
+typedef struct {
+    const char *name;
+    double nsPerCall;
+    double maxError;
+    benchErrorType_e errorType;
+} benchResult_t;
+
+static int benchIterations = 2000;
+static int benchRepeat = 5;
+static volatile float benchSink;
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Best time of benchRepeat runs of body(), which makes `calls` calls
+static double timeCalls(const std::function<void(void)> &body, uint64_t calls)
+{
+    uint64_t best = UINT64_MAX;
+
+    for (int i = 0; i < benchRepeat; i++) {
+        const uint64_t start = nanos();
+        body();
+        best = std::min(best, nanos() - start);
+    }
+
+    return (double)best / calls;
+}
+
+static float randomFloat(float min, float max)
+{
+    return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+/*
+ * Functions of one argument
+ */
+static void benchUnary(benchResult_t *result, float (*fn)(float), double (*reference)(double), float min, float max, benchErrorType_e errorType)
+{
+    float input[INPUT_COUNT];
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        input[i] = randomFloat(min, max);
+    }
+
+    result->nsPerCall = timeCalls([&]() {
+        float sum = 0;
+        for (int n = 0; n < benchIterations; n++) {
+            for (int i = 0; i < INPUT_COUNT; i++) {
+                sum += fn(input[i]);
+            }
+        }
+        benchSink = sum;
+    }, (uint64_t)benchIterations * INPUT_COUNT);
+
+    result->errorType = errorType;
+    result->maxError = 0;
+    for (int i = 0; i <= ERROR_SAMPLE_COUNT; i++) {
+        const float x = min + (max - min) * i / ERROR_SAMPLE_COUNT;
+        const double expected = reference(x);
+        double error = fabs(fn(x) - expected);
+        if (errorType == ERROR_RELATIVE) {
+            error = expected != 0 ? error / fabs(expected) : 0;
+        }
+        result->maxError = std::max(result->maxError, error);
+    }
+}
+
+// Wrappers as maths.h may turn the functions into libm macros
+static float benchSinApprox(float x) { return sin_approx(x); }
+static float benchCosApprox(float x) { return cos_approx(x); }
+static float benchAcosApprox(float x) { return acos_approx(x); }
+static float benchFastSqrt(float x) { return fast_fsqrtf(x); }
+static double referenceSin(double x) { return sin(x); }
+static double referenceCos(double x) { return cos(x); }
+static double referenceAcos(double x) { return acos(x); }
+static double referenceSqrt(double x) { return sqrt(x); }
+
+static void benchSin(benchResult_t *result)
+{
+    benchUnary(result, benchSinApprox, referenceSin, -2 * M_PIf, 2 * M_PIf, ERROR_ABSOLUTE);
+}
+
+static void benchCos(benchResult_t *result)
+{
+    benchUnary(result, benchCosApprox, referenceCos, -2 * M_PIf, 2 * M_PIf, ERROR_ABSOLUTE);
+}
+
+static void benchAcos(benchResult_t *result)
+{
+    benchUnary(result, benchAcosApprox, referenceAcos, -1.0f, 1.0f, ERROR_ABSOLUTE);
+}
+
+static void benchFastFsqrtf(benchResult_t *result)
+{
+    benchUnary(result, benchFastSqrt, referenceSqrt, 0.0f, 10000.0f, ERROR_RELATIVE);
+}
+
+// Points on circles of different radius, all angles
+static void benchAtan2(benchResult_t *result)
+{
+    float inputY[INPUT_COUNT];
+    float inputX[INPUT_COUNT];
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        inputY[i] = randomFloat(-1000.0f, 1000.0f);
+        inputX[i] = randomFloat(-1000.0f, 1000.0f);
+    }
+
+    result->nsPerCall = timeCalls([&]() {
+        float sum = 0;
+        for (int n = 0; n < benchIterations; n++) {
+            for (int i = 0; i < INPUT_COUNT; i++) {
+                sum += atan2_approx(inputY[i], inputX[i]);
+            }
+        }
+        benchSink = sum;
+    }, (uint64_t)benchIterations * INPUT_COUNT);
+
+    result->errorType = ERROR_ABSOLUTE;
+    result->maxError = 0;
+    for (int i = 0; i < ERROR_SAMPLE_COUNT; i++) {
+        const double angle = 2 * M_PI * i / ERROR_SAMPLE_COUNT - M_PI;
+        for (double radius = 0.01; radius < 10000; radius *= 10) {
+            const float y = radius * sin(angle);
+            const float x = radius * cos(angle);
+            result->maxError = std::max(result->maxError, fabs(atan2_approx(y, x) - atan2((double)y, (double)x)));
+        }
+    }
+}
+
+/*
+ * Median filters, the error is the distance to the true median
+ */
+template <typename T, int N>
+static void benchMedian(benchResult_t *result, T (*fn)(T *))
+{
+    static T input[INPUT_COUNT][N];
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        for (int k = 0; k < N; k++) {
+            input[i][k] = rand() % 20000 - 10000;
+        }
+    }
+
+    result->nsPerCall = timeCalls([&]() {
+        int32_t sum = 0;
+        for (int n = 0; n < benchIterations; n++) {
+            for (int i = 0; i < INPUT_COUNT; i++) {
+                sum += fn(input[i]);
+            }
+        }
+        benchSink = sum;
+    }, (uint64_t)benchIterations * INPUT_COUNT);
+
+    result->errorType = ERROR_ABSOLUTE;
+    result->maxError = 0;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        T sorted[N];
+        memcpy(sorted, input[i], sizeof(sorted));
+        std::sort(sorted, sorted + N);
+        result->maxError = std::max(result->maxError, fabs((double)fn(input[i]) - sorted[N / 2]));
+    }
+}
+
+static void benchMedian3(benchResult_t *result) { benchMedian<int32_t, 3>(result, quickMedianFilter3); }
+static void benchMedian5(benchResult_t *result) { benchMedian<int32_t, 5>(result, quickMedianFilter5); }
+static void benchMedian7(benchResult_t *result) { benchMedian<int32_t, 7>(result, quickMedianFilter7); }
+static void benchMedian9(benchResult_t *result) { benchMedian<int32_t, 9>(result, quickMedianFilter9); }
+static void benchMedian3_16(benchResult_t *result) { benchMedian<int16_t, 3>(result, quickMedianFilter3_16); }
+static void benchMedian5_16(benchResult_t *result) { benchMedian<int16_t, 5>(result, quickMedianFilter5_16); }
+
+/*
+ * Filters, gyro like input: a slow signal, a noise line and broadband noise.
+ * The reference runs the same difference equation with the same coefficients
+ * in double precision, the error shows what float rounding costs.
+ */
+static std::vector<float> filterInput(void)
+{
+    std::vector<float> input(INPUT_COUNT);
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        const float t = US2S(i * LOOPTIME_US);
+        input[i] = 300.0f * sinf(2 * M_PIf * 3.0f * t) + 30.0f * sinf(2 * M_PIf * 210.0f * t) + randomFloat(-10.0f, 10.0f);
+    }
+    return input;
+}
+
+static void benchFilter(benchResult_t *result, const std::function<float(float)> &apply, const std::function<double(double)> &reference)
+{
+    const std::vector<float> input = filterInput();
+
+    // Error over the first pass only, the filter state keeps running afterwards
+    result->errorType = ERROR_ABSOLUTE;
+    result->maxError = 0;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        result->maxError = std::max(result->maxError, fabs(apply(input[i]) - reference(input[i])));
+    }
+
+    result->nsPerCall = timeCalls([&]() {
+        float sum = 0;
+        for (int n = 0; n < benchIterations; n++) {
+            for (int i = 0; i < INPUT_COUNT; i++) {
+                sum += apply(input[i]);
+            }
+        }
+        benchSink = sum;
+    }, (uint64_t)benchIterations * INPUT_COUNT);
+}
+
+static void benchPt1(benchResult_t *result)
+{
+    pt1Filter_t filter;
+    pt1FilterInit(&filter, 80, US2S(LOOPTIME_US));
+    double state = 0;
+
+    benchFilter(result,
+        [&](float x) { return pt1FilterApply(&filter, x); },
+        [&](double x) { return state += filter.alpha * (x - state); });
+}
+
+static void benchPt2(benchResult_t *result)
+{
+    pt2Filter_t filter;
+    pt2FilterInit(&filter, pt2FilterGain(80, US2S(LOOPTIME_US)));
+    double state[2] = { 0 };
+
+    benchFilter(result,
+        [&](float x) { return pt2FilterApply(&filter, x); },
+        [&](double x) {
+            state[0] += filter.k * (x - state[0]);
+            return state[1] += filter.k * (state[0] - state[1]);
+        });
+}
+
+static void benchPt3(benchResult_t *result)
+{
+    pt3Filter_t filter;
+    pt3FilterInit(&filter, pt3FilterGain(80, US2S(LOOPTIME_US)));
+    double state[3] = { 0 };
+
+    benchFilter(result,
+        [&](float x) { return pt3FilterApply(&filter, x); },
+        [&](double x) {
+            state[0] += filter.k * (x - state[0]);
+            state[1] += filter.k * (state[0] - state[1]);
+            return state[2] += filter.k * (state[1] - state[2]);
+        });
+}
+
+// Direct form I in double for all biquads, both forms compute the same transfer function
+static std::function<double(double)> biquadReference(const biquadFilter_t *filter)
+{
+    struct { double x1, x2, y1, y2; } state = { 0, 0, 0, 0 };
+
+    return [filter, state](double x) mutable {
+        const double y = filter->b0 * x + filter->b1 * state.x1 + filter->b2 * state.x2 - filter->a1 * state.y1 - filter->a2 * state.y2;
+        state.x2 = state.x1;
+        state.x1 = x;
+        state.y2 = state.y1;
+        state.y1 = y;
+        return y;
+    };
+}
+
+static void benchBiquadLpf(benchResult_t *result)
+{
+    biquadFilter_t filter;
+    biquadFilterInitLPF(&filter, 80, LOOPTIME_US);
+
+    benchFilter(result, [&](float x) { return biquadFilterApply(&filter, x); }, biquadReference(&filter));
+}
+
+static void benchBiquadDF1(benchResult_t *result)
+{
+    biquadFilter_t filter;
+    biquadFilterInitLPF(&filter, 80, LOOPTIME_US);
+
+    benchFilter(result, [&](float x) { return biquadFilterApplyDF1(&filter, x); }, biquadReference(&filter));
+}
+
+static void benchBiquadNotch(benchResult_t *result)
+{
+    biquadFilter_t filter;
+    biquadFilterInitNotch(&filter, LOOPTIME_US, 210, 160);
+
+    benchFilter(result, [&](float x) { return biquadFilterApply(&filter, x); }, biquadReference(&filter));
+}
+
+// One call filters all three axes through a biquad and a PT3 stage, like gyro main LPF
+static void benchFilterBank(benchResult_t *result)
+{
+    filterBank_t bank;
+    filterBankInit(&bank);
+    filterBankAddLowpass(&bank, FILTER_BIQUAD, 250, LOOPTIME_US);
+    filterBankAddLowpass(&bank, FILTER_PT3, 110, LOOPTIME_US);
+
+    // Sections in double, the same transposed direct form II as the bank
+    struct { double s1, s2; } state[FILTER_BANK_MAX_SECTIONS] = { };
+
+    benchFilter(result,
+        [&](float x) {
+            float values[XYZ_AXIS_COUNT] = { x, x, x };
+            filterBankApply(&bank, values);
+            return values[X] + values[Y] + values[Z];
+        },
+        [&](double x) {
+            for (int i = 0; i < bank.sectionCount; i++) {
+                const filterBankSection_t *section = &bank.sections[i];
+                const double y = section->b0 * x + state[i].s1;
+                state[i].s1 = section->b1 * x - section->a1 * y + state[i].s2;
+                state[i].s2 = section->b2 * x - section->a2 * y;
+                x = y;
+            }
+            return 3 * x;
+        });
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(benchResult_t *result);
+} benchmark_t;
+
+static const benchmark_t benchmarks[] = {
+    { "sin_approx",               benchSin },
+    { "cos_approx",               benchCos },
+    { "atan2_approx",             benchAtan2 },
+    { "acos_approx",              benchAcos },
+    { "fast_fsqrtf",              benchFastFsqrtf },
+    { "quickMedianFilter3",       benchMedian3 },
+    { "quickMedianFilter5",       benchMedian5 },
+    { "quickMedianFilter7",       benchMedian7 },
+    { "quickMedianFilter9",       benchMedian9 },
+    { "quickMedianFilter3_16",    benchMedian3_16 },
+    { "quickMedianFilter5_16",    benchMedian5_16 },
+    { "pt1FilterApply",           benchPt1 },
+    { "pt2FilterApply",           benchPt2 },
+    { "pt3FilterApply",           benchPt3 },
+    { "biquadFilterApply",        benchBiquadLpf },
+    { "biquadFilterApplyDF1",     benchBiquadDF1 },
+    { "biquadFilterApply notch",  benchBiquadNotch },
+    { "filterBankApply",          benchFilterBank },
+};
+
+static const char * const errorTypeNames[] = { "absolute", "relative" };
+
+static bool writeJson(const char *path, const std::vector<benchResult_t> &results)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Can't write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"iterations\": %d,\n  \"results\": [\n", benchIterations);
+    for (size_t i = 0; i < results.size(); i++) {
+        const benchResult_t *result = &results[i];
+        fprintf(file, "    { \"name\": \"%s\", \"ns_per_call\": %.3f, \"calls_per_s\": %.0f, \"max_error\": %.9g, \"error_type\": \"%s\" }%s\n",
+            result->name, result->nsPerCall, 1e9 / result->nsPerCall, result->maxError,
+            errorTypeNames[result->errorType], i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *jsonPath = NULL;
+    const char *match = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--json") && hasValue) {
+            jsonPath = argv[++i];
+        } else if (!strcmp(argv[i], "--repeat") && hasValue) {
+            benchRepeat = MAX(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--match") && hasValue) {
+            match = argv[++i];
+        } else if (!strcmp(argv[i], "--quick")) {
+            benchIterations = 10;
+            benchRepeat = 1;
+        } else {
+            fprintf(stderr, "Usage: maths_bench [--json <file>] [--repeat <n>] [--match <text>] [--quick]\n");
+            return 1;
+        }
+    }
+
+    std::vector<benchResult_t> results;
+
+    printf("%-26s %10s %12s %12s\n", "Function", "ns/call", "Mcalls/s", "max error");
+    for (const benchmark_t &benchmark : benchmarks) {
+        if (match && !strstr(benchmark.name, match)) {
+            continue;
+        }
+
+        benchResult_t result = { benchmark.name, 0, 0, ERROR_ABSOLUTE };
+        srand(1);
+        benchmark.run(&result);
+        results.push_back(result);
+
+        printf("%-26s %10.2f %12.1f %12.3g%s\n", result.name, result.nsPerCall, 1e3 / result.nsPerCall,
+            result.maxError, result.errorType == ERROR_RELATIVE ? " rel" : "");
+    }
+
+    if (jsonPath && !writeJson(jsonPath, results)) {
+        return 1;
+    }
+
+    return 0;
+}
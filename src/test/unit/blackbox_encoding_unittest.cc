@@ -0,0 +1,185 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+    #include "blackbox/blackbox_encoding.h"
+    #include "blackbox/blackbox_io.h"
+    #include "common/encoding.h"
+    #include "common/printf.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static std::vector<uint8_t> written;
+
+static std::vector<uint8_t> takeWritten(void)
+{
+    blackboxFrameBufferFlush();
+    std::vector<uint8_t> result = written;
+    written.clear();
+    return result;
+}
+
+// Reads back a block written by blackboxWritePackedBlock()
+static size_t readPackedBlock(const std::vector<uint8_t> &data, int32_t *values, int valueCount, uint8_t *flags)
+{
+    size_t pos = 0;
+    const uint8_t header = data[pos++];
+    const int width = header & 0x3F;
+    uint64_t bitBuffer = 0;
+    int bitCount = 0;
+
+    *flags = header & ~0x3F;
+    for (int i = 0; i < valueCount; i++) {
+        while (bitCount < width) {
+            bitBuffer |= (uint64_t)data[pos++] << bitCount;
+            bitCount += 8;
+        }
+        const uint32_t zigzag = width ? bitBuffer & (UINT64_MAX >> (64 - width)) : 0;
+        bitBuffer >>= width;
+        bitCount -= width;
+        values[i] = (int32_t)((zigzag >> 1) ^ -(int32_t)(zigzag & 1));
+    }
+    return pos;
+}
+
+TEST(BlackboxEncodingUnittest, PackedBlockWidth)
+{
+    const int32_t zeros[4] = { 0, 0, 0, 0 };
+    const int32_t small[4] = { 1, -1, 0, 2 };
+    const int32_t negative[2] = { -64, 3 };
+    const int32_t extremes[2] = { INT32_MIN, INT32_MAX };
+
+    EXPECT_EQ(0, blackboxPackedBlockWidth(zeros, 4));
+    EXPECT_EQ(3, blackboxPackedBlockWidth(small, 4));
+    EXPECT_EQ(7, blackboxPackedBlockWidth(negative, 2));
+    EXPECT_EQ(32, blackboxPackedBlockWidth(extremes, 2));
+}
+
+TEST(BlackboxEncodingUnittest, PackedBlockOfZerosIsOnlyAHeader)
+{
+    const int32_t zeros[BLACKBOX_PACKED_BLOCK_MAX_VALUES] = { 0 };
+
+    blackboxWritePackedBlock(zeros, BLACKBOX_PACKED_BLOCK_MAX_VALUES, 0, BLACKBOX_PACKED_BLOCK_FLAG_LINEAR);
+
+    const std::vector<uint8_t> data = takeWritten();
+    ASSERT_EQ(1u, data.size());
+    EXPECT_EQ(BLACKBOX_PACKED_BLOCK_FLAG_LINEAR, data[0]);
+}
+
+TEST(BlackboxEncodingUnittest, PackedBlockLayout)
+{
+    // ZigZag 1, 2, 3 in 2 bits each: 01 10 11, least significant bit first
+    const int32_t values[3] = { -1, 1, -2 };
+
+    blackboxWritePackedBlock(values, 3, 2, 0);
+
+    const std::vector<uint8_t> data = takeWritten();
+    ASSERT_EQ(2u, data.size());
+    EXPECT_EQ(2, data[0]);
+    EXPECT_EQ(0x39, data[1]);
+}
+
+TEST(BlackboxEncodingUnittest, PackedBlockRoundTrip)
+{
+    const int32_t blocks[][BLACKBOX_PACKED_BLOCK_MAX_VALUES] = {
+        { 0, 1, -1, 2, -2, 3, -3, 4 },
+        { 1000, -1000, 0, 0, 5, -7, 100, -128 },
+        { 123456, -654321, 1, 0, 0, 0, 0, -1 },
+        { INT32_MIN, INT32_MAX, 0, -1, 1, INT32_MIN, 7, -8 },
+    };
+
+    for (const auto &block : blocks) {
+        for (int count = 1; count <= BLACKBOX_PACKED_BLOCK_MAX_VALUES; count++) {
+            const uint8_t width = blackboxPackedBlockWidth(block, count);
+            blackboxWritePackedBlock(block, count, width, 0);
+
+            const std::vector<uint8_t> data = takeWritten();
+            EXPECT_EQ(1u + (count * width + 7) / 8, data.size());
+
+            int32_t decoded[BLACKBOX_PACKED_BLOCK_MAX_VALUES];
+            uint8_t flags;
+            EXPECT_EQ(data.size(), readPackedBlock(data, decoded, count, &flags));
+            EXPECT_EQ(0, flags);
+            for (int i = 0; i < count; i++) {
+                EXPECT_EQ(block[i], decoded[i]);
+            }
+        }
+    }
+}
+
+TEST(BlackboxEncodingUnittest, PackedBlocksSpanFrameBufferFlushes)
+{
+    const int32_t block[BLACKBOX_PACKED_BLOCK_MAX_VALUES] = { 30000, -30000, 1, 2, 3, 4, 5, 6 };
+    const int blockCount = 3 * BLACKBOX_FRAME_BUFFER_SIZE / 16;
+    const uint8_t width = blackboxPackedBlockWidth(block, BLACKBOX_PACKED_BLOCK_MAX_VALUES);
+
+    for (int i = 0; i < blockCount; i++) {
+        blackboxWritePackedBlock(block, BLACKBOX_PACKED_BLOCK_MAX_VALUES, width, 0);
+    }
+
+    const std::vector<uint8_t> data = takeWritten();
+    const size_t blockSize = 1 + BLACKBOX_PACKED_BLOCK_MAX_VALUES * width / 8;
+    ASSERT_EQ(blockCount * blockSize, data.size());
+
+    for (int i = 0; i < blockCount; i++) {
+        const std::vector<uint8_t> one(data.begin() + i * blockSize, data.begin() + (i + 1) * blockSize);
+        int32_t decoded[BLACKBOX_PACKED_BLOCK_MAX_VALUES];
+        uint8_t flags;
+        readPackedBlock(one, decoded, BLACKBOX_PACKED_BLOCK_MAX_VALUES, &flags);
+        for (int j = 0; j < BLACKBOX_PACKED_BLOCK_MAX_VALUES; j++) {
+            EXPECT_EQ(block[j], decoded[j]);
+        }
+    }
+}
+
+// STUBS
+
+extern "C" {
+
+int32_t blackboxHeaderBudget;
+blackboxFrameBuffer_t blackboxFrameBuffer;
+
+void blackboxFrameBufferFlush(void)
+{
+    written.insert(written.end(), blackboxFrameBuffer.data, blackboxFrameBuffer.data + blackboxFrameBuffer.length);
+    blackboxFrameBuffer.length = 0;
+}
+
+int blackboxPrint(const char *s)
+{
+    UNUSED(s);
+    return 0;
+}
+
+int tfp_format(void *putp, void (*putf) (void *, char), const char *fmt, va_list va)
+{
+    UNUSED(putp);
+    UNUSED(putf);
+    UNUSED(fmt);
+    UNUSED(va);
+    return 0;
+}
+
+}
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstring>
+
+extern "C" {
+#include "common/crc.h"
+#include "common/streambuf.h"
+}
+
+#include "gtest/gtest.h"
+
+static const uint8_t checkString[] = "123456789";
+
+// Bitwise reference implementations
+static uint16_t refCrc16Ccitt(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    while (length--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t refCrc8(uint8_t poly, uint8_t crc, const uint8_t *data, uint32_t length)
+{
+    while (length--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ poly : crc << 1;
+        }
+    }
+    return crc;
+}
+
+class CrcTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        uint32_t x = 0x12345678;
+        for (unsigned i = 0; i < sizeof(data); i++) {
+            x = x * 1103515245 + 12345;
+            data[i] = x >> 16;
+        }
+    }
+
+    uint8_t data[300];
+};
+
+TEST_F(CrcTest, TestCheckValues)
+{
+    EXPECT_EQ(0x31C3, crc16_ccitt_update(0, checkString, 9));
+    EXPECT_EQ(0xBC, crc8_dvb_s2_update(0, checkString, 9));
+    EXPECT_EQ(0xF4, crc8_update(0, checkString, 9));
+}
+
+TEST_F(CrcTest, TestCrc16Ccitt)
+{
+    for (uint32_t offset = 0; offset < 4; offset++) {
+        for (uint32_t length = 0; length <= 260; length++) {
+            EXPECT_EQ(refCrc16Ccitt(0x1D0F, data + offset, length), crc16_ccitt_update(0x1D0F, data + offset, length));
+        }
+    }
+
+    uint16_t crc = 0;
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        crc = crc16_ccitt(crc, data[i]);
+    }
+    EXPECT_EQ(refCrc16Ccitt(0, data, sizeof(data)), crc);
+}
+
+TEST_F(CrcTest, TestCrc8DvbS2)
+{
+    for (uint32_t offset = 0; offset < 4; offset++) {
+        for (uint32_t length = 0; length <= 260; length++) {
+            EXPECT_EQ(refCrc8(0xD5, 0x5A, data + offset, length), crc8_dvb_s2_update(0x5A, data + offset, length));
+        }
+    }
+
+    uint8_t crc = 0;
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        crc = crc8_dvb_s2(crc, data[i]);
+    }
+    EXPECT_EQ(refCrc8(0xD5, 0, data, sizeof(data)), crc);
+}
+
+TEST_F(CrcTest, TestCrc8)
+{
+    for (uint32_t length = 0; length <= 64; length++) {
+        EXPECT_EQ(refCrc8(0x07, 0x11, data, length), crc8_update(0x11, data, length));
+    }
+}
+
+TEST_F(CrcTest, TestCrc8Xor)
+{
+    for (uint32_t offset = 0; offset < 4; offset++) {
+        for (uint32_t length = 0; length <= 64; length++) {
+            uint8_t expected = 0x3C;
+            for (uint32_t i = 0; i < length; i++) {
+                expected ^= data[offset + i];
+            }
+            EXPECT_EQ(expected, crc8_xor_update(0x3C, data + offset, length));
+        }
+    }
+}
+
+TEST_F(CrcTest, TestSbufAppend)
+{
+    uint8_t frame[32];
+    sbuf_t buf = { .ptr = frame, .end = frame + sizeof(frame) };
+
+    sbufWriteData(&buf, checkString, 9);
+    crc8_dvb_s2_sbuf_append(&buf, frame);
+    EXPECT_EQ(10, buf.ptr - frame);
+    EXPECT_EQ(0xBC, frame[9]);
+
+    buf.ptr = frame;
+    sbufWriteData(&buf, checkString, 9);
+    crc16_ccitt_sbuf_append(&buf, frame);
+    EXPECT_EQ(0xC3, frame[9]);
+    EXPECT_EQ(0x31, frame[10]);
+}
@@ -0,0 +1,159 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <math.h>
+
+extern "C" {
+    #include "platform.h"
+    #include "common/axis.h"
+    #include "common/filter.h"
+    #include "common/maths.h"
+    #include "common/time.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define LOOPTIME_US     1000
+#define SAMPLE_COUNT    200
+
+static float testInput(int sample, int axis)
+{
+    // Step on the first axis, noisy ramp on the other two
+    switch (axis) {
+        case X:
+            return sample < 20 ? 0.0f : 100.0f;
+        case Y:
+            return sample * 0.5f + ((sample % 3) - 1) * 10.0f;
+        default:
+            return (sample % 7) * -25.0f;
+    }
+}
+
+TEST(FilterUnittest, BankPt1MatchesReference)
+{
+    filterBank_t bank;
+    pt1Filter_t reference[XYZ_AXIS_COUNT];
+
+    filterBankInit(&bank);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT1, 80, LOOPTIME_US), 0);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        pt1FilterInit(&reference[axis], 80, US2S(LOOPTIME_US));
+    }
+
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        float values[XYZ_AXIS_COUNT];
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            values[axis] = testInput(i, axis);
+        }
+        filterBankApply(&bank, values);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            EXPECT_NEAR(values[axis], pt1FilterApply(&reference[axis], testInput(i, axis)), 1e-3f);
+        }
+    }
+}
+
+TEST(FilterUnittest, BankPt2Pt3MatchReference)
+{
+    filterBank_t bank;
+    pt2Filter_t pt2[XYZ_AXIS_COUNT];
+    pt3Filter_t pt3[XYZ_AXIS_COUNT];
+
+    filterBankInit(&bank);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT2, 120, LOOPTIME_US), 0);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT3, 60, LOOPTIME_US), 1);
+    EXPECT_EQ(bank.sectionCount, 3);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        pt2FilterInit(&pt2[axis], pt2FilterGain(120, US2S(LOOPTIME_US)));
+        pt3FilterInit(&pt3[axis], pt3FilterGain(60, US2S(LOOPTIME_US)));
+    }
+
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        float values[XYZ_AXIS_COUNT];
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            values[axis] = testInput(i, axis);
+        }
+        filterBankApply(&bank, values);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            const float expected = pt3FilterApply(&pt3[axis], pt2FilterApply(&pt2[axis], testInput(i, axis)));
+            EXPECT_NEAR(values[axis], expected, 1e-3f);
+        }
+    }
+}
+
+TEST(FilterUnittest, BankBiquadMatchesReference)
+{
+    filterBank_t bank;
+    biquadFilter_t reference[XYZ_AXIS_COUNT];
+
+    filterBankInit(&bank);
+    const int8_t stage = filterBankAddLowpass(&bank, FILTER_BIQUAD, 100, LOOPTIME_US);
+    EXPECT_EQ(stage, 0);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        biquadFilterInitLPF(&reference[axis], 100, LOOPTIME_US);
+    }
+
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        // Cutoff changes half way through, as the dynamic gyro LPF does
+        if (i == SAMPLE_COUNT / 2) {
+            filterBankUpdateLowpass(&bank, stage, FILTER_BIQUAD, 150, LOOPTIME_US);
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                biquadFilterUpdate(&reference[axis], 150, LOOPTIME_US, BIQUAD_Q, FILTER_LPF);
+            }
+        }
+
+        float values[XYZ_AXIS_COUNT];
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            values[axis] = testInput(i, axis);
+        }
+        filterBankApply(&bank, values);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            EXPECT_NEAR(values[axis], biquadFilterApply(&reference[axis], testInput(i, axis)), 1e-3f);
+        }
+    }
+}
+
+TEST(FilterUnittest, BankPassThrough)
+{
+    filterBank_t bank;
+
+    filterBankInit(&bank);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_BIQUAD, 0, LOOPTIME_US), -1);
+    EXPECT_EQ(bank.sectionCount, 0);
+
+    float values[XYZ_AXIS_COUNT] = { 1.0f, -2.0f, 3.0f };
+    filterBankApply(&bank, values);
+    EXPECT_FLOAT_EQ(values[X], 1.0f);
+    EXPECT_FLOAT_EQ(values[Y], -2.0f);
+    EXPECT_FLOAT_EQ(values[Z], 3.0f);
+}
+
+TEST(FilterUnittest, BankFull)
+{
+    filterBank_t bank;
+
+    filterBankInit(&bank);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT3, 50, LOOPTIME_US), 0);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT1, 50, LOOPTIME_US), 2);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT3, 50, LOOPTIME_US), -1);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT2, 50, LOOPTIME_US), 3);
+    EXPECT_EQ(filterBankAddLowpass(&bank, FILTER_PT2, 50, LOOPTIME_US), -1);
+    EXPECT_EQ(bank.sectionCount, FILTER_BANK_MAX_SECTIONS);
+}
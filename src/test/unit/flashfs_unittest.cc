@@ -0,0 +1,286 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+    #include "common/maths.h"
+    #include "common/utils.h"
+    #include "drivers/flash.h"
+    #include "io/flashfs.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// A NOR chip of 16 sectors, the last two of them hold the log index
+#define PAGE_SIZE           256
+#define SECTOR_SIZE         4096
+#define SECTOR_COUNT        16
+#define INDEX_FIRST_SECTOR  14
+#define INDEX_SLOT_SIZE     16
+
+static const flashGeometry_t testGeometry = {
+    .sectors = SECTOR_COUNT,
+    .pageSize = PAGE_SIZE,
+    .sectorSize = SECTOR_SIZE,
+    .totalSize = SECTOR_SIZE * SECTOR_COUNT,
+    .pagesPerSector = SECTOR_SIZE / PAGE_SIZE,
+    .flashType = FLASH_TYPE_NOR,
+};
+
+static flashPartition_t testPartitions[] = {
+    { FLASH_PARTITION_TYPE_FLASHFS, 0, INDEX_FIRST_SECTOR - 1 },
+    { FLASH_PARTITION_TYPE_FLASHFS_LOG_INDEX, INDEX_FIRST_SECTOR, SECTOR_COUNT - 1 },
+};
+
+static uint8_t flashMemory[SECTOR_SIZE * SECTOR_COUNT];
+
+static void writeLog(uint32_t time, uint8_t flags, int length, bool finish)
+{
+    uint8_t data[100];
+
+    flashfsLogStart(time, flags);
+    for (int written = 0; written < length; written += sizeof(data)) {
+        memset(data, written / sizeof(data), sizeof(data));
+        flashfsWrite(data, MIN(sizeof(data), (unsigned)(length - written)), false);
+    }
+    flashfsFlushSync();
+    flashfsClose();
+    if (finish) {
+        flashfsLogFinish();
+    }
+}
+
+class FlashfsLogIndexTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        memset(flashMemory, 0xFF, sizeof(flashMemory));
+        flashfsInit();
+    }
+};
+
+TEST_F(FlashfsLogIndexTest, EmptyIndex)
+{
+    flashfsLogEntry_t entry;
+    flashfsLogIterator_t iterator;
+
+    flashfsLogIteratorInit(&iterator);
+    EXPECT_FALSE(flashfsLogIteratorNext(&iterator, &entry));
+    EXPECT_EQ(0, flashfsLogGetEntries(0, &entry, 1));
+    EXPECT_EQ(0U, flashfsGetOffset());
+}
+
+TEST_F(FlashfsLogIndexTest, ListsFinishedLogs)
+{
+    flashfsLogEntry_t entries[3];
+
+    writeLog(1000, 1, 1234, true);
+    writeLog(2000, 2, 500, true);
+
+    ASSERT_EQ(2, flashfsLogGetEntries(0, entries, 3));
+
+    EXPECT_EQ(0U, entries[0].start);
+    EXPECT_EQ(1234U, entries[0].length);
+    EXPECT_EQ(1000U, entries[0].time);
+    EXPECT_EQ(1, entries[0].flags);
+    EXPECT_TRUE(entries[0].finished);
+
+    EXPECT_EQ(1234U, entries[1].start);
+    EXPECT_EQ(500U, entries[1].length);
+    EXPECT_EQ(2000U, entries[1].time);
+    EXPECT_EQ(2, entries[1].flags);
+    EXPECT_TRUE(entries[1].finished);
+
+    // The end of the last log is found again after a reboot
+    flashfsInit();
+    EXPECT_EQ(1734U, flashfsGetOffset());
+}
+
+TEST_F(FlashfsLogIndexTest, GetEntriesFillsWindow)
+{
+    flashfsLogEntry_t entries[2];
+
+    for (int i = 0; i < 5; i++) {
+        writeLog(i, i, 100, true);
+    }
+
+    // The total count comes back, only the window from `first` is filled
+    memset(entries, 0, sizeof(entries));
+    EXPECT_EQ(5, flashfsLogGetEntries(3, entries, 2));
+    EXPECT_EQ(300U, entries[0].start);
+    EXPECT_EQ(400U, entries[1].start);
+
+    EXPECT_EQ(5, flashfsLogGetEntries(4, entries, 2));
+    EXPECT_EQ(400U, entries[0].start);
+
+    EXPECT_EQ(5, flashfsLogGetEntries(7, entries, 2));
+}
+
+TEST_F(FlashfsLogIndexTest, UnfinishedLogs)
+{
+    flashfsLogEntry_t entries[3];
+
+    // Power lost while logging, the free space search finds the end of the log
+    writeLog(1, 0, 700, false);
+    flashfsInit();
+    EXPECT_EQ(2048U, flashfsGetOffset());
+
+    writeLog(2, 0, 300, true);
+    writeLog(3, 0, 200, false);
+
+    ASSERT_EQ(3, flashfsLogGetEntries(0, entries, 3));
+
+    // An unfinished log lasts until the next one started
+    EXPECT_FALSE(entries[0].finished);
+    EXPECT_EQ(0U, entries[0].start);
+    EXPECT_EQ(2048U, entries[0].length);
+
+    EXPECT_TRUE(entries[1].finished);
+    EXPECT_EQ(2048U, entries[1].start);
+    EXPECT_EQ(300U, entries[1].length);
+
+    // The last one is still being written to
+    EXPECT_FALSE(entries[2].finished);
+    EXPECT_EQ(2348U, entries[2].start);
+    EXPECT_EQ(200U, entries[2].length);
+}
+
+TEST_F(FlashfsLogIndexTest, SkipsDamagedRecords)
+{
+    flashfsLogEntry_t entries[3];
+    flashfsLogIterator_t iterator;
+
+    writeLog(1, 0, 100, true);
+    writeLog(2, 0, 100, true);
+    writeLog(3, 0, 100, true);
+
+    // Lose the START record of the second log to a power loss while it was programmed
+    flashMemory[INDEX_FIRST_SECTOR * SECTOR_SIZE + 2 * INDEX_SLOT_SIZE + 8] = 0;
+
+    ASSERT_EQ(2, flashfsLogGetEntries(0, entries, 3));
+    EXPECT_EQ(1U, entries[0].time);
+    EXPECT_TRUE(entries[0].finished);
+    EXPECT_EQ(3U, entries[1].time);
+    EXPECT_EQ(200U, entries[1].start);
+    EXPECT_TRUE(entries[1].finished);
+
+    // The iterator gives the same logs
+    flashfsLogIteratorInit(&iterator);
+    for (int i = 0; i < 2; i++) {
+        ASSERT_TRUE(flashfsLogIteratorNext(&iterator, &entries[2]));
+        EXPECT_EQ(entries[i].start, entries[2].start);
+        EXPECT_EQ(entries[i].length, entries[2].length);
+    }
+    EXPECT_FALSE(flashfsLogIteratorNext(&iterator, &entries[2]));
+}
+
+TEST_F(FlashfsLogIndexTest, EraseClearsIndex)
+{
+    flashfsLogEntry_t entry;
+
+    writeLog(1, 0, 100, true);
+    flashfsEraseCompletely();
+
+    EXPECT_EQ(0, flashfsLogGetEntries(0, &entry, 1));
+
+    writeLog(2, 0, 100, true);
+    ASSERT_EQ(1, flashfsLogGetEntries(0, &entry, 1));
+    EXPECT_EQ(0U, entry.start);
+    EXPECT_EQ(2U, entry.time);
+}
+
+// STUBS
+
+extern "C" {
+
+bool flashIsReady(void)
+{
+    return true;
+}
+
+void flashEraseSector(uint32_t address)
+{
+    memset(flashMemory + address / SECTOR_SIZE * SECTOR_SIZE, 0xFF, SECTOR_SIZE);
+}
+
+void flashEraseCompletely(void)
+{
+    memset(flashMemory, 0xFF, sizeof(flashMemory));
+}
+
+uint32_t flashPageProgram(uint32_t address, const uint8_t *data, int length)
+{
+    // Programming can only clear bits
+    for (int i = 0; i < length; i++) {
+        flashMemory[address + i] &= data[i];
+    }
+    return address + length;
+}
+
+uint32_t flashPageProgramMultiple(uint32_t address, const uint8_t **buffers, const uint32_t *bufferSizes, int bufferCount)
+{
+    for (int i = 0; i < bufferCount; i++) {
+        address = flashPageProgram(address, buffers[i], bufferSizes[i]);
+    }
+    return address;
+}
+
+int flashReadBytes(uint32_t address, uint8_t *buffer, int length)
+{
+    memcpy(buffer, flashMemory + address, length);
+    return length;
+}
+
+void flashFlush(void)
+{
+}
+
+const flashGeometry_t *flashGetGeometry(void)
+{
+    return &testGeometry;
+}
+
+flashPartition_t *flashPartitionFindByType(flashPartitionType_e type)
+{
+    for (unsigned i = 0; i < ARRAYLEN(testPartitions); i++) {
+        if (testPartitions[i].type == type) {
+            return &testPartitions[i];
+        }
+    }
+    return NULL;
+}
+
+int flashPartitionCount(void)
+{
+    return ARRAYLEN(testPartitions);
+}
+
+uint32_t flashPartitionSize(flashPartition_t *partition)
+{
+    return FLASH_PARTITION_SECTOR_COUNT(partition) * SECTOR_SIZE;
+}
+
+void flashPartitionErase(flashPartition_t *partition)
+{
+    memset(flashMemory + partition->startSector * SECTOR_SIZE, 0xFF, flashPartitionSize(partition));
+}
+
+}
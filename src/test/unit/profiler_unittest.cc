@@ -0,0 +1,115 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern "C" {
+    #include "platform.h"
+    #include "build/debug.h"
+    #include "build/profiler.h"
+    #include "drivers/time.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static uint32_t fakeTicks;
+
+// One loop, stages take the given number of ticks, negative ones are skipped
+static void runLoop(const int32_t *stageTicks)
+{
+    profilerStart();
+    for (int stage = 0; stage < PROFILER_STAGE_COUNT; stage++) {
+        if (stageTicks[stage] >= 0) {
+            fakeTicks += stageTicks[stage];
+            profilerMark((profilerStage_e)stage);
+        }
+    }
+    profilerFinish();
+}
+
+TEST(ProfilerUnittest, StageStatistics)
+{
+    const int32_t loop1[PROFILER_STAGE_COUNT] = { 100, 200, 10, 500, 1000, 300, 50, 7000 };
+    const int32_t loop2[PROFILER_STAGE_COUNT] = { 300, 200, 10, 500, 1000, 300, 50, -1 };
+    profilerStageStats_t stats;
+
+    profilerReset();
+    runLoop(loop1);
+    runLoop(loop2);
+
+    profilerGetStageStats(PROFILER_STAGE_GYRO_FILTER, &stats);
+    EXPECT_EQ(2u, stats.count);
+    EXPECT_EQ(100u, stats.minTicks);
+    EXPECT_EQ(300u, stats.maxTicks);
+    EXPECT_EQ(400u, stats.totalTicks);
+    // 100 ticks is in [64, 128), 300 in [256, 512)
+    EXPECT_EQ(1, stats.histogram[1]);
+    EXPECT_EQ(1, stats.histogram[3]);
+    EXPECT_EQ(64u, profilerHistogramBucketLowerBound(1));
+    EXPECT_EQ(256u, profilerHistogramBucketLowerBound(3));
+
+    // Below the first bucket bound
+    profilerGetStageStats(PROFILER_STAGE_RC, &stats);
+    EXPECT_EQ(2, stats.histogram[0]);
+
+    // Not run in the second loop
+    profilerGetStageStats(PROFILER_STAGE_BLACKBOX, &stats);
+    EXPECT_EQ(1u, stats.count);
+    EXPECT_EQ(7000u, stats.maxTicks);
+}
+
+TEST(ProfilerUnittest, RepeatedMarkAccumulates)
+{
+    profilerStageStats_t stats;
+
+    profilerReset();
+    profilerStart();
+    fakeTicks += 40;
+    profilerMark(PROFILER_STAGE_NAVIGATION);
+    fakeTicks += 1000;
+    profilerMark(PROFILER_STAGE_PID);
+    fakeTicks += 60;
+    profilerMark(PROFILER_STAGE_NAVIGATION);
+    profilerFinish();
+
+    profilerGetStageStats(PROFILER_STAGE_NAVIGATION, &stats);
+    EXPECT_EQ(1u, stats.count);
+    EXPECT_EQ(100u, stats.totalTicks);
+}
+
+TEST(ProfilerUnittest, DebugValuesInNanoseconds)
+{
+    const int32_t loop[PROFILER_STAGE_COUNT] = { 168, 336, 0, 0, 168000, 0, 0, 0 };
+
+    usTicks = 168;
+    debugMode = DEBUG_LOOP_STAGES;
+    runLoop(loop);
+
+    EXPECT_EQ(1000, debug[PROFILER_STAGE_GYRO_FILTER]);
+    EXPECT_EQ(2000, debug[PROFILER_STAGE_IMU]);
+    EXPECT_EQ(1000000, debug[PROFILER_STAGE_PID]);
+    EXPECT_EQ(1000000u, profilerTicksToNs(168000));
+}
+
+// STUBS
+
+extern "C" {
+uint32_t usTicks = 168;
+uint32_t ticks(void) { return fakeTicks; }
+}
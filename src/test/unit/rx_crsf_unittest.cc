@@ -0,0 +1,318 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/maths.h"
+    #include "common/utils.h"
+
+    #include "drivers/serial.h"
+
+    #include "io/serial.h"
+
+    #include "rx/rx.h"
+    #include "rx/crsf.h"
+
+    extern bool crsfFrameDone;
+    extern crsfFrame_t crsfFrame;
+    extern uint32_t crsfChannelData[CRSF_MAX_CHANNEL];
+
+    uint32_t crsfProcessReceivedSpan(const uint8_t *data, uint32_t count, uint32_t bytesWaiting);
+    bool crsfReceiveFrame(void);
+    uint8_t crsfFrameStatus(rxRuntimeConfig_t *rxRuntimeConfig);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+static timeUs_t fakeMicros;
+
+// RX ring of the fake serial port, serialPeekContiguous() hands out at most fakeRxSpanLimit bytes at a time
+static bytes_t fakeRx;
+static uint32_t fakeRxSpanLimit = 1000;
+static bytes_t fakeTx;
+static serialPort_t fakePort;
+static serialPortConfig_t fakePortConfig;
+
+static bytes_t crsfBuildFrame(uint8_t type, const bytes_t& payload)
+{
+    bytes_t frame = { CRSF_SYNC_BYTE, (uint8_t)(payload.size() + CRSF_FRAME_LENGTH_TYPE_CRC), type };
+
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.push_back(crc8_dvb_s2_update(0, &frame[2], payload.size() + CRSF_FRAME_LENGTH_TYPE));
+    return frame;
+}
+
+// RC channels frame with all 16 channels at the given 11 bit value
+static bytes_t crsfBuildRcFrame(uint16_t value)
+{
+    bytes_t payload(CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE, 0);
+
+    for (int bit = 0; bit < 16 * 11; bit++) {
+        if (value & (1 << (bit % 11))) {
+            payload[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+    return crsfBuildFrame(CRSF_FRAMETYPE_RC_CHANNELS_PACKED, payload);
+}
+
+static bytes_t crsfBuildLinkStatisticsFrame(void)
+{
+    return crsfBuildFrame(CRSF_FRAMETYPE_LINK_STATISTICS, bytes_t(CRSF_FRAME_LINK_STATISTICS_PAYLOAD_SIZE, 0x20));
+}
+
+static bytes_t operator+(bytes_t a, const bytes_t& b)
+{
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+
+static uint32_t processSpan(const bytes_t& data, uint32_t offset = 0, uint32_t count = UINT32_MAX)
+{
+    count = MIN(count, (uint32_t)data.size() - offset);
+    return crsfProcessReceivedSpan(data.data() + offset, count, data.size() - offset);
+}
+
+static bool receivedFrameIs(const bytes_t& frame)
+{
+    return crsfFrameDone && !memcmp(crsfFrame.bytes, frame.data(), frame.size());
+}
+
+class CrsfRxTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        fakeMicros = 100000;
+        fakeRx.clear();
+        fakeRxSpanLimit = 1000;
+        fakeTx.clear();
+        memset(&fakePort, 0, sizeof(fakePort));
+        memset(&fakePortConfig, 0, sizeof(fakePortConfig));
+        crsfFrameDone = false;
+    }
+};
+
+TEST_F(CrsfRxTest, FrameSplitAcrossSpans)
+{
+    const bytes_t frame = crsfBuildRcFrame(992);
+
+    // The sync byte alone, part of the header, then the payload in small pieces
+    uint32_t offset = 0;
+    for (uint32_t count : { 1, 1, 2, 7, 11 }) {
+        EXPECT_EQ(count, processSpan(frame, offset, count));
+        EXPECT_FALSE(crsfFrameDone);
+        offset += count;
+    }
+
+    EXPECT_EQ(frame.size() - offset, processSpan(frame, offset));
+    EXPECT_TRUE(receivedFrameIs(frame));
+}
+
+TEST_F(CrsfRxTest, NoiseBeforeSyncByte)
+{
+    const bytes_t frame = crsfBuildRcFrame(172);
+    const bytes_t noise = { 0x00, 0x55, 0xff, 0x16, 0x18 };
+
+    // Noise without a sync byte is consumed and dropped
+    EXPECT_EQ(noise.size(), processSpan(noise));
+    EXPECT_FALSE(crsfFrameDone);
+
+    // A sync byte in the noise whose frame doesn't check out is dropped too
+    const bytes_t data = noise + bytes_t{ CRSF_SYNC_BYTE, 0x04, 0x01, 0x02 } + noise + frame;
+    EXPECT_EQ(data.size(), processSpan(data));
+    EXPECT_TRUE(receivedFrameIs(frame));
+}
+
+TEST_F(CrsfRxTest, BadLengthByte)
+{
+    const bytes_t frame = crsfBuildRcFrame(1811);
+
+    // Longer than the longest frame
+    EXPECT_EQ(2u, processSpan(bytes_t{ CRSF_SYNC_BYTE, CRSF_FRAME_SIZE_MAX - 1 }));
+    EXPECT_FALSE(crsfFrameDone);
+    EXPECT_EQ(frame.size(), processSpan(frame));
+    EXPECT_TRUE(receivedFrameIs(frame));
+
+    // Shorter than type and CRC
+    crsfFrameDone = false;
+    const bytes_t data = bytes_t{ CRSF_SYNC_BYTE, 1 } + frame;
+    EXPECT_EQ(data.size(), processSpan(data));
+    EXPECT_TRUE(receivedFrameIs(frame));
+}
+
+TEST_F(CrsfRxTest, BadCrc)
+{
+    const bytes_t frame = crsfBuildRcFrame(500);
+    bytes_t damaged = crsfBuildRcFrame(600);
+
+    damaged[10] ^= 0x01;
+
+    EXPECT_EQ(damaged.size(), processSpan(damaged));
+    EXPECT_FALSE(crsfFrameDone);
+
+    // A frame following the damaged one in the same span is still found
+    const bytes_t data = damaged + frame;
+    EXPECT_EQ(data.size(), processSpan(data));
+    EXPECT_TRUE(receivedFrameIs(frame));
+}
+
+TEST_F(CrsfRxTest, TwoFramesInOneSpan)
+{
+    const bytes_t first = crsfBuildLinkStatisticsFrame();
+    const bytes_t second = crsfBuildRcFrame(1200);
+    const bytes_t data = first + second;
+
+    // Parsing stops after the first frame, the rest of the span is left for the next call
+    EXPECT_EQ(first.size(), processSpan(data));
+    EXPECT_TRUE(receivedFrameIs(first));
+
+    crsfFrameDone = false;
+    EXPECT_EQ(second.size(), processSpan(data, first.size()));
+    EXPECT_TRUE(receivedFrameIs(second));
+}
+
+TEST_F(CrsfRxTest, ReceiveFrameFromSerialPort)
+{
+    rxRuntimeConfig_t rxRuntimeConfig;
+    rxConfig_t rxConfig;
+
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    ASSERT_TRUE(crsfRxInit(&rxConfig, &rxRuntimeConfig));
+
+    const bytes_t rcFrame = crsfBuildRcFrame(1811);
+    const bytes_t data = bytes_t{ 0x12, 0x34 } + crsfBuildLinkStatisticsFrame() + rcFrame;
+
+    // The port hands out its buffer in pieces, like a ring buffer that wraps around
+    fakeRxSpanLimit = 7;
+
+    // Nothing complete yet
+    fakeRx.assign(data.begin(), data.begin() + 9);
+    EXPECT_FALSE(crsfReceiveFrame());
+    EXPECT_TRUE(fakeRx.empty());
+
+    // Both frames are handled in one call, the RC channels of the last one are taken
+    fakeRx.assign(data.begin() + 9, data.end());
+    EXPECT_EQ(RX_FRAME_COMPLETE, crsfFrameStatus(&rxRuntimeConfig) & RX_FRAME_COMPLETE);
+    EXPECT_EQ(1811u, crsfChannelData[0]);
+    EXPECT_EQ(1811u, crsfChannelData[15]);
+    EXPECT_TRUE(fakeRx.empty());
+    EXPECT_FALSE(crsfReceiveFrame());
+}
+
+TEST_F(CrsfRxTest, TelemetryWaitsWhileBytesAreWaiting)
+{
+    rxRuntimeConfig_t rxRuntimeConfig;
+    rxConfig_t rxConfig;
+    const uint8_t telemetry[] = { CRSF_SYNC_BYTE, 0x03, 0x08, 0x00, 0x00 };
+
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    rxConfig.halfDuplex = TRISTATE_ON;
+    ASSERT_TRUE(crsfRxInit(&rxConfig, &rxRuntimeConfig));
+
+    const bytes_t frame = crsfBuildRcFrame(992);
+    fakeRx = frame;
+    EXPECT_TRUE(crsfReceiveFrame());
+    crsfFrameDone = false;
+
+    // Past the end of the frame and well before the next one is due
+    fakeMicros += 2000;
+    crsfRxWriteTelemetryData(telemetry, sizeof(telemetry));
+
+    // A new frame has started to arrive but isn't parsed yet
+    fakeRx = bytes_t(frame.begin(), frame.begin() + 3);
+    crsfRxSendTelemetryData();
+    EXPECT_TRUE(fakeTx.empty());
+
+    fakeRx.clear();
+    crsfRxSendTelemetryData();
+    EXPECT_EQ(sizeof(telemetry), fakeTx.size());
+}
+
+// STUBS
+
+extern "C" {
+
+rxLinkStatistics_t rxLinkStatistics;
+
+timeUs_t micros(void)
+{
+    return fakeMicros;
+}
+
+serialPortConfig_t *findSerialPortConfig(serialPortFunction_e function)
+{
+    UNUSED(function);
+    return &fakePortConfig;
+}
+
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr rxCallback,
+    void *rxCallbackData, uint32_t baudrate, portMode_t mode, portOptions_t options)
+{
+    UNUSED(identifier);
+    UNUSED(function);
+    UNUSED(rxCallback);
+    UNUSED(rxCallbackData);
+    UNUSED(baudrate);
+
+    fakePort.mode = mode;
+    fakePort.options = options;
+    return &fakePort;
+}
+
+uint32_t serialRxBytesWaiting(const serialPort_t *instance)
+{
+    UNUSED(instance);
+    return fakeRx.size();
+}
+
+uint32_t serialPeekContiguous(serialPort_t *instance, const uint8_t **data)
+{
+    UNUSED(instance);
+    *data = fakeRx.data();
+    return MIN((uint32_t)fakeRx.size(), fakeRxSpanLimit);
+}
+
+void serialSkip(serialPort_t *instance, uint32_t count)
+{
+    UNUSED(instance);
+    fakeRx.erase(fakeRx.begin(), fakeRx.begin() + count);
+}
+
+uint8_t serialRead(serialPort_t *instance)
+{
+    UNUSED(instance);
+    const uint8_t c = fakeRx.front();
+    fakeRx.erase(fakeRx.begin());
+    return c;
+}
+
+void serialWriteBuf(serialPort_t *instance, const uint8_t *data, int count)
+{
+    UNUSED(instance);
+    fakeTx.insert(fakeTx.end(), data, data + count);
+}
+
+}
@@ -0,0 +1,343 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+    #include "scheduler/scheduler.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+enum {
+    pidTime = 100,
+    gyroTime = 20,
+    rxTime = 30,
+    serialTime = 50,
+    batteryTime = 10,
+    temperatureTime = 10,
+    gpsTime = 40,
+};
+
+extern "C" {
+    // set up micros() to simulate time
+    timeUs_t simulatedTime = 0;
+    timeUs_t micros(void) { return simulatedTime; }
+
+    // tasks take a representative time and record when they ran
+    std::vector<cfTaskId_e> executedTasks;
+
+    static void runTask(cfTaskId_e taskId, timeUs_t executionTime)
+    {
+        executedTasks.push_back(taskId);
+        simulatedTime += executionTime;
+    }
+
+    void taskSystemLoad(timeUs_t currentTimeUs) { runTask(TASK_SYSTEM, 0); taskSystem(currentTimeUs); }
+    void taskPid(timeUs_t) { runTask(TASK_PID, pidTime); }
+    void taskGyro(timeUs_t) { runTask(TASK_GYRO, gyroTime); }
+    void taskRx(timeUs_t) { runTask(TASK_RX, rxTime); }
+    void taskSerial(timeUs_t) { runTask(TASK_SERIAL, serialTime); }
+    void taskBattery(timeUs_t) { runTask(TASK_BATTERY, batteryTime); }
+    void taskTemperature(timeUs_t) { runTask(TASK_TEMPERATURE, temperatureTime); }
+    void taskGps(timeUs_t) { runTask(TASK_GPS, gpsTime); }
+
+    bool rxSignalled = false;
+    bool taskRxCheck(timeUs_t, timeDelta_t) { return rxSignalled; }
+
+    void taskRunRealtimeCallbacks(timeUs_t) {}
+
+    // Tasks in cfTaskId_e order, the ones after TASK_GPS have no function and can't be enabled
+    #define DEFINE_TASK(name, check, func, period, priority) \
+        { name, check, func, period, priority, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+
+    cfTask_t cfTasks[TASK_COUNT] = {
+        DEFINE_TASK("SYSTEM", NULL, taskSystemLoad, TASK_PERIOD_HZ(10), TASK_PRIORITY_HIGH),
+        DEFINE_TASK("PID", NULL, taskPid, TASK_PERIOD_US(1000), TASK_PRIORITY_REALTIME),
+        DEFINE_TASK("GYRO", NULL, taskGyro, TASK_PERIOD_US(1000), TASK_PRIORITY_REALTIME),
+        DEFINE_TASK("RX", taskRxCheck, taskRx, TASK_PERIOD_HZ(10), TASK_PRIORITY_HIGH),
+        DEFINE_TASK("SERIAL", NULL, taskSerial, TASK_PERIOD_HZ(100), TASK_PRIORITY_LOW),
+        DEFINE_TASK("BATTERY", NULL, taskBattery, TASK_PERIOD_HZ(50), TASK_PRIORITY_MEDIUM),
+        DEFINE_TASK("TEMPERATURE", NULL, taskTemperature, TASK_PERIOD_HZ(100), TASK_PRIORITY_LOW),
+        DEFINE_TASK("GPS", NULL, taskGps, TASK_PERIOD_HZ(50), TASK_PRIORITY_MEDIUM),
+        DEFINE_TASK("COMPASS", NULL, NULL, TASK_PERIOD_HZ(10), TASK_PRIORITY_LOW),
+    };
+
+    extern cfTask_t *taskQueueArray[];
+
+    extern void queueClear(void);
+    extern int queueSize(void);
+    extern bool queueContains(cfTask_t *task);
+    extern bool queueAdd(cfTask_t *task);
+    extern bool queueRemove(cfTask_t *task);
+    extern cfTask_t *queueFirst(void);
+    extern cfTask_t *queueNext(void);
+}
+
+static void enableOnly(std::initializer_list<cfTaskId_e> taskIds, timeUs_t lastExecutedAt)
+{
+    queueClear();
+    for (const cfTaskId_e taskId : taskIds) {
+        cfTasks[taskId].lastExecutedAt = lastExecutedAt;
+        cfTasks[taskId].dynamicPriority = 0;
+        setTaskEnabled(taskId, true);
+    }
+    rxSignalled = false;
+    executedTasks.clear();
+}
+
+// The due time is the heap key, so the task is taken out while it changes
+static void setLastExecutedAt(cfTaskId_e taskId, timeUs_t lastExecutedAt)
+{
+    setTaskEnabled(taskId, false);
+    cfTasks[taskId].lastExecutedAt = lastExecutedAt;
+    setTaskEnabled(taskId, true);
+}
+
+// Runs the scheduler in steps of 1us until the time given, returns the tasks that ran
+static std::vector<cfTaskId_e> runUntil(timeUs_t endTime)
+{
+    executedTasks.clear();
+    while (simulatedTime < endTime) {
+        const timeUs_t before = simulatedTime;
+        scheduler();
+        if (simulatedTime == before) {
+            simulatedTime++;
+        }
+    }
+    return executedTasks;
+}
+
+TEST(SchedulerUnittest, TestQueueOrderedByPriority)
+{
+    queueClear();
+    EXPECT_EQ(0, queueSize());
+    EXPECT_EQ(NULL, queueFirst());
+
+    queueAdd(&cfTasks[TASK_SERIAL]);        // LOW
+    queueAdd(&cfTasks[TASK_PID]);           // REALTIME
+    queueAdd(&cfTasks[TASK_BATTERY]);       // MEDIUM
+    queueAdd(&cfTasks[TASK_SYSTEM]);        // HIGH
+    queueAdd(&cfTasks[TASK_TEMPERATURE]);   // LOW, after SERIAL
+
+    EXPECT_EQ(5, queueSize());
+    EXPECT_EQ(&cfTasks[TASK_PID], queueFirst());
+    EXPECT_EQ(&cfTasks[TASK_SYSTEM], queueNext());
+    EXPECT_EQ(&cfTasks[TASK_BATTERY], queueNext());
+    EXPECT_EQ(&cfTasks[TASK_SERIAL], queueNext());
+    EXPECT_EQ(&cfTasks[TASK_TEMPERATURE], queueNext());
+    EXPECT_EQ(NULL, queueNext());
+
+    // adding twice is refused
+    EXPECT_FALSE(queueAdd(&cfTasks[TASK_PID]));
+    EXPECT_EQ(5, queueSize());
+
+    EXPECT_TRUE(queueRemove(&cfTasks[TASK_BATTERY]));
+    EXPECT_FALSE(queueRemove(&cfTasks[TASK_BATTERY]));
+    EXPECT_EQ(4, queueSize());
+    EXPECT_EQ(&cfTasks[TASK_PID], queueFirst());
+    EXPECT_EQ(&cfTasks[TASK_SYSTEM], queueNext());
+    EXPECT_EQ(&cfTasks[TASK_SERIAL], queueNext());
+    EXPECT_EQ(&cfTasks[TASK_TEMPERATURE], queueNext());
+    EXPECT_EQ(NULL, queueNext());
+}
+
+TEST(SchedulerUnittest, TestTasksWithoutFunctionAreNotEnabled)
+{
+    queueClear();
+    setTaskEnabled(TASK_COMPASS, true);
+    EXPECT_EQ(0, queueSize());
+
+    cfTaskInfo_t taskInfo;
+    getTaskInfo(TASK_COMPASS, &taskInfo);
+    EXPECT_FALSE(taskInfo.isEnabled);
+}
+
+TEST(SchedulerUnittest, TestNothingRunsBeforeDue)
+{
+    simulatedTime = 100000;
+    enableOnly({ TASK_SERIAL, TASK_BATTERY }, simulatedTime);
+
+    EXPECT_TRUE(runUntil(100000 + TASK_PERIOD_HZ(100)).empty());
+
+    // SERIAL becomes due first
+    std::vector<cfTaskId_e> executed = runUntil(100000 + TASK_PERIOD_HZ(100) + 1);
+    ASSERT_EQ(1U, executed.size());
+    EXPECT_EQ(TASK_SERIAL, executed[0]);
+}
+
+TEST(SchedulerUnittest, TestTasksRunInDueOrder)
+{
+    // All tasks share a priority, so only the heap decides which one becomes ready first
+    simulatedTime = 200000;
+    enableOnly({ TASK_SERIAL, TASK_TEMPERATURE }, 0);
+    setLastExecutedAt(TASK_SERIAL, simulatedTime);
+    setLastExecutedAt(TASK_TEMPERATURE, simulatedTime - 3000);
+
+    // TEMPERATURE is due at +7ms, +17ms, SERIAL at +10ms, +20ms
+    std::vector<cfTaskId_e> executed = runUntil(200000 + 25000);
+    const std::vector<cfTaskId_e> expected = { TASK_TEMPERATURE, TASK_SERIAL, TASK_TEMPERATURE, TASK_SERIAL };
+    EXPECT_EQ(expected, executed);
+}
+
+TEST(SchedulerUnittest, TestManyTasksLeaveHeapInDueOrder)
+{
+    // Stagger the tasks so they become due one by one, in a different order than they were added
+    const cfTaskId_e taskIds[] = { TASK_SYSTEM, TASK_SERIAL, TASK_BATTERY, TASK_TEMPERATURE, TASK_GPS };
+    const timeDelta_t offsets[] = { 4000, 500, 3000, 1500, 2500 };
+
+    simulatedTime = 300000;
+    enableOnly({ TASK_SYSTEM, TASK_SERIAL, TASK_BATTERY, TASK_TEMPERATURE, TASK_GPS }, 0);
+    for (int i = 0; i < 5; i++) {
+        setLastExecutedAt(taskIds[i], simulatedTime + offsets[i] - cfTasks[taskIds[i]].desiredPeriod);
+    }
+
+    std::vector<cfTaskId_e> executed = runUntil(300000 + 5000);
+    const std::vector<cfTaskId_e> expected = { TASK_SERIAL, TASK_TEMPERATURE, TASK_GPS, TASK_BATTERY, TASK_SYSTEM };
+    EXPECT_EQ(expected, executed);
+}
+
+TEST(SchedulerUnittest, TestHigherPriorityWinsWhenBothDue)
+{
+    simulatedTime = 400000;
+    enableOnly({ TASK_SERIAL, TASK_BATTERY }, 0);
+    // Both overdue by one period
+    setLastExecutedAt(TASK_SERIAL, simulatedTime - TASK_PERIOD_HZ(100));
+    setLastExecutedAt(TASK_BATTERY, simulatedTime - TASK_PERIOD_HZ(50));
+
+    scheduler();
+    scheduler();
+    const std::vector<cfTaskId_e> expected = { TASK_BATTERY, TASK_SERIAL };
+    EXPECT_EQ(expected, executedTasks);
+}
+
+TEST(SchedulerUnittest, TestTiesGoToQueueOrder)
+{
+    // Same static priority and age, the task added first wins the tie
+    simulatedTime = 500000;
+    enableOnly({ TASK_TEMPERATURE, TASK_SERIAL }, simulatedTime - TASK_PERIOD_HZ(100));
+
+    scheduler();
+    scheduler();
+    std::vector<cfTaskId_e> expected = { TASK_TEMPERATURE, TASK_SERIAL };
+    EXPECT_EQ(expected, executedTasks);
+
+    enableOnly({ TASK_SERIAL, TASK_TEMPERATURE }, simulatedTime - TASK_PERIOD_HZ(100));
+
+    scheduler();
+    scheduler();
+    expected = { TASK_SERIAL, TASK_TEMPERATURE };
+    EXPECT_EQ(expected, executedTasks);
+}
+
+TEST(SchedulerUnittest, TestRealtimeTaskRunsFirst)
+{
+    simulatedTime = 600000;
+    enableOnly({ TASK_SERIAL, TASK_PID }, simulatedTime - 50000);
+
+    scheduler();
+    ASSERT_EQ(1U, executedTasks.size());
+    EXPECT_EQ(TASK_PID, executedTasks[0]);
+}
+
+TEST(SchedulerUnittest, TestEventTaskRunsWhenSignalled)
+{
+    simulatedTime = 700000;
+    enableOnly({ TASK_RX }, simulatedTime);
+
+    EXPECT_TRUE(runUntil(700000 + 1000).empty());
+
+    rxSignalled = true;
+    scheduler();
+    rxSignalled = false;
+    ASSERT_EQ(1U, executedTasks.size());
+    EXPECT_EQ(TASK_RX, executedTasks[0]);
+
+    EXPECT_TRUE(runUntil(simulatedTime + 1000).empty());
+}
+
+TEST(SchedulerUnittest, TestRemoveAndReAddWaitingTask)
+{
+    simulatedTime = 800000;
+    enableOnly({ TASK_SERIAL, TASK_BATTERY, TASK_TEMPERATURE }, simulatedTime);
+
+    // Removed from the middle of the heap, the others still run
+    setTaskEnabled(TASK_BATTERY, false);
+    std::vector<cfTaskId_e> executed = runUntil(800000 + 15000);
+    for (const cfTaskId_e taskId : executed) {
+        EXPECT_NE(TASK_BATTERY, taskId);
+    }
+    EXPECT_EQ(2U, executed.size());
+
+    // Added back, it is due one period after its last execution
+    setTaskEnabled(TASK_BATTERY, true);
+    executed = runUntil(800000 + 21000);
+    ASSERT_EQ(3U, executed.size());
+    EXPECT_EQ(TASK_BATTERY, executed[0]);
+
+    // Removing twice and adding twice keeps one entry
+    setTaskEnabled(TASK_BATTERY, false);
+    setTaskEnabled(TASK_BATTERY, false);
+    setTaskEnabled(TASK_BATTERY, true);
+    setTaskEnabled(TASK_BATTERY, true);
+    EXPECT_EQ(3, queueSize());
+    executed = runUntil(800000 + 41000);
+    int batteryRuns = 0;
+    for (const cfTaskId_e taskId : executed) {
+        batteryRuns += taskId == TASK_BATTERY;
+    }
+    EXPECT_EQ(1, batteryRuns);
+}
+
+TEST(SchedulerUnittest, TestRemoveReadyTask)
+{
+    simulatedTime = 900000;
+    enableOnly({ TASK_SERIAL, TASK_TEMPERATURE }, simulatedTime - TASK_PERIOD_HZ(100));
+
+    // Both are ready after this run, TEMPERATURE is removed while waiting in the ready list
+    scheduler();
+    ASSERT_EQ(1U, executedTasks.size());
+    EXPECT_EQ(TASK_SERIAL, executedTasks[0]);
+
+    setTaskEnabled(TASK_TEMPERATURE, false);
+    EXPECT_TRUE(runUntil(simulatedTime + 5000).empty());
+
+    setTaskEnabled(TASK_TEMPERATURE, true);
+    scheduler();
+    ASSERT_EQ(1U, executedTasks.size());
+    EXPECT_EQ(TASK_TEMPERATURE, executedTasks[0]);
+}
+
+TEST(SchedulerUnittest, TestRescheduleWaitingTask)
+{
+    simulatedTime = 1000000;
+    enableOnly({ TASK_SERIAL, TASK_BATTERY }, simulatedTime);
+
+    // BATTERY was due after SERIAL, a shorter period moves it to the top of the heap. At +10ms both
+    // are due and BATTERY wins on priority.
+    rescheduleTask(TASK_BATTERY, 5000);
+    std::vector<cfTaskId_e> executed = runUntil(1000000 + 10100);
+    const std::vector<cfTaskId_e> expected = { TASK_BATTERY, TASK_BATTERY, TASK_SERIAL };
+    EXPECT_EQ(expected, executed);
+
+    rescheduleTask(TASK_BATTERY, TASK_PERIOD_HZ(50));
+}
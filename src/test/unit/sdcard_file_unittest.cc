@@ -0,0 +1,236 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+extern "C" {
+    #include "platform.h"
+    #include "common/maths.h"
+    #include "drivers/time.h"
+    #include "drivers/sdcard/sdcard.h"
+    #include "drivers/sdcard/sdcard_file.h"
+    #include "drivers/sdcard/sdcard_impl.h"
+    #include "io/asyncfatfs/asyncfatfs.h"
+
+    extern sdcardVTable_t sdcardFileVTable;
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define POLL_STEP_US        50
+#define POLL_TIMEOUT_US     (30 * 1000 * 1000)
+
+static timeUs_t fakeTimeUs;
+static char imagePath[] = "/tmp/inav_sdcard_XXXXXX";
+
+static afatfsFilePtr_t openedFile;
+
+static void fileOpened(afatfsFilePtr_t file)
+{
+    openedFile = file;
+}
+
+// Poll the filesystem on the emulated clock until `done` returns true
+static bool pollUntil(bool (*done)(void))
+{
+    for (timeUs_t start = fakeTimeUs; fakeTimeUs - start < POLL_TIMEOUT_US; fakeTimeUs += POLL_STEP_US) {
+        afatfs_poll();
+        if (done()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool filesystemReady(void)
+{
+    return afatfs_getFilesystemState() == AFATFS_FILESYSTEM_STATE_READY;
+}
+
+static bool fileOpen(void)
+{
+    return openedFile != NULL;
+}
+
+// The file is busy while the cursor moves on to the next cluster
+static bool fileIdle(void)
+{
+    uint32_t position;
+    return afatfs_ftell(openedFile, &position);
+}
+
+static bool flushed(void)
+{
+    return afatfs_flush();
+}
+
+static bool destroyed(void)
+{
+    return afatfs_destroy(false);
+}
+
+static void mountCard(void)
+{
+    sdcard_init();
+    afatfs_init();
+    ASSERT_TRUE(pollUntil(filesystemReady));
+}
+
+static uint8_t testByte(uint32_t position)
+{
+    return position * 7 + position / 512;
+}
+
+class SdcardFileTest : public ::testing::Test {
+protected:
+    static void SetUpTestCase() {
+        const int fd = mkstemp(imagePath);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        ASSERT_TRUE(sdcardFileSetPath(imagePath));
+    }
+
+    static void TearDownTestCase() {
+        unlink(imagePath);
+    }
+
+    virtual void SetUp() {
+        mountCard();
+    }
+
+    virtual void TearDown() {
+        EXPECT_TRUE(pollUntil(destroyed));
+    }
+};
+
+TEST_F(SdcardFileTest, FormatsNewImage)
+{
+    struct stat st;
+
+    ASSERT_EQ(0, stat(imagePath, &st));
+    EXPECT_EQ(1024 * 1024 * 1024, st.st_size);
+    EXPECT_EQ(st.st_size / 512, sdcard_getMetadata()->numBlocks);
+    EXPECT_GT(afatfs_getContiguousFreeSpace(), 1000U * 1024 * 1024);
+}
+
+TEST_F(SdcardFileTest, FileSurvivesRemount)
+{
+    const uint32_t fileSize = 3 * 1024 * 1024;
+    uint8_t buffer[512];
+
+    // Log like blackbox does, in append mode with freefile preallocation
+    openedFile = NULL;
+    ASSERT_TRUE(afatfs_fopen("LOG00001.TXT", "as", fileOpened));
+    ASSERT_TRUE(pollUntil(fileOpen));
+
+    const timeUs_t writeStartUs = fakeTimeUs;
+    for (uint32_t written = 0; written < fileSize; ) {
+        const uint32_t length = MIN(sizeof(buffer), fileSize - written);
+        for (uint32_t i = 0; i < length; i++) {
+            buffer[i] = testByte(written + i);
+        }
+        written += afatfs_fwrite(openedFile, buffer, length);
+        afatfs_poll();
+        fakeTimeUs += POLL_STEP_US;
+        ASSERT_LT(fakeTimeUs - writeStartUs, (timeUs_t)POLL_TIMEOUT_US);
+    }
+    ASSERT_TRUE(pollUntil(flushed));
+
+    // Multi-block writes into a pre-erased file are far faster than the 700us a single block takes
+    const float kiBPerSecond = fileSize / 1024.0f / ((fakeTimeUs - writeStartUs) * 1e-6f);
+    EXPECT_GT(kiBPerSecond, 1000.0f);
+    printf("Emulated write speed %.0f KiB/s\n", kiBPerSecond);
+
+    afatfs_fclose(openedFile, NULL);
+    ASSERT_TRUE(pollUntil(destroyed));
+
+    mountCard();
+
+    openedFile = NULL;
+    ASSERT_TRUE(afatfs_fopen("LOG00001.TXT", "r", fileOpened));
+    ASSERT_TRUE(pollUntil(fileOpen));
+    EXPECT_EQ(fileSize, afatfs_fileSize(openedFile));
+
+    for (uint32_t position = 0; position < fileSize; ) {
+        const uint32_t length = afatfs_fread(openedFile, buffer, sizeof(buffer));
+        for (uint32_t i = 0; i < length; i++) {
+            ASSERT_EQ(testByte(position + i), buffer[i]) << "at " << position + i;
+        }
+        position += length;
+        afatfs_poll();
+        fakeTimeUs += POLL_STEP_US;
+    }
+    ASSERT_TRUE(pollUntil(fileIdle));
+    EXPECT_TRUE(afatfs_feof(openedFile));
+
+    afatfs_fclose(openedFile, NULL);
+}
+
+// STUBS
+
+extern "C" {
+
+timeUs_t micros(void)
+{
+    return fakeTimeUs;
+}
+
+bool rtcGetDateTimeLocal(dateTime_t *dt)
+{
+    UNUSED(dt);
+    return false;
+}
+
+sdcard_t sdcard;
+
+void sdcard_init(void)
+{
+    sdcardFileVTable.init();
+}
+
+bool sdcard_readBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    return sdcardFileVTable.readBlock(blockIndex, buffer, callback, callbackData);
+}
+
+sdcardOperationStatus_e sdcard_beginWriteBlocks(uint32_t blockIndex, uint32_t blockCount)
+{
+    return sdcardFileVTable.beginWriteBlocks(blockIndex, blockCount);
+}
+
+sdcardOperationStatus_e sdcard_writeBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    return sdcardFileVTable.writeBlock(blockIndex, buffer, callback, callbackData);
+}
+
+bool sdcard_poll(void)
+{
+    return sdcardFileVTable.poll();
+}
+
+const sdcardMetadata_t* sdcard_getMetadata(void)
+{
+    return sdcardFileVTable.getMetadata();
+}
+
+}
@@ -0,0 +1,106 @@
+/*
+ * This file is part of INAV Project.
+ *
+ * INAV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * INAV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with INAV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <math.h>
+
+extern "C" {
+    #include "platform.h"
+    #include "common/maths.h"
+    #include "common/sdft.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define WINDOW_SIZE     64
+#define SAMPLE_RATE_HZ  500.0f
+
+static float testSignal(int sample, float frequencyHz)
+{
+    return 20.0f * sinf(2.0f * M_PIf * frequencyHz * sample / SAMPLE_RATE_HZ) + 3.0f;
+}
+
+// Hann windowed DFT magnitude of the last WINDOW_SIZE samples, oldest first
+static float referenceMagnitude(const float *window, int bin)
+{
+    double re = 0;
+    double im = 0;
+
+    for (int m = 0; m < WINDOW_SIZE; m++) {
+        const double hann = 0.5 - 0.5 * cos(2.0 * M_PI * m / WINDOW_SIZE);
+        re += hann * window[m] * cos(2.0 * M_PI * bin * m / WINDOW_SIZE);
+        im -= hann * window[m] * sin(2.0 * M_PI * bin * m / WINDOW_SIZE);
+    }
+
+    return sqrt(re * re + im * im);
+}
+
+TEST(SdftUnittest, MatchesWindowedDft)
+{
+    sdft_t sdft;
+    float window[WINDOW_SIZE];
+    float magnitude[WINDOW_SIZE / 2] = { 0 };
+
+    sdftInit(&sdft, WINDOW_SIZE, 2, WINDOW_SIZE / 2 - 1);
+
+    // Several windows worth of samples so the damping error has settled
+    const int sampleCount = WINDOW_SIZE * 5 + 13;
+    for (int i = 0; i < sampleCount; i++) {
+        sdftPush(&sdft, testSignal(i, 95.0f));
+    }
+    for (int m = 0; m < WINDOW_SIZE; m++) {
+        window[m] = testSignal(sampleCount - WINDOW_SIZE + m, 95.0f);
+    }
+
+    sdftWindowedMagnitude(&sdft, magnitude, 2, WINDOW_SIZE / 2 - 1);
+
+    for (int bin = 2; bin < WINDOW_SIZE / 2; bin++) {
+        // Damping attenuates bins by a fraction of a percent
+        const float expected = referenceMagnitude(window, bin);
+        EXPECT_NEAR(magnitude[bin], expected, 0.01f * expected + 0.05f);
+    }
+}
+
+TEST(SdftUnittest, FindsPeak)
+{
+    sdft_t sdft;
+    float magnitude[WINDOW_SIZE / 2] = { 0 };
+
+    sdftInit(&sdft, WINDOW_SIZE, 1, WINDOW_SIZE / 2 - 1);
+
+    // 125Hz is exactly bin 16 at 500Hz sampling and 64 samples window
+    for (int i = 0; i < WINDOW_SIZE * 2; i++) {
+        sdftPush(&sdft, testSignal(i, 125.0f));
+    }
+
+    sdftWindowedMagnitude(&sdft, magnitude, 1, WINDOW_SIZE / 2 - 1);
+
+    int peakBin = 0;
+    for (int bin = 1; bin < WINDOW_SIZE / 2; bin++) {
+        if (magnitude[bin] > magnitude[peakBin]) {
+            peakBin = bin;
+        }
+    }
+
+    EXPECT_EQ(peakBin, 16);
+    // Outside of the Hann main lobe the spectrum is (almost) empty
+    EXPECT_LT(magnitude[10], magnitude[16] * 0.01f);
+    EXPECT_LT(magnitude[22], magnitude[16] * 0.01f);
+}
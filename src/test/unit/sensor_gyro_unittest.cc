@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include <limits.h>
 #include <algorithm>
@@ -132,6 +133,77 @@ TEST(SensorGyro, Update)
     EXPECT_FLOAT_EQ(90 * gyroDev[0].scale, gyro.gyroADCf[Z]);
 }
 
+static int16_t fifoTestSamples[2][XYZ_AXIS_COUNT];
+
+static bool fakeGyroReadFifo(gyroDev_t *gyro)
+{
+    memcpy(gyro->fifoRaw, fifoTestSamples, sizeof(fifoTestSamples));
+    gyroFifoCompleteRead(gyro, 2);
+    return true;
+}
+
+TEST(SensorGyro, UpdateFifo)
+{
+    // Two single sample updates, as reference for a batch of two samples
+    gyroInit();
+    gyroStartCalibration();
+    fakeGyroSet(0, 0, 0);
+    while (!gyroIsCalibrationComplete()) {
+        gyroUpdate();
+    }
+    fakeGyroSet(100, 200, 300);
+    gyroUpdate();
+    fakeGyroSet(400, 500, 600);
+    gyroUpdate();
+    const float expected[XYZ_AXIS_COUNT] = { gyro.gyroADCf[X], gyro.gyroADCf[Y], gyro.gyroADCf[Z] };
+
+    gyroInit();
+    gyroStartCalibration();
+    fakeGyroSet(0, 0, 0);
+    while (!gyroIsCalibrationComplete()) {
+        gyroUpdate();
+    }
+    const int16_t samples[2][XYZ_AXIS_COUNT] = { { 100, 200, 300 }, { 400, 500, 600 } };
+    memcpy(fifoTestSamples, samples, sizeof(samples));
+    gyroDev[0].readFifoFn = fakeGyroReadFifo;
+    gyroUpdate();
+    gyroDev[0].readFifoFn = NULL;
+
+    // Newest sample is mirrored for calibration and blackbox
+    EXPECT_EQ(400, gyroDev[0].gyroADCRaw[X]);
+    EXPECT_EQ(600, gyroDev[0].gyroADCRaw[Z]);
+    EXPECT_FLOAT_EQ(400 * gyroDev[0].scale, gyro.gyroRaw[X]);
+
+    // Both samples passed the anti-aliasing filter
+    EXPECT_FLOAT_EQ(expected[X], gyro.gyroADCf[X]);
+    EXPECT_FLOAT_EQ(expected[Y], gyro.gyroADCf[Y]);
+    EXPECT_FLOAT_EQ(expected[Z], gyro.gyroADCf[Z]);
+}
+
+TEST(SensorGyro, FifoSampleRate)
+{
+    gyroDev_t dev = {};
+
+    // 8kHz sensor, 2 samples per 250us run
+    dev.requestedSampleIntervalUs = 250;
+    gyroSetFifoSampleRate(&dev, 8000);
+    EXPECT_EQ(125U, dev.fifoSampleIntervalUs);
+    EXPECT_EQ(250U, dev.sampleRateIntervalUs);
+
+    // 6.66kHz sensor, the task stays at 250us and drains 1 or 2 samples
+    gyroSetFifoSampleRate(&dev, 6664);
+    EXPECT_EQ(150U, dev.fifoSampleIntervalUs);
+    EXPECT_EQ(250U, dev.sampleRateIntervalUs);
+
+    // 3.2kHz sensor is slower than the requested interval
+    gyroSetFifoSampleRate(&dev, 3200);
+    EXPECT_EQ(312U, dev.sampleRateIntervalUs);
+
+    // Runs never need more than GYRO_FIFO_MAX_SAMPLES samples
+    dev.requestedSampleIntervalUs = 2000;
+    gyroSetFifoSampleRate(&dev, 8000);
+    EXPECT_EQ(125U * GYRO_FIFO_MAX_SAMPLES, dev.sampleRateIntervalUs);
+}
 
 // STUBS
 